@@ -0,0 +1,251 @@
+/*
+ * FreeRTOS V202203.00
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+
+#include "portableDefs.h"
+#include "FreeRTOS.h"
+
+#include "mock_portable.h"
+#include "mock_core_mqtt.h"
+
+/* Subscription manager include. */
+#include "mqtt_subscription_manager.h"
+
+#define TOPIC           "a/b"
+#define EXACT_FILTER    "a/b"
+#define PLUS_FILTER     "a/+"
+
+/*-----------------------------------------------------------*/
+
+/* Context of the publish callbacks. */
+typedef struct CallbackContext
+{
+    const char * pFilterToRemove;
+    uint32_t callCount;
+} CallbackContext_t;
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionList_t subscriptionList;
+static MQTTPublishInfo_t publishInfo;
+
+/*-----------------------------------------------------------*/
+
+static void * mallocStub( size_t size,
+                          int numCalls )
+{
+    ( void ) numCalls;
+
+    return malloc( size );
+}
+
+static void freeStub( void * pBuffer,
+                      int numCalls )
+{
+    ( void ) numCalls;
+
+    free( pBuffer );
+}
+
+/* The trie only finds filters matching the topic, so confirm every one. */
+static MQTTStatus_t matchTopicStub( const char * pTopicName,
+                                    const uint16_t topicNameLength,
+                                    const char * pTopicFilter,
+                                    const uint16_t topicFilterLength,
+                                    bool * pIsMatch,
+                                    int numCalls )
+{
+    ( void ) pTopicName;
+    ( void ) topicNameLength;
+    ( void ) pTopicFilter;
+    ( void ) topicFilterLength;
+    ( void ) numCalls;
+
+    *pIsMatch = true;
+
+    return MQTTSuccess;
+}
+
+/* Confirms the first filter, then fails without writing pIsMatch. */
+static MQTTStatus_t matchTopicFailingStub( const char * pTopicName,
+                                           const uint16_t topicNameLength,
+                                           const char * pTopicFilter,
+                                           const uint16_t topicFilterLength,
+                                           bool * pIsMatch,
+                                           int numCalls )
+{
+    MQTTStatus_t status = MQTTBadParameter;
+
+    ( void ) pTopicName;
+    ( void ) topicNameLength;
+    ( void ) pTopicFilter;
+    ( void ) topicFilterLength;
+
+    if( numCalls == 0 )
+    {
+        *pIsMatch = true;
+        status = MQTTSuccess;
+    }
+
+    return status;
+}
+
+/* Counts its calls, and removes a topic filter if the context names one. */
+static void publishCallback( void * pContext,
+                             MQTTPublishInfo_t * pPublishInfo )
+{
+    CallbackContext_t * pCallbackContext = ( CallbackContext_t * ) pContext;
+
+    ( void ) pPublishInfo;
+    pCallbackContext->callCount++;
+
+    if( pCallbackContext->pFilterToRemove != NULL )
+    {
+        SubscriptionManager_RemoveSubscription( &subscriptionList,
+                                                pCallbackContext->pFilterToRemove,
+                                                ( uint16_t ) strlen( pCallbackContext->pFilterToRemove ) );
+    }
+}
+
+/* Adds a subscription. */
+static void subscribe( const char * pFilter,
+                       CallbackContext_t * pContext )
+{
+    TEST_ASSERT_TRUE( SubscriptionManager_AddSubscription( &subscriptionList,
+                                                           pFilter,
+                                                           ( uint16_t ) strlen( pFilter ),
+                                                           publishCallback,
+                                                           pContext ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( &subscriptionList, 0, sizeof( subscriptionList ) );
+    ( void ) memset( &publishInfo, 0, sizeof( publishInfo ) );
+    publishInfo.pTopicName = TOPIC;
+    publishInfo.topicNameLength = ( uint16_t ) strlen( TOPIC );
+
+    pvPortMalloc_Stub( mallocStub );
+    vPortFree_Stub( freeStub );
+    MQTT_MatchTopic_Stub( matchTopicStub );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that a callback can unsubscribe the filter being dispatched
+ * from the exact-match table, and that the removed subscriptions are not
+ * invoked and are released once the dispatch returns.
+ */
+void test_SubscriptionManager_Unsubscribe_From_Callback_Exact( void )
+{
+    CallbackContext_t removed = { NULL, 0U };
+    CallbackContext_t removing = { EXACT_FILTER, 0U };
+
+    /* The most recent subscription of a filter is invoked first. */
+    subscribe( EXACT_FILTER, &removed );
+    subscribe( EXACT_FILTER, &removing );
+
+    TEST_ASSERT_TRUE( SubscriptionManager_HandleIncomingPublishes( &subscriptionList, &publishInfo ) );
+    TEST_ASSERT_EQUAL_UINT32( 1U, removing.callCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, removed.callCount );
+    TEST_ASSERT_NULL( subscriptionList.pxSubscriptions );
+    TEST_ASSERT_EQUAL_UINT32( 0U, subscriptionList.ulExactCount );
+
+    TEST_ASSERT_FALSE( SubscriptionManager_HandleIncomingPublishes( &subscriptionList, &publishInfo ) );
+
+    /* The released elements can be reused. */
+    removing.pFilterToRemove = NULL;
+    subscribe( EXACT_FILTER, &removing );
+    TEST_ASSERT_TRUE( SubscriptionManager_HandleIncomingPublishes( &subscriptionList, &publishInfo ) );
+    TEST_ASSERT_EQUAL_UINT32( 2U, removing.callCount );
+}
+
+/**
+ * @brief Test that a callback can unsubscribe the wildcard filter being
+ * dispatched, and that its trie nodes are released once the dispatch returns.
+ */
+void test_SubscriptionManager_Unsubscribe_From_Callback_Wildcard( void )
+{
+    CallbackContext_t removed = { NULL, 0U };
+    CallbackContext_t removing = { PLUS_FILTER, 0U };
+    CallbackContext_t exact = { NULL, 0U };
+
+    subscribe( EXACT_FILTER, &exact );
+    subscribe( PLUS_FILTER, &removed );
+    subscribe( PLUS_FILTER, &removing );
+
+    TEST_ASSERT_TRUE( SubscriptionManager_HandleIncomingPublishes( &subscriptionList, &publishInfo ) );
+    TEST_ASSERT_EQUAL_UINT32( 1U, exact.callCount );
+    TEST_ASSERT_EQUAL_UINT32( 1U, removing.callCount );
+    TEST_ASSERT_EQUAL_UINT32( 0U, removed.callCount );
+
+    TEST_ASSERT_EQUAL_UINT32( 0U, subscriptionList.xTrieRoot.ulRefCount );
+    TEST_ASSERT_NULL( subscriptionList.xTrieRoot.pxFirstChild );
+    TEST_ASSERT_EQUAL_PTR( &exact, subscriptionList.pxSubscriptions->pvIncomingPublishCallbackContext );
+    TEST_ASSERT_NULL( subscriptionList.pxSubscriptions->pxNextInList );
+}
+
+/**
+ * @brief Test that a subscription is not invoked when the topic match cannot
+ * be confirmed, even after an earlier subscription of the same trie node matched.
+ */
+void test_SubscriptionManager_Match_Failure_Not_Invoked( void )
+{
+    CallbackContext_t first = { NULL, 0U };
+    CallbackContext_t second = { NULL, 0U };
+
+    subscribe( PLUS_FILTER, &first );
+    subscribe( PLUS_FILTER, &second );
+
+    MQTT_MatchTopic_Stub( matchTopicFailingStub );
+
+    TEST_ASSERT_TRUE( SubscriptionManager_HandleIncomingPublishes( &subscriptionList, &publishInfo ) );
+    TEST_ASSERT_EQUAL_UINT32( 1U, first.callCount + second.callCount );
+}
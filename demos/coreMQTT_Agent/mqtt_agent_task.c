@@ -428,15 +428,15 @@ static MQTTAgentMessageContext_t xCommandQueue;
 static struct DemoParams taskParameters[ democonfigNUM_SIMPLE_SUB_PUB_TASKS_TO_CREATE ];
 
 /**
- * @brief The global array of subscription elements.
+ * @brief The global list of subscriptions.
  *
- * @note No thread safety is required to this array, since updates to the array
- * elements are done only from the MQTT agent task. The subscription manager
- * implementation expects that the array of the subscription elements used for
- * storing subscriptions to be initialized to 0. As this is a global array, it
- * will be initialized to 0 by default.
+ * @note No thread safety is required to this list, since updates to the list
+ * are done only from the MQTT agent task. The subscription manager
+ * implementation expects that the list used for storing subscriptions to be
+ * initialized to 0. As this is a global variable, it will be initialized to 0
+ * by default.
  */
-SubscriptionElement_t xGlobalSubscriptionList[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
+SubscriptionList_t xGlobalSubscriptionList;
 
 /*-----------------------------------------------------------*/
 
@@ -522,8 +522,8 @@ static MQTTStatus_t prvMQTTAgentInit( void )
                               &xTransport,
                               prvGetTimeMs,
                               prvIncomingPublishCallback,
-                              /* Context to pass into the callback. Passing the pointer to subscription array. */
-                              xGlobalSubscriptionList );
+                              /* Context to pass into the callback. Passing the pointer to subscription list. */
+                              &xGlobalSubscriptionList );
 
     return xReturn;
 }
@@ -611,56 +611,78 @@ static MQTTStatus_t prvMQTTConnect( bool xCleanSession )
 static MQTTStatus_t prvHandleResubscribe( void )
 {
     MQTTStatus_t xResult = MQTTBadParameter;
-    uint32_t ulIndex = 0U;
+    const SubscriptionElement_t * pxSubscription = NULL;
+    MQTTSubscribeInfo_t * pxSubInfo = NULL;
     uint16_t usNumSubscriptions = 0U;
 
-    /* These variables need to stay in scope until command completes. */
+    /* These variables need to stay in scope until command completes. The
+     * subscribe info array is freed by prvSubscriptionCommandCallback(). */
     static MQTTAgentSubscribeArgs_t xSubArgs = { 0 };
-    static MQTTSubscribeInfo_t xSubInfo[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
     static MQTTAgentCommandInfo_t xCommandParams = { 0 };
 
-    memset( &( xSubInfo[ 0 ] ), 0, SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS * sizeof( MQTTSubscribeInfo_t ) );
+    /* The subscription list has no fixed size, so count it first. */
+    for( pxSubscription = xGlobalSubscriptionList.pxSubscriptions;
+         pxSubscription != NULL;
+         pxSubscription = pxSubscription->pxNextInList )
+    {
+        usNumSubscriptions++;
+    }
 
-    /* Loop through each subscription in the subscription list and add a subscribe
-     * command to the command queue. */
-    for( ulIndex = 0U; ulIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; ulIndex++ )
+    if( usNumSubscriptions == 0U )
+    {
+        /* Mark the resubscribe as success if there is nothing to be subscribed. */
+        xResult = MQTTSuccess;
+    }
+    else
     {
-        /* Check if there is a subscription in the subscription list. This demo
-         * doesn't check for duplicate subscriptions. */
-        if( xGlobalSubscriptionList[ ulIndex ].usFilterStringLength != 0 )
+        pxSubInfo = ( MQTTSubscribeInfo_t * ) pvPortMalloc( usNumSubscriptions * sizeof( MQTTSubscribeInfo_t ) );
+
+        if( pxSubInfo == NULL )
+        {
+            xResult = MQTTNoMemory;
+        }
+        else
         {
-            xSubInfo[ usNumSubscriptions ].pTopicFilter = xGlobalSubscriptionList[ ulIndex ].pcSubscriptionFilterString;
-            xSubInfo[ usNumSubscriptions ].topicFilterLength = xGlobalSubscriptionList[ ulIndex ].usFilterStringLength;
+            memset( pxSubInfo, 0, usNumSubscriptions * sizeof( MQTTSubscribeInfo_t ) );
+            usNumSubscriptions = 0U;
+
+            /* Loop through each subscription in the subscription list and add it
+             * to the subscribe command. This demo doesn't check for duplicate
+             * subscriptions. */
+            for( pxSubscription = xGlobalSubscriptionList.pxSubscriptions;
+                 pxSubscription != NULL;
+                 pxSubscription = pxSubscription->pxNextInList )
+            {
+                pxSubInfo[ usNumSubscriptions ].pTopicFilter = pxSubscription->pcSubscriptionFilterString;
+                pxSubInfo[ usNumSubscriptions ].topicFilterLength = pxSubscription->usFilterStringLength;
 
-            /* QoS1 is used for all the subscriptions in this demo. */
-            xSubInfo[ usNumSubscriptions ].qos = MQTTQoS1;
+                /* QoS1 is used for all the subscriptions in this demo. */
+                pxSubInfo[ usNumSubscriptions ].qos = MQTTQoS1;
 
-            LogInfo( ( "Resubscribe to the topic %.*s will be attempted.",
-                       xSubInfo[ usNumSubscriptions ].topicFilterLength,
-                       xSubInfo[ usNumSubscriptions ].pTopicFilter ) );
+                LogInfo( ( "Resubscribe to the topic %.*s will be attempted.",
+                           pxSubInfo[ usNumSubscriptions ].topicFilterLength,
+                           pxSubInfo[ usNumSubscriptions ].pTopicFilter ) );
 
-            usNumSubscriptions++;
-        }
-    }
+                usNumSubscriptions++;
+            }
 
-    if( usNumSubscriptions > 0U )
-    {
-        xSubArgs.pSubscribeInfo = xSubInfo;
-        xSubArgs.numSubscriptions = usNumSubscriptions;
+            xSubArgs.pSubscribeInfo = pxSubInfo;
+            xSubArgs.numSubscriptions = usNumSubscriptions;
 
-        /* The block time can be 0 as the command loop is not running at this point. */
-        xCommandParams.blockTimeMs = 0U;
-        xCommandParams.cmdCompleteCallback = prvSubscriptionCommandCallback;
-        xCommandParams.pCmdCompleteCallbackContext = ( void * ) &xSubArgs;
+            /* The block time can be 0 as the command loop is not running at this point. */
+            xCommandParams.blockTimeMs = 0U;
+            xCommandParams.cmdCompleteCallback = prvSubscriptionCommandCallback;
+            xCommandParams.pCmdCompleteCallbackContext = ( void * ) &xSubArgs;
 
-        /* Enqueue subscribe to the command queue. These commands will be processed only
-         * when command loop starts. */
-        xResult = MQTTAgent_Subscribe( &xGlobalMqttAgentContext, &xSubArgs, &xCommandParams );
-    }
-    else
-    {
-        /* Mark the resubscribe as success if there is nothing to be subscribed. */
-        xResult = MQTTSuccess;
+            /* Enqueue subscribe to the command queue. These commands will be processed only
+             * when command loop starts. */
+            xResult = MQTTAgent_Subscribe( &xGlobalMqttAgentContext, &xSubArgs, &xCommandParams );
+
+            if( xResult != MQTTSuccess )
+            {
+                vPortFree( pxSubInfo );
+            }
+        }
     }
 
     if( xResult != MQTTSuccess )
@@ -695,12 +717,16 @@ static void prvSubscriptionCommandCallback( MQTTAgentCommandContext_t * pxComman
                             pxSubscribeArgs->pSubscribeInfo[ lIndex ].topicFilterLength,
                             pxSubscribeArgs->pSubscribeInfo[ lIndex ].pTopicFilter ) );
                 /* Remove subscription callback for unsubscribe. */
-                removeSubscription( xGlobalSubscriptionList,
+                removeSubscription( &xGlobalSubscriptionList,
                                     pxSubscribeArgs->pSubscribeInfo[ lIndex ].pTopicFilter,
                                     pxSubscribeArgs->pSubscribeInfo[ lIndex ].topicFilterLength );
             }
         }
     }
+
+    /* The subscribe info array was allocated by prvHandleResubscribe(). */
+    vPortFree( pxSubscribeArgs->pSubscribeInfo );
+    pxSubscribeArgs->pSubscribeInfo = NULL;
 }
 
 /*-----------------------------------------------------------*/
@@ -854,7 +880,7 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pMqttAgentContext,
 
     /* Fan out the incoming publishes to the callbacks registered using
      * subscription manager. */
-    xPublishHandled = handleIncomingPublishes( ( SubscriptionElement_t * ) pMqttAgentContext->pIncomingCallbackContext,
+    xPublishHandled = handleIncomingPublishes( ( SubscriptionList_t * ) pMqttAgentContext->pIncomingCallbackContext,
                                                pxPublishInfo );
 
     /* If there are no callbacks to handle the incoming publishes,
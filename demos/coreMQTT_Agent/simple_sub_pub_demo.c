@@ -295,7 +295,7 @@ static void prvSubscribeCommandCallback( MQTTAgentCommandContext_t * pxCommandCo
     {
         /* Add subscription so that incoming publishes are routed to the application
          * callback. */
-        xSubscriptionAdded = addSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+        xSubscriptionAdded = addSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                               pxSubscribeArgs->pSubscribeInfo->pTopicFilter,
                                               pxSubscribeArgs->pSubscribeInfo->topicFilterLength,
                                               prvIncomingPublishCallback,
@@ -32,18 +32,743 @@
 /* Standard includes. */
 #include <string.h>
 
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
+/**
+ * @brief Character separating the levels of a topic name or filter.
+ */
+#define SUBSCRIPTION_MANAGER_LEVEL_SEPARATOR           ( '/' )
+
+/**
+ * @brief Topic filter character matching a single topic level.
+ */
+#define SUBSCRIPTION_MANAGER_SINGLE_LEVEL_WILDCARD     ( '+' )
+
+/**
+ * @brief Topic filter character matching any number of trailing topic levels.
+ */
+#define SUBSCRIPTION_MANAGER_MULTI_LEVEL_WILDCARD      ( '#' )
+
+/**
+ * @brief Topic names starting with this character are reserved for the
+ * broker and are not matched by filters starting with a wildcard.
+ */
+#define SUBSCRIPTION_MANAGER_RESERVED_TOPIC_PREFIX     ( '$' )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compute the FNV-1a hash of a string.
+ *
+ * @param[in] pcString Start of the string.
+ * @param[in] usLength Length of the string.
+ *
+ * @return Hash of the string.
+ */
+static uint32_t prvHashString( const char * pcString,
+                               uint16_t usLength );
+
+/**
+ * @brief Compute the length of the topic level starting at ulLevelStart.
+ *
+ * @param[in] pcString Topic name or topic filter.
+ * @param[in] usStringLength Length of pcString.
+ * @param[in] ulLevelStart Offset of the first character of the level.
+ *
+ * @return Number of characters up to the next separator or the end of the string.
+ */
+static uint16_t prvLevelLength( const char * pcString,
+                                uint16_t usStringLength,
+                                uint32_t ulLevelStart );
+
+/**
+ * @brief Check whether a topic filter contains a wildcard character.
+ *
+ * @param[in] pcTopicFilterString Topic filter.
+ * @param[in] usTopicFilterLength Length of topic filter.
+ *
+ * @return `true` if the topic filter belongs in the trie, `false` if it
+ * belongs in the exact-match table.
+ */
+static bool prvIsWildcardFilter( const char * pcTopicFilterString,
+                                 uint16_t usTopicFilterLength );
+
+/**
+ * @brief Take a subscription element from the pool, growing the pool if it
+ * has no free element.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ *
+ * @return A zeroed subscription element, or NULL if out of memory.
+ */
+static SubscriptionElement_t * prvAllocateSubscription( SubscriptionList_t * pxSubscriptionList );
+
+/**
+ * @brief Unlink a subscription element from the list of every subscription
+ * and return it to the pool.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ * @param[in] pxSubscription The subscription element.
+ */
+static void prvReleaseSubscription( SubscriptionList_t * pxSubscriptionList,
+                                    SubscriptionElement_t * pxSubscription );
+
+/**
+ * @brief Unlink a subscription element from its table bucket or trie node
+ * and release it.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ * @param[in] ppxLink The link to the subscription element in its bucket or
+ * on its trie node.
+ */
+static void prvRemoveSubscription( SubscriptionList_t * pxSubscriptionList,
+                                   SubscriptionElement_t ** ppxLink );
+
+/**
+ * @brief Release the subscriptions removed while a publish was dispatched.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ */
+static void prvReleaseRemovedSubscriptions( SubscriptionList_t * pxSubscriptionList );
+
+/**
+ * @brief Take a trie node from the pool, growing the pool if it has no free
+ * node.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ *
+ * @return A zeroed trie node, or NULL if out of memory.
+ */
+static SubscriptionTrieNode_t * prvAllocateTrieNode( SubscriptionList_t * pxSubscriptionList );
 
-bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
+/**
+ * @brief Double the number of buckets of the exact-match table, or create
+ * the table if the list has none yet.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ *
+ * @return `true` if the table was resized, `false` if out of memory.
+ */
+static bool prvGrowBuckets( SubscriptionList_t * pxSubscriptionList );
+
+/**
+ * @brief Find the non-wildcard child of a trie node for a topic level.
+ *
+ * @param[in] pxParent Parent node.
+ * @param[in] ulLevelHash Hash of the topic level.
+ * @param[in] usLevelLength Length of the topic level.
+ *
+ * @return The child node, or NULL if there is none.
+ */
+static SubscriptionTrieNode_t * prvFindExactChild( const SubscriptionTrieNode_t * pxParent,
+                                                   uint32_t ulLevelHash,
+                                                   uint16_t usLevelLength );
+
+/**
+ * @brief Walk the trie along the levels of a topic filter.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ * @param[in] pcTopicFilterString Topic filter.
+ * @param[in] usTopicFilterLength Length of topic filter.
+ * @param[in] xCreate Whether to create the nodes missing along the path.
+ *
+ * @return The node of the last level of the topic filter, or NULL if it does
+ * not exist and could not be created.
+ */
+static SubscriptionTrieNode_t * prvFindFilterNode( SubscriptionList_t * pxSubscriptionList,
+                                                   const char * pcTopicFilterString,
+                                                   uint16_t usTopicFilterLength,
+                                                   bool xCreate );
+
+/**
+ * @brief Return the unused nodes from pxNode up towards the root to the pool.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ * @param[in] pxNode The deepest node to consider.
+ */
+static void prvPruneNodes( SubscriptionList_t * pxSubscriptionList,
+                           SubscriptionTrieNode_t * pxNode );
+
+/**
+ * @brief Invoke the callbacks of the subscriptions in the exact-match table
+ * whose topic filter is the topic of the publish.
+ *
+ * @param[in] pxSubscriptionList The subscription list.
+ * @param[in] pxPublishInfo Info of incoming publish.
+ * @param[in,out] pxPublishHandled Set to `true` if a callback was invoked.
+ */
+static void prvDispatchExact( const SubscriptionList_t * pxSubscriptionList,
+                              MQTTPublishInfo_t * pxPublishInfo,
+                              bool * pxPublishHandled );
+
+/**
+ * @brief Invoke the callbacks of the subscriptions attached to a trie node
+ * whose topic filter matches the topic of the publish.
+ *
+ * @param[in] pxNode The trie node.
+ * @param[in] pxPublishInfo Info of incoming publish.
+ * @param[in,out] pxPublishHandled Set to `true` if a callback was invoked.
+ */
+static void prvInvokeSubscriptions( const SubscriptionTrieNode_t * pxNode,
+                                    MQTTPublishInfo_t * pxPublishInfo,
+                                    bool * pxPublishHandled );
+
+/**
+ * @brief Dispatch a publish to every subscription below pxNode that matches
+ * the topic levels starting at ulLevelStart.
+ *
+ * @param[in] pxNode Trie node reached by the preceding topic levels.
+ * @param[in] pxPublishInfo Info of incoming publish.
+ * @param[in] ulLevelStart Offset of the next topic level in the topic name.
+ * @param[in,out] pxPublishHandled Set to `true` if a callback was invoked.
+ */
+static void prvDispatchFromNode( const SubscriptionTrieNode_t * pxNode,
+                                 MQTTPublishInfo_t * pxPublishInfo,
+                                 uint32_t ulLevelStart,
+                                 bool * pxPublishHandled );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHashString( const char * pcString,
+                               uint16_t usLength )
+{
+    uint32_t ulHash = 2166136261UL;
+    uint16_t usIndex;
+
+    for( usIndex = 0U; usIndex < usLength; usIndex++ )
+    {
+        ulHash ^= ( uint8_t ) pcString[ usIndex ];
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvLevelLength( const char * pcString,
+                                uint16_t usStringLength,
+                                uint32_t ulLevelStart )
+{
+    uint32_t ulIndex = ulLevelStart;
+
+    while( ( ulIndex < usStringLength ) &&
+           ( pcString[ ulIndex ] != SUBSCRIPTION_MANAGER_LEVEL_SEPARATOR ) )
+    {
+        ulIndex++;
+    }
+
+    return ( uint16_t ) ( ulIndex - ulLevelStart );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsWildcardFilter( const char * pcTopicFilterString,
+                                 uint16_t usTopicFilterLength )
+{
+    uint16_t usIndex;
+    bool xIsWildcard = false;
+
+    for( usIndex = 0U; ( usIndex < usTopicFilterLength ) && ( xIsWildcard == false ); usIndex++ )
+    {
+        xIsWildcard = ( ( pcTopicFilterString[ usIndex ] == SUBSCRIPTION_MANAGER_SINGLE_LEVEL_WILDCARD ) ||
+                        ( pcTopicFilterString[ usIndex ] == SUBSCRIPTION_MANAGER_MULTI_LEVEL_WILDCARD ) );
+    }
+
+    return xIsWildcard;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionElement_t * prvAllocateSubscription( SubscriptionList_t * pxSubscriptionList )
+{
+    SubscriptionElement_t * pxBlock = NULL;
+    SubscriptionElement_t * pxSubscription = NULL;
+    size_t xIndex;
+
+    if( pxSubscriptionList->pxFreeSubscriptions == NULL )
+    {
+        pxBlock = ( SubscriptionElement_t * ) SUBSCRIPTION_MANAGER_MALLOC( SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH *
+                                                                           sizeof( SubscriptionElement_t ) );
+
+        if( pxBlock != NULL )
+        {
+            ( void ) memset( pxBlock, 0x00, SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH * sizeof( SubscriptionElement_t ) );
+
+            for( xIndex = 0U; xIndex < SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH; xIndex++ )
+            {
+                pxBlock[ xIndex ].pxNext = pxSubscriptionList->pxFreeSubscriptions;
+                pxSubscriptionList->pxFreeSubscriptions = &( pxBlock[ xIndex ] );
+            }
+        }
+        else
+        {
+            LogError( ( "Failed to grow the subscription pool." ) );
+        }
+    }
+
+    pxSubscription = pxSubscriptionList->pxFreeSubscriptions;
+
+    if( pxSubscription != NULL )
+    {
+        pxSubscriptionList->pxFreeSubscriptions = pxSubscription->pxNext;
+        pxSubscription->pxNext = NULL;
+    }
+
+    return pxSubscription;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseSubscription( SubscriptionList_t * pxSubscriptionList,
+                                    SubscriptionElement_t * pxSubscription )
+{
+    if( pxSubscription->pxPreviousInList != NULL )
+    {
+        pxSubscription->pxPreviousInList->pxNextInList = pxSubscription->pxNextInList;
+    }
+    else
+    {
+        pxSubscriptionList->pxSubscriptions = pxSubscription->pxNextInList;
+    }
+
+    if( pxSubscription->pxNextInList != NULL )
+    {
+        pxSubscription->pxNextInList->pxPreviousInList = pxSubscription->pxPreviousInList;
+    }
+
+    ( void ) memset( pxSubscription, 0x00, sizeof( SubscriptionElement_t ) );
+    pxSubscription->pxNext = pxSubscriptionList->pxFreeSubscriptions;
+    pxSubscriptionList->pxFreeSubscriptions = pxSubscription;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRemoveSubscription( SubscriptionList_t * pxSubscriptionList,
+                                   SubscriptionElement_t ** ppxLink )
+{
+    SubscriptionElement_t * pxSubscription = *ppxLink;
+    SubscriptionTrieNode_t * pxPathNode = NULL;
+
+    *ppxLink = pxSubscription->pxNext;
+
+    if( pxSubscription->pxNode != NULL )
+    {
+        for( pxPathNode = pxSubscription->pxNode; pxPathNode != NULL; pxPathNode = pxPathNode->pxParent )
+        {
+            pxPathNode->ulRefCount--;
+        }
+    }
+    else
+    {
+        pxSubscriptionList->ulExactCount--;
+    }
+
+    prvReleaseSubscription( pxSubscriptionList, pxSubscription );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseRemovedSubscriptions( SubscriptionList_t * pxSubscriptionList )
+{
+    SubscriptionElement_t * pxSubscription = pxSubscriptionList->pxSubscriptions;
+    SubscriptionElement_t * pxNextInList = NULL;
+    SubscriptionElement_t ** ppxLink = NULL;
+    SubscriptionTrieNode_t * pxNode = NULL;
+
+    while( pxSubscription != NULL )
+    {
+        pxNextInList = pxSubscription->pxNextInList;
+
+        if( pxSubscription->pxIncomingPublishCallback == NULL )
+        {
+            pxNode = pxSubscription->pxNode;
+            ppxLink = ( pxNode != NULL ) ?
+                      &( pxNode->pxSubscriptions ) :
+                      &( pxSubscriptionList->ppxBuckets[ pxSubscription->ulFilterHash & ( pxSubscriptionList->ulBucketCount - 1U ) ] );
+
+            while( *ppxLink != pxSubscription )
+            {
+                ppxLink = &( ( *ppxLink )->pxNext );
+            }
+
+            prvRemoveSubscription( pxSubscriptionList, ppxLink );
+
+            if( pxNode != NULL )
+            {
+                prvPruneNodes( pxSubscriptionList, pxNode );
+            }
+        }
+
+        pxSubscription = pxNextInList;
+    }
+
+    pxSubscriptionList->xHasRemovedSubscriptions = false;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionTrieNode_t * prvAllocateTrieNode( SubscriptionList_t * pxSubscriptionList )
+{
+    SubscriptionTrieNode_t * pxBlock = NULL;
+    SubscriptionTrieNode_t * pxNode = NULL;
+    size_t xIndex;
+
+    if( pxSubscriptionList->pxFreeTrieNodes == NULL )
+    {
+        pxBlock = ( SubscriptionTrieNode_t * ) SUBSCRIPTION_MANAGER_MALLOC( SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH *
+                                                                            sizeof( SubscriptionTrieNode_t ) );
+
+        if( pxBlock != NULL )
+        {
+            ( void ) memset( pxBlock, 0x00, SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH * sizeof( SubscriptionTrieNode_t ) );
+
+            for( xIndex = 0U; xIndex < SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH; xIndex++ )
+            {
+                pxBlock[ xIndex ].pxNextSibling = pxSubscriptionList->pxFreeTrieNodes;
+                pxSubscriptionList->pxFreeTrieNodes = &( pxBlock[ xIndex ] );
+            }
+        }
+        else
+        {
+            LogError( ( "Failed to grow the topic trie node pool." ) );
+        }
+    }
+
+    pxNode = pxSubscriptionList->pxFreeTrieNodes;
+
+    if( pxNode != NULL )
+    {
+        pxSubscriptionList->pxFreeTrieNodes = pxNode->pxNextSibling;
+        pxNode->pxNextSibling = NULL;
+    }
+
+    return pxNode;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvGrowBuckets( SubscriptionList_t * pxSubscriptionList )
+{
+    SubscriptionElement_t ** ppxBuckets = NULL;
+    SubscriptionElement_t * pxSubscription = NULL;
+    SubscriptionElement_t * pxNext = NULL;
+    uint32_t ulBucketCount = 0U, ulIndex = 0U;
+    bool xReturnStatus = false;
+
+    ulBucketCount = ( pxSubscriptionList->ulBucketCount == 0U ) ?
+                    SUBSCRIPTION_MANAGER_INITIAL_BUCKET_COUNT :
+                    ( pxSubscriptionList->ulBucketCount * 2U );
+
+    ppxBuckets = ( SubscriptionElement_t ** ) SUBSCRIPTION_MANAGER_MALLOC( ulBucketCount *
+                                                                           sizeof( SubscriptionElement_t * ) );
+
+    if( ppxBuckets != NULL )
+    {
+        ( void ) memset( ppxBuckets, 0x00, ulBucketCount * sizeof( SubscriptionElement_t * ) );
+
+        /* Every element keeps the hash of its topic filter, so rehashing
+         * does not need to read the topic filters again. */
+        for( ulIndex = 0U; ulIndex < pxSubscriptionList->ulBucketCount; ulIndex++ )
+        {
+            for( pxSubscription = pxSubscriptionList->ppxBuckets[ ulIndex ];
+                 pxSubscription != NULL;
+                 pxSubscription = pxNext )
+            {
+                pxNext = pxSubscription->pxNext;
+                pxSubscription->pxNext = ppxBuckets[ pxSubscription->ulFilterHash & ( ulBucketCount - 1U ) ];
+                ppxBuckets[ pxSubscription->ulFilterHash & ( ulBucketCount - 1U ) ] = pxSubscription;
+            }
+        }
+
+        if( pxSubscriptionList->ppxBuckets != NULL )
+        {
+            SUBSCRIPTION_MANAGER_FREE( pxSubscriptionList->ppxBuckets );
+        }
+
+        pxSubscriptionList->ppxBuckets = ppxBuckets;
+        pxSubscriptionList->ulBucketCount = ulBucketCount;
+        xReturnStatus = true;
+    }
+
+    return xReturnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionTrieNode_t * prvFindExactChild( const SubscriptionTrieNode_t * pxParent,
+                                                   uint32_t ulLevelHash,
+                                                   uint16_t usLevelLength )
+{
+    SubscriptionTrieNode_t * pxChild = pxParent->pxFirstChild;
+
+    while( ( pxChild != NULL ) &&
+           ( ( pxChild->usLevelLength != usLevelLength ) || ( pxChild->ulLevelHash != ulLevelHash ) ) )
+    {
+        pxChild = pxChild->pxNextSibling;
+    }
+
+    return pxChild;
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionTrieNode_t * prvFindFilterNode( SubscriptionList_t * pxSubscriptionList,
+                                                   const char * pcTopicFilterString,
+                                                   uint16_t usTopicFilterLength,
+                                                   bool xCreate )
+{
+    SubscriptionTrieNode_t * pxNode = &( pxSubscriptionList->xTrieRoot );
+    SubscriptionTrieNode_t * pxChild = NULL;
+    SubscriptionTrieNode_t ** ppxWildcardLink = NULL;
+    const char * pcLevel = NULL;
+    uint32_t ulLevelStart = 0U, ulLevelHash = 0U;
+    uint16_t usLevelLength = 0U;
+    bool xIsLastLevel = false;
+
+    do
+    {
+        pcLevel = &( pcTopicFilterString[ ulLevelStart ] );
+        usLevelLength = prvLevelLength( pcTopicFilterString, usTopicFilterLength, ulLevelStart );
+        xIsLastLevel = ( ( ulLevelStart + usLevelLength ) >= usTopicFilterLength );
+        ulLevelHash = prvHashString( pcLevel, usLevelLength );
+        ppxWildcardLink = NULL;
+
+        /* Wildcard levels have a dedicated child so dispatch does not need
+         * to search for them. A multi-level wildcard is only a wildcard when
+         * it is the last level of the filter. */
+        if( ( usLevelLength == 1U ) && ( pcLevel[ 0 ] == SUBSCRIPTION_MANAGER_SINGLE_LEVEL_WILDCARD ) )
+        {
+            ppxWildcardLink = &( pxNode->pxPlusChild );
+        }
+        else if( ( usLevelLength == 1U ) && ( pcLevel[ 0 ] == SUBSCRIPTION_MANAGER_MULTI_LEVEL_WILDCARD ) && ( xIsLastLevel == true ) )
+        {
+            ppxWildcardLink = &( pxNode->pxHashChild );
+        }
+
+        pxChild = ( ppxWildcardLink != NULL ) ? *ppxWildcardLink :
+                  prvFindExactChild( pxNode, ulLevelHash, usLevelLength );
+
+        if( ( pxChild == NULL ) && ( xCreate == true ) )
+        {
+            pxChild = prvAllocateTrieNode( pxSubscriptionList );
+
+            if( pxChild != NULL )
+            {
+                pxChild->ulLevelHash = ulLevelHash;
+                pxChild->usLevelLength = usLevelLength;
+                pxChild->pxParent = pxNode;
+
+                if( ppxWildcardLink != NULL )
+                {
+                    *ppxWildcardLink = pxChild;
+                }
+                else
+                {
+                    pxChild->pxNextSibling = pxNode->pxFirstChild;
+                    pxNode->pxFirstChild = pxChild;
+                }
+            }
+            else
+            {
+                /* Release any node created for this filter so far. */
+                prvPruneNodes( pxSubscriptionList, pxNode );
+            }
+        }
+
+        pxNode = pxChild;
+        ulLevelStart += ( uint32_t ) usLevelLength + 1U;
+    } while( ( pxNode != NULL ) && ( xIsLastLevel == false ) );
+
+    return pxNode;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPruneNodes( SubscriptionList_t * pxSubscriptionList,
+                           SubscriptionTrieNode_t * pxNode )
+{
+    SubscriptionTrieNode_t * pxParent = NULL;
+    SubscriptionTrieNode_t ** ppxLink = NULL;
+
+    /* A node without subscriptions at or below it has no children in use
+     * either, so it can be released along with its unused ancestors. */
+    while( ( pxNode != &( pxSubscriptionList->xTrieRoot ) ) &&
+           ( pxNode->ulRefCount == 0U ) )
+    {
+        pxParent = pxNode->pxParent;
+
+        if( pxParent->pxPlusChild == pxNode )
+        {
+            pxParent->pxPlusChild = NULL;
+        }
+        else if( pxParent->pxHashChild == pxNode )
+        {
+            pxParent->pxHashChild = NULL;
+        }
+        else
+        {
+            ppxLink = &( pxParent->pxFirstChild );
+
+            while( *ppxLink != pxNode )
+            {
+                ppxLink = &( ( *ppxLink )->pxNextSibling );
+            }
+
+            *ppxLink = pxNode->pxNextSibling;
+        }
+
+        ( void ) memset( pxNode, 0x00, sizeof( SubscriptionTrieNode_t ) );
+        pxNode->pxNextSibling = pxSubscriptionList->pxFreeTrieNodes;
+        pxSubscriptionList->pxFreeTrieNodes = pxNode;
+
+        pxNode = pxParent;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDispatchExact( const SubscriptionList_t * pxSubscriptionList,
+                              MQTTPublishInfo_t * pxPublishInfo,
+                              bool * pxPublishHandled )
+{
+    SubscriptionElement_t * pxSubscription = NULL;
+    SubscriptionElement_t * pxNext = NULL;
+    uint32_t ulHash = prvHashString( pxPublishInfo->pTopicName, pxPublishInfo->topicNameLength );
+
+    pxSubscription = pxSubscriptionList->ppxBuckets[ ulHash & ( pxSubscriptionList->ulBucketCount - 1U ) ];
+
+    while( pxSubscription != NULL )
+    {
+        /* The callback may modify the list, so read the link first. */
+        pxNext = pxSubscription->pxNext;
+
+        /* A subscription removed by an earlier callback has no callback. */
+        if( ( pxSubscription->pxIncomingPublishCallback != NULL ) &&
+            ( pxSubscription->ulFilterHash == ulHash ) &&
+            ( pxSubscription->usFilterStringLength == pxPublishInfo->topicNameLength ) &&
+            ( memcmp( pxSubscription->pcSubscriptionFilterString,
+                      pxPublishInfo->pTopicName,
+                      pxPublishInfo->topicNameLength ) == 0 ) )
+        {
+            pxSubscription->pxIncomingPublishCallback( pxSubscription->pvIncomingPublishCallbackContext,
+                                                       pxPublishInfo );
+            *pxPublishHandled = true;
+        }
+
+        pxSubscription = pxNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvInvokeSubscriptions( const SubscriptionTrieNode_t * pxNode,
+                                    MQTTPublishInfo_t * pxPublishInfo,
+                                    bool * pxPublishHandled )
+{
+    SubscriptionElement_t * pxSubscription = pxNode->pxSubscriptions;
+    SubscriptionElement_t * pxNext = NULL;
+    bool isMatched = false;
+
+    while( pxSubscription != NULL )
+    {
+        /* The callback may modify the list, so read the link first. */
+        pxNext = pxSubscription->pxNext;
+        isMatched = false;
+
+        /* Levels are compared by hash in the trie; confirm the match. A
+         * subscription removed by an earlier callback has no callback. */
+        if( pxSubscription->pxIncomingPublishCallback != NULL )
+        {
+            ( void ) MQTT_MatchTopic( pxPublishInfo->pTopicName,
+                                      pxPublishInfo->topicNameLength,
+                                      pxSubscription->pcSubscriptionFilterString,
+                                      pxSubscription->usFilterStringLength,
+                                      &isMatched );
+        }
+
+        if( isMatched == true )
+        {
+            pxSubscription->pxIncomingPublishCallback( pxSubscription->pvIncomingPublishCallbackContext,
+                                                       pxPublishInfo );
+            *pxPublishHandled = true;
+        }
+
+        pxSubscription = pxNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDispatchFromNode( const SubscriptionTrieNode_t * pxNode,
+                                 MQTTPublishInfo_t * pxPublishInfo,
+                                 uint32_t ulLevelStart,
+                                 bool * pxPublishHandled )
+{
+    const SubscriptionTrieNode_t * pxChild = NULL;
+    const char * pcLevel = NULL;
+    uint16_t usLevelLength = 0U;
+    bool xMatchWildcards = true;
+
+    /* Topics reserved for the broker are not matched by a filter starting
+     * with a wildcard. */
+    if( ( ulLevelStart == 0U ) &&
+        ( pxPublishInfo->pTopicName[ 0 ] == SUBSCRIPTION_MANAGER_RESERVED_TOPIC_PREFIX ) )
+    {
+        xMatchWildcards = false;
+    }
+
+    /* A multi-level wildcard matches the remaining levels, including none
+     * at all, i.e. "a/#" matches "a". */
+    if( ( pxNode->pxHashChild != NULL ) && ( xMatchWildcards == true ) )
+    {
+        prvInvokeSubscriptions( pxNode->pxHashChild, pxPublishInfo, pxPublishHandled );
+    }
+
+    if( ulLevelStart > pxPublishInfo->topicNameLength )
+    {
+        /* Every level of the topic has been consumed. */
+        prvInvokeSubscriptions( pxNode, pxPublishInfo, pxPublishHandled );
+    }
+    else
+    {
+        pcLevel = &( pxPublishInfo->pTopicName[ ulLevelStart ] );
+        usLevelLength = prvLevelLength( pxPublishInfo->pTopicName,
+                                        pxPublishInfo->topicNameLength,
+                                        ulLevelStart );
+
+        pxChild = prvFindExactChild( pxNode, prvHashString( pcLevel, usLevelLength ), usLevelLength );
+
+        if( pxChild != NULL )
+        {
+            prvDispatchFromNode( pxChild, pxPublishInfo, ulLevelStart + usLevelLength + 1U, pxPublishHandled );
+        }
+
+        if( ( pxNode->pxPlusChild != NULL ) && ( xMatchWildcards == true ) )
+        {
+            prvDispatchFromNode( pxNode->pxPlusChild, pxPublishInfo, ulLevelStart + usLevelLength + 1U, pxPublishHandled );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool addSubscription( SubscriptionList_t * pxSubscriptionList,
                       const char * pcTopicFilterString,
                       uint16_t usTopicFilterLength,
                       IncomingPubCallback_t pxIncomingPublishCallback,
                       void * pvIncomingPublishCallbackContext )
 {
-    int32_t lIndex = 0;
-    size_t xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
+    SubscriptionElement_t * pxAvailable = NULL;
+    SubscriptionElement_t * pxSubscription = NULL;
+    SubscriptionElement_t ** ppxChain = NULL;
+    SubscriptionTrieNode_t * pxNode = NULL;
+    uint32_t ulFilterHash = 0U;
+    bool xIsWildcard = false;
     bool xReturnStatus = false;
 
     if( ( pxSubscriptionList == NULL ) ||
@@ -60,36 +785,116 @@ bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
     }
     else
     {
-        /* Start at end of array, so that we will insert at the first available index.
-         * Scans backwards to find duplicates. */
-        for( lIndex = ( int32_t ) SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS - 1; lIndex >= 0; lIndex-- )
+        xIsWildcard = prvIsWildcardFilter( pcTopicFilterString, usTopicFilterLength );
+        ulFilterHash = prvHashString( pcTopicFilterString, usTopicFilterLength );
+
+        /* Duplicates can only be in the bucket or on the trie node of the
+         * same filter. */
+        if( xIsWildcard == true )
+        {
+            pxNode = prvFindFilterNode( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, false );
+            pxSubscription = ( pxNode != NULL ) ? pxNode->pxSubscriptions : NULL;
+        }
+        else if( pxSubscriptionList->ppxBuckets != NULL )
+        {
+            pxSubscription = pxSubscriptionList->ppxBuckets[ ulFilterHash & ( pxSubscriptionList->ulBucketCount - 1U ) ];
+        }
+        else
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == 0 )
+            pxSubscription = NULL;
+        }
+
+        for( ; pxSubscription != NULL; pxSubscription = pxSubscription->pxNext )
+        {
+            if( ( pxSubscription->usFilterStringLength == usTopicFilterLength ) &&
+                ( strncmp( pcTopicFilterString, pxSubscription->pcSubscriptionFilterString, ( size_t ) usTopicFilterLength ) == 0 ) &&
+                ( pxSubscription->pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
+                ( pxSubscription->pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
             {
-                xAvailableIndex = lIndex;
+                /* If a subscription already exists, don't do anything. */
+                LogWarn( ( "Subscription already exists.\n" ) );
+                xReturnStatus = true;
+                break;
             }
-            else if( ( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength ) &&
-                     ( strncmp( pcTopicFilterString, pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, ( size_t ) usTopicFilterLength ) == 0 ) )
+        }
+
+        if( xReturnStatus == false )
+        {
+            pxAvailable = prvAllocateSubscription( pxSubscriptionList );
+        }
+
+        if( pxAvailable != NULL )
+        {
+            if( xIsWildcard == true )
             {
-                /* If a subscription already exists, don't do anything. */
-                if( ( pxSubscriptionList[ lIndex ].pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
-                    ( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
+                pxNode = prvFindFilterNode( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, true );
+                ppxChain = ( pxNode != NULL ) ? &( pxNode->pxSubscriptions ) : NULL;
+            }
+            else
+            {
+                /* Keep the average bucket length at or below one. A table
+                 * that cannot grow stays correct, only slower. The table is
+                 * not rehashed under a publish being dispatched, unless it
+                 * does not exist yet. */
+                if( ( pxSubscriptionList->ulExactCount >= pxSubscriptionList->ulBucketCount ) &&
+                    ( ( pxSubscriptionList->ulDispatchDepth == 0U ) || ( pxSubscriptionList->ppxBuckets == NULL ) ) )
                 {
-                    LogWarn( ( "Subscription already exists.\n" ) );
-                    xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
-                    xReturnStatus = true;
-                    break;
+                    ( void ) prvGrowBuckets( pxSubscriptionList );
                 }
+
+                ppxChain = ( pxSubscriptionList->ppxBuckets != NULL ) ?
+                           &( pxSubscriptionList->ppxBuckets[ ulFilterHash & ( pxSubscriptionList->ulBucketCount - 1U ) ] ) :
+                           NULL;
+            }
+
+            if( ppxChain != NULL )
+            {
+                pxAvailable->pcSubscriptionFilterString = pcTopicFilterString;
+                pxAvailable->usFilterStringLength = usTopicFilterLength;
+                pxAvailable->pxIncomingPublishCallback = pxIncomingPublishCallback;
+                pxAvailable->pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
+                pxAvailable->ulFilterHash = ulFilterHash;
+                pxAvailable->pxNode = pxNode;
+                pxAvailable->pxNext = *ppxChain;
+                *ppxChain = pxAvailable;
+
+                pxAvailable->pxNextInList = pxSubscriptionList->pxSubscriptions;
+
+                if( pxSubscriptionList->pxSubscriptions != NULL )
+                {
+                    pxSubscriptionList->pxSubscriptions->pxPreviousInList = pxAvailable;
+                }
+
+                pxSubscriptionList->pxSubscriptions = pxAvailable;
+
+                if( xIsWildcard == true )
+                {
+                    /* Account for the subscription on every node of its path. */
+                    for( ; pxNode != NULL; pxNode = pxNode->pxParent )
+                    {
+                        pxNode->ulRefCount++;
+                    }
+                }
+                else
+                {
+                    pxSubscriptionList->ulExactCount++;
+                }
+
+                xReturnStatus = true;
+            }
+            else
+            {
+                /* The element is not linked anywhere yet. */
+                pxAvailable->pxNext = pxSubscriptionList->pxFreeSubscriptions;
+                pxSubscriptionList->pxFreeSubscriptions = pxAvailable;
             }
         }
 
-        if( xAvailableIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS )
+        if( xReturnStatus == false )
         {
-            pxSubscriptionList[ xAvailableIndex ].pcSubscriptionFilterString = pcTopicFilterString;
-            pxSubscriptionList[ xAvailableIndex ].usFilterStringLength = usTopicFilterLength;
-            pxSubscriptionList[ xAvailableIndex ].pxIncomingPublishCallback = pxIncomingPublishCallback;
-            pxSubscriptionList[ xAvailableIndex ].pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
-            xReturnStatus = true;
+            LogError( ( "Failed to add subscription for topic filter %.*s.",
+                        usTopicFilterLength,
+                        pcTopicFilterString ) );
         }
     }
 
@@ -98,11 +903,14 @@ bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
 
 /*-----------------------------------------------------------*/
 
-void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
+void removeSubscription( SubscriptionList_t * pxSubscriptionList,
                          const char * pcTopicFilterString,
                          uint16_t usTopicFilterLength )
 {
-    int32_t lIndex = 0;
+    SubscriptionTrieNode_t * pxNode = NULL;
+    SubscriptionElement_t ** ppxLink = NULL;
+    SubscriptionElement_t * pxSubscription = NULL;
+    uint32_t ulFilterHash = 0U;
 
     if( ( pxSubscriptionList == NULL ) ||
         ( pcTopicFilterString == NULL ) ||
@@ -116,26 +924,58 @@ void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
     }
     else
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
+        if( prvIsWildcardFilter( pcTopicFilterString, usTopicFilterLength ) == true )
+        {
+            pxNode = prvFindFilterNode( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, false );
+            ppxLink = ( pxNode != NULL ) ? &( pxNode->pxSubscriptions ) : NULL;
+        }
+        else if( pxSubscriptionList->ppxBuckets != NULL )
+        {
+            ulFilterHash = prvHashString( pcTopicFilterString, usTopicFilterLength );
+            ppxLink = &( pxSubscriptionList->ppxBuckets[ ulFilterHash & ( pxSubscriptionList->ulBucketCount - 1U ) ] );
+        }
+        else
+        {
+            /* No subscription without wildcards was ever added. */
+        }
+
+        while( ( ppxLink != NULL ) && ( *ppxLink != NULL ) )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength )
+            pxSubscription = *ppxLink;
+
+            if( ( pxSubscription->usFilterStringLength != usTopicFilterLength ) ||
+                ( strncmp( pxSubscription->pcSubscriptionFilterString, pcTopicFilterString, usTopicFilterLength ) != 0 ) )
             {
-                if( strncmp( pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, pcTopicFilterString, usTopicFilterLength ) == 0 )
-                {
-                    memset( &( pxSubscriptionList[ lIndex ] ), 0x00, sizeof( SubscriptionElement_t ) );
-                }
+                ppxLink = &( pxSubscription->pxNext );
+            }
+            else if( pxSubscriptionList->ulDispatchDepth > 0U )
+            {
+                /* A publish callback is removing the subscription. The
+                 * dispatch may still hold this element or the next one, so
+                 * only mark it as removed. */
+                pxSubscription->pxIncomingPublishCallback = NULL;
+                pxSubscriptionList->xHasRemovedSubscriptions = true;
+                ppxLink = &( pxSubscription->pxNext );
+            }
+            else
+            {
+                prvRemoveSubscription( pxSubscriptionList, ppxLink );
             }
         }
+
+        if( ( pxNode != NULL ) && ( pxSubscriptionList->ulDispatchDepth == 0U ) )
+        {
+            prvPruneNodes( pxSubscriptionList, pxNode );
+        }
     }
 }
 
 /*-----------------------------------------------------------*/
 
-bool handleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool handleIncomingPublishes( SubscriptionList_t * pxSubscriptionList,
                               MQTTPublishInfo_t * pxPublishInfo )
 {
-    int32_t lIndex = 0;
-    bool isMatched = false, publishHandled = false;
+    bool publishHandled = false;
 
     if( ( pxSubscriptionList == NULL ) ||
         ( pxPublishInfo == NULL ) )
@@ -144,27 +984,36 @@ bool handleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
                     pxSubscriptionList,
                     pxPublishInfo ) );
     }
-    else
+    else if( ( pxPublishInfo->pTopicName != NULL ) && ( pxPublishInfo->topicNameLength > 0U ) )
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
+        pxSubscriptionList->ulDispatchDepth++;
+
+        if( pxSubscriptionList->ppxBuckets != NULL )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength > 0 )
-            {
-                MQTT_MatchTopic( pxPublishInfo->pTopicName,
-                                 pxPublishInfo->topicNameLength,
-                                 pxSubscriptionList[ lIndex ].pcSubscriptionFilterString,
-                                 pxSubscriptionList[ lIndex ].usFilterStringLength,
-                                 &isMatched );
+            prvDispatchExact( pxSubscriptionList, pxPublishInfo, &publishHandled );
+        }
 
-                if( isMatched == true )
-                {
-                    pxSubscriptionList[ lIndex ].pxIncomingPublishCallback( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext,
-                                                                            pxPublishInfo );
-                    publishHandled = true;
-                }
-            }
+        /* The trie is only walked when some wildcard filter is subscribed. */
+        if( pxSubscriptionList->xTrieRoot.ulRefCount > 0U )
+        {
+            prvDispatchFromNode( &( pxSubscriptionList->xTrieRoot ),
+                                 pxPublishInfo,
+                                 0U,
+                                 &publishHandled );
+        }
+
+        pxSubscriptionList->ulDispatchDepth--;
+
+        if( ( pxSubscriptionList->ulDispatchDepth == 0U ) &&
+            ( pxSubscriptionList->xHasRemovedSubscriptions == true ) )
+        {
+            prvReleaseRemovedSubscriptions( pxSubscriptionList );
         }
     }
+    else
+    {
+        /* A publish without a topic matches no subscription. */
+    }
 
     return publishHandled;
 }
@@ -63,11 +63,35 @@
 
 
 /**
- * @brief Maximum number of subscriptions maintained by the subscription manager
- * simultaneously in a list.
+ * @brief Number of subscriptions, or of topic trie nodes, allocated at once
+ * when the pool of a subscription list runs out of free entries.
+ *
+ * Entries released by a removed subscription are kept in the pool and reused
+ * by later subscriptions; they are not returned to the heap.
+ */
+#ifndef SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH
+    #define SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH    8U
+#endif
+
+/**
+ * @brief Initial number of buckets of the table holding the topic filters
+ * without wildcards. Must be a power of 2.
+ *
+ * The table doubles in size whenever it holds more filters than buckets.
  */
-#ifndef SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS
-    #define SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS    10U
+#ifndef SUBSCRIPTION_MANAGER_INITIAL_BUCKET_COUNT
+    #define SUBSCRIPTION_MANAGER_INITIAL_BUCKET_COUNT    16U
+#endif
+
+/**
+ * @brief Functions used to allocate and free the memory of the pool and of
+ * the exact-match table.
+ */
+#ifndef SUBSCRIPTION_MANAGER_MALLOC
+    #define SUBSCRIPTION_MANAGER_MALLOC    pvPortMalloc
+#endif
+#ifndef SUBSCRIPTION_MANAGER_FREE
+    #define SUBSCRIPTION_MANAGER_FREE      vPortFree
 #endif
 
 /**
@@ -82,9 +106,6 @@ typedef void (* IncomingPubCallback_t )( void * pvIncomingPublishCallbackContext
 /**
  * @brief An element in the list of subscriptions.
  *
- * This subscription manager implementation expects that the array of the
- * subscription elements used for storing subscriptions to be initialized to 0.
- *
  * @note This implementation allows multiple tasks to subscribe to the same topic.
  * In this case, another element is added to the subscription list, differing
  * in the intended publish callback. Also note that the topic filters are not
@@ -97,8 +118,93 @@ typedef struct subscriptionElement
     void * pvIncomingPublishCallbackContext;
     uint16_t usFilterStringLength;
     const char * pcSubscriptionFilterString;
+
+    /* Hash of the whole topic filter, used by the exact-match table. */
+    uint32_t ulFilterHash;
+
+    /* Trie node of the last level of a wildcard topic filter, or NULL for
+     * a topic filter held in the exact-match table. */
+    struct subscriptionTrieNode * pxNode;
+
+    /* Next subscription in the same table bucket or attached to the same
+     * trie node, or next free element of the pool. */
+    struct subscriptionElement * pxNext;
+
+    /* Links of the list of every subscription, see SubscriptionList_t. */
+    struct subscriptionElement * pxNextInList;
+    struct subscriptionElement * pxPreviousInList;
 } SubscriptionElement_t;
 
+/**
+ * @brief A node of the topic trie. Each node represents one topic level of
+ * one or more wildcard topic filters.
+ *
+ * Levels are identified by their hash and length rather than by a copy of
+ * the level string, so no topic filter storage is held by the trie. A hash
+ * collision can only make a node shared by two different levels; matches are
+ * always confirmed against the full topic filter before a callback is invoked.
+ */
+typedef struct subscriptionTrieNode
+{
+    uint32_t ulLevelHash;
+    uint16_t usLevelLength;
+
+    /* Number of subscriptions whose filter ends at or below this node. */
+    uint32_t ulRefCount;
+
+    /* A non-root node is in use while its parent is set. */
+    struct subscriptionTrieNode * pxParent;
+
+    /* Exact-level children; also links the free nodes of the pool. */
+    struct subscriptionTrieNode * pxFirstChild;
+    struct subscriptionTrieNode * pxNextSibling;
+
+    /* Children for the single-level and multi-level wildcards. */
+    struct subscriptionTrieNode * pxPlusChild;
+    struct subscriptionTrieNode * pxHashChild;
+
+    /* Subscriptions whose topic filter ends at this node. */
+    SubscriptionElement_t * pxSubscriptions;
+} SubscriptionTrieNode_t;
+
+/**
+ * @brief A list of subscriptions.
+ *
+ * Topic filters without wildcards are kept in a hash table so that a publish
+ * finds them in constant time, while wildcard topic filters are kept in a
+ * topic trie walked in O(topic depth). Subscriptions and trie nodes are taken
+ * from a pool that grows on demand, so the number of subscriptions is only
+ * bounded by the heap.
+ *
+ * This subscription manager implementation expects the list to be
+ * initialized to 0. Every subscription in the list can be visited, but not
+ * modified, by following pxSubscriptions and then pxNextInList; a subscription
+ * with a NULL callback is a removed one still waiting to be released.
+ */
+typedef struct subscriptionList
+{
+    /* Every subscription of the list, most recent first. */
+    SubscriptionElement_t * pxSubscriptions;
+
+    /* Exact-match table, allocated on the first wildcard-free subscription. */
+    SubscriptionElement_t ** ppxBuckets;
+    uint32_t ulBucketCount;
+    uint32_t ulExactCount;
+
+    /* Root of the trie holding the wildcard topic filters. */
+    SubscriptionTrieNode_t xTrieRoot;
+
+    /* Free entries of the pool. */
+    SubscriptionElement_t * pxFreeSubscriptions;
+    SubscriptionTrieNode_t * pxFreeTrieNodes;
+
+    /* Nesting depth of the publish dispatch. While a publish is dispatched,
+     * removed subscriptions only have their callback set to NULL, and are
+     * released once the dispatch returns. */
+    uint32_t ulDispatchDepth;
+    bool xHasRemovedSubscriptions;
+} SubscriptionList_t;
+
 /**
  * @brief Add a subscription to the subscription list.
  *
@@ -106,15 +212,16 @@ typedef struct subscriptionElement
  * context-callback pairs. However, a single context-callback pair may only be
  * associated to the same topic filter once.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pcTopicFilterString Topic filter string of subscription.
  * @param[in] usTopicFilterLength Length of topic filter string.
  * @param[in] pxIncomingPublishCallback Callback function for the subscription.
  * @param[in] pvIncomingPublishCallbackContext Context for the subscription callback.
  *
- * @return `true` if subscription added or exists, `false` if insufficient memory.
+ * @return `true` if subscription added or exists, `false` if the memory for
+ * it could not be allocated.
  */
-bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
+bool addSubscription( SubscriptionList_t * pxSubscriptionList,
                       const char * pcTopicFilterString,
                       uint16_t usTopicFilterLength,
                       IncomingPubCallback_t pxIncomingPublishCallback,
@@ -126,11 +233,15 @@ bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
  * @note If the topic filter exists multiple times in the subscription list,
  * then every instance of the subscription will be removed.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @note This function may be called from a publish callback, including for
+ * the subscription being dispatched. The removed subscriptions are not
+ * invoked again, and their memory is reused only after the dispatch returns.
+ *
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pcTopicFilterString Topic filter of subscription.
  * @param[in] usTopicFilterLength Length of topic filter.
  */
-void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
+void removeSubscription( SubscriptionList_t * pxSubscriptionList,
                          const char * pcTopicFilterString,
                          uint16_t usTopicFilterLength );
 
@@ -138,13 +249,16 @@ void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
  * @brief Handle incoming publishes by invoking the callbacks registered
  * for the incoming publish's topic filter.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * Every subscription whose topic filter matches the topic is invoked, so a
+ * single publish can fan out to several callbacks.
+ *
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pxPublishInfo Info of incoming publish.
  *
  * @return `true` if an application callback could be invoked;
  *  `false` otherwise.
  */
-bool handleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool handleIncomingPublishes( SubscriptionList_t * pxSubscriptionList,
                               MQTTPublishInfo_t * pxPublishInfo );
 
 #endif /* SUBSCRIPTION_MANAGER_H */
@@ -491,13 +491,13 @@ static MQTTAgentMessageContext_t xCommandQueue;
 static BaseType_t xHttpConnectionStatus;
 
 /**
- * @brief The global array of subscription elements.
+ * @brief The global list of subscriptions.
  *
- * @note The subscription manager implementation expects that the array of the
- * subscription elements used for storing subscriptions to be initialized to 0.
- * As this is a global array, it will be intialized to 0 by default.
+ * @note The subscription manager implementation expects that the list used for
+ * storing subscriptions to be initialized to 0. As this is a global variable,
+ * it will be intialized to 0 by default.
  */
-static SubscriptionElement_t pxGlobalSubscriptionList[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
+static SubscriptionList_t xGlobalSubscriptionList;
 
 /**
  * @brief The parameters for the network context using a TLS channel.
@@ -1088,7 +1088,7 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pxMqttAgentContext,
 
     /* Fan out the incoming publishes to the callbacks registered using
      * subscription manager. */
-    xPublishHandled = SubscriptionManager_HandleIncomingPublishes( ( SubscriptionElement_t * ) pxMqttAgentContext->pIncomingCallbackContext,
+    xPublishHandled = SubscriptionManager_HandleIncomingPublishes( ( SubscriptionList_t * ) pxMqttAgentContext->pIncomingCallbackContext,
                                                                    pxPublishInfo );
 
     /* If there are no callbacks to handle the incoming publishes,
@@ -1226,7 +1226,7 @@ static void prvRegisterOTACallback( const char * pcTopicFilter,
         if( xIsMatch )
         {
             /* Add subscription so that incoming publishes are routed to the application callback. */
-            xSubscriptionAdded = SubscriptionManager_AddSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+            xSubscriptionAdded = SubscriptionManager_AddSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                                                       pcTopicFilter,
                                                                       usTopicFilterLength,
                                                                       xOtaTopicFilterCallbacks[ usIndex ].xCallback,
@@ -1279,7 +1279,7 @@ static void prvMQTTUnsubscribeCompleteCallback( MQTTAgentCommandContext_t * pxCo
     {
         pxSubscribeArgs = ( MQTTAgentSubscribeArgs_t * ) ( pxCommandContext->pArgs );
         /* Add subscription so that incoming publishes are routed to the application callback. */
-        SubscriptionManager_RemoveSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+        SubscriptionManager_RemoveSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                                 pxSubscribeArgs->pSubscribeInfo->pTopicFilter,
                                                 pxSubscribeArgs->pSubscribeInfo->topicFilterLength );
 
@@ -1407,8 +1407,8 @@ static MQTTStatus_t prvMqttAgentInit( void )
                               &xTransport,
                               prvGetTimeMs,
                               prvIncomingPublishCallback,
-                              /* Context to pass into the callback. Passing the pointer to subscription array. */
-                              pxGlobalSubscriptionList );
+                              /* Context to pass into the callback. Passing the pointer to subscription list. */
+                              &xGlobalSubscriptionList );
 
     return xReturn;
 }
@@ -2446,7 +2446,7 @@ int RunOtaCoreHttpDemo( bool xAwsIotMqttMode,
      * Remvove callback for receiving messages intended for OTA agent from broker,
      * for which the topic has not been subscribed for.
      */
-    SubscriptionManager_RemoveSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+    SubscriptionManager_RemoveSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                             otaexampleDEFAULT_TOPIC_FILTER,
                                             otaexampleDEFAULT_TOPIC_FILTER_LENGTH );
 
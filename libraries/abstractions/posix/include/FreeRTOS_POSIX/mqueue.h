@@ -53,6 +53,40 @@ struct mq_attr
     long mq_curmsgs; /**< Number of messages currently queued. */
 };
 
+/**
+ * @brief mq_attr.mq_flags bit requesting a zero-copy message queue.
+ *
+ * FreeRTOS+POSIX extension. When set in the attributes given to mq_open with
+ * O_CREAT, the queue preallocates a pool of message buffers of mq_msgsize
+ * bytes and passes them between threads by pointer. Such a queue supports
+ * mq_buffer_get(), mq_buffer_send(), mq_buffer_receive() and mq_buffer_release()
+ * in addition to the standard functions.
+ */
+#define MQ_ZEROCOPY    0x10000L
+
+/**
+ * @name Events of struct mq_pollfd.
+ *
+ * FreeRTOS+POSIX extension, values match those of poll.h.
+ */
+/**@{ */
+#define MQ_POLLIN      0x0001 /**< A message can be received without blocking. */
+#define MQ_POLLOUT     0x0004 /**< A message can be sent without blocking. */
+#define MQ_POLLNVAL    0x0020 /**< The descriptor is not valid. Only returned in revents. */
+/**@} */
+
+/**
+ * @brief Message queue to wait on with mq_poll().
+ *
+ * FreeRTOS+POSIX extension.
+ */
+struct mq_pollfd
+{
+    mqd_t mqdes;   /**< Message queue descriptor. */
+    short events;  /**< Requested events, MQ_POLLIN and/or MQ_POLLOUT. */
+    short revents; /**< Returned events. */
+};
+
 /**
  * @brief Close a message queue.
  *
@@ -93,6 +127,7 @@ int mq_getattr( mqd_t mqdes,
  * overwritten by user.
  * @note mode argument is not supported.
  * @note Supported oflags: O_RDWR, O_CREAT, O_EXCL, and O_NONBLOCK.
+ * @note Of the attr->mq_flags bits, only MQ_ZEROCOPY is used; all other flags come from oflag.
  *
  * @retval Message queue descriptor -- Upon successful completion
  * @retval (mqd_t) - 1 -- An error occurred. errno is also set.
@@ -248,4 +283,142 @@ int mq_timedsend( mqd_t mqdes,
  */
 int mq_unlink( const char * name );
 
+/**
+ * @brief Take a free message buffer from the pool of a zero-copy message queue.
+ *
+ * FreeRTOS+POSIX extension. The buffer holds mq_msgsize bytes and is owned by
+ * the caller until it is passed to mq_buffer_send() or mq_buffer_release().
+ *
+ * @param[in] mqdes Descriptor of a queue created with MQ_ZEROCOPY.
+ * @param[in] abstime Absolute timeout; NULL blocks forever. Ignored with O_NONBLOCK.
+ *
+ * @retval Pointer to the message buffer - Upon successful completion.
+ * @retval NULL - An error occurred. errno is also set.
+ *
+ * @sideeffect Possible errno values
+ * <br>
+ * EBADF - The mqdes argument is not a valid message queue descriptor.
+ * <br>
+ * ENOTSUP - The message queue was not created with MQ_ZEROCOPY.
+ * <br>
+ * EINVAL - abstime is invalid.
+ * <br>
+ * ETIMEDOUT - No buffer became free before the specified timeout expired.
+ * <br>
+ * EAGAIN - O_NONBLOCK is set and no buffer is free.
+ */
+char * mq_buffer_get( mqd_t mqdes,
+                      const struct timespec * abstime );
+
+/**
+ * @brief Send a buffer from mq_buffer_get() to a zero-copy message queue.
+ *
+ * FreeRTOS+POSIX extension. Only the pointer is queued. On success, ownership
+ * of msg_buf passes to the queue; on failure, the caller keeps it.
+ *
+ * @param[in] mqdes Descriptor of a queue created with MQ_ZEROCOPY.
+ * @param[in] msg_buf Buffer from mq_buffer_get() or mq_buffer_receive().
+ * @param[in] msg_len Number of valid bytes in msg_buf.
+ * @param[in] abstime Absolute timeout; NULL blocks forever. Ignored with O_NONBLOCK.
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval -1 - An error occurred. errno is also set.
+ *
+ * @sideeffect Possible errno values
+ * <br>
+ * EBADF - The mqdes argument is not a valid message queue descriptor.
+ * <br>
+ * ENOTSUP - The message queue was not created with MQ_ZEROCOPY.
+ * <br>
+ * EINVAL - msg_buf is not a buffer of this queue held by the caller, or abstime is invalid.
+ * <br>
+ * EMSGSIZE - msg_len exceeds the message size attribute of the message queue.
+ * <br>
+ * ETIMEDOUT - The timeout expired before the message could be added to the queue.
+ * <br>
+ * EAGAIN - O_NONBLOCK is set and the message queue is full.
+ */
+int mq_buffer_send( mqd_t mqdes,
+                    char * msg_buf,
+                    size_t msg_len,
+                    const struct timespec * abstime );
+
+/**
+ * @brief Receive a message buffer from a zero-copy message queue.
+ *
+ * FreeRTOS+POSIX extension. Ownership of the buffer passes to the caller, who
+ * must give it back with mq_buffer_release() or forward it with mq_buffer_send().
+ *
+ * @param[in] mqdes Descriptor of a queue created with MQ_ZEROCOPY.
+ * @param[out] msg_buf Set to the received buffer.
+ * @param[in] abstime Absolute timeout; NULL blocks forever. Ignored with O_NONBLOCK.
+ *
+ * @retval The length of the message in bytes - Upon successful completion.
+ * @retval -1 - An error occurred. errno is also set.
+ *
+ * @sideeffect Possible errno values
+ * <br>
+ * EBADF - The mqdes argument is not a valid message queue descriptor.
+ * <br>
+ * ENOTSUP - The message queue was not created with MQ_ZEROCOPY.
+ * <br>
+ * EINVAL - msg_buf is NULL, or abstime is invalid.
+ * <br>
+ * ETIMEDOUT - No message arrived on the queue before the specified timeout expired.
+ * <br>
+ * EAGAIN - O_NONBLOCK is set and the message queue is empty.
+ */
+ssize_t mq_buffer_receive( mqd_t mqdes,
+                           char ** msg_buf,
+                           const struct timespec * abstime );
+
+/**
+ * @brief Return a message buffer to the pool of a zero-copy message queue.
+ *
+ * FreeRTOS+POSIX extension.
+ *
+ * @param[in] mqdes Descriptor of a queue created with MQ_ZEROCOPY.
+ * @param[in] msg_buf Buffer from mq_buffer_get() or mq_buffer_receive().
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval -1 - An error occurred. errno is also set.
+ *
+ * @sideeffect Possible errno values
+ * <br>
+ * EBADF - The mqdes argument is not a valid message queue descriptor.
+ * <br>
+ * ENOTSUP - The message queue was not created with MQ_ZEROCOPY.
+ * <br>
+ * EINVAL - msg_buf is not a buffer of this queue held by the caller, e.g. it
+ * was already released or sent.
+ */
+int mq_buffer_release( mqd_t mqdes,
+                       char * msg_buf );
+
+/**
+ * @brief Wait until one of several message queues is ready.
+ *
+ * FreeRTOS+POSIX extension, modeled on poll(). One thread can service many
+ * queues this way instead of using one thread per queue. The wait ends when
+ * a message is sent to, received from, or the last descriptor is closed on
+ * one of the queues.
+ *
+ * @param[in,out] fds Queues to wait on and events of interest; revents is
+ * set for every entry on return.
+ * @param[in] nfds Number of entries in fds.
+ * @param[in] abstime Absolute timeout; NULL blocks forever. A timeout in the
+ * past checks the queues without blocking.
+ *
+ * @retval Number of entries with nonzero revents - Upon successful completion,
+ * 0 if the timeout expired.
+ * @retval -1 - An error occurred. errno is also set.
+ *
+ * @sideeffect Possible errno values
+ * <br>
+ * EINVAL - fds is NULL while nfds is not 0, or abstime is invalid.
+ */
+int mq_poll( struct mq_pollfd * fds,
+             size_t nfds,
+             const struct timespec * abstime );
+
 #endif /* ifndef _FREERTOS_POSIX_MQUEUE_H_ */
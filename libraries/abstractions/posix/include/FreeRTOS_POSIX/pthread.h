@@ -68,11 +68,45 @@
 #ifndef PTHREAD_MUTEX_RECURSIVE
     #define PTHREAD_MUTEX_RECURSIVE     2                        /**< Non-robust, recursive relock, remembers owner. */
 #endif
+#ifndef PTHREAD_MUTEX_ADAPTIVE_NP
+    #define PTHREAD_MUTEX_ADAPTIVE_NP   3                        /**< Non-portable. Like PTHREAD_MUTEX_NORMAL, but spins on an atomic word before blocking. */
+#endif
 #ifndef PTHREAD_MUTEX_DEFAULT
     #define PTHREAD_MUTEX_DEFAULT       PTHREAD_MUTEX_NORMAL     /**< PTHREAD_MUTEX_NORMAL (default). */
 #endif
 /**@} */
 
+/**
+ * @name Process-shared attribute values.
+ *
+ * @brief There is a single process, so both values behave the same.
+ */
+/**@{ */
+#ifndef PTHREAD_PROCESS_PRIVATE
+    #define PTHREAD_PROCESS_PRIVATE    0 /**< Object is only used by threads of the creating process. */
+#endif
+#ifndef PTHREAD_PROCESS_SHARED
+    #define PTHREAD_PROCESS_SHARED     1 /**< Object may be used by threads of any process. */
+#endif
+/**@} */
+
+/**
+ * @name Reader-writer lock kinds.
+ *
+ * @brief Non-portable extension, following glibc. Set with pthread_rwlockattr_setkind_np().
+ */
+/**@{ */
+#ifndef PTHREAD_RWLOCK_PREFER_READER_NP
+    #define PTHREAD_RWLOCK_PREFER_READER_NP    0                               /**< Readers may lock while a writer waits; writers can starve. */
+#endif
+#ifndef PTHREAD_RWLOCK_PREFER_WRITER_NP
+    #define PTHREAD_RWLOCK_PREFER_WRITER_NP    1                               /**< A waiting writer blocks new readers. */
+#endif
+#ifndef PTHREAD_RWLOCK_DEFAULT_NP
+    #define PTHREAD_RWLOCK_DEFAULT_NP          PTHREAD_RWLOCK_PREFER_READER_NP /**< PTHREAD_RWLOCK_PREFER_READER_NP (default). */
+#endif
+/**@} */
+
 /**
  * @name Compile-time initializers.
  *
@@ -81,6 +115,9 @@
  *
  * To use PTHREAD_MUTEX_INITIALIZER, posixconfigENABLE_PTHREAD_MUTEX_T needs to be set to 1 in
  * port specific POSIX config file.
+ *
+ * To use PTHREAD_RWLOCK_INITIALIZER, posixconfigENABLE_PTHREAD_RWLOCK_T needs to be set to 1 in
+ * port specific POSIX config file.
  */
 /**@{ */
 #if posixconfigENABLE_PTHREAD_COND_T == 1
@@ -91,6 +128,10 @@
     #define PTHREAD_MUTEX_INITIALIZER    FREERTOS_POSIX_MUTEX_INITIALIZER /**< pthread_mutex_t. */
 #endif
 
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+    #define PTHREAD_RWLOCK_INITIALIZER    FREERTOS_POSIX_RWLOCK_INITIALIZER /**< pthread_rwlock_t. */
+#endif
+
 /**@} */
 
 /**
@@ -209,15 +250,11 @@ int pthread_barrier_destroy( pthread_barrier_t * barrier );
  *
  * @retval 0 - Upon successful completion.
  * @retval EINVAL - The value specified by count is equal to zero.
- * @retval ENOMEM - count cannot fit into FreeRTOS event group type OR insufficient memory exists to initialize the barrier.
  *
  * @note attr is ignored.
  *
- * @note pthread_barrier_init() is implemented with FreeRTOS event group.
- * To ensure count fits in event group, count may be at most 8 when configUSE_16_BIT_TICKS is 1;
- * it may be at most 24 otherwise. configUSE_16_BIT_TICKS is configured in application FreeRTOSConfig.h
- * file, which defines how many bits tick count type has. See further details and limitation about event
- * group and configUSE_16_BIT_TICKS in FreeRTOS site.
+ * @note pthread_barrier_init() is implemented with a counter and two bits of a FreeRTOS
+ * event group, so count is not limited by the number of event group bits.
  */
 int pthread_barrier_init( pthread_barrier_t * barrier,
                           const pthread_barrierattr_t * attr,
@@ -228,7 +265,7 @@ int pthread_barrier_init( pthread_barrier_t * barrier,
  *
  * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_barrier_wait.html
  *
- * @retval PTHREAD_BARRIER_SERIAL_THREAD - Upon successful completion, the first thread.
+ * @retval PTHREAD_BARRIER_SERIAL_THREAD - Upon successful completion, the last thread to enter the barrier.
  * @retval 0 - Upon successful completion, other thread(s).
  */
 int pthread_barrier_wait( pthread_barrier_t * barrier );
@@ -344,6 +381,15 @@ int pthread_getschedparam( pthread_t thread,
                            int * policy,
                            struct sched_param * param );
 
+/**
+ * @brief Thread-specific data management.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_getspecific.html
+ *
+ * @return The value bound to key in the calling thread, or NULL if no value is bound.
+ */
+void * pthread_getspecific( pthread_key_t key );
+
 /**
  * @brief Wait for thread termination.
  *
@@ -370,6 +416,37 @@ int pthread_join( pthread_t thread,
  */
 int pthread_detach( pthread_t thread );
 
+/**
+ * @brief Thread-specific data key creation.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_key_create.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EAGAIN - All PTHREAD_KEYS_MAX keys are in use.
+ *
+ * @note Each key is a FreeRTOS thread local storage pointer, from index
+ * posixconfigPTHREAD_KEY_TLS_INDEX on. The port must define that index to
+ * enable pthread keys. destructor is called when a thread created by
+ * pthread_create exits with a non-NULL value bound to key.
+ */
+int pthread_key_create( pthread_key_t * key,
+                        void ( * destructor )( void * ) );
+
+/**
+ * @brief Thread-specific data key deletion.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_key_delete.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The key value is invalid.
+ *
+ * @note Values bound to key are set to NULL in the calling task and in every
+ * thread created by pthread_create that has not exited, without calling the
+ * destructor. Other FreeRTOS tasks must set their value to NULL before the key
+ * is deleted, as a later pthread_key_create may return the same key.
+ */
+int pthread_key_delete( pthread_key_t key );
+
 /**
  * @brief Destroy a mutex.
  *
@@ -484,10 +561,227 @@ int pthread_mutexattr_init( pthread_mutexattr_t * attr );
  *
  * @retval 0 - Upon successful completion.
  * @retval EINVAL - The value type is invalid.
+ *
+ * @note A PTHREAD_MUTEX_ADAPTIVE_NP mutex is locked and unlocked without a kernel call
+ * unless it is contended. A thread that finds it locked retries up to posixconfigSPIN_COUNT
+ * times before it blocks on a FreeRTOS binary semaphore. Unlike the other types, its owner
+ * does not inherit the priority of blocked threads.
  */
 int pthread_mutexattr_settype( pthread_mutexattr_t * attr,
                                int type );
 
+/**
+ * @brief Destroy a read-write lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_destroy.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EBUSY - The rwlock is locked. It is not destroyed.
+ */
+int pthread_rwlock_destroy( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Initialize a read-write lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_init.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval ENOMEM - Insufficient memory exists to initialize the rwlock.
+ * @retval EAGAIN - Unable to initialize the rwlock structure member(s).
+ *
+ * @note Writers hold a FreeRTOS mutex while they own the rwlock, so readers and
+ * writers blocked behind a writer raise its priority. Readers holding the rwlock
+ * do not inherit the priority of a waiting writer.
+ */
+int pthread_rwlock_init( pthread_rwlock_t * rwlock,
+                         const pthread_rwlockattr_t * attr );
+
+/**
+ * @brief Lock a read-write lock object for reading.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_rdlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ *
+ * @note With PTHREAD_RWLOCK_PREFER_WRITER_NP, a thread that already holds a read
+ * lock deadlocks if it read locks again while a writer is waiting.
+ */
+int pthread_rwlock_rdlock( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Lock a read-write lock for reading with a timeout.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_timedrdlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The abstime parameter specified a nanoseconds field value less than zero or
+ *                  greater than or equal to 1000 million.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ * @retval ETIMEDOUT - The lock could not be acquired before the specified timeout expired.
+ */
+int pthread_rwlock_timedrdlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime );
+
+/**
+ * @brief Lock a read-write lock for writing with a timeout.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_timedwrlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The abstime parameter specified a nanoseconds field value less than zero or
+ *                  greater than or equal to 1000 million.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ * @retval ETIMEDOUT - The lock could not be acquired before the specified timeout expired.
+ */
+int pthread_rwlock_timedwrlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime );
+
+/**
+ * @brief Attempt to lock a read-write lock object for reading. Fail immediately if it is write locked.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_tryrdlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ * @retval EBUSY - The rwlock could not be acquired for reading because a writer holds the lock or,
+ *                 with PTHREAD_RWLOCK_PREFER_WRITER_NP, is waiting for it.
+ */
+int pthread_rwlock_tryrdlock( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Attempt to lock a read-write lock object for writing. Fail immediately if it is locked.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_trywrlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ * @retval EBUSY - The rwlock could not be acquired for writing because it was already locked
+ *                 for reading or writing.
+ */
+int pthread_rwlock_trywrlock( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Unlock a read-write lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_unlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EPERM - The current thread does not hold a lock on the rwlock.
+ *
+ * @note Read locks are not tracked per thread, so EPERM is only detected when the rwlock
+ * is not read locked by any thread.
+ */
+int pthread_rwlock_unlock( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Lock a read-write lock object for writing.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlock_wrlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EDEADLK - The current thread already owns the rwlock for writing.
+ */
+int pthread_rwlock_wrlock( pthread_rwlock_t * rwlock );
+
+/**
+ * @brief Destroy the read-write lock attributes object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlockattr_destroy.html
+ *
+ * @retval 0 - Upon successful completion.
+ */
+int pthread_rwlockattr_destroy( pthread_rwlockattr_t * attr );
+
+/**
+ * @brief Get the read-write lock kind attribute.
+ *
+ * Non-portable extension, following glibc.
+ *
+ * @retval 0 - Upon successful completion.
+ */
+int pthread_rwlockattr_getkind_np( const pthread_rwlockattr_t * attr,
+                                   int * pref );
+
+/**
+ * @brief Initialize the read-write lock attributes object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_rwlockattr_init.html
+ *
+ * @retval 0 - Upon successful completion.
+ *
+ * @note Currently, only the kind attribute is supported. Also see pthread_rwlockattr_setkind_np()
+ *       and pthread_rwlockattr_getkind_np().
+ */
+int pthread_rwlockattr_init( pthread_rwlockattr_t * attr );
+
+/**
+ * @brief Set the read-write lock kind attribute.
+ *
+ * Non-portable extension, following glibc.
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The value pref is not PTHREAD_RWLOCK_PREFER_READER_NP or
+ *                  PTHREAD_RWLOCK_PREFER_WRITER_NP.
+ */
+int pthread_rwlockattr_setkind_np( pthread_rwlockattr_t * attr,
+                                   int pref );
+
+/**
+ * @brief Destroy a spin lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_spin_destroy.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EBUSY - The spin lock is locked. It is not destroyed.
+ */
+int pthread_spin_destroy( pthread_spinlock_t * lock );
+
+/**
+ * @brief Initialize a spin lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_spin_init.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The value of pshared is not PTHREAD_PROCESS_PRIVATE or PTHREAD_PROCESS_SHARED.
+ */
+int pthread_spin_init( pthread_spinlock_t * lock,
+                       int pshared );
+
+/**
+ * @brief Lock a spin lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_spin_lock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EDEADLK - The calling thread already holds the lock.
+ *
+ * @note The holder of the lock may be a preempted thread of lower priority, which
+ * cannot run while the caller spins. After every posixconfigSPIN_COUNT failed attempts,
+ * the caller sleeps for one tick.
+ */
+int pthread_spin_lock( pthread_spinlock_t * lock );
+
+/**
+ * @brief Attempt to lock a spin lock object. Fail immediately if it is locked.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_spin_trylock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EBUSY - A thread currently holds the lock.
+ */
+int pthread_spin_trylock( pthread_spinlock_t * lock );
+
+/**
+ * @brief Unlock a spin lock object.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_spin_unlock.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EPERM - The calling thread does not hold the lock.
+ */
+int pthread_spin_unlock( pthread_spinlock_t * lock );
+
 /**
  * @brief Get the calling thread ID.
  *
@@ -510,4 +804,15 @@ int pthread_setschedparam( pthread_t thread,
                            int policy,
                            const struct sched_param * param );
 
+/**
+ * @brief Thread-specific data management.
+ *
+ * @see http://pubs.opengroup.org/onlinepubs/9699919799/functions/pthread_setspecific.html
+ *
+ * @retval 0 - Upon successful completion.
+ * @retval EINVAL - The key value is invalid.
+ */
+int pthread_setspecific( pthread_key_t key,
+                         const void * value );
+
 #endif /* _FREERTOS_POSIX_PTHREAD_H_ */
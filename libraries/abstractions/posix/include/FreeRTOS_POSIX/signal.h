@@ -65,7 +65,7 @@ struct sigevent
     int sigev_signo;                                  /**< Signal number. This member is ignored. */
     union sigval sigev_value;                         /**< Signal value. Only the sival_ptr member is used. */
     void ( * sigev_notify_function )( union sigval ); /**< Notification function. */
-    pthread_attr_t * sigev_notify_attributes;         /**< Notification attributes. */
+    pthread_attr_t * sigev_notify_attributes;         /**< Notification attributes. Only checked by timer_create. */
 };
 
 #endif /* ifndef _FREERTOS_POSIX_SIGNAL_H_ */
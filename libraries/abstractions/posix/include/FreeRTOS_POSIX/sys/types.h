@@ -125,6 +125,16 @@ typedef void                         * pthread_barrierattr_t;
     typedef void                     * pthread_condattr_t;
 #endif
 
+/**
+ * @ingroup posix_datatypes_handles
+ * @brief Used for thread-specific data keys.
+ *
+ * Enabled/disabled by posixconfigENABLE_PTHREAD_KEY_T.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_KEY_T ) || ( posixconfigENABLE_PTHREAD_KEY_T == 1 )
+    typedef int                      pthread_key_t;
+#endif
+
 /**
  * @ingroup posix_datatypes_handles
  * @brief Used for mutexes.
@@ -145,6 +155,36 @@ typedef void                         * pthread_barrierattr_t;
     typedef PthreadMutexAttrType_t   pthread_mutexattr_t;
 #endif
 
+/**
+ * @ingroup posix_datatypes_handles
+ * @brief Used for reader-writer locks.
+ *
+ * Enabled/disabled by posixconfigENABLE_PTHREAD_RWLOCK_T.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_RWLOCK_T ) || ( posixconfigENABLE_PTHREAD_RWLOCK_T == 1 )
+    typedef PthreadRwlockType_t      pthread_rwlock_t;
+#endif
+
+/**
+ * @ingroup posix_datatypes_handles
+ * @brief Used to identify a reader-writer lock attribute object.
+ *
+ * Enabled/disabled by posixconfigENABLE_PTHREAD_RWLOCKATTR_T.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_RWLOCKATTR_T ) || ( posixconfigENABLE_PTHREAD_RWLOCKATTR_T == 1 )
+    typedef PthreadRwlockAttrType_t  pthread_rwlockattr_t;
+#endif
+
+/**
+ * @ingroup posix_datatypes_handles
+ * @brief Used for spin locks.
+ *
+ * Enabled/disabled by posixconfigENABLE_PTHREAD_SPINLOCK_T.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_SPINLOCK_T ) || ( posixconfigENABLE_PTHREAD_SPINLOCK_T == 1 )
+    typedef PthreadSpinlockType_t    pthread_spinlock_t;
+#endif
+
 /**
  * @ingroup posix_datatypes_handles
  * @brief Used to identify a thread.
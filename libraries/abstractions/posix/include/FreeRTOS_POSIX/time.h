@@ -217,13 +217,18 @@ int nanosleep( const struct timespec * rqtp,
  *
  * @note clock_id is ignored, as this function used the FreeRTOS tick count as its clock.
  * @note evp.sigev_notify must be set to SIGEV_THREAD, since signals are currently not supported.
+ * @note Notification functions of all timers run in a pool of posixconfigTIMER_NOTIFY_THREADS
+ * threads, created on first use with posixconfigTIMER_NOTIFY_STACK_SIZE and
+ * posixconfigTIMER_NOTIFY_PRIORITY. evp.sigev_notify_attributes may be NULL; otherwise,
+ * only its stack size and priority are checked against those of the pool.
  *
  * @retval 0 - Upon successful completion, with location referenced by timerid updated.
  * @retval -1 - If an error occurs. errno is also set.
  *
  * @sideeffect Possible errno values
  * <br>
- * ENOTSUP - If evp is NULL OR evp->sigen_notify == SIGEV_SIGNAL.
+ * ENOTSUP - If evp is NULL OR evp->sigen_notify == SIGEV_SIGNAL OR evp->sigev_notify_attributes
+ * requests a larger stack size or a higher priority than those of the notification threads.
  * <br>
  * EAGAIN - The system lacks sufficient signal queuing resources to honor the request.
  */
@@ -245,7 +250,13 @@ int timer_delete( timer_t timerid );
  *
  * http://pubs.opengroup.org/onlinepubs/9699919799/functions/timer_getoverrun.html
  *
- * @retval 0 - Always return 0, since signals are not supported.
+ * @note Unlike POSIX, where the overrun count applies to the notification being
+ * delivered, this count is cumulative: it is never reset when a notification is
+ * delivered, and expirations whose notification was queued are not counted.
+ *
+ * @return The number of expirations of this timer, since timer_create, whose
+ * notification was dropped because posixconfigTIMER_NOTIFY_QUEUE_LENGTH
+ * notifications were already waiting for a thread.
  */
 int timer_getoverrun( timer_t timerid );
 
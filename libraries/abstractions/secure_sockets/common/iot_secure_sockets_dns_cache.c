@@ -0,0 +1,164 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_dns_cache.c
+ * @brief Host name cache shared by the Secure Sockets ports.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Secure Sockets includes. */
+#include "iot_secure_sockets_dns_cache.h"
+
+#if ( socketsconfigDNS_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Cached address of one host.
+ *
+ * An entry is free when ulAddress is 0.
+ */
+    typedef struct SocketsDnsCacheEntry
+    {
+        char cHostName[ securesocketsMAX_DNS_NAME_LENGTH + 1 ]; /**< NUL terminated host name. */
+        uint32_t ulAddress;                                    /**< IPv4 address of the host. */
+        TickType_t xStored;                                    /**< Tick count when the address was resolved. */
+        TickType_t xUsed;                                      /**< Tick count of the last lookup that returned it. */
+    } SocketsDnsCacheEntry_t;
+
+/*
+ * The cache is small and only locked for string compares, so the scheduler
+ * is suspended rather than creating a mutex.
+ */
+    static SocketsDnsCacheEntry_t xDnsCache[ socketsconfigDNS_CACHE_ENTRIES ];
+
+/*-----------------------------------------------------------*/
+
+    BaseType_t SOCKETS_DnsCacheLookup( const char * pcHostName,
+                                       uint32_t * pulAddress )
+    {
+        BaseType_t xFound = pdFALSE;
+        TickType_t xNow;
+        size_t xEntry;
+
+        if( ( NULL != pcHostName ) && ( NULL != pulAddress ) )
+        {
+            vTaskSuspendAll();
+            {
+                xNow = xTaskGetTickCount();
+
+                for( xEntry = 0; xEntry < socketsconfigDNS_CACHE_ENTRIES; xEntry++ )
+                {
+                    if( ( 0U != xDnsCache[ xEntry ].ulAddress ) &&
+                        ( 0 == strcmp( xDnsCache[ xEntry ].cHostName, pcHostName ) ) )
+                    {
+                        if( ( xNow - xDnsCache[ xEntry ].xStored ) < pdMS_TO_TICKS( socketsconfigDNS_CACHE_TTL_MS ) )
+                        {
+                            xDnsCache[ xEntry ].xUsed = xNow;
+                            *pulAddress = xDnsCache[ xEntry ].ulAddress;
+                            xFound = pdTRUE;
+                        }
+                        else
+                        {
+                            /* Expired, resolve it again. */
+                            xDnsCache[ xEntry ].ulAddress = 0;
+                        }
+
+                        break;
+                    }
+                }
+            }
+            ( void ) xTaskResumeAll();
+        }
+
+        return xFound;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_DnsCacheStore( const char * pcHostName,
+                                uint32_t ulAddress )
+    {
+        size_t xEntry;
+        size_t xVictim = 0;
+        size_t xLength;
+        TickType_t xNow;
+
+        if( ( NULL != pcHostName ) && ( 0U != ulAddress ) )
+        {
+            xLength = strlen( pcHostName );
+
+            if( xLength <= ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
+            {
+                vTaskSuspendAll();
+                {
+                    xNow = xTaskGetTickCount();
+
+                    /* Prefer the entry of the same host, then a free entry,
+                     * then the least recently used one. */
+                    for( xEntry = 0; xEntry < socketsconfigDNS_CACHE_ENTRIES; xEntry++ )
+                    {
+                        if( ( 0U != xDnsCache[ xEntry ].ulAddress ) &&
+                            ( 0 == strcmp( xDnsCache[ xEntry ].cHostName, pcHostName ) ) )
+                        {
+                            xVictim = xEntry;
+                            break;
+                        }
+
+                        if( ( 0U != xDnsCache[ xVictim ].ulAddress ) &&
+                            ( ( 0U == xDnsCache[ xEntry ].ulAddress ) ||
+                              ( ( xNow - xDnsCache[ xEntry ].xUsed ) > ( xNow - xDnsCache[ xVictim ].xUsed ) ) ) )
+                        {
+                            xVictim = xEntry;
+                        }
+                    }
+
+                    ( void ) memcpy( xDnsCache[ xVictim ].cHostName, pcHostName, xLength + 1U );
+                    xDnsCache[ xVictim ].ulAddress = ulAddress;
+                    xDnsCache[ xVictim ].xStored = xNow;
+                    xDnsCache[ xVictim ].xUsed = xNow;
+                }
+                ( void ) xTaskResumeAll();
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_DnsCacheFlush( void )
+    {
+        vTaskSuspendAll();
+        {
+            ( void ) memset( xDnsCache, 0, sizeof( xDnsCache ) );
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+#endif /* if ( socketsconfigDNS_CACHE_ENTRIES > 0 ) */
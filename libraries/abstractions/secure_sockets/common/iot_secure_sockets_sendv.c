@@ -0,0 +1,130 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_sendv.c
+ * @brief Gathered send shared by the Secure Sockets ports.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* Secure Sockets includes. */
+#include "iot_secure_sockets_sendv.h"
+
+int32_t SOCKETS_SendvCoalesce( NetworkSend_t xSend,
+                               void * pvSendContext,
+                               const SocketsIOVec_t * pxIoVec,
+                               size_t xIoVecCount )
+{
+    uint8_t ucCoalesceBuffer[ socketsconfigSENDV_COALESCE_SIZE ];
+    const uint8_t * pucData = NULL;
+    const uint8_t * pucSend = NULL;
+    size_t xVector = 0, xOffset = 0, xPending = 0, xSendLength = 0, xCopyLength = 0;
+    int32_t lSent = 0;
+    BaseType_t xResult = 0;
+
+    for( ; ; )
+    {
+        pucSend = NULL;
+
+        if( xVector == xIoVecCount )
+        {
+            if( xPending == 0U )
+            {
+                break;
+            }
+
+            /* Flush the gathered tail of the last buffers. */
+            pucSend = ucCoalesceBuffer;
+            xSendLength = xPending;
+        }
+        else if( xOffset == pxIoVec[ xVector ].xLength )
+        {
+            xVector++;
+            xOffset = 0;
+        }
+        else
+        {
+            pucData = ( const uint8_t * ) pxIoVec[ xVector ].pvBuffer;
+
+            if( ( xPending == 0U ) &&
+                ( ( pxIoVec[ xVector ].xLength - xOffset ) >= sizeof( ucCoalesceBuffer ) ) )
+            {
+                /* Nothing is gathered, so the buffer is sent in place. */
+                pucSend = &pucData[ xOffset ];
+                xSendLength = pxIoVec[ xVector ].xLength - xOffset;
+                xOffset = pxIoVec[ xVector ].xLength;
+            }
+            else
+            {
+                xCopyLength = sizeof( ucCoalesceBuffer ) - xPending;
+
+                if( xCopyLength > ( pxIoVec[ xVector ].xLength - xOffset ) )
+                {
+                    xCopyLength = pxIoVec[ xVector ].xLength - xOffset;
+                }
+
+                memcpy( &ucCoalesceBuffer[ xPending ], &pucData[ xOffset ], xCopyLength );
+                xPending += xCopyLength;
+                xOffset += xCopyLength;
+
+                if( xPending == sizeof( ucCoalesceBuffer ) )
+                {
+                    pucSend = ucCoalesceBuffer;
+                    xSendLength = xPending;
+                }
+            }
+        }
+
+        if( pucSend != NULL )
+        {
+            xResult = xSend( pvSendContext, pucSend, xSendLength );
+
+            if( xResult < 0 )
+            {
+                break;
+            }
+
+            lSent += ( int32_t ) xResult;
+
+            if( ( size_t ) xResult < xSendLength )
+            {
+                /* Timed out; report what was sent so far. */
+                break;
+            }
+
+            if( pucSend == ucCoalesceBuffer )
+            {
+                xPending = 0U;
+            }
+        }
+    }
+
+    return ( xResult < 0 ) ? ( int32_t ) xResult : lSent;
+}
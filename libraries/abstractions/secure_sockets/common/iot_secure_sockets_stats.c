@@ -0,0 +1,177 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_stats.c
+ * @brief Traffic and latency counters shared by the Secure Sockets ports.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Secure Sockets includes. */
+#include "iot_secure_sockets_stats.h"
+#include "iot_tls.h"
+
+#if ( socketsconfigENABLE_STATS == 1 )
+
+/*
+ * Counters of all sockets since boot. The counters are updated with a few
+ * additions, so the scheduler is suspended rather than creating a mutex. The
+ * counters of each socket are updated under the same lock, as the send and
+ * receive tasks of a socket may differ.
+ */
+    static SocketsStatsCounters_t xGlobalCounters;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Add the TLS records sent and received since the last call to the
+ * counters of the socket and of all sockets. Called with the scheduler
+ * suspended.
+ */
+    static void prvRecordTlsRecords( SocketsStatsCounters_t * pxCounters,
+                                     void * pvTLSContext )
+    {
+        TLSConnectionStats_t xTlsStats;
+        uint32_t ulNewRecords;
+
+        if( NULL != pvTLSContext )
+        {
+            TLS_GetConnectionStats( pvTLSContext, &xTlsStats );
+
+            ulNewRecords = xTlsStats.ulRecordsSent - pxCounters->ulTlsRecordsSent;
+            pxCounters->ulTlsRecordsSent += ulNewRecords;
+            xGlobalCounters.ulTlsRecordsSent += ulNewRecords;
+
+            ulNewRecords = xTlsStats.ulRecordsReceived - pxCounters->ulTlsRecordsReceived;
+            pxCounters->ulTlsRecordsReceived += ulNewRecords;
+            xGlobalCounters.ulTlsRecordsReceived += ulNewRecords;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_StatsRecordSend( SocketsStatsCounters_t * pxCounters,
+                                  void * pvTLSContext,
+                                  TickType_t xStart,
+                                  int32_t lResult )
+    {
+        TickType_t xElapsed = xTaskGetTickCount() - xStart;
+        uint32_t ulBytes = ( lResult > 0 ) ? ( uint32_t ) lResult : 0U;
+
+        vTaskSuspendAll();
+        {
+            pxCounters->ulSendCalls++;
+            pxCounters->ulBytesSent += ulBytes;
+            pxCounters->xSendBlockedTicks += xElapsed;
+
+            xGlobalCounters.ulSendCalls++;
+            xGlobalCounters.ulBytesSent += ulBytes;
+            xGlobalCounters.xSendBlockedTicks += xElapsed;
+
+            prvRecordTlsRecords( pxCounters, pvTLSContext );
+        }
+        ( void ) xTaskResumeAll();
+    }
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_StatsRecordRecv( SocketsStatsCounters_t * pxCounters,
+                                  void * pvTLSContext,
+                                  TickType_t xStart,
+                                  int32_t lResult )
+    {
+        TickType_t xElapsed = xTaskGetTickCount() - xStart;
+        uint32_t ulBytes = ( lResult > 0 ) ? ( uint32_t ) lResult : 0U;
+
+        vTaskSuspendAll();
+        {
+            pxCounters->ulRecvCalls++;
+            pxCounters->ulBytesReceived += ulBytes;
+            pxCounters->xRecvWaitTicks += xElapsed;
+
+            xGlobalCounters.ulRecvCalls++;
+            xGlobalCounters.ulBytesReceived += ulBytes;
+            xGlobalCounters.xRecvWaitTicks += xElapsed;
+
+            prvRecordTlsRecords( pxCounters, pvTLSContext );
+        }
+        ( void ) xTaskResumeAll();
+    }
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_StatsRecordHandshake( SocketsStatsCounters_t * pxCounters,
+                                       TickType_t xStart )
+    {
+        TickType_t xElapsed = xTaskGetTickCount() - xStart;
+
+        vTaskSuspendAll();
+        {
+            pxCounters->ulHandshakes++;
+            pxCounters->xHandshakeTicks += xElapsed;
+
+            xGlobalCounters.ulHandshakes++;
+            xGlobalCounters.xHandshakeTicks += xElapsed;
+        }
+        ( void ) xTaskResumeAll();
+    }
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_StatsGet( const SocketsStatsCounters_t * pxCounters,
+                           SocketsStats_t * pxStats )
+    {
+        SocketsStatsCounters_t xCounters;
+
+        vTaskSuspendAll();
+        {
+            xCounters = *pxCounters;
+        }
+        ( void ) xTaskResumeAll();
+
+        pxStats->ulBytesSent = xCounters.ulBytesSent;
+        pxStats->ulBytesReceived = xCounters.ulBytesReceived;
+        pxStats->ulSendCalls = xCounters.ulSendCalls;
+        pxStats->ulRecvCalls = xCounters.ulRecvCalls;
+        pxStats->ulTlsRecordsSent = xCounters.ulTlsRecordsSent;
+        pxStats->ulTlsRecordsReceived = xCounters.ulTlsRecordsReceived;
+        pxStats->ulHandshakes = xCounters.ulHandshakes;
+        pxStats->ulHandshakeTimeMs = ( uint32_t ) ( xCounters.xHandshakeTicks * portTICK_PERIOD_MS );
+        pxStats->ulSendBlockedTimeMs = ( uint32_t ) ( xCounters.xSendBlockedTicks * portTICK_PERIOD_MS );
+        pxStats->ulRecvWaitTimeMs = ( uint32_t ) ( xCounters.xRecvWaitTicks * portTICK_PERIOD_MS );
+    }
+/*-----------------------------------------------------------*/
+
+    void SOCKETS_GetGlobalStats( SocketsStats_t * pxStats )
+    {
+        if( NULL != pxStats )
+        {
+            SOCKETS_StatsGet( &xGlobalCounters, pxStats );
+        }
+    }
+
+#endif /* if ( socketsconfigENABLE_STATS == 1 ) */
@@ -31,8 +31,12 @@
 #include "FreeRTOS_IP.h"
 #include "FreeRTOS_Sockets.h"
 #include "iot_secure_sockets.h"
+#include "iot_secure_sockets_dns_cache.h"
+#include "iot_secure_sockets_sendv.h"
+#include "iot_secure_sockets_stats.h"
 #include "iot_tls.h"
 #include "task.h"
+#include "timers.h"
 #include "core_pkcs11.h"
 #include "iot_crypto.h"
 
@@ -50,8 +54,32 @@ typedef struct SSOCKETContext
     char ** ppcAlpnProtocols;
     uint32_t ulAlpnProtocolsCount;
     BaseType_t xConnectAttempted;
+    uint32_t ulWriteCombineMaxAgeMs;
+    #if ( socketsconfigENABLE_STATS == 1 )
+        SocketsStatsCounters_t xStats;
+    #endif
 } SSOCKETContext_t, * SSOCKETContextPtr_t;
 
+#if ( ipconfigDNS_USE_CALLBACKS == 1 )
+
+/* Pending SOCKETS_GetHostByNameAsync() call. It is freed once the calling
+ * task, the IP task and the timeout timer are all done with it. */
+    typedef struct SSOCKETHostRequest
+    {
+        SocketsHostResolvedCallback_t pxCallback;
+        void * pvContext;
+        StaticTimer_t xTimeoutTimerBuffer; /* Calls back with 0 if the IP task never does. */
+        BaseType_t xCalledBack;            /* pdTRUE once pxCallback has been called. */
+        BaseType_t xResolverHolds;         /* pdTRUE while the IP task may still call back. */
+        UBaseType_t uxReferences;          /* Number of the above still using the request. */
+        char * pcHostName;                 /* Copy of the host name, stored after the request. */
+    } SSOCKETHostRequest_t;
+
+/* The IP task normally times a lookup out first; the timer only catches
+ * lookups it never registered. */
+    #define socketsDNS_REQUEST_TIMEOUT_TICKS    ( 2U * pdMS_TO_TICKS( socketsconfigDNS_RESOLVE_TIMEOUT_MS ) )
+#endif
+
 /*
  * Helper routines.
  */
@@ -153,6 +181,10 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
     TLSParams_t xTLSParams = { 0 };
     struct freertos_sockaddr xTempAddress = { 0 };
 
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t xHandshakeStart;
+    #endif
+
     if( ( pxContext != ( SSOCKETContextPtr_t ) SOCKETS_INVALID_SOCKET ) && ( pxAddress != NULL ) )
     {
         /* A connection was attempted. If this function fails, then the socket is invalid and the user
@@ -178,6 +210,12 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
             xTLSParams.pvCallerContext = pxContext;
             xTLSParams.pxNetworkRecv = prvNetworkRecv;
             xTLSParams.pxNetworkSend = prvNetworkSend;
+            xTLSParams.ulWriteCombineMaxAgeMs = pxContext->ulWriteCombineMaxAgeMs;
+
+            #if ( socketsconfigENABLE_STATS == 1 )
+                xHandshakeStart = xTaskGetTickCount();
+            #endif
+
             lStatus = TLS_Init( &pxContext->pvTLSContext, &xTLSParams );
 
             if( SOCKETS_ERROR_NONE == lStatus )
@@ -189,6 +227,13 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
                     lStatus = SOCKETS_TLS_HANDSHAKE_ERROR;
                 }
             }
+
+            #if ( socketsconfigENABLE_STATS == 1 )
+                if( SOCKETS_ERROR_NONE == lStatus )
+                {
+                    SOCKETS_StatsRecordHandshake( &pxContext->xStats, xHandshakeStart );
+                }
+            #endif
         }
     }
     else
@@ -202,7 +247,210 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
 
 uint32_t SOCKETS_GetHostByName( const char * pcHostName )
 {
-    return FreeRTOS_gethostbyname( pcHostName );
+    uint32_t ulAddress = 0;
+
+    if( pdFALSE == SOCKETS_DnsCacheLookup( pcHostName, &ulAddress ) )
+    {
+        ulAddress = FreeRTOS_gethostbyname( pcHostName );
+        SOCKETS_DnsCacheStore( pcHostName, ulAddress );
+    }
+
+    return ulAddress;
+}
+/*-----------------------------------------------------------*/
+
+#if ( ipconfigDNS_USE_CALLBACKS == 1 )
+
+/*
+ * @brief Drop one reference to a SOCKETS_GetHostByNameAsync() request, and
+ * free it if it was the last.
+ */
+    static void prvHostRequestRelease( SSOCKETHostRequest_t * pxRequest )
+    {
+        UBaseType_t uxReferences = 0;
+
+        taskENTER_CRITICAL();
+        {
+            pxRequest->uxReferences--;
+            uxReferences = pxRequest->uxReferences;
+        }
+        taskEXIT_CRITICAL();
+
+        if( 0U == uxReferences )
+        {
+            vPortFree( pxRequest );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Drop the reference of the IP task, once, when it can no longer call
+ * back for the request.
+ */
+    static void prvHostRequestReleaseResolver( SSOCKETHostRequest_t * pxRequest )
+    {
+        BaseType_t xRelease = pdFALSE;
+
+        taskENTER_CRITICAL();
+        {
+            xRelease = pxRequest->xResolverHolds;
+            pxRequest->xResolverHolds = pdFALSE;
+        }
+        taskEXIT_CRITICAL();
+
+        if( pdTRUE == xRelease )
+        {
+            prvHostRequestRelease( pxRequest );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Call the callback of the request, unless it was already called.
+ */
+    static void prvHostRequestCallBack( SSOCKETHostRequest_t * pxRequest,
+                                        uint32_t ulIPAddress )
+    {
+        BaseType_t xCallBack = pdFALSE;
+
+        taskENTER_CRITICAL();
+        {
+            xCallBack = ( pdFALSE == pxRequest->xCalledBack ) ? pdTRUE : pdFALSE;
+            pxRequest->xCalledBack = pdTRUE;
+        }
+        taskEXIT_CRITICAL();
+
+        if( pdTRUE == xCallBack )
+        {
+            pxRequest->pxCallback( pxRequest->pcHostName, ulIPAddress, pxRequest->pvContext );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief DNS callback of SOCKETS_GetHostByNameAsync(), called by the IP task
+ * with the answer or with 0 on timeout. Some FreeRTOS+TCP versions also call
+ * it from FreeRTOS_gethostbyname_a() for an address they already know.
+ */
+    static void prvHostResolved( const char * pcName,
+                                 void * pvSearchID,
+                                 uint32_t ulIPAddress )
+    {
+        SSOCKETHostRequest_t * pxRequest = ( SSOCKETHostRequest_t * ) pvSearchID; /*lint !e9087 cast used for portability. */
+
+        SOCKETS_DnsCacheStore( pcName, ulIPAddress );
+        prvHostRequestCallBack( pxRequest, ulIPAddress );
+        prvHostRequestReleaseResolver( pxRequest );
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Timeout of a SOCKETS_GetHostByNameAsync() request, called by the
+ * timer task. FreeRTOS_gethostbyname_a() returns 0 without registering the
+ * callback when it cannot start the lookup, so the callback is called with 0
+ * here if the IP task has not called it.
+ */
+    static void prvHostRequestTimeout( TimerHandle_t xTimer )
+    {
+        SSOCKETHostRequest_t * pxRequest = ( SSOCKETHostRequest_t * ) pvTimerGetTimerID( xTimer ); /*lint !e9087 cast used for portability. */
+
+        /* The IP task calls back with the scheduler suspended, so once the
+         * lookup is cancelled, it has either called back or never will. */
+        FreeRTOS_gethostbyname_cancel( pxRequest );
+        prvHostRequestReleaseResolver( pxRequest );
+        prvHostRequestCallBack( pxRequest, 0U );
+
+        /* A one-shot timer is not used by the timer task once it has expired,
+         * so its memory may be freed with the request. */
+        prvHostRequestRelease( pxRequest );
+    }
+#endif /* if ( ipconfigDNS_USE_CALLBACKS == 1 ) */
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_GetHostByNameAsync( const char * pcHostName,
+                                    SocketsHostResolvedCallback_t pxCallback,
+                                    void * pvContext )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    uint32_t ulAddress = 0;
+
+    #if ( ipconfigDNS_USE_CALLBACKS == 1 )
+        SSOCKETHostRequest_t * pxRequest = NULL;
+        size_t xHostNameLength = 0;
+        TimerHandle_t xTimeoutTimer = NULL;
+    #endif
+
+    if( ( NULL == pcHostName ) || ( NULL == pxCallback ) )
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+    else if( pdTRUE == SOCKETS_DnsCacheLookup( pcHostName, &ulAddress ) )
+    {
+        pxCallback( pcHostName, ulAddress, pvContext );
+    }
+    else
+    {
+        #if ( ipconfigDNS_USE_CALLBACKS == 1 )
+            xHostNameLength = strlen( pcHostName );
+            pxRequest = pvPortMalloc( sizeof( SSOCKETHostRequest_t ) + xHostNameLength + 1U );
+
+            if( NULL == pxRequest )
+            {
+                lStatus = SOCKETS_ENOMEM;
+            }
+            else
+            {
+                pxRequest->pxCallback = pxCallback;
+                pxRequest->pvContext = pvContext;
+                pxRequest->xCalledBack = pdFALSE;
+                pxRequest->xResolverHolds = pdTRUE;
+                pxRequest->uxReferences = 3U; /* This task, the IP task and the timer. */
+                pxRequest->pcHostName = ( char * ) &pxRequest[ 1 ];
+                memcpy( pxRequest->pcHostName, pcHostName, xHostNameLength + 1U );
+
+                xTimeoutTimer = xTimerCreateStatic( "DNS",
+                                                    socketsDNS_REQUEST_TIMEOUT_TICKS,
+                                                    pdFALSE,
+                                                    pxRequest,
+                                                    prvHostRequestTimeout,
+                                                    &pxRequest->xTimeoutTimerBuffer );
+
+                ulAddress = FreeRTOS_gethostbyname_a( pcHostName,
+                                                      prvHostResolved,
+                                                      pxRequest,
+                                                      pdMS_TO_TICKS( socketsconfigDNS_RESOLVE_TIMEOUT_MS ) );
+
+                if( 0U != ulAddress )
+                {
+                    /* The IP task does not look up an address that is already
+                     * known. Depending on the FreeRTOS+TCP version, the
+                     * callback was either just called or is left to this task. */
+                    SOCKETS_DnsCacheStore( pcHostName, ulAddress );
+                    prvHostRequestCallBack( pxRequest, ulAddress );
+                    prvHostRequestReleaseResolver( pxRequest );
+
+                    /* The timer is not needed. */
+                    prvHostRequestRelease( pxRequest );
+                }
+                /* Otherwise, the IP task calls back with the answer, or the
+                 * timer calls back with 0. Without the timer, give up on the
+                 * lookup now, in case the IP task never registered it. */
+                else if( pdFAIL == xTimerStart( xTimeoutTimer, 0 ) )
+                {
+                    prvHostRequestTimeout( xTimeoutTimer );
+                }
+
+                prvHostRequestRelease( pxRequest );
+            }
+        #else /* if ( ipconfigDNS_USE_CALLBACKS == 1 ) */
+            /* FreeRTOS+TCP only resolves in the background with DNS
+             * callbacks, so the answer is waited for here. */
+            ulAddress = SOCKETS_GetHostByName( pcHostName );
+            pxCallback( pcHostName, ulAddress, pvContext );
+        #endif /* if ( ipconfigDNS_USE_CALLBACKS == 1 ) */
+    }
+
+    return lStatus;
 }
 /*-----------------------------------------------------------*/
 
@@ -214,6 +462,10 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
     int32_t lStatus = SOCKETS_SOCKET_ERROR;
     SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
 
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t xStart = xTaskGetTickCount();
+    #endif
+
     if( ( xSocket != SOCKETS_INVALID_SOCKET ) &&
         ( pvBuffer != NULL ) )
     {
@@ -229,6 +481,10 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
             /* Receive unencrypted. */
             lStatus = prvNetworkRecv( pxContext, pvBuffer, xBufferLength );
         }
+
+        #if ( socketsconfigENABLE_STATS == 1 )
+            SOCKETS_StatsRecordRecv( &pxContext->xStats, pxContext->pvTLSContext, xStart, lStatus );
+        #endif
     }
     else
     {
@@ -247,6 +503,10 @@ int32_t SOCKETS_Send( Socket_t xSocket,
     int32_t lStatus = SOCKETS_SOCKET_ERROR;
     SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
 
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t xStart = xTaskGetTickCount();
+    #endif
+
     if( ( xSocket != SOCKETS_INVALID_SOCKET ) &&
         ( pvBuffer != NULL ) )
     {
@@ -262,6 +522,51 @@ int32_t SOCKETS_Send( Socket_t xSocket,
             /* Send unencrypted. */
             lStatus = prvNetworkSend( pxContext, pvBuffer, xDataLength );
         }
+
+        #if ( socketsconfigENABLE_STATS == 1 )
+            SOCKETS_StatsRecordSend( &pxContext->xStats, pxContext->pvTLSContext, xStart, lStatus );
+        #endif
+    }
+    else
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Sendv( Socket_t xSocket,
+                       const SocketsIOVec_t * pxIoVec,
+                       size_t xIoVecCount,
+                       uint32_t ulFlags )
+{
+    int32_t lStatus = SOCKETS_SOCKET_ERROR;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t xStart = xTaskGetTickCount();
+    #endif
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) &&
+        ( pxIoVec != NULL ) )
+    {
+        pxContext->xSendFlags = ( BaseType_t ) ulFlags;
+
+        if( pdTRUE == pxContext->xRequireTLS )
+        {
+            /* Send through TLS pipe, if negotiated. */
+            lStatus = SOCKETS_SendvCoalesce( TLS_Send, pxContext->pvTLSContext, pxIoVec, xIoVecCount );
+        }
+        else
+        {
+            /* Send unencrypted. */
+            lStatus = SOCKETS_SendvCoalesce( prvNetworkSend, pxContext, pxIoVec, xIoVecCount );
+        }
+
+        #if ( socketsconfigENABLE_STATS == 1 )
+            SOCKETS_StatsRecordSend( &pxContext->xStats, pxContext->pvTLSContext, xStart, lStatus );
+        #endif
     }
     else
     {
@@ -349,6 +654,24 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 
                 break;
 
+            case SOCKETS_SO_TLS_WRITE_COMBINE:
+
+                /* Do not change TLS options if the socket is possibly already connected. */
+                if( pxContext->xConnectAttempted == pdTRUE )
+                {
+                    lStatus = SOCKETS_EISCONN;
+                }
+                else if( ( NULL == pvOptionValue ) || ( xOptionLength != sizeof( uint32_t ) ) )
+                {
+                    lStatus = SOCKETS_EINVAL;
+                }
+                else
+                {
+                    pxContext->ulWriteCombineMaxAgeMs = *( ( const uint32_t * ) pvOptionValue ); /*lint !e9087 pvOptionValue is checked for NULL above. */
+                }
+
+                break;
+
             case SOCKETS_SO_ALPN_PROTOCOLS:
 
                 /* Do not set the ALPN option if the socket is already connected. */
@@ -462,6 +785,54 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 }
 /*-----------------------------------------------------------*/
 
+int32_t SOCKETS_GetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            void * pvOptionValue,
+                            size_t * pxOptionLength )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+
+    /* Unused parameters, and the context without metrics. */
+    ( void ) lLevel;
+    ( void ) pxContext;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) && ( xSocket != NULL ) &&
+        ( pvOptionValue != NULL ) && ( pxOptionLength != NULL ) )
+    {
+        switch( lOptionName )
+        {
+            #if ( socketsconfigENABLE_STATS == 1 )
+                case SOCKETS_SO_STATS:
+
+                    if( *pxOptionLength < sizeof( SocketsStats_t ) )
+                    {
+                        lStatus = SOCKETS_EINVAL;
+                    }
+                    else
+                    {
+                        SOCKETS_StatsGet( &pxContext->xStats, ( SocketsStats_t * ) pvOptionValue );
+                        *pxOptionLength = sizeof( SocketsStats_t );
+                    }
+
+                    break;
+            #endif /* if ( socketsconfigENABLE_STATS == 1 ) */
+
+            default:
+                lStatus = SOCKETS_ENOPROTOOPT;
+                break;
+        }
+    }
+    else
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
 int32_t SOCKETS_Shutdown( Socket_t xSocket,
                           uint32_t ulHow )
 {
@@ -656,24 +1027,35 @@ static CK_RV prvSocketsGetCryptoSession( SemaphoreHandle_t * pxSessionLock,
 BaseType_t xApplicationGetRandomNumber( uint32_t * pulNumber )
 {
     CK_RV xResult = 0;
-    SemaphoreHandle_t xSessionLock = NULL;
-    CK_SESSION_HANDLE xPkcs11Session = 0;
-    CK_FUNCTION_LIST_PTR pxPkcs11FunctionList = NULL;
     uint32_t ulRandomValue = 0;
     BaseType_t xReturn; /* Return pdTRUE if successful */
 
-    xResult = prvSocketsGetCryptoSession( &xSessionLock,
-                                          &xPkcs11Session,
-                                          &pxPkcs11FunctionList );
+    #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+        /* Serve the request from the TLS entropy pool rather than doing a
+         * token round trip for four bytes. */
+        if( TLS_GetEntropy( ( unsigned char * ) &ulRandomValue,
+                            sizeof( ulRandomValue ) ) != pdPASS )
+        {
+            xResult = CKR_FUNCTION_FAILED;
+        }
+    #else
+        SemaphoreHandle_t xSessionLock = NULL;
+        CK_SESSION_HANDLE xPkcs11Session = 0;
+        CK_FUNCTION_LIST_PTR pxPkcs11FunctionList = NULL;
 
-    if( 0 == xResult )
-    {
-        /* Request a sequence of cryptographically random byte values using
-         * PKCS#11. */
-        xResult = pxPkcs11FunctionList->C_GenerateRandom( xPkcs11Session,
-                                                          ( CK_BYTE_PTR ) &ulRandomValue,
-                                                          sizeof( ulRandomValue ) );
-    }
+        xResult = prvSocketsGetCryptoSession( &xSessionLock,
+                                              &xPkcs11Session,
+                                              &pxPkcs11FunctionList );
+
+        if( 0 == xResult )
+        {
+            /* Request a sequence of cryptographically random byte values using
+             * PKCS#11. */
+            xResult = pxPkcs11FunctionList->C_GenerateRandom( xPkcs11Session,
+                                                              ( CK_BYTE_PTR ) &ulRandomValue,
+                                                              sizeof( ulRandomValue ) );
+        }
+    #endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
 
     /* Check if any of the API calls failed. */
     if( 0 == xResult )
@@ -723,9 +1105,17 @@ uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
         if( CK_FALSE == xKeyIsInitialized )
         {
             /* One-time initialization, per boot, of the random seed. */
-            xResult = pxPkcs11FunctionList->C_GenerateRandom( xPkcs11Session,
-                                                              ( CK_BYTE_PTR ) &ullKey,
-                                                              sizeof( ullKey ) );
+            #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+                if( TLS_GetEntropy( ( unsigned char * ) &ullKey,
+                                    sizeof( ullKey ) ) != pdPASS )
+                {
+                    xResult = CKR_FUNCTION_FAILED;
+                }
+            #else
+                xResult = pxPkcs11FunctionList->C_GenerateRandom( xPkcs11Session,
+                                                                  ( CK_BYTE_PTR ) &ullKey,
+                                                                  sizeof( ullKey ) );
+            #endif
 
             if( xResult == CKR_OK )
             {
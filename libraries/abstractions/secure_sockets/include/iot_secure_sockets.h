@@ -171,6 +171,8 @@ typedef struct xSOCKET * Socket_t; /**< @brief Socket handle data type. */
 #define SOCKETS_SO_TCPKEEPALIVE_INTERVAL         ( 19 ) /**< Set the time in seconds between individual TCP keep-alive probes. */
 #define SOCKETS_SO_TCPKEEPALIVE_COUNT            ( 20 ) /**< Set the maximum number of keep-alive probes TCP should send before dropping the connection. */
 #define SOCKETS_SO_TCPKEEPALIVE_IDLE_TIME        ( 21 ) /**< Set the time in seconds for which the connection needs to remain idle before TCP starts sending keep-alive probes. */
+#define SOCKETS_SO_TLS_WRITE_COMBINE             ( 22 ) /**< Combine small sends into full TLS records. */
+#define SOCKETS_SO_STATS                         ( 23 ) /**< Get the traffic and latency counters of the socket, with SOCKETS_GetSockOpt() only. */
 
 /**@} */
 
@@ -205,6 +207,36 @@ typedef struct SocketsSockaddr
     uint32_t ulAddress;     /**< IP Address. Convention is to call this sin_addr. */
 } SocketsSockaddr_t;
 
+/**
+ * @brief One buffer of a gathered send, see SOCKETS_Sendv().
+ */
+typedef struct SocketsIOVec
+{
+    const void * pvBuffer; /**< Start of the data to send. */
+    size_t xLength;        /**< Number of bytes to send from pvBuffer. */
+} SocketsIOVec_t;
+
+/**
+ * @brief Traffic and latency counters of a socket, see @ref SOCKETS_SO_STATS,
+ * or of all sockets, see SOCKETS_GetGlobalStats().
+ *
+ * Times are measured with the tick count, so calls shorter than a tick may
+ * not be accounted for. Counters wrap around.
+ */
+typedef struct SocketsStats
+{
+    uint32_t ulBytesSent;          /**< Bytes of application data sent. */
+    uint32_t ulBytesReceived;      /**< Bytes of application data received. */
+    uint32_t ulSendCalls;          /**< Number of SOCKETS_Send() and SOCKETS_Sendv() calls. */
+    uint32_t ulRecvCalls;          /**< Number of SOCKETS_Recv() calls. */
+    uint32_t ulTlsRecordsSent;     /**< Number of TLS records of application data sent. */
+    uint32_t ulTlsRecordsReceived; /**< Number of TLS records of application data received. */
+    uint32_t ulHandshakes;         /**< Number of successful TLS handshakes. */
+    uint32_t ulHandshakeTimeMs;    /**< Time spent in successful TLS handshakes. */
+    uint32_t ulSendBlockedTimeMs;  /**< Time spent in send calls, waiting for buffer space and TLS. */
+    uint32_t ulRecvWaitTimeMs;     /**< Time spent in receive calls, waiting for data and TLS. */
+} SocketsStats_t;
+
 /**
  * @brief Well-known port numbers.
  */
@@ -385,6 +417,38 @@ int32_t SOCKETS_Send( Socket_t xSocket,
                       uint32_t ulFlags );
 /* @[declare_secure_sockets_send] */
 
+/**
+ * @brief Transmit the data of several buffers, in order, to the remote socket.
+ *
+ * The socket must have already been created using a call to SOCKETS_Socket() and
+ * connected to a remote socket using SOCKETS_Connect().
+ *
+ * On a TLS socket the buffers are packed into as few TLS records as
+ * possible: small buffers are gathered into records of up to
+ * @ref socketsconfigSENDV_COALESCE_SIZE bytes, while the rest of larger
+ * buffers is handed to TLS without being copied. This avoids both
+ * concatenating the buffers in the caller and sending one record per buffer.
+ *
+ * @note This function is only provided by ports that set
+ * @ref socketsconfigSENDV_SUPPORTED to 1.
+ *
+ * @param[in] xSocket The handle of the sending socket.
+ * @param[in] pxIoVec The buffers containing the data to be sent.
+ * @param[in] xIoVecCount The number of buffers in pxIoVec.
+ * @param[in] ulFlags Not currently used. Should be set to 0.
+ *
+ * @return
+ * * On success, the number of bytes actually sent is returned. It is smaller
+ *   than the total length of the buffers if the send timed out.
+ * * If an error occurred, a negative value is returned. @ref SocketsErrors
+ */
+/* @[declare_secure_sockets_sendv] */
+int32_t SOCKETS_Sendv( Socket_t xSocket,
+                       const SocketsIOVec_t * pxIoVec,
+                       size_t xIoVecCount,
+                       uint32_t ulFlags );
+/* @[declare_secure_sockets_sendv] */
+
 /**
  * @brief Closes all or part of a full-duplex connection on the socket.
  *
@@ -514,6 +578,17 @@ int32_t SOCKETS_Close( Socket_t xSocket );
  *      - The ALPN list is expressed as an array of NULL-terminated ANSI
  *        strings.
  *      - xOptionLength is the number of items in the array.
+ *    - @ref SOCKETS_SO_TLS_WRITE_COMBINE
+ *      - Buffer small sends and encrypt them together into records of the
+ *        negotiated maximum fragment length, instead of one record each.
+ *      - Buffered data is sent by SOCKETS_Recv(), SOCKETS_Close(), or once
+ *        it is older than the maximum age, by a software timer where
+ *        configUSE_TIMERS and INCLUDE_xTimerPendFunctionCall are 1 and by the
+ *        next send otherwise.
+ *      - This socket option should be set before SOCKETS_Connect() is
+ *        called.
+ *      - pvOptionValue is a pointer to a uint32_t maximum age in
+ *        milliseconds, 0xFFFFFFFF to only send on receive or close.
  *    - @ref SOCKETS_SO_TCPKEEPALIVE
  *      - Enable or disable the TCP keep-alive functionality.
  *      - pvOptionValue is the value to enable or disable Keepalive.
@@ -541,6 +616,45 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
                             size_t xOptionLength );
 /* @[declare_secure_sockets_setsockopt] */
 
+/**
+ * @brief Reads an option of the socket.
+ *
+ * @param[in] xSocket The handle of the socket to read the option of.
+ * @param[in] lLevel Not currently used. Should be set to 0.
+ * @param[in] lOptionName See @ref SetSockOptOptions.
+ * @param[out] pvOptionValue A buffer for the value of the option.
+ * @param[in,out] pxOptionLength The length of the buffer pointed to by
+ * pvOptionValue, set to the length of the value on success.
+ *
+ * - Supported options
+ *   - @ref SOCKETS_SO_STATS
+ *     - Get the traffic and latency counters of the socket.
+ *     - pvOptionValue is a pointer to a SocketsStats_t.
+ *     - Only supported when socketsconfigENABLE_STATS is 1.
+ *
+ * @return
+ * * On success, 0 is returned.
+ * * If an error occurred, a negative value is returned. @ref SocketsErrors
+ */
+/* @[declare_secure_sockets_getsockopt] */
+int32_t SOCKETS_GetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            void * pvOptionValue,
+                            size_t * pxOptionLength );
+/* @[declare_secure_sockets_getsockopt] */
+
+#if ( socketsconfigENABLE_STATS == 1 )
+
+/**
+ * @brief Get the counters of all sockets since boot, e.g. to publish them
+ * with Device Defender metrics.
+ *
+ * @param[out] pxStats Snapshot of the counters.
+ */
+    void SOCKETS_GetGlobalStats( SocketsStats_t * pxStats );
+#endif
+
 /**
  * @brief Resolve a host name using Domain Name Service.
  *
@@ -557,6 +671,39 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 uint32_t SOCKETS_GetHostByName( const char * pcHostName );
 /* @[declare_secure_sockets_gethostbyname] */
 
+/**
+ * @brief Completion callback of SOCKETS_GetHostByNameAsync().
+ *
+ * @param[in] pcHostName The host name that was resolved.
+ * @param[in] ulAddress The IPv4 address of the host, or 0 if it could not be
+ * resolved.
+ * @param[in] pvContext The context passed to SOCKETS_GetHostByNameAsync().
+ */
+typedef void ( * SocketsHostResolvedCallback_t )( const char * pcHostName,
+                                                  uint32_t ulAddress,
+                                                  void * pvContext );
+
+/**
+ * @brief Resolve a host name without waiting for the answer.
+ *
+ * The callback is called exactly once if the resolution was started. It is
+ * called from the calling task when the address is cached, and otherwise from
+ * the task of the TCP/IP stack or, if the lookup could not be started or
+ * never completes, with 0 from the timer service task. It must not block.
+ *
+ * @param[in] pcHostName The host name to resolve.
+ * @param[in] pxCallback The function to call with the address.
+ * @param[in] pvContext Passed to pxCallback.
+ *
+ * @return
+ * * On success, 0 is returned.
+ * * If an error occurred, a negative value is returned and pxCallback is not
+ *   called. @ref SocketsErrors
+ */
+int32_t SOCKETS_GetHostByNameAsync( const char * pcHostName,
+                                    SocketsHostResolvedCallback_t pxCallback,
+                                    void * pvContext );
+
 
 
 /**
@@ -69,4 +69,66 @@
     #define AWS_IOT_SECURE_SOCKETS_METRICS_ENABLED    ( 0 )
 #endif
 
+/**
+ * @brief Whether the FreeRTOS+TCP and lwIP ports count the traffic and the
+ * time spent in each socket, readable with SOCKETS_GetSockOpt() and
+ * SOCKETS_GetGlobalStats().
+ *
+ * Disabled by default, as every send and receive then updates the counters
+ * with the scheduler suspended. When set to 1,
+ * common/iot_secure_sockets_stats.c must be built together with the port.
+ */
+#ifndef socketsconfigENABLE_STATS
+    #define socketsconfigENABLE_STATS    ( 0 )
+#endif
+
+/**
+ * @brief Whether the Secure Sockets port provides SOCKETS_Sendv().
+ *
+ * The FreeRTOS+TCP and lwIP ports do, and must be built together with
+ * common/iot_secure_sockets_sendv.c. When this is 0, callers such as the
+ * Secure Sockets transport send each buffer with SOCKETS_Send() instead.
+ */
+#ifndef socketsconfigSENDV_SUPPORTED
+    #define socketsconfigSENDV_SUPPORTED    ( 0 )
+#endif
+
+/**
+ * @brief Size of the buffer SOCKETS_Sendv() uses to gather small buffers
+ * into a single TLS record.
+ *
+ * The buffer is on the stack of the sending task.
+ */
+#ifndef socketsconfigSENDV_COALESCE_SIZE
+    #define socketsconfigSENDV_COALESCE_SIZE    ( 128 )
+#endif
+
+/**
+ * @brief Number of host name addresses kept by SOCKETS_GetHostByName() and
+ * SOCKETS_GetHostByNameAsync().
+ *
+ * Zero disables the cache. Otherwise common/iot_secure_sockets_dns_cache.c
+ * must be built together with the port.
+ */
+#ifndef socketsconfigDNS_CACHE_ENTRIES
+    #define socketsconfigDNS_CACHE_ENTRIES    ( 0 )
+#endif
+
+/**
+ * @brief Time in milliseconds for which a cached address is used.
+ *
+ * The TCP/IP stacks do not report the TTL of a DNS answer through their
+ * resolver APIs, so this must not exceed the TTL of the resolved hosts.
+ */
+#ifndef socketsconfigDNS_CACHE_TTL_MS
+    #define socketsconfigDNS_CACHE_TTL_MS    ( 60000 )
+#endif
+
+/**
+ * @brief Time in milliseconds after which a host name resolution fails.
+ */
+#ifndef socketsconfigDNS_RESOLVE_TIMEOUT_MS
+    #define socketsconfigDNS_RESOLVE_TIMEOUT_MS    ( 20000 )
+#endif
+
 #endif /* AWS_INC_SECURE_SOCKETS_CONFIG_DEFAULTS_H_ */
@@ -0,0 +1,77 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_dns_cache.h
+ * @brief Host name cache shared by the Secure Sockets ports.
+ *
+ * The ports look up a host name here before asking the DNS resolver of their
+ * TCP/IP stack, and store every address the resolver returns. When
+ * socketsconfigDNS_CACHE_ENTRIES is 0 the functions compile to nothing.
+ */
+
+#ifndef _AWS_SECURE_SOCKETS_DNS_CACHE_H_
+#define _AWS_SECURE_SOCKETS_DNS_CACHE_H_
+
+#include "iot_secure_sockets.h"
+
+#if ( socketsconfigDNS_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Get the cached address of a host.
+ *
+ * @param[in] pcHostName The host name to look up.
+ * @param[out] pulAddress The IPv4 address of the host.
+ *
+ * @return pdTRUE if an address younger than socketsconfigDNS_CACHE_TTL_MS was
+ * found, pdFALSE otherwise.
+ */
+    BaseType_t SOCKETS_DnsCacheLookup( const char * pcHostName,
+                                       uint32_t * pulAddress );
+
+/**
+ * @brief Cache the address of a host, replacing the least recently used
+ * entry when the cache is full.
+ *
+ * @param[in] pcHostName The host name.
+ * @param[in] ulAddress The IPv4 address the resolver returned for it.
+ */
+    void SOCKETS_DnsCacheStore( const char * pcHostName,
+                                uint32_t ulAddress );
+
+/**
+ * @brief Forget all cached addresses, e.g. after a network change.
+ */
+    void SOCKETS_DnsCacheFlush( void );
+
+#else /* if ( socketsconfigDNS_CACHE_ENTRIES > 0 ) */
+
+    #define SOCKETS_DnsCacheLookup( pcHostName, pulAddress )    ( pdFALSE )
+    #define SOCKETS_DnsCacheStore( pcHostName, ulAddress )
+    #define SOCKETS_DnsCacheFlush()
+
+#endif /* if ( socketsconfigDNS_CACHE_ENTRIES > 0 ) */
+
+#endif /* _AWS_SECURE_SOCKETS_DNS_CACHE_H_ */
@@ -0,0 +1,63 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_sendv.h
+ * @brief Gathered send shared by the Secure Sockets ports.
+ *
+ * The ports implement SOCKETS_Sendv() by passing the buffers to
+ * SOCKETS_SendvCoalesce() together with the function that sends on the
+ * socket, which is TLS_Send() on a TLS socket.
+ */
+
+#ifndef _AWS_SECURE_SOCKETS_SENDV_H_
+#define _AWS_SECURE_SOCKETS_SENDV_H_
+
+#include "iot_secure_sockets.h"
+#include "iot_tls.h"
+
+/**
+ * @brief Send the buffers of a gathered send, in order, with xSend.
+ *
+ * Buffers shorter than socketsconfigSENDV_COALESCE_SIZE are gathered, along
+ * with the head of the buffer that follows them, into one call to xSend so
+ * that TLS emits a single record for them. The remainder of longer buffers is
+ * passed to xSend without being copied. The gathering buffer is on the stack
+ * of the calling task.
+ *
+ * @param[in] xSend The function that sends on the socket.
+ * @param[in] pvSendContext The context passed to xSend.
+ * @param[in] pxIoVec The buffers containing the data to be sent.
+ * @param[in] xIoVecCount The number of buffers in pxIoVec.
+ *
+ * @return The number of bytes sent, which is smaller than the total length
+ * of the buffers if xSend timed out, or the negative value returned by xSend.
+ */
+int32_t SOCKETS_SendvCoalesce( NetworkSend_t xSend,
+                               void * pvSendContext,
+                               const SocketsIOVec_t * pxIoVec,
+                               size_t xIoVecCount );
+
+#endif /* _AWS_SECURE_SOCKETS_SENDV_H_ */
@@ -0,0 +1,106 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_stats.h
+ * @brief Traffic and latency counters shared by the Secure Sockets ports.
+ *
+ * The ports keep a SocketsStatsCounters_t in each socket and record every
+ * send, receive and TLS handshake in it. The records are also added to the
+ * counters of all sockets. Only available when socketsconfigENABLE_STATS
+ * is 1.
+ */
+
+#ifndef _AWS_SECURE_SOCKETS_STATS_H_
+#define _AWS_SECURE_SOCKETS_STATS_H_
+
+#include "iot_secure_sockets.h"
+
+#if ( socketsconfigENABLE_STATS == 1 )
+
+/**
+ * @brief Counters of a socket. Times are kept in ticks.
+ */
+    typedef struct SocketsStatsCounters
+    {
+        uint32_t ulBytesSent;
+        uint32_t ulBytesReceived;
+        uint32_t ulSendCalls;
+        uint32_t ulRecvCalls;
+        uint32_t ulTlsRecordsSent;
+        uint32_t ulTlsRecordsReceived;
+        uint32_t ulHandshakes;
+        TickType_t xHandshakeTicks;
+        TickType_t xSendBlockedTicks;
+        TickType_t xRecvWaitTicks;
+    } SocketsStatsCounters_t;
+
+/**
+ * @brief Record a send call.
+ *
+ * @param[in] pxCounters The counters of the socket.
+ * @param[in] pvTLSContext The TLS context of the socket, or NULL.
+ * @param[in] xStart Tick count when the call started.
+ * @param[in] lResult Value returned by the call.
+ */
+    void SOCKETS_StatsRecordSend( SocketsStatsCounters_t * pxCounters,
+                                  void * pvTLSContext,
+                                  TickType_t xStart,
+                                  int32_t lResult );
+
+/**
+ * @brief Record a receive call.
+ *
+ * @param[in] pxCounters The counters of the socket.
+ * @param[in] pvTLSContext The TLS context of the socket, or NULL.
+ * @param[in] xStart Tick count when the call started.
+ * @param[in] lResult Value returned by the call.
+ */
+    void SOCKETS_StatsRecordRecv( SocketsStatsCounters_t * pxCounters,
+                                  void * pvTLSContext,
+                                  TickType_t xStart,
+                                  int32_t lResult );
+
+/**
+ * @brief Record a successful TLS handshake.
+ *
+ * @param[in] pxCounters The counters of the socket.
+ * @param[in] xStart Tick count when the handshake started.
+ */
+    void SOCKETS_StatsRecordHandshake( SocketsStatsCounters_t * pxCounters,
+                                       TickType_t xStart );
+
+/**
+ * @brief Get a snapshot of the counters of a socket.
+ *
+ * @param[in] pxCounters The counters of the socket.
+ * @param[out] pxStats The counters, with times in milliseconds.
+ */
+    void SOCKETS_StatsGet( const SocketsStatsCounters_t * pxCounters,
+                           SocketsStats_t * pxStats );
+
+#endif /* if ( socketsconfigENABLE_STATS == 1 ) */
+
+#endif /* _AWS_SECURE_SOCKETS_STATS_H_ */
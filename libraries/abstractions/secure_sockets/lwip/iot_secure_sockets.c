@@ -30,6 +30,9 @@
 
 /* Secure Socket interface includes. */
 #include "iot_secure_sockets.h"
+#include "iot_secure_sockets_dns_cache.h"
+#include "iot_secure_sockets_sendv.h"
+#include "iot_secure_sockets_stats.h"
 
 
 #include "lwip/sockets.h"
@@ -45,41 +48,31 @@
 
 #include "task.h"
 
+#include "semphr.h"
+
 #include "event_groups.h"
 
 #include <stdbool.h>
 
-/*
- * The loop delay used while waiting for DNS resolution
- * to complete.
- */
-
-#define lwip_dns_resolver_LOOP_DELAY_MS       ( 250 )
-#define lwip_dns_resolver_LOOP_DELAY_TICKS    ( ( TickType_t ) lwip_dns_resolver_LOOP_DELAY_MS / portTICK_PERIOD_MS )
-
-/*
- * The maximum time to wait for DNS resolution
- * to complete.
- */
-#define lwip_dns_resolver_MAX_WAIT_SECONDS    ( 20 )
-
-/*
- * The maximum number of loop iterations to wait for DNS
- * resolution to complete.
- */
-#define lwip_dns_resolver_MAX_WAIT_CYCLES                 \
-    ( ( ( lwip_dns_resolver_MAX_WAIT_SECONDS ) * 1000 ) / \
-      ( lwip_dns_resolver_LOOP_DELAY_MS ) )
-
 /*-----------------------------------------------------------*/
 
 #define SS_STATUS_CONNECTED               ( 1 )
 #define SS_STATUS_SECURED                 ( 2 )
 
-#define SECURE_SOCKETS_SELECT_WAIT_SEC    ( 10 )
+/*
+ * A registration change wakes the receive reactor through a loopback UDP
+ * socket when lwIP can deliver to 127.0.0.1. Otherwise the reactor picks up
+ * new sockets after at most SECURE_SOCKETS_REACTOR_POLL_MS.
+ */
+#if ( LWIP_UDP != 0 ) && ( ( LWIP_HAVE_LOOPIF != 0 ) || ( LWIP_NETIF_LOOPBACK != 0 ) )
+    #define SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET    ( 1 )
+#else
+    #define SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET    ( 0 )
+#endif
 
-#define SOCKETS_START_DELETION            ( 0x01 )
-#define SOCKETS_COMPLETE_DELETION         ( 0x02 )
+#define SECURE_SOCKETS_REACTOR_POLL_MS              ( 100 )
+
+#define SOCKETS_REACTOR_DISPATCH_DONE               ( 0x01 )
 
 /*
  * secure socket context.
@@ -101,9 +94,7 @@ typedef struct _ss_ctx_t
     int send_flag;
     int recv_flag;
 
-    TaskHandle_t rx_handle;
     void ( * rx_callback )( Socket_t pxSocket );
-    EventGroupHandle_t rx_EventGroup;
 
     bool enforce_tls;
     void * tls_ctx;
@@ -115,8 +106,35 @@ typedef struct _ss_ctx_t
     char ** ppcAlpnProtocols;
     uint32_t ulAlpnProtocolsCount;
     uint32_t ulRefcount;
+
+    uint32_t write_combine_max_age_ms;
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        SocketsStatsCounters_t stats;
+    #endif
 } ss_ctx_t;
 
+/*
+ * Pending SOCKETS_GetHostByNameAsync() call, freed by the DNS callback.
+ */
+typedef struct _ss_dns_request_t
+{
+    SocketsHostResolvedCallback_t callback;
+    void * context;
+} ss_dns_request_t;
+
+/*
+ * SOCKETS_GetHostByName() waiting for SOCKETS_GetHostByNameAsync(). It is
+ * freed by the last of the waiting task and the callback, as the waiting task
+ * may time out before lwIP answers.
+ */
+typedef struct _ss_dns_wait_t
+{
+    SemaphoreHandle_t done;
+    uint32_t addr;
+    uint32_t ulRefcount;
+} ss_dns_wait_t;
+
 /*-----------------------------------------------------------*/
 
 /*#define SUPPORTED_DESCRIPTORS  (2) */
@@ -126,6 +144,24 @@ typedef struct _ss_ctx_t
 /*static int8_t sockets_allocated = SUPPORTED_DESCRIPTORS; */
 static int8_t sockets_allocated = socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS;
 
+/*
+ * State of the receive reactor, the single task that waits for data on every
+ * socket with a SOCKETS_SO_WAKEUP_CALLBACK and calls the callbacks. All of it
+ * is guarded by xReactorMutex. A registered socket holds a reference on its
+ * ctx, which is dropped when the callback is cleared or the socket closed.
+ */
+static SemaphoreHandle_t xReactorMutex = NULL;
+static EventGroupHandle_t xReactorEventGroup = NULL;
+static TaskHandle_t xReactorTask = NULL;
+static ss_ctx_t * pxReactorSockets[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static uint32_t ulReactorSocketCount = 0;
+static ss_ctx_t * pxReactorDispatching = NULL;
+
+#if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
+    static int lReactorWakeupSocket = -1;
+    static struct sockaddr_in xReactorWakeupAddress;
+#endif
+
 
 /*-----------------------------------------------------------*/
 
@@ -273,120 +309,303 @@ static BaseType_t prvNetworkRecv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
-static void vTaskRxSelect( void * param )
-{
-    ss_ctx_t * ctx = ( ss_ctx_t * ) param;
-    int s = ctx->ip_socket;
-    struct timeval tv;
+#if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
 
-    fd_set s_fds;
-    fd_set read_fds;
-    fd_set write_fds;
-    fd_set err_fds;
+/*
+ * @brief Create the loopback UDP socket used to wake the reactor from
+ *        lwip_select. Called with xReactorMutex held.
+ */
+    static void prvReactorWakeupInit( void )
+    {
+        struct sockaddr_in xAddress = { 0 };
+        socklen_t xAddressLength = sizeof( xAddress );
+        int lSocket;
 
-    FD_ZERO( &s_fds );
-    FD_ZERO( &read_fds );
-    FD_ZERO( &write_fds );
-    FD_ZERO( &err_fds );
+        lSocket = lwip_socket( AF_INET, SOCK_DGRAM, 0 );
 
-    FD_SET( s, &s_fds );
+        if( lSocket >= 0 )
+        {
+            xAddress.sin_family = AF_INET;
+            xAddress.sin_port = 0;
+            xAddress.sin_addr.s_addr = PP_HTONL( INADDR_LOOPBACK );
 
-    ctx->state = SST_RX_READY;
+            if( ( lwip_bind( lSocket, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) ) == 0 ) &&
+                ( lwip_getsockname( lSocket, ( struct sockaddr * ) &xAddress, &xAddressLength ) == 0 ) )
+            {
+                xReactorWakeupAddress = xAddress;
+                lReactorWakeupSocket = lSocket;
+            }
+            else
+            {
+                lwip_close( lSocket );
+            }
+        }
+    }
 
-    tv.tv_sec = SECURE_SOCKETS_SELECT_WAIT_SEC;
-    tv.tv_usec = 0;
+#endif /* if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 ) */
 
-    while( 1 )
-    {
-        if( ctx->state == SST_RX_CLOSING )
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Make the reactor rebuild its select set now instead of after its
+ *        current lwip_select call times out.
+ */
+static void prvReactorWakeup( void )
+{
+    #if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
+        uint8_t ucWakeup = 0;
+
+        if( lReactorWakeupSocket >= 0 )
         {
-            ctx->state = SST_RX_CLOSED;
-            break;
+            ( void ) lwip_sendto( lReactorWakeupSocket,
+                                  &ucWakeup,
+                                  sizeof( ucWakeup ),
+                                  0,
+                                  ( struct sockaddr * ) &xReactorWakeupAddress,
+                                  sizeof( xReactorWakeupAddress ) );
         }
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Receive reactor task.
+ *
+ * Waits in one lwip_select call for data on every registered socket and calls
+ * their callbacks without holding xReactorMutex, so a callback may read from,
+ * clear the callback of, or close its socket. The task deletes itself once no
+ * socket is registered and is created again by the next registration.
+ */
+static void prvRxReactorTask( void * pvParameters )
+{
+    ss_ctx_t * pxSelected[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+    void ( * pxCallback )( Socket_t pxSocket );
+    fd_set xReadSet;
+    struct timeval xTimeout;
+    struct timeval * pxTimeout = &xTimeout;
+    int lMaxSocket;
+    int lResult;
+    uint32_t ulIndex;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        FD_ZERO( &xReadSet );
+        lMaxSocket = -1;
 
-        read_fds = s_fds;
-        err_fds = s_fds;
+        ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
 
-        if( lwip_select( s + 1, &read_fds, &write_fds, &err_fds, &tv ) == -1 )
+        if( ulReactorSocketCount == 0 )
         {
+            xReactorTask = NULL;
+            ( void ) xSemaphoreGive( xReactorMutex );
             break;
         }
 
-        if( FD_ISSET( s, &read_fds ) )
+        for( ulIndex = 0; ulIndex < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; ulIndex++ )
         {
-            ctx->rx_callback( ( Socket_t ) ctx );
+            pxSelected[ ulIndex ] = pxReactorSockets[ ulIndex ];
+
+            if( pxSelected[ ulIndex ] != NULL )
+            {
+                FD_SET( pxSelected[ ulIndex ]->ip_socket, &xReadSet );
+
+                if( pxSelected[ ulIndex ]->ip_socket > lMaxSocket )
+                {
+                    lMaxSocket = pxSelected[ ulIndex ]->ip_socket;
+                }
+            }
         }
 
-        if( xEventGroupWaitBits( ctx->rx_EventGroup, SOCKETS_START_DELETION, pdTRUE, pdTRUE, 0 ) == SOCKETS_START_DELETION )
+        ( void ) xSemaphoreGive( xReactorMutex );
+
+        xTimeout.tv_sec = SECURE_SOCKETS_REACTOR_POLL_MS / 1000;
+        xTimeout.tv_usec = ( SECURE_SOCKETS_REACTOR_POLL_MS % 1000 ) * 1000;
+
+        #if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
+            if( lReactorWakeupSocket >= 0 )
+            {
+                FD_SET( lReactorWakeupSocket, &xReadSet );
+
+                if( lReactorWakeupSocket > lMaxSocket )
+                {
+                    lMaxSocket = lReactorWakeupSocket;
+                }
+
+                /* Registration changes wake the reactor, so block until they do. */
+                pxTimeout = NULL;
+            }
+        #endif
+
+        lResult = lwip_select( lMaxSocket + 1, &xReadSet, NULL, NULL, pxTimeout );
+
+        if( lResult < 0 )
         {
-            /* Inform the main task that the event has been received. */
-            ( void ) xEventGroupSetBits( ctx->rx_EventGroup, SOCKETS_COMPLETE_DELETION );
-            break;
+            /* A socket was closed under the select; retry with a fresh set
+             * without spinning. */
+            vTaskDelay( pdMS_TO_TICKS( SECURE_SOCKETS_REACTOR_POLL_MS ) );
+            continue;
         }
-    }
 
-    prvDecrementRefCount( ctx );
+        #if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
+            if( ( lReactorWakeupSocket >= 0 ) && FD_ISSET( lReactorWakeupSocket, &xReadSet ) )
+            {
+                uint8_t ucWakeup[ 8 ];
+
+                while( lwip_recv( lReactorWakeupSocket, ucWakeup, sizeof( ucWakeup ), MSG_DONTWAIT ) > 0 )
+                {
+                    /* Drain every pending wakeup. */
+                }
+            }
+        #endif
+
+        ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
+
+        for( ulIndex = 0; ( lResult > 0 ) && ( ulIndex < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ); ulIndex++ )
+        {
+            /* Skip sockets cleared or replaced while the reactor was selecting. */
+            if( ( pxSelected[ ulIndex ] != NULL ) &&
+                ( pxSelected[ ulIndex ] == pxReactorSockets[ ulIndex ] ) &&
+                FD_ISSET( pxSelected[ ulIndex ]->ip_socket, &xReadSet ) )
+            {
+                pxReactorDispatching = pxSelected[ ulIndex ];
+                pxCallback = pxReactorDispatching->rx_callback;
+                ( void ) xSemaphoreGive( xReactorMutex );
+
+                pxCallback( ( Socket_t ) pxSelected[ ulIndex ] );
+
+                /* The ctx may have been freed by the callback; do not touch it. */
+                ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
+                pxReactorDispatching = NULL;
+                ( void ) xEventGroupSetBits( xReactorEventGroup, SOCKETS_REACTOR_DISPATCH_DONE );
+            }
+        }
+
+        ( void ) xSemaphoreGive( xReactorMutex );
+    }
 
     vTaskDelete( NULL );
 }
 
-
 /*-----------------------------------------------------------*/
 
-static void prvRxSelectSet( ss_ctx_t * ctx,
-                            const void * pvOptionValue )
+static int32_t prvRxSelectSet( ss_ctx_t * ctx,
+                               const void * pvOptionValue )
 {
-    BaseType_t xReturned;
-    TaskHandle_t xHandle = NULL;
-    configSTACK_DEPTH_TYPE xStackDepth = socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH;
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    bool bRegistered = false;
+    uint32_t ulIndex;
 
-    ctx->rx_callback = ( void ( * )( Socket_t ) )pvOptionValue;
+    configASSERT( xReactorMutex != NULL );
+
+    ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
+
+    if( ctx->rx_callback == NULL )
+    {
+        for( ulIndex = 0; ulIndex < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; ulIndex++ )
+        {
+            if( pxReactorSockets[ ulIndex ] == NULL )
+            {
+                pxReactorSockets[ ulIndex ] = ctx;
+                ulReactorSocketCount++;
+                prvIncrementRefCount( ctx );
+                bRegistered = true;
+                break;
+            }
+        }
 
-    prvIncrementRefCount( ctx );
+        /* There is a slot for every socket that can be allocated. */
+        configASSERT( bRegistered == true );
+    }
+
+    ctx->rx_callback = ( void ( * )( Socket_t ) )pvOptionValue;
 
-    ctx->rx_EventGroup = xEventGroupCreate();
+    if( xReactorTask == NULL )
+    {
+        #if ( SECURE_SOCKETS_REACTOR_WAKEUP_SOCKET == 1 )
+            if( lReactorWakeupSocket < 0 )
+            {
+                prvReactorWakeupInit();
+            }
+        #endif
+
+        if( xTaskCreate( prvRxReactorTask,                               /* pvTaskCode */
+                         "rxs",                                          /* pcName */
+                         socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH, /* usStackDepth */
+                         NULL,                                           /* pvParameters */
+                         1,                                              /* uxPriority */
+                         &xReactorTask ) != pdPASS )                     /* pxCreatedTask */
+        {
+            xReactorTask = NULL;
+            lStatus = SOCKETS_ENOMEM;
+        }
+    }
 
-    configASSERT( ctx->rx_EventGroup != NULL );
+    if( ( lStatus != SOCKETS_ERROR_NONE ) && ( bRegistered == true ) )
+    {
+        pxReactorSockets[ ulIndex ] = NULL;
+        ulReactorSocketCount--;
+        ctx->rx_callback = NULL;
+        prvDecrementRefCount( ctx );
+    }
 
-    xReturned = xTaskCreate( vTaskRxSelect, /* pvTaskCode */
-                             "rxs",         /* pcName */
-                             xStackDepth,   /* usStackDepth */
-                             ctx,           /* pvParameters */
-                             1,             /* uxPriority */
-                             &xHandle );    /* pxCreatedTask */
+    ( void ) xSemaphoreGive( xReactorMutex );
 
-    configASSERT( xReturned == pdPASS );
-    configASSERT( xHandle != NULL );
+    prvReactorWakeup();
 
-    ctx->rx_handle = xHandle;
+    return lStatus;
 }
 
 /*-----------------------------------------------------------*/
 
 static void prvRxSelectClear( ss_ctx_t * ctx )
 {
-    /* Inform the vTaskRxSelect to delete itself. */
-    xEventGroupSetBits( ctx->rx_EventGroup, SOCKETS_START_DELETION );
-
-    /* Wait for the task to delete itself. */
-    while( xEventGroupWaitBits( ctx->rx_EventGroup,
-                                SOCKETS_COMPLETE_DELETION,
-                                pdTRUE,
-                                pdTRUE,
-                                pdMS_TO_TICKS( SECURE_SOCKETS_SELECT_WAIT_SEC * 1000 ) ) !=
-           SOCKETS_COMPLETE_DELETION )
-    {
-        /* Continue waiting for the task to delete itself. */
-    }
+    bool bRegistered = false;
+    uint32_t ulIndex;
 
-    /* Reset the handle of the task to NULL. */
-    ctx->rx_handle = NULL;
+    ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
 
-    /* Delete the event group. */
-    vEventGroupDelete( ctx->rx_EventGroup );
+    for( ulIndex = 0; ulIndex < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; ulIndex++ )
+    {
+        if( pxReactorSockets[ ulIndex ] == ctx )
+        {
+            pxReactorSockets[ ulIndex ] = NULL;
+            ulReactorSocketCount--;
+            bRegistered = true;
+            break;
+        }
+    }
 
     /* Remove the reference to the callback. */
     ctx->rx_callback = NULL;
+
+    /* Wait for a callback running for this socket on the reactor to return,
+     * unless it is that callback which is clearing itself. */
+    while( ( pxReactorDispatching == ctx ) &&
+           ( xTaskGetCurrentTaskHandle() != xReactorTask ) )
+    {
+        ( void ) xEventGroupClearBits( xReactorEventGroup, SOCKETS_REACTOR_DISPATCH_DONE );
+        ( void ) xSemaphoreGive( xReactorMutex );
+        ( void ) xEventGroupWaitBits( xReactorEventGroup,
+                                      SOCKETS_REACTOR_DISPATCH_DONE,
+                                      pdFALSE,
+                                      pdTRUE,
+                                      portMAX_DELAY );
+        ( void ) xSemaphoreTake( xReactorMutex, portMAX_DELAY );
+    }
+
+    ( void ) xSemaphoreGive( xReactorMutex );
+
+    /* Let the reactor drop the socket from its select set, or exit if it was
+     * the last one. */
+    prvReactorWakeup();
+
+    if( bRegistered == true )
+    {
+        prvDecrementRefCount( ctx );
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -542,6 +761,10 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
         TLSParams_t tls_params = { 0 };
         BaseType_t status;
 
+        #if ( socketsconfigENABLE_STATS == 1 )
+            TickType_t handshake_start = xTaskGetTickCount();
+        #endif
+
         ctx->status |= SS_STATUS_CONNECTED;
 
         if( !ctx->enforce_tls )
@@ -558,6 +781,7 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
         tls_params.pxNetworkSend = prvNetworkSend;
         tls_params.ppcAlpnProtocols = ( const char ** ) ctx->ppcAlpnProtocols;
         tls_params.ulAlpnProtocolsCount = ctx->ulAlpnProtocolsCount;
+        tls_params.ulWriteCombineMaxAgeMs = ctx->write_combine_max_age_ms;
 
         status = TLS_Init( &ctx->tls_ctx, &tls_params );
 
@@ -572,6 +796,11 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
         if( pdFREERTOS_ERRNO_NONE == status )
         {
             ctx->status |= SS_STATUS_SECURED;
+
+            #if ( socketsconfigENABLE_STATS == 1 )
+                SOCKETS_StatsRecordHandshake( &ctx->stats, handshake_start );
+            #endif
+
             return SOCKETS_ERROR_NONE;
         }
         else
@@ -597,6 +826,11 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
                       uint32_t ulFlags )
 {
     ss_ctx_t * ctx = ( ss_ctx_t * ) xSocket;
+    int32_t ret;
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t start = xTaskGetTickCount();
+    #endif
 
     if( SOCKETS_INVALID_SOCKET == xSocket )
     {
@@ -620,12 +854,18 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
     if( ctx->enforce_tls )
     {
         /* Receive through TLS pipe, if negotiated. */
-        return TLS_Recv( ctx->tls_ctx, pvBuffer, xBufferLength );
+        ret = TLS_Recv( ctx->tls_ctx, pvBuffer, xBufferLength );
     }
     else
     {
-        return prvNetworkRecv( ( void * ) ctx, pvBuffer, xBufferLength );
+        ret = prvNetworkRecv( ( void * ) ctx, pvBuffer, xBufferLength );
     }
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        SOCKETS_StatsRecordRecv( &ctx->stats, ctx->tls_ctx, start, ret );
+    #endif
+
+    return ret;
 }
 
 /*-----------------------------------------------------------*/
@@ -636,6 +876,11 @@ int32_t SOCKETS_Send( Socket_t xSocket,
                       uint32_t ulFlags )
 {
     ss_ctx_t * ctx;
+    int32_t ret;
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t start = xTaskGetTickCount();
+    #endif
 
     if( SOCKETS_INVALID_SOCKET == xSocket )
     {
@@ -660,12 +905,69 @@ int32_t SOCKETS_Send( Socket_t xSocket,
     if( ctx->enforce_tls )
     {
         /* Send through TLS pipe, if negotiated. */
-        return TLS_Send( ctx->tls_ctx, pvBuffer, xDataLength );
+        ret = TLS_Send( ctx->tls_ctx, pvBuffer, xDataLength );
+    }
+    else
+    {
+        ret = prvNetworkSend( ( void * ) ctx, pvBuffer, xDataLength );
+    }
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        SOCKETS_StatsRecordSend( &ctx->stats, ctx->tls_ctx, start, ret );
+    #endif
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Sendv( Socket_t xSocket,
+                       const SocketsIOVec_t * pxIoVec,
+                       size_t xIoVecCount,
+                       uint32_t ulFlags )
+{
+    ss_ctx_t * ctx;
+    int32_t ret;
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        TickType_t start = xTaskGetTickCount();
+    #endif
+
+    if( SOCKETS_INVALID_SOCKET == xSocket )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    if( NULL == pxIoVec )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    ctx = ( ss_ctx_t * ) xSocket;
+
+    if( ( ctx->status & SS_STATUS_CONNECTED ) != SS_STATUS_CONNECTED )
+    {
+        return SOCKETS_ENOTCONN;
+    }
+
+    configASSERT( ctx->ip_socket >= 0 );
+    ctx->send_flag = ulFlags;
+
+    if( ctx->enforce_tls )
+    {
+        /* Send through TLS pipe, if negotiated. */
+        ret = SOCKETS_SendvCoalesce( TLS_Send, ctx->tls_ctx, pxIoVec, xIoVecCount );
     }
     else
     {
-        return prvNetworkSend( ( void * ) ctx, pvBuffer, xDataLength );
+        ret = SOCKETS_SendvCoalesce( prvNetworkSend, ( void * ) ctx, pxIoVec, xIoVecCount );
     }
+
+    #if ( socketsconfigENABLE_STATS == 1 )
+        SOCKETS_StatsRecordSend( &ctx->stats, ctx->tls_ctx, start, ret );
+    #endif
+
+    return ret;
 }
 
 /*-----------------------------------------------------------*/
@@ -708,6 +1010,12 @@ int32_t SOCKETS_Close( Socket_t xSocket )
     ctx = ( ss_ctx_t * ) xSocket;
     ctx->state = SST_RX_CLOSING;
 
+    /* Stop receive callbacks before the descriptor can be reused. */
+    if( ctx->rx_callback != NULL )
+    {
+        prvRxSelectClear( ctx );
+    }
+
     lwip_close( ctx->ip_socket );
     prvDecrementRefCount( ctx );
 
@@ -861,15 +1169,30 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
             if( ( xOptionLength == sizeof( void * ) ) &&
                 ( pvOptionValue != NULL ) )
             {
-                prvRxSelectSet( ctx, pvOptionValue );
+                ret = prvRxSelectSet( ctx, pvOptionValue );
             }
-            else
+            else if( ctx->rx_callback != NULL )
             {
                 prvRxSelectClear( ctx );
             }
 
             break;
 
+        case SOCKETS_SO_TLS_WRITE_COMBINE:
+
+            if( ctx->status & SS_STATUS_CONNECTED )
+            {
+                return SOCKETS_EISCONN;
+            }
+
+            if( ( NULL == pvOptionValue ) || ( sizeof( uint32_t ) != xOptionLength ) )
+            {
+                return SOCKETS_EINVAL;
+            }
+
+            ctx->write_combine_max_age_ms = *( ( const uint32_t * ) pvOptionValue );
+            break;
+
         case SOCKETS_SO_ALPN_PROTOCOLS:
 
             /* Do not set the ALPN option if the socket is already connected. */
@@ -974,6 +1297,49 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 
 /*-----------------------------------------------------------*/
 
+int32_t SOCKETS_GetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            void * pvOptionValue,
+                            size_t * pxOptionLength )
+{
+    ss_ctx_t * ctx;
+
+    ( void ) lLevel;
+
+    if( ( SOCKETS_INVALID_SOCKET == xSocket ) || ( NULL == pvOptionValue ) ||
+        ( NULL == pxOptionLength ) )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    ctx = ( ss_ctx_t * ) xSocket;
+    ( void ) ctx;
+
+    switch( lOptionName )
+    {
+        #if ( socketsconfigENABLE_STATS == 1 )
+            case SOCKETS_SO_STATS:
+
+                if( *pxOptionLength < sizeof( SocketsStats_t ) )
+                {
+                    return SOCKETS_EINVAL;
+                }
+
+                SOCKETS_StatsGet( &ctx->stats, ( SocketsStats_t * ) pvOptionValue );
+                *pxOptionLength = sizeof( SocketsStats_t );
+                break;
+        #endif /* if ( socketsconfigENABLE_STATS == 1 ) */
+
+        default:
+            return SOCKETS_ENOPROTOOPT;
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
 /*
  * Lwip DNS Found callback, compatible with type "dns_found_callback"
  * declared in lwip/dns.h.
@@ -985,70 +1351,177 @@ static void lwip_dns_found_callback( const char * name,
                                      const ip_addr_t * ipaddr,
                                      void * callback_arg )
 {
-    uint32_t * addr = ( uint32_t * ) callback_arg;
+    ss_dns_request_t * req = ( ss_dns_request_t * ) callback_arg;
+    uint32_t addr = 0;
 
     if( ipaddr != NULL )
     {
-        *addr = *( ( uint32_t * ) ipaddr ); /* NOTE: IPv4 addresses only */
+        addr = *( ( uint32_t * ) ipaddr ); /* NOTE: IPv4 addresses only */
+        SOCKETS_DnsCacheStore( name, addr );
     }
-    else
+
+    req->callback( name, addr, req->context );
+    vPortFree( req );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Drop a reference to the state of a synchronous resolution.
+ */
+static void prvDnsWaitRelease( ss_dns_wait_t * wait )
+{
+    if( Atomic_Decrement_u32( &wait->ulRefcount ) == 1 )
     {
-        *addr = 0;
+        vSemaphoreDelete( wait->done );
+        vPortFree( wait );
     }
 }
 
 /*-----------------------------------------------------------*/
 
-uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+/*
+ * @brief Completion callback of the resolution SOCKETS_GetHostByName() waits for.
+ */
+static void prvDnsWaitCallback( const char * pcHostName,
+                                uint32_t ulAddress,
+                                void * pvContext )
 {
-    uint32_t addr = 0; /* 0 indicates failure to caller */
+    ss_dns_wait_t * wait = ( ss_dns_wait_t * ) pvContext;
+
+    ( void ) pcHostName;
+
+    wait->addr = ulAddress;
+    ( void ) xSemaphoreGive( wait->done );
+    prvDnsWaitRelease( wait );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_GetHostByNameAsync( const char * pcHostName,
+                                    SocketsHostResolvedCallback_t pxCallback,
+                                    void * pvContext )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    uint32_t addr = 0;
     err_t xLwipError = ERR_OK;
     ip_addr_t xLwipIpv4Address;
-    uint32_t ulDnsResolutionWaitCycles = 0;
+    ss_dns_request_t * req = NULL;
 
-    if( strlen( pcHostName ) <= ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
+    if( ( NULL == pcHostName ) || ( NULL == pxCallback ) )
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+    else if( strlen( pcHostName ) > ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
+    {
+        configPRINTF( ( "Host name (%s) too long!", pcHostName ) );
+        lStatus = SOCKETS_EINVAL;
+    }
+    else if( pdTRUE == SOCKETS_DnsCacheLookup( pcHostName, &addr ) )
     {
-        xLwipError = dns_gethostbyname_addrtype( pcHostName, &xLwipIpv4Address,
-                                                 lwip_dns_found_callback, ( void * ) &addr,
-                                                 LWIP_DNS_ADDRTYPE_IPV4 );
+        pxCallback( pcHostName, addr, pvContext );
+    }
+    else
+    {
+        req = pvPortMalloc( sizeof( ss_dns_request_t ) );
 
-        switch( xLwipError )
+        if( NULL == req )
         {
-            case ERR_OK:
-                addr = *( ( uint32_t * ) &xLwipIpv4Address ); /* NOTE: IPv4 addresses only */
-                break;
-
-            case ERR_INPROGRESS:
+            lStatus = SOCKETS_ENOMEM;
+        }
+        else
+        {
+            req->callback = pxCallback;
+            req->context = pvContext;
 
-                /*
-                 * The DNS resolver is working the request.  Wait for it to complete
-                 * or time out; print a timeout error message if configured for debug
-                 * printing.
-                 */
-                do
-                {
-                    vTaskDelay( lwip_dns_resolver_LOOP_DELAY_TICKS );
-                }   while( ( ulDnsResolutionWaitCycles++ < lwip_dns_resolver_MAX_WAIT_CYCLES ) && addr == 0 );
+            xLwipError = dns_gethostbyname_addrtype( pcHostName, &xLwipIpv4Address,
+                                                     lwip_dns_found_callback, ( void * ) req,
+                                                     LWIP_DNS_ADDRTYPE_IPV4 );
 
-                if( addr == 0 )
-                {
-                    configPRINTF( ( "Unable to resolve (%s) within (%ul) seconds",
-                                    pcHostName, lwip_dns_resolver_MAX_WAIT_SECONDS ) );
-                }
+            switch( xLwipError )
+            {
+                case ERR_OK:
+                    /* Answered from the lwIP DNS table, there is no callback. */
+                    vPortFree( req );
+                    addr = *( ( uint32_t * ) &xLwipIpv4Address ); /* NOTE: IPv4 addresses only */
+                    SOCKETS_DnsCacheStore( pcHostName, addr );
+                    pxCallback( pcHostName, addr, pvContext );
+                    break;
 
-                break;
+                case ERR_INPROGRESS:
+                    /* lwip_dns_found_callback completes the request, and may
+                     * already have. */
+                    break;
 
-            default:
-                configPRINTF( ( "Unexpected error (%lu) from dns_gethostbyname_addrtype() while resolving (%s)!",
-                                ( uint32_t ) xLwipError, pcHostName ) );
-                break;
+                default:
+                    vPortFree( req );
+                    configPRINTF( ( "Unexpected error (%lu) from dns_gethostbyname_addrtype() while resolving (%s)!",
+                                    ( uint32_t ) xLwipError, pcHostName ) );
+                    lStatus = SOCKETS_SOCKET_ERROR;
+                    break;
+            }
         }
     }
-    else
+
+    return lStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+{
+    uint32_t addr = 0; /* 0 indicates failure to caller */
+    ss_dns_wait_t * wait = NULL;
+
+    if( strlen( pcHostName ) > ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
     {
-        addr = 0;
         configPRINTF( ( "Host name (%s) too long!", pcHostName ) );
     }
+    else if( pdTRUE == SOCKETS_DnsCacheLookup( pcHostName, &addr ) )
+    {
+        /* Nothing to wait for. */
+    }
+    else
+    {
+        wait = pvPortMalloc( sizeof( ss_dns_wait_t ) );
+
+        if( NULL != wait )
+        {
+            wait->done = xSemaphoreCreateBinary();
+            wait->addr = 0;
+            wait->ulRefcount = 2;
+
+            if( NULL == wait->done )
+            {
+                vPortFree( wait );
+                wait = NULL;
+            }
+        }
+
+        if( NULL != wait )
+        {
+            if( SOCKETS_ERROR_NONE == SOCKETS_GetHostByNameAsync( pcHostName, prvDnsWaitCallback, wait ) )
+            {
+                /* Wait for the DNS callback instead of polling. */
+                if( pdTRUE == xSemaphoreTake( wait->done, pdMS_TO_TICKS( socketsconfigDNS_RESOLVE_TIMEOUT_MS ) ) )
+                {
+                    addr = wait->addr;
+                }
+                else
+                {
+                    configPRINTF( ( "Unable to resolve (%s) within (%lu) ms",
+                                    pcHostName, ( uint32_t ) socketsconfigDNS_RESOLVE_TIMEOUT_MS ) );
+                }
+            }
+            else
+            {
+                /* The callback will not be called. */
+                prvDnsWaitRelease( wait );
+            }
+
+            prvDnsWaitRelease( wait );
+        }
+    }
 
     return addr;
 }
@@ -1061,6 +1534,17 @@ BaseType_t SOCKETS_Init( void )
 
     dns_init();
 
+    if( xReactorMutex == NULL )
+    {
+        xReactorMutex = xSemaphoreCreateMutex();
+        xReactorEventGroup = xEventGroupCreate();
+
+        if( ( xReactorMutex == NULL ) || ( xReactorEventGroup == NULL ) )
+        {
+            xResult = pdFAIL;
+        }
+    }
+
     return xResult;
 }
 
@@ -37,6 +37,7 @@
 
 /* Secure Sockets includes. */
 #include "iot_secure_sockets.h"
+#include "iot_secure_sockets_dns_cache.h"
 
 /* Test framework includes. */
 #include "unity_fixture.h"
@@ -3338,6 +3339,8 @@ TEST( Full_TCP_Extended, SOCKETS_dns_multiple_addresses )
      */
     for( i = 0; ( i < 120 ) && ( ulNumUniqueIPAddresses < dnstestNUM_UNIQUE_IP_ADDRESSES ); i++ )
     {
+        /* Ask the TCP/IP stack every time rather than the Secure Sockets cache. */
+        SOCKETS_DnsCacheFlush();
         ulIPAddress = SOCKETS_GetHostByName( clientcredentialMQTT_BROKER_ENDPOINT );
 
         for( j = 0, ulUnique = 1; j < ulNumUniqueIPAddresses; j++ )
@@ -0,0 +1,301 @@
+/*
+ * FreeRTOS Secure Sockets V1.3.1
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "portableDefs.h"
+#include "FreeRTOS.h"
+#include "FreeRTOSConfig.h"
+#include "FreeRTOS_IP.h"
+
+#include "mock_portable.h"
+#include "mock_task.h"
+#include "mock_timers.h"
+#include "mock_FreeRTOS_DNS.h"
+
+#include "iot_secure_sockets.h"
+
+
+#define RESOLVED_ADDRESS    0x0A000001UL
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint16_t malloc_free_calls = 0;
+
+/* The request allocated by SOCKETS_GetHostByNameAsync, and its frees. */
+static void * request = NULL;
+static uint32_t request_frees = 0;
+
+/* The timeout timer of the request. */
+static void * timer_id = NULL;
+static TimerCallbackFunction_t timer_callback = NULL;
+
+/* The callback registered with the resolver. */
+static FOnDNSEvent dns_callback = NULL;
+static void * dns_search_id = NULL;
+
+static uint32_t resolved_addr = 0;
+static uint32_t resolved_calls = 0;
+
+/* ==========================  CALLBACK FUNCTIONS =========================== */
+/*@null@*/ void * malloc_cb( size_t size,
+                             int numCalls )
+{
+    malloc_free_calls++;
+    request = malloc( size );
+    return request;
+}
+
+void free_cb( void * ptr,
+              int numCalls )
+{
+    malloc_free_calls--;
+
+    if( ptr == request )
+    {
+        request_frees++;
+    }
+
+    free( ptr );
+}
+
+static TimerHandle_t xTimerCreateStatic_cb( const char * const pcTimerName,
+                                            const TickType_t xTimerPeriodInTicks,
+                                            const UBaseType_t uxAutoReload,
+                                            void * const pvTimerID,
+                                            TimerCallbackFunction_t pxCallbackFunction,
+                                            StaticTimer_t * pxTimerBuffer,
+                                            int cmock_num_calls )
+{
+    TEST_ASSERT_EQUAL( pdFALSE, uxAutoReload );
+    timer_id = pvTimerID;
+    timer_callback = pxCallbackFunction;
+    return ( TimerHandle_t ) pxTimerBuffer;
+}
+
+static void * pvTimerGetTimerID_cb( const TimerHandle_t xTimer,
+                                    int cmock_num_calls )
+{
+    return timer_id;
+}
+
+static void host_resolved_cb( const char * pcHostName,
+                              uint32_t ulAddress,
+                              void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( &resolved_calls, pvContext );
+    TEST_ASSERT_EQUAL_STRING( "hostname", pcHostName );
+    resolved_addr = ulAddress;
+    resolved_calls++;
+}
+
+/* The resolver already knows the address and does not call back. */
+static uint32_t gethostbyname_a_known_CALLBACK( const char * pcHostName,
+                                                FOnDNSEvent pCallback,
+                                                void * pvSearchID,
+                                                TickType_t uxTimeout,
+                                                int cmock_num_calls )
+{
+    return RESOLVED_ADDRESS;
+}
+
+/* The resolver already knows the address, and calls back before returning
+ * as FreeRTOS+TCP V2.3 does. */
+static uint32_t gethostbyname_a_known_called_back_CALLBACK( const char * pcHostName,
+                                                            FOnDNSEvent pCallback,
+                                                            void * pvSearchID,
+                                                            TickType_t uxTimeout,
+                                                            int cmock_num_calls )
+{
+    pCallback( pcHostName, pvSearchID, RESOLVED_ADDRESS );
+    return RESOLVED_ADDRESS;
+}
+
+/* The resolver registers the callback and calls back later. */
+static uint32_t gethostbyname_a_registered_CALLBACK( const char * pcHostName,
+                                                     FOnDNSEvent pCallback,
+                                                     void * pvSearchID,
+                                                     TickType_t uxTimeout,
+                                                     int cmock_num_calls )
+{
+    dns_callback = pCallback;
+    dns_search_id = pvSearchID;
+    return 0;
+}
+
+/* ==================  Critical sections of the port layer ================== */
+void vPortEnterCritical( void )
+{
+}
+
+void vPortExitCritical( void )
+{
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    pvPortMalloc_Stub( malloc_cb );
+    vPortFree_Stub( free_cb );
+    xTimerCreateStatic_Stub( xTimerCreateStatic_cb );
+    pvTimerGetTimerID_Stub( pvTimerGetTimerID_cb );
+    xTaskGetTickCount_IgnoreAndReturn( 0 );
+
+    malloc_free_calls = 0;
+    request = NULL;
+    request_frees = 0;
+    timer_id = NULL;
+    timer_callback = NULL;
+    dns_callback = NULL;
+    dns_search_id = NULL;
+    resolved_addr = 0;
+    resolved_calls = 0;
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE( 0, malloc_free_calls,
+                                   "free is not called the same number of times as malloc, \
+            you might have a memory leak!!" );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =================  TESTING  SOCKETS_GetHostByNameAsync  ================== */
+
+/*!
+ * @brief GetHostByNameAsync of an address the resolver already knows
+ *
+ * The callback is called once before SOCKETS_GetHostByNameAsync returns,
+ * whether or not the resolver also called back, and the timer is not started.
+ */
+void test_SecureSockets_GetHostByNameAsync_known( void )
+{
+    int32_t ret;
+
+    FreeRTOS_gethostbyname_a_Stub( gethostbyname_a_known_CALLBACK );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( RESOLVED_ADDRESS, resolved_addr );
+    TEST_ASSERT_EQUAL_UINT32( 1, request_frees );
+
+    resolved_calls = 0;
+    request_frees = 0;
+
+    FreeRTOS_gethostbyname_a_Stub( gethostbyname_a_known_called_back_CALLBACK );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( RESOLVED_ADDRESS, resolved_addr );
+    TEST_ASSERT_EQUAL_UINT32( 1, request_frees );
+}
+
+/*!
+ * @brief GetHostByNameAsync answered by the resolver
+ *
+ * The resolver calls back with the answer. The timer expiring afterwards
+ * does not call back again, and frees the request.
+ */
+void test_SecureSockets_GetHostByNameAsync_registered( void )
+{
+    int32_t ret;
+
+    FreeRTOS_gethostbyname_a_Stub( gethostbyname_a_registered_CALLBACK );
+    xTimerGenericCommand_ExpectAnyArgsAndReturn( pdPASS );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 0, request_frees );
+
+    /* The IP task calls back with the answer. */
+    dns_callback( "hostname", dns_search_id, RESOLVED_ADDRESS );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( RESOLVED_ADDRESS, resolved_addr );
+    TEST_ASSERT_EQUAL_UINT32( 0, request_frees );
+
+    /* The timer task runs the expired timer. */
+    FreeRTOS_gethostbyname_cancel_Expect( dns_search_id );
+    timer_callback( ( TimerHandle_t ) timer_id );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 1, request_frees );
+}
+
+/*!
+ * @brief GetHostByNameAsync the resolver did not register
+ *
+ * FreeRTOS_gethostbyname_a returns 0 without keeping the callback, so the
+ * timer calls back with 0 and frees the request.
+ */
+void test_SecureSockets_GetHostByNameAsync_unregistered( void )
+{
+    int32_t ret;
+
+    FreeRTOS_gethostbyname_a_ExpectAnyArgsAndReturn( 0 );
+    xTimerGenericCommand_ExpectAnyArgsAndReturn( pdPASS );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 0, request_frees );
+
+    FreeRTOS_gethostbyname_cancel_Expect( timer_id );
+    timer_callback( ( TimerHandle_t ) timer_id );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_addr );
+    TEST_ASSERT_EQUAL_UINT32( 1, request_frees );
+}
+
+/*!
+ * @brief GetHostByNameAsync when the timer cannot be started
+ *
+ * The lookup is given up straight away: the callback is called with 0 and
+ * the request freed before SOCKETS_GetHostByNameAsync returns.
+ */
+void test_SecureSockets_GetHostByNameAsync_timerStartFailure( void )
+{
+    int32_t ret;
+
+    FreeRTOS_gethostbyname_a_ExpectAnyArgsAndReturn( 0 );
+    xTimerGenericCommand_ExpectAnyArgsAndReturn( pdFAIL );
+    FreeRTOS_gethostbyname_cancel_ExpectAnyArgs();
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_addr );
+    TEST_ASSERT_EQUAL_UINT32( 1, request_frees );
+}
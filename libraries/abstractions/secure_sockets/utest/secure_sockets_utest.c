@@ -24,6 +24,7 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 
 #include "unity.h"
 
@@ -35,14 +36,12 @@
 #include "mock_sockets.h"
 #include "mock_portable.h"
 #include "mock_task.h"
+#include "mock_queue.h"
 #include "mock_event_groups.h"
 #include "mock_iot_tls.h"
 #include "mock_iot_logging_task.h"
 #include "mock_dns.h"
 
-#include "wait_for_event.h"
-#include "task_control.h"
-
 #include "iot_secure_sockets.h"
 
 
@@ -315,6 +314,153 @@ void test_SecureSockets_send_not_connected( void )
     deinitSocket( so );
 }
 
+/* ======================  TESTING SOCKETS_Sendv  =========================== */
+
+/* Data passed to TLS_Send by SOCKETS_Sendv. */
+static uint8_t sendvData[ BUFFER_LEN * 4 ];
+static size_t sendvDataLength = 0;
+static size_t sendvCallLengths[ 4 ];
+
+static BaseType_t TLS_Send_sendv_cb( void * pvContext,
+                                     const unsigned char * pucMsg,
+                                     size_t xMsgLength,
+                                     int numCalls )
+{
+    TEST_ASSERT_LESS_THAN_INT( 4, numCalls );
+    memcpy( &sendvData[ sendvDataLength ], pucMsg, xMsgLength );
+    sendvDataLength += xMsgLength;
+    sendvCallLengths[ numCalls ] = xMsgLength;
+
+    return ( BaseType_t ) xMsgLength;
+}
+
+/*!
+ * @brief Small buffers are gathered into one TLS record
+ *
+ * @details The purpose of this testcase is to make sure the header and topic
+ *          of a packet are sent in the same TLS_Send call as the head of the
+ *          payload, and the rest of the payload is sent as is
+ */
+void test_SecureSockets_sendv_coalesces_tls( void )
+{
+    int32_t ret;
+    uint8_t header[ 4 ] = { 0x30, 0x01, 0x02, 0x03 };
+    char topic[] = "a/topic";
+    uint8_t payload[ BUFFER_LEN * 3 ];
+    SocketsIOVec_t ioVec[ 3 ];
+    size_t i;
+
+    for( i = 0; i < sizeof( payload ); i++ )
+    {
+        payload[ i ] = ( uint8_t ) i;
+    }
+
+    ioVec[ 0 ].pvBuffer = header;
+    ioVec[ 0 ].xLength = sizeof( header );
+    ioVec[ 1 ].pvBuffer = topic;
+    ioVec[ 1 ].xLength = strlen( topic );
+    ioVec[ 2 ].pvBuffer = payload;
+    ioVec[ 2 ].xLength = sizeof( payload );
+
+    Socket_t so = create_TLS_connection();
+
+    sendvDataLength = 0;
+    TLS_Send_Stub( TLS_Send_sendv_cb );
+    ret = SOCKETS_Sendv( so, ioVec, 3, 0 );
+    TLS_Send_Stub( NULL );
+
+    TEST_ASSERT_EQUAL_INT( sizeof( header ) + strlen( topic ) + sizeof( payload ), ret );
+    TEST_ASSERT_EQUAL_INT( ret, sendvDataLength );
+    TEST_ASSERT_EQUAL_INT( socketsconfigSENDV_COALESCE_SIZE, sendvCallLengths[ 0 ] );
+    TEST_ASSERT_EQUAL_INT( ret - socketsconfigSENDV_COALESCE_SIZE, sendvCallLengths[ 1 ] );
+    TEST_ASSERT_EQUAL_MEMORY( header, sendvData, sizeof( header ) );
+    TEST_ASSERT_EQUAL_MEMORY( topic, &sendvData[ sizeof( header ) ], strlen( topic ) );
+    TEST_ASSERT_EQUAL_MEMORY( payload, &sendvData[ sizeof( header ) + strlen( topic ) ], sizeof( payload ) );
+
+    TLS_Cleanup_ExpectAnyArgs();
+    deinitSocket( so );
+}
+
+/*!
+ * @brief A happy sendv case with normal sockets
+ *
+ * @details The purpose is to make sure buffers shorter than the coalesce
+ *          buffer are sent with a single lwip_send
+ */
+void test_SecureSockets_sendv_successful( void )
+{
+    int32_t ret;
+    const char buffer[ BUFFER_LEN ];
+    SocketsIOVec_t ioVec[ 2 ] =
+    {
+        { buffer, 10 },
+        { &buffer[ 10 ], 20 }
+    };
+
+    Socket_t so = create_normal_connection();
+
+    lwip_send_ExpectAnyArgsAndReturn( 30 );
+    ret = SOCKETS_Sendv( so, ioVec, 2, 0 );
+    TEST_ASSERT_EQUAL_INT( 30, ret );
+    deinitSocket( so );
+}
+
+/*!
+ * @brief A partial send stops SOCKETS_Sendv
+ *
+ * @details The purpose of this testcase is to make sure SOCKETS_Sendv returns
+ *          the number of bytes sent so far when TLS_Send times out
+ */
+void test_SecureSockets_sendv_partial_tls( void )
+{
+    int32_t ret;
+    uint8_t payload[ BUFFER_LEN * 3 ];
+    SocketsIOVec_t ioVec[ 2 ] =
+    {
+        { payload, sizeof( payload ) },
+        { payload, sizeof( payload ) }
+    };
+
+    Socket_t so = create_TLS_connection();
+
+    TLS_Send_ExpectAnyArgsAndReturn( BUFFER_LEN );
+    ret = SOCKETS_Sendv( so, ioVec, 2, 0 );
+    TEST_ASSERT_EQUAL_INT( BUFFER_LEN, ret );
+
+    TLS_Send_ExpectAnyArgsAndReturn( SOCKETS_SOCKET_ERROR );
+    ret = SOCKETS_Sendv( so, ioVec, 2, 0 );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_SOCKET_ERROR, ret );
+
+    TLS_Cleanup_ExpectAnyArgs();
+    deinitSocket( so );
+}
+
+/*!
+ * @brief Test various bad parameters
+ *
+ * @details The purpose of this testcase is to make sure SOCKETS_Sendv returns
+ *          errors when it receives some invalid parameters, or when the
+ *          socket is not connected
+ */
+void test_SecureSockets_sendv_invalid_parameters( void )
+{
+    const char buffer[ BUFFER_LEN ];
+    SocketsIOVec_t ioVec = { buffer, BUFFER_LEN };
+    int32_t ret;
+    Socket_t s;
+
+    ret = SOCKETS_Sendv( SOCKETS_INVALID_SOCKET, &ioVec, 1, 0 );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_SOCKET_ERROR, ret );
+
+    s = initSocket();
+    ret = SOCKETS_Sendv( s, NULL, 1, 0 );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EINVAL, ret );
+
+    ret = SOCKETS_Sendv( s, &ioVec, 1, 0 );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ENOTCONN, ret );
+    deinitSocket( s );
+}
+
 /* =====================  TESTING SOCKETS_Socket  =========================== */
 
 /*!
@@ -896,6 +1042,15 @@ void test_SecureSockets_Connect_TLS_SNI_connect_error( void )
 
 /* ====================  TESTING  SOCKETS_GetHostByName  ==================== */
 
+/* helper function to set up the kernel objects used while waiting for DNS */
+static void initDnsWait( BaseType_t xAnswered )
+{
+    xQueueGenericCreate_IgnoreAndReturn( ( QueueHandle_t ) 1 );
+    xQueueGenericSend_IgnoreAndReturn( pdTRUE );
+    xQueueSemaphoreTake_IgnoreAndReturn( xAnswered );
+    vQueueDelete_Ignore();
+}
+
 /*!
  * @brief GetHostByName  successful case
  *
@@ -906,13 +1061,13 @@ void test_SecureSockets_Connect_TLS_SNI_connect_error( void )
 void test_SecureSockets_GetHostByName_successful( void )
 {
     int32_t ret;
-    uint8_t addr = 0;
     uint32_t ret_addr = 5;
     int32_t hostnameMaxLen = securesocketsMAX_DNS_NAME_LENGTH;
     char hostname[ hostnameMaxLen ];
 
     strncpy( hostname, "this is a hostname", hostnameMaxLen );
 
+    initDnsWait( pdTRUE );
     dns_gethostbyname_addrtype_ExpectAnyArgsAndReturn( ERR_OK );
     dns_gethostbyname_addrtype_ReturnThruPtr_addr( &ret_addr );
     ret = SOCKETS_GetHostByName( hostname );
@@ -926,6 +1081,9 @@ void test_SecureSockets_GetHostByName_successful( void )
  * handles the case where lwip dns must wait for completion.
  */
 #define STUB_RETURNED_ADDRESS    5
+static dns_found_callback dns_found_stub = NULL;
+static void * dns_callback_arg_stub = NULL;
+
 static err_t dns_gethostbyname_addrtype_success_CALLBACK( const char * hostname,
                                                           ip_addr_t * addr,
                                                           dns_found_callback found,
@@ -933,9 +1091,21 @@ static err_t dns_gethostbyname_addrtype_success_CALLBACK( const char * hostname,
                                                           u8_t dns_addrtype,
                                                           int cmock_num_calls )
 {
-    uint32_t * ipv4_addr_p = ( uint32_t * ) callback_arg;
+    uint32_t ipv4_addr = STUB_RETURNED_ADDRESS;
 
-    *ipv4_addr_p = STUB_RETURNED_ADDRESS;
+    found( hostname, ( ip_addr_t * ) &ipv4_addr, callback_arg );
+    return ERR_INPROGRESS;
+}
+
+static err_t dns_gethostbyname_addrtype_pending_CALLBACK( const char * hostname,
+                                                          ip_addr_t * addr,
+                                                          dns_found_callback found,
+                                                          void * callback_arg,
+                                                          u8_t dns_addrtype,
+                                                          int cmock_num_calls )
+{
+    dns_found_stub = found;
+    dns_callback_arg_stub = callback_arg;
     return ERR_INPROGRESS;
 }
 
@@ -948,12 +1118,37 @@ void test_SecureSockets_GetHostByName_wait_success( void )
 
     strncpy( hostname, "this is a hostname", hostnameMaxLen );
 
-    vTaskDelay_CMockIgnore();
+    initDnsWait( pdTRUE );
     dns_gethostbyname_addrtype_Stub( dns_gethostbyname_addrtype_success_CALLBACK );
     ret = SOCKETS_GetHostByName( hostname );
     TEST_ASSERT_EQUAL_INT( ret_addr, ret );
 }
 
+/*!
+ * @brief GetHostByName timeout case
+ *
+ * The purpose of this test case is to make sure sockets_gethostbyname
+ * gives up waiting, and that a late answer from lwip dns is still safe.
+ */
+void test_SecureSockets_GetHostByName_timeout( void )
+{
+    int32_t ret;
+    uint32_t late_addr = STUB_RETURNED_ADDRESS;
+    int32_t hostnameMaxLen = securesocketsMAX_DNS_NAME_LENGTH;
+    char hostname[ hostnameMaxLen ];
+
+    strncpy( hostname, "this is a hostname", hostnameMaxLen );
+
+    vLoggingPrintf_Ignore();
+    initDnsWait( pdFALSE );
+    dns_gethostbyname_addrtype_Stub( dns_gethostbyname_addrtype_pending_CALLBACK );
+    ret = SOCKETS_GetHostByName( hostname );
+    TEST_ASSERT_EQUAL_INT( 0, ret );
+
+    /* The answer arrives after the caller gave up. */
+    dns_found_stub( hostname, ( ip_addr_t * ) &late_addr, dns_callback_arg_stub );
+}
+
 /*!
  * @brief GetHostByName  failure case
  *
@@ -963,18 +1158,37 @@ void test_SecureSockets_GetHostByName_wait_success( void )
 void test_SecureSockets_GetHostByName_failure( void )
 {
     int32_t ret;
-    uint8_t addr = 0;
-    uint32_t ret_addr = 5;
     int32_t hostnameMaxLen = securesocketsMAX_DNS_NAME_LENGTH;
     char hostname[ hostnameMaxLen ];
 
     strncpy( hostname, "this is a hostname", hostnameMaxLen );
 
+    vLoggingPrintf_Ignore();
+    initDnsWait( pdTRUE );
     dns_gethostbyname_addrtype_ExpectAnyArgsAndReturn( ERR_CLSD );
     ret = SOCKETS_GetHostByName( hostname );
     TEST_ASSERT_EQUAL_INT( 0, ret );
 }
 
+/*!
+ * @brief GetHostByName no memory case
+ *
+ * The purpose of this test case is to make sure sockets_gethostbyname
+ * fails cleanly when the semaphore cannot be created.
+ */
+void test_SecureSockets_GetHostByName_noSemaphore( void )
+{
+    int32_t ret;
+    int32_t hostnameMaxLen = securesocketsMAX_DNS_NAME_LENGTH;
+    char hostname[ hostnameMaxLen ];
+
+    strncpy( hostname, "this is a hostname", hostnameMaxLen );
+
+    xQueueGenericCreate_IgnoreAndReturn( NULL );
+    ret = SOCKETS_GetHostByName( hostname );
+    TEST_ASSERT_EQUAL_INT( 0, ret );
+}
+
 /*!
  * @brief GetHostByName hostname too large
  *
@@ -995,6 +1209,104 @@ void test_SecureSockets_GetHostByName_longHostname( void )
     TEST_ASSERT_EQUAL_INT( 0, ret );
 }
 
+/* =================  TESTING  SOCKETS_GetHostByNameAsync  ================== */
+
+static uint32_t resolved_addr = 0;
+static uint32_t resolved_calls = 0;
+
+static void host_resolved_cb( const char * pcHostName,
+                              uint32_t ulAddress,
+                              void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( &resolved_calls, pvContext );
+    resolved_addr = ulAddress;
+    resolved_calls++;
+}
+
+/*!
+ * @brief GetHostByNameAsync answered immediately
+ *
+ * The callback is called before SOCKETS_GetHostByNameAsync returns when lwip
+ * dns already knows the address.
+ */
+void test_SecureSockets_GetHostByNameAsync_immediate( void )
+{
+    int32_t ret;
+    uint32_t ret_addr = 7;
+
+    resolved_addr = 0;
+    resolved_calls = 0;
+
+    dns_gethostbyname_addrtype_ExpectAnyArgsAndReturn( ERR_OK );
+    dns_gethostbyname_addrtype_ReturnThruPtr_addr( &ret_addr );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( ret_addr, resolved_addr );
+}
+
+/*!
+ * @brief GetHostByNameAsync answered later
+ *
+ * The callback is called once lwip dns has the answer, and with 0 when the
+ * resolution fails.
+ */
+void test_SecureSockets_GetHostByNameAsync_pending( void )
+{
+    int32_t ret;
+    uint32_t late_addr = STUB_RETURNED_ADDRESS;
+
+    resolved_addr = 0;
+    resolved_calls = 0;
+
+    dns_gethostbyname_addrtype_Stub( dns_gethostbyname_addrtype_pending_CALLBACK );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_calls );
+
+    dns_found_stub( "hostname", ( ip_addr_t * ) &late_addr, dns_callback_arg_stub );
+    TEST_ASSERT_EQUAL_UINT32( 1, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( STUB_RETURNED_ADDRESS, resolved_addr );
+
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+
+    dns_found_stub( "hostname", NULL, dns_callback_arg_stub );
+    TEST_ASSERT_EQUAL_UINT32( 2, resolved_calls );
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_addr );
+}
+
+/*!
+ * @brief GetHostByNameAsync errors
+ *
+ * The callback is not called when the resolution cannot be started.
+ */
+void test_SecureSockets_GetHostByNameAsync_errors( void )
+{
+    int32_t ret;
+
+    resolved_calls = 0;
+
+    ret = SOCKETS_GetHostByNameAsync( NULL, host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EINVAL, ret );
+
+    ret = SOCKETS_GetHostByNameAsync( "hostname", NULL, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EINVAL, ret );
+
+    pvPortMalloc_Stub( NULL );
+    pvPortMalloc_ExpectAnyArgsAndReturn( NULL );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ENOMEM, ret );
+
+    initCallbacks();
+    vLoggingPrintf_Ignore();
+    dns_gethostbyname_addrtype_ExpectAnyArgsAndReturn( ERR_ARG );
+    ret = SOCKETS_GetHostByNameAsync( "hostname", host_resolved_cb, &resolved_calls );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_SOCKET_ERROR, ret );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, resolved_calls );
+}
+
 /* ========================  TESTING   SOCKETS_Init  ======================== */
 
 /*!
@@ -1009,6 +1321,8 @@ void test_SecureSockets_Init( void )
     BaseType_t ret;
 
     dns_init_Expect();
+    xQueueCreateMutex_ExpectAndReturn( queueQUEUE_TYPE_MUTEX, ( QueueHandle_t ) 1 );
+    xEventGroupCreate_ExpectAndReturn( ( EventGroupHandle_t ) 1 );
     ret = SOCKETS_Init();
     TEST_ASSERT_EQUAL( ret, pdPASS );
 }
@@ -1108,6 +1422,58 @@ void test_SecureSockets_SetSockOpt_Invalid_Option( void )
     deinitSocket( so );
 }
 
+/*!
+ * @brief GetSockOpt invalid arguments
+ *
+ * The Purpose of this testcase is to make sure getsockopt returns EINVAL for
+ * an invalid socket or a missing value buffer
+ */
+void test_SecureSockets_GetSockOpt_bad_arguments( void )
+{
+    Socket_t so = SOCKETS_INVALID_SOCKET;
+    SocketsStats_t stats;
+    size_t length = sizeof( stats );
+    int32_t ret;
+
+    ret = SOCKETS_GetSockOpt( so, 0, SOCKETS_SO_STATS, &stats, &length );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, ret );
+
+    so = initSocket();
+
+    ret = SOCKETS_GetSockOpt( so, 0, SOCKETS_SO_STATS, NULL, &length );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, ret );
+
+    ret = SOCKETS_GetSockOpt( so, 0, SOCKETS_SO_STATS, &stats, NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, ret );
+
+    deinitSocket( so );
+}
+
+/*!
+ * @brief GetSockOpt unsupported options
+ *
+ * The Purpose of this testcase is to make sure getsockopt returns ENOPROTOOPT
+ * for options that cannot be read, and for the statistics when metrics are
+ * disabled
+ */
+void test_SecureSockets_GetSockOpt_Invalid_Option( void )
+{
+    Socket_t so = SOCKETS_INVALID_SOCKET;
+    SocketsStats_t stats;
+    size_t length = sizeof( stats );
+    int32_t ret;
+
+    so = initSocket();
+
+    ret = SOCKETS_GetSockOpt( so, 0, SOCKETS_SO_RCVTIMEO, &stats, &length );
+    TEST_ASSERT_EQUAL( SOCKETS_ENOPROTOOPT, ret );
+
+    ret = SOCKETS_GetSockOpt( so, 0, SOCKETS_SO_STATS, &stats, &length );
+    TEST_ASSERT_EQUAL( SOCKETS_ENOPROTOOPT, ret );
+
+    deinitSocket( so );
+}
+
 /*!
  * @brief SetSockOp so nonblock_success succesful case
  *
@@ -1159,50 +1525,65 @@ void test_SecureSockets_SetsockOpt_nonblock_error( void )
     deinitSocket( so );
 }
 
-static TaskHandle_t handle;
+static TaskHandle_t reactorHandle = ( TaskHandle_t ) 1;
 static Socket_t s_so;
 static bool userCallback_called;
-static struct event * callback_event;
-static struct task * tsk;
 
-static void taskComplete_cb( Socket_t ctx )
+/* user callback which clears itself, the last registration, from the reactor */
+static void clearCallback_cb( Socket_t ctx )
 {
     userCallback_called = true;
-    event_signal( callback_event );
+    ( void ) SOCKETS_SetSockOpt( ctx, 0, SOCKETS_SO_WAKEUP_CALLBACK, NULL, 0 );
 }
 
-/* helper function to delete the thread created and free the handle */
-static void vTaskDelete_cb( TaskHandle_t task_handle,
-                            int num_calls )
+/* user callback which closes its socket from the reactor */
+static void closeCallback_cb( Socket_t ctx )
 {
-    free_cb( handle, 1 );
-    task_kill( tsk );
+    userCallback_called = true;
+    vPortFree_Stub( free_cb );
+    lwip_close_IgnoreAndReturn( 0 );
+    ( void ) SOCKETS_Close( ctx );
 }
 
-/* helper function to create a fake implementation of xTaskCreate */
-static long int xTaskCreate_cb2( TaskFunction_t pxTaskCode,
-                                 const char * const pcName,
-                                 const configSTACK_DEPTH_TYPE usStackDepth,
-                                 void * const pvParameters,
-                                 UBaseType_t uxPriority,
-                                 TaskHandle_t * const pxCreatedTask,
-                                 int num_of_calls )
+/* helper function to create a fake implementation of xTaskCreate which runs
+ * the reactor until it deletes itself */
+static long int xTaskCreate_cb( TaskFunction_t pxTaskCode,
+                                const char * const pcName,
+                                const configSTACK_DEPTH_TYPE usStackDepth,
+                                void * const pvParameters,
+                                UBaseType_t uxPriority,
+                                TaskHandle_t * const pxCreatedTask,
+                                int num_of_calls )
 {
-    lwip_select_IgnoreAndReturn( 1 );
-    vTaskDelete_Stub( vTaskDelete_cb );
+    *pxCreatedTask = reactorHandle;
+    pxTaskCode( pvParameters );
+    return pdPASS;
+}
 
-    handle = malloc_cb( sizeof( TaskHandle_t ), 1 );
-    *pxCreatedTask = handle;
+/* helper function to set up the kernel objects used by the reactor */
+static void initReactor( void )
+{
+    dns_init_Ignore();
+    xQueueCreateMutex_IgnoreAndReturn( ( QueueHandle_t ) 1 );
+    xEventGroupCreate_IgnoreAndReturn( ( EventGroupHandle_t ) 1 );
+    ( void ) SOCKETS_Init();
 
-    tsk = task_create( pxTaskCode, pvParameters );
+    xQueueSemaphoreTake_IgnoreAndReturn( pdTRUE );
+    xQueueGenericSend_IgnoreAndReturn( pdTRUE );
+    xEventGroupSetBits_IgnoreAndReturn( 0 );
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn( reactorHandle );
+    vTaskDelete_Ignore();
+}
 
-    if( tsk == NULL )
-    {
-        TEST_FAIL();
-        return pdFAIL;
-    }
+/* helper function to make the next lwip_select report data on the socket */
+static void expectSocketReadable( void )
+{
+    static fd_set read_fds;
 
-    return pdPASS;
+    FD_ZERO( &read_fds );
+    FD_SET( 5, &read_fds );
+    lwip_select_ExpectAnyArgsAndReturn( 1 );
+    lwip_select_ReturnMemThruPtr_readset( &read_fds, sizeof( fd_set ) );
 }
 
 /*!
@@ -1210,106 +1591,85 @@ static long int xTaskCreate_cb2( TaskFunction_t pxTaskCode,
  *        making sure it got called when an actifity occured on the socket
  *
  * The Purpose of this testcase is to make sure the asynchronous operation of
- * sockets is working as expected, the user callback is called when some
- * activity is available on the socket.
+ * sockets is working as expected, the user callback is called from the
+ * reactor when some activity is available on the socket, and the reactor
+ * exits once the callback clears the last registration.
  */
-void test_SecureSockets_SetSockOpt_wakeup_callback_socket_close( void )
+void test_SecureSockets_SetSockOpt_wakeup_callback( void )
 {
+    Socket_t so = SOCKETS_INVALID_SOCKET;
     int32_t ret;
-    void * option = &taskComplete_cb; /* user callback for socket event */
+    void * option = &clearCallback_cb; /* user callback for socket event */
 
-    s_so = SOCKETS_INVALID_SOCKET;
-    callback_event = event_create();
-
-    s_so = initSocket();
-
-    xEventGroupCreate_IgnoreAndReturn( ( EventGroupHandle_t ) 1 );
-    xEventGroupWaitBits_IgnoreAndReturn( 2 );
-    xEventGroupSetBits_IgnoreAndReturn( 0 );
+    so = initSocket();
+    initReactor();
+    expectSocketReadable();
+    xTaskCreate_Stub( xTaskCreate_cb );
 
-    xTaskCreate_Stub( xTaskCreate_cb2 );
-    ret = SOCKETS_SetSockOpt( s_so, 0, SOCKETS_SO_WAKEUP_CALLBACK,
+    ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_WAKEUP_CALLBACK,
                               option, sizeof( void * ) );
-    TEST_ASSERT_EQUAL_MESSAGE( SOCKETS_ERROR_NONE, ret,
-                               "set sock opt return error" );
+    TEST_ASSERT_EQUAL( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_TRUE( userCallback_called );
+    userCallback_called = false;
 
-    /* wait for the callback ...to  deinitialize the socket */
-    event_wait( callback_event );
-    deinitSocket( s_so );
-    task_join( tsk );
-    event_delete( callback_event );
+    deinitSocket( so );
 }
 
-static long int xTaskCreate_cb( TaskFunction_t pxTaskCode,
-                                const char * const pcName,
-                                const configSTACK_DEPTH_TYPE usStackDepth,
-                                void * const pvParameters,
-                                UBaseType_t uxPriority,
-                                TaskHandle_t * const pxCreatedTask,
-                                int num_of_calls )
+/*!
+ * @brief test SetSockOpt sockets_so_wakeup_callback with a callback that
+ *        closes its socket
+ *
+ * The Purpose of this testcase is to make sure a socket can be closed from
+ * its own callback, and that its context is released once the reactor no
+ * longer references it.
+ */
+void test_SecureSockets_SetSockOpt_wakeup_callback_socket_close( void )
 {
-    handle = malloc_cb( sizeof( TaskHandle_t ), 1 );
-    *pxCreatedTask = handle;
-
-    fd_set read_fds;
-    fd_set read_fds2;
-    FD_ZERO( &read_fds );
-    FD_ZERO( &read_fds2 );
-
-    lwip_select_ExpectAndReturn( 6, &read_fds, &read_fds, &read_fds, NULL, 1 );
-    lwip_select_IgnoreArg_writeset();
-    lwip_select_IgnoreArg_exceptset();
-    lwip_select_IgnoreArg_maxfdp1();
-    lwip_select_IgnoreArg_readset();
-    lwip_select_IgnoreArg_timeout();
-    lwip_select_ReturnMemThruPtr_readset( &read_fds2, sizeof( fd_set ) );
+    int32_t ret;
+    void * option = &closeCallback_cb; /* user callback for socket event */
 
-    lwip_select_ExpectAnyArgsAndReturn( -1 );
+    s_so = initSocket();
+    initReactor();
+    expectSocketReadable();
+    xTaskCreate_Stub( xTaskCreate_cb );
 
-    vTaskDelete_Ignore();
-    pxTaskCode( pvParameters ); /* pvParameters the socket_t/ss_ctx */
-    /*return pdPASS; */
-    return pdFAIL;
+    ret = SOCKETS_SetSockOpt( s_so, 0, SOCKETS_SO_WAKEUP_CALLBACK,
+                              option, sizeof( void * ) );
+    TEST_ASSERT_EQUAL_MESSAGE( SOCKETS_ERROR_NONE, ret,
+                               "set sock opt return error" );
+    TEST_ASSERT_TRUE( userCallback_called );
+    userCallback_called = false;
+    s_so = SOCKETS_INVALID_SOCKET;
 }
 
 /*!
- * @brief test SetSockOpt sockets_so_wakeup_callback by registering a callback
- *        making sure it got called when an actifity occured on the socket
+ * @brief SetSockOpt SOCKETS_SO_WAKEUP_CALLBACK reactor creation failure
  *
- * The Purpose of this testcase is to make sure the asynchronous operation of
- * sockets is working as expected, the user callback is called when some
- * activity is available on the socket.
+ * The Purpose of this testcase is to make sure the registration is rolled
+ * back and an error returned when the reactor task cannot be created.
  */
-void test_SecureSockets_SetSockOpt_wakeup_callback( void )
+void test_SecureSockets_SetSockOpt_wakeup_callback_no_memory( void )
 {
     Socket_t so = SOCKETS_INVALID_SOCKET;
     int32_t ret;
-    void * option = &taskComplete_cb; /* user callback for socket event */
+    void * option = &clearCallback_cb; /* user callback for socket event */
 
-    xEventGroupCreate_IgnoreAndReturn( ( EventGroupHandle_t ) 1 );
-    xEventGroupWaitBits_IgnoreAndReturn( 2 );
-
-    xTaskCreate_Stub( xTaskCreate_cb );
     so = initSocket();
+    initReactor();
+    xTaskCreate_IgnoreAndReturn( pdFAIL );
 
     ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_WAKEUP_CALLBACK,
                               option, sizeof( void * ) );
-    TEST_ASSERT_EQUAL( SOCKETS_ERROR_NONE, ret );
+    TEST_ASSERT_EQUAL( SOCKETS_SOCKET_ERROR, ret );
 
     deinitSocket( so );
-    TEST_ASSERT_TRUE( userCallback_called );
-    userCallback_called = false;
-    free_cb( handle, 1 );
 }
 
 /*!
  * @brief SetSockOpt SOCKETS_SO_WAKEUP_CALLBACK
  *
- * The Purpose of this testcase is to
- *
- * @warning currently the clean functionality is not implemented,
- * but once implemented this test case will
- * probably fails until it is updated to test the new code
+ * The Purpose of this testcase is to make sure clearing the callback of a
+ * socket which has none is a no-op that does not involve the reactor.
  */
 void test_SecureSockets_SetSockOpt_wakeup_callback_clear( void )
 {
@@ -1318,10 +1678,6 @@ void test_SecureSockets_SetSockOpt_wakeup_callback_clear( void )
 
     so = initSocket();
 
-    xEventGroupSetBits_IgnoreAndReturn( 0 );
-    xEventGroupWaitBits_IgnoreAndReturn( 2 );
-    vEventGroupDelete_Ignore();
-
     ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_WAKEUP_CALLBACK,
                               NULL, 0 );
     TEST_ASSERT_EQUAL( SOCKETS_ERROR_NONE, ret );
@@ -1571,3 +1927,34 @@ void test_SecureSockets_SetSockOpt_trusted_server_invalid_arguments()
 
     deinitSocket( so );
 }
+
+/*!
+ * @brief SetSockOpt SOCKETS_SO_TLS_WRITE_COMBINE
+ *
+ * The Purpose of this testcase is to make sure setsockopt accepts a write
+ * combining maximum age before connect only, and rejects bad arguments
+ */
+void test_SecureSockets_SetSockOpt_tls_write_combine( void )
+{
+    int32_t ret;
+    uint32_t ulMaxAgeMs = 10;
+    Socket_t so = initSocket();
+
+    ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_TLS_WRITE_COMBINE, NULL, sizeof( ulMaxAgeMs ) );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EINVAL, ret );
+
+    ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_TLS_WRITE_COMBINE, &ulMaxAgeMs, 1 );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EINVAL, ret );
+
+    ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_TLS_WRITE_COMBINE, &ulMaxAgeMs, sizeof( ulMaxAgeMs ) );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_ERROR_NONE, ret );
+
+    deinitSocket( so );
+
+    so = create_normal_connection();
+
+    ret = SOCKETS_SetSockOpt( so, 0, SOCKETS_SO_TLS_WRITE_COMBINE, &ulMaxAgeMs, sizeof( ulMaxAgeMs ) );
+    TEST_ASSERT_EQUAL_INT( SOCKETS_EISCONN, ret );
+
+    deinitSocket( so );
+}
@@ -0,0 +1,473 @@
+/*
+ * FreeRTOS Transport Loopback V1.0.0
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file transport_loopback.c
+ * @brief Implementation of the transport interface over an in-memory link.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Loopback transport includes. */
+#include "transport_loopback.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ * It should contain a single pointer to the type of your desired transport.
+ * When using multiple transports in the same compilation unit, define this pointer as void *.
+ *
+ * @note Transport stacks are defined in amazon-freertos/libraries/abstractions/transport/loopback/transport_loopback.h.
+ */
+struct NetworkContext
+{
+    LoopbackTransportParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Return the parameters of a network context, after checking that it
+ * is connected to a link.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return The parameters, or NULL if the network context is invalid.
+ */
+static LoopbackTransportParams_t * getConnectedParams( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Return the time a number of bytes takes to be put on the wire.
+ *
+ * @param[in] length Number of bytes.
+ * @param[in] bytesPerSecond Bandwidth of the link, or 0 for no limit.
+ *
+ * @return Time in microseconds, rounded up.
+ */
+static uint64_t transmitTimeUs( size_t length,
+                                uint32_t bytesPerSecond );
+
+/**
+ * @brief Append bytes to the ring buffer of a pipe.
+ *
+ * @param[in] pPipe The pipe, with at least @p length bytes free.
+ * @param[in] pData The bytes to append.
+ * @param[in] length Number of bytes.
+ */
+static void pipeWrite( LoopbackPipe_t * pPipe,
+                       const uint8_t * pData,
+                       size_t length );
+
+/**
+ * @brief Remove bytes from the ring buffer of a pipe.
+ *
+ * @param[in] pPipe The pipe, with at least @p length bytes in it.
+ * @param[out] pData Buffer for the bytes.
+ * @param[in] length Number of bytes.
+ */
+static void pipeRead( LoopbackPipe_t * pPipe,
+                      uint8_t * pData,
+                      size_t length );
+
+/*-----------------------------------------------------------*/
+
+static LoopbackTransportParams_t * getConnectedParams( const NetworkContext_t * pNetworkContext )
+{
+    LoopbackTransportParams_t * pParams = NULL;
+
+    if( pNetworkContext == NULL )
+    {
+        LogError( ( "pNetworkContext cannot be NULL." ) );
+    }
+    else if( ( pNetworkContext->pParams == NULL ) ||
+             ( pNetworkContext->pParams->pLink == NULL ) )
+    {
+        LogError( ( "pNetworkContext is not connected to a link." ) );
+    }
+    else
+    {
+        pParams = pNetworkContext->pParams;
+    }
+
+    return pParams;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t transmitTimeUs( size_t length,
+                                uint32_t bytesPerSecond )
+{
+    uint64_t timeUs = 0U;
+
+    if( bytesPerSecond != 0U )
+    {
+        timeUs = ( ( ( uint64_t ) length * 1000000U ) + bytesPerSecond - 1U ) / bytesPerSecond;
+    }
+
+    return timeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void pipeWrite( LoopbackPipe_t * pPipe,
+                       const uint8_t * pData,
+                       size_t length )
+{
+    size_t writeOffset = ( pPipe->readOffset + pPipe->length ) % pPipe->bufferSize;
+    size_t firstPart = pPipe->bufferSize - writeOffset;
+
+    if( firstPart > length )
+    {
+        firstPart = length;
+    }
+
+    ( void ) memcpy( &pPipe->pBuffer[ writeOffset ], pData, firstPart );
+    ( void ) memcpy( pPipe->pBuffer, &pData[ firstPart ], length - firstPart );
+
+    pPipe->length += length;
+}
+
+/*-----------------------------------------------------------*/
+
+static void pipeRead( LoopbackPipe_t * pPipe,
+                      uint8_t * pData,
+                      size_t length )
+{
+    size_t firstPart = pPipe->bufferSize - pPipe->readOffset;
+
+    if( firstPart > length )
+    {
+        firstPart = length;
+    }
+
+    ( void ) memcpy( pData, &pPipe->pBuffer[ pPipe->readOffset ], firstPart );
+    ( void ) memcpy( &pData[ firstPart ], pPipe->pBuffer, length - firstPart );
+
+    pPipe->readOffset = ( pPipe->readOffset + length ) % pPipe->bufferSize;
+    pPipe->length -= length;
+}
+
+/*-----------------------------------------------------------*/
+
+LoopbackTransportStatus_t LoopbackTransport_CreateLink( LoopbackLink_t * pLink,
+                                                        const LoopbackLinkConfig_t * pConfig,
+                                                        uint8_t * pClientBuffer,
+                                                        uint8_t * pServerBuffer,
+                                                        size_t bufferSize )
+{
+    LoopbackTransportStatus_t returnStatus = LOOPBACK_TRANSPORT_STATUS_SUCCESS;
+
+    if( ( pLink == NULL ) || ( pConfig == NULL ) )
+    {
+        LogError( ( "pLink and pConfig cannot be NULL." ) );
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else if( ( pClientBuffer == NULL ) || ( pServerBuffer == NULL ) || ( bufferSize == 0U ) )
+    {
+        LogError( ( "Both pipe buffers must be provided with a non-zero size." ) );
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pLink, 0, sizeof( LoopbackLink_t ) );
+        pLink->config = *pConfig;
+
+        pLink->pipes[ LOOPBACK_TRANSPORT_CLIENT ].pBuffer = pClientBuffer;
+        pLink->pipes[ LOOPBACK_TRANSPORT_CLIENT ].bufferSize = bufferSize;
+        pLink->pipes[ LOOPBACK_TRANSPORT_SERVER ].pBuffer = pServerBuffer;
+        pLink->pipes[ LOOPBACK_TRANSPORT_SERVER ].bufferSize = bufferSize;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+LoopbackTransportStatus_t LoopbackTransport_Connect( NetworkContext_t * pNetworkContext,
+                                                     LoopbackLink_t * pLink,
+                                                     LoopbackTransportEndpoint_t endpoint,
+                                                     LoopbackTransportRecvCallback_t recvCallback,
+                                                     void * pCallbackContext )
+{
+    LoopbackTransportStatus_t returnStatus = LOOPBACK_TRANSPORT_STATUS_SUCCESS;
+    LoopbackTransportParams_t * pParams = NULL;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) || ( pLink == NULL ) )
+    {
+        LogError( ( "pNetworkContext, its parameters and pLink cannot be NULL." ) );
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else if( ( endpoint != LOOPBACK_TRANSPORT_CLIENT ) && ( endpoint != LOOPBACK_TRANSPORT_SERVER ) )
+    {
+        LogError( ( "Invalid endpoint: %d.", ( int ) endpoint ) );
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else if( ( pLink->pEndpoints[ endpoint ] != NULL ) || ( pLink->closed[ endpoint ] == true ) )
+    {
+        /* A link carries one connection. Create it again to reconnect. */
+        LogError( ( "Endpoint %d of the link was already connected.", ( int ) endpoint ) );
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pParams = pNetworkContext->pParams;
+        ( void ) memset( pParams, 0, sizeof( LoopbackTransportParams_t ) );
+
+        pParams->pLink = pLink;
+        pParams->endpoint = endpoint;
+        pParams->pNetworkContext = pNetworkContext;
+        pParams->recvCallback = recvCallback;
+        pParams->pCallbackContext = pCallbackContext;
+
+        pLink->pEndpoints[ endpoint ] = pParams;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+LoopbackTransportStatus_t LoopbackTransport_Disconnect( NetworkContext_t * pNetworkContext )
+{
+    LoopbackTransportStatus_t returnStatus = LOOPBACK_TRANSPORT_STATUS_SUCCESS;
+    LoopbackTransportParams_t * pParams = getConnectedParams( pNetworkContext );
+
+    if( pParams == NULL )
+    {
+        returnStatus = LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pParams->pLink->closed[ pParams->endpoint ] = true;
+        pParams->pLink->pEndpoints[ pParams->endpoint ] = NULL;
+        pParams->pLink = NULL;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t LoopbackTransport_Send( NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend )
+{
+    int32_t bytesSent = 0;
+    size_t totalSent = 0U, chunk = 0U;
+    uint64_t nowUs = 0U, departureUs = 0U;
+    LoopbackTransportParams_t * pParams = getConnectedParams( pNetworkContext );
+    LoopbackTransportParams_t * pPeer = NULL;
+    LoopbackLink_t * pLink = NULL;
+    LoopbackPipe_t * pPipe = NULL;
+    LoopbackSegment_t * pSegment = NULL;
+    const uint8_t * pData = ( const uint8_t * ) pBuffer;
+
+    if( ( pParams == NULL ) || ( pBuffer == NULL ) || ( bytesToSend == 0U ) )
+    {
+        LogError( ( "Invalid parameter: pParams=%p, pBuffer=%p, bytesToSend=%lu.",
+                    ( void * ) pParams, pBuffer, ( unsigned long ) bytesToSend ) );
+        bytesSent = -1;
+    }
+    else if( pParams->pLink->closed[ 1 - pParams->endpoint ] == true )
+    {
+        LogDebug( ( "The other endpoint disconnected." ) );
+        bytesSent = -1;
+    }
+    else
+    {
+        pLink = pParams->pLink;
+        pPipe = &pLink->pipes[ pParams->endpoint ];
+        nowUs = LoopbackTransport_GetTimeUs( pLink );
+
+        while( ( totalSent < bytesToSend ) &&
+               ( pPipe->length < pPipe->bufferSize ) &&
+               ( pPipe->segmentCount < LOOPBACK_TRANSPORT_MAX_SEGMENTS ) )
+        {
+            chunk = bytesToSend - totalSent;
+
+            if( chunk > ( pPipe->bufferSize - pPipe->length ) )
+            {
+                chunk = pPipe->bufferSize - pPipe->length;
+            }
+
+            if( ( pLink->config.segmentSize != 0U ) && ( chunk > pLink->config.segmentSize ) )
+            {
+                chunk = pLink->config.segmentSize;
+            }
+
+            pipeWrite( pPipe, &pData[ totalSent ], chunk );
+
+            /* Bytes wait for the ones sent before to leave, then take their
+             * own transmit time, and arrive one latency later. */
+            departureUs = ( pPipe->wireFreeUs > nowUs ) ? pPipe->wireFreeUs : nowUs;
+            pPipe->wireFreeUs = departureUs + transmitTimeUs( chunk, pLink->config.bytesPerSecond );
+
+            pSegment = &pPipe->segments[ ( pPipe->firstSegment + pPipe->segmentCount ) %
+                                         LOOPBACK_TRANSPORT_MAX_SEGMENTS ];
+            pSegment->deliveryUs = pPipe->wireFreeUs + pLink->config.latencyUs;
+            pSegment->length = chunk;
+            pPipe->segmentCount++;
+
+            totalSent += chunk;
+        }
+
+        pParams->metrics.sendCalls++;
+        pParams->metrics.bytesSent += totalSent;
+        bytesSent = ( int32_t ) totalSent;
+
+        /* Let the other endpoint answer. Its own sends do not call back into
+         * this endpoint, which is waiting in its receive loop anyway. */
+        pPeer = pLink->pEndpoints[ 1 - pParams->endpoint ];
+
+        if( ( totalSent > 0U ) && ( pPeer != NULL ) &&
+            ( pPeer->recvCallback != NULL ) && ( pLink->inCallback == false ) )
+        {
+            pLink->inCallback = true;
+            pPeer->recvCallback( pPeer->pNetworkContext, pPeer->pCallbackContext );
+            pLink->inCallback = false;
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t LoopbackTransport_Recv( NetworkContext_t * pNetworkContext,
+                                void * pBuffer,
+                                size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    size_t totalReceived = 0U, chunk = 0U;
+    uint64_t nowUs = 0U;
+    LoopbackTransportParams_t * pParams = getConnectedParams( pNetworkContext );
+    LoopbackLink_t * pLink = NULL;
+    LoopbackPipe_t * pPipe = NULL;
+    LoopbackSegment_t * pSegment = NULL;
+    uint8_t * pData = ( uint8_t * ) pBuffer;
+
+    if( ( pParams == NULL ) || ( pBuffer == NULL ) || ( bytesToRecv == 0U ) )
+    {
+        LogError( ( "Invalid parameter: pParams=%p, pBuffer=%p, bytesToRecv=%lu.",
+                    ( void * ) pParams, pBuffer, ( unsigned long ) bytesToRecv ) );
+        bytesReceived = -1;
+    }
+    else
+    {
+        pLink = pParams->pLink;
+        pPipe = &pLink->pipes[ 1 - pParams->endpoint ];
+        pParams->metrics.recvCalls++;
+
+        if( pPipe->segmentCount == 0U )
+        {
+            if( pLink->closed[ 1 - pParams->endpoint ] == true )
+            {
+                LogDebug( ( "The other endpoint disconnected." ) );
+                bytesReceived = -1;
+            }
+        }
+        else
+        {
+            nowUs = LoopbackTransport_GetTimeUs( pLink );
+            pSegment = &pPipe->segments[ pPipe->firstSegment ];
+
+            /* Wait for data in flight on the virtual clock. */
+            if( ( pLink->config.getTimeUs == NULL ) && ( pSegment->deliveryUs > nowUs ) )
+            {
+                pLink->virtualTimeUs = pSegment->deliveryUs;
+                nowUs = pSegment->deliveryUs;
+            }
+
+            while( ( totalReceived < bytesToRecv ) &&
+                   ( pPipe->segmentCount > 0U ) &&
+                   ( pSegment->deliveryUs <= nowUs ) )
+            {
+                chunk = bytesToRecv - totalReceived;
+
+                if( chunk > pSegment->length )
+                {
+                    chunk = pSegment->length;
+                }
+
+                pipeRead( pPipe, &pData[ totalReceived ], chunk );
+                pSegment->length -= chunk;
+                totalReceived += chunk;
+
+                if( pSegment->length == 0U )
+                {
+                    pPipe->firstSegment = ( pPipe->firstSegment + 1U ) % LOOPBACK_TRANSPORT_MAX_SEGMENTS;
+                    pPipe->segmentCount--;
+                    pSegment = &pPipe->segments[ pPipe->firstSegment ];
+
+                    /* Fragmented links deliver a segment per receive. */
+                    if( pLink->config.segmentSize != 0U )
+                    {
+                        break;
+                    }
+                }
+            }
+
+            bytesReceived = ( int32_t ) totalReceived;
+        }
+
+        if( bytesReceived == 0 )
+        {
+            pParams->metrics.emptyRecvs++;
+        }
+        else
+        {
+            pParams->metrics.bytesRecved += totalReceived;
+        }
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t LoopbackTransport_GetTimeUs( const LoopbackLink_t * pLink )
+{
+    uint64_t timeUs = 0U;
+
+    if( pLink != NULL )
+    {
+        timeUs = ( pLink->config.getTimeUs != NULL ) ? pLink->config.getTimeUs() : pLink->virtualTimeUs;
+    }
+
+    return timeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+void LoopbackTransport_AdvanceTimeUs( LoopbackLink_t * pLink,
+                                      uint64_t timeUs )
+{
+    if( ( pLink != NULL ) && ( pLink->config.getTimeUs == NULL ) )
+    {
+        pLink->virtualTimeUs += timeUs;
+    }
+}
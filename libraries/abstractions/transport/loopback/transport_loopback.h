@@ -0,0 +1,320 @@
+/*
+ * FreeRTOS Transport Loopback V1.0.0
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file transport_loopback.h
+ * @brief In-memory loopback implementation of the transport interface.
+ *
+ * A link connects two endpoints, e.g. an MQTT or HTTP client and a scripted
+ * server, through two byte pipes with a configurable latency, bandwidth and
+ * segment size. It needs no sockets, TLS or RTOS, so the transport-facing
+ * code of a protocol library can be benchmarked on a host. Without a clock
+ * function, the link runs on a virtual clock that only advances while a
+ * receiver waits for data in flight, and results are deterministic.
+ *
+ * The link is not thread safe. Both endpoints are meant to be driven from
+ * one thread, with the server answering from its receive callback.
+ */
+
+#ifndef TRANSPORT_LOOPBACK_H
+#define TRANSPORT_LOOPBACK_H
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/* bool is defined in only C99+. */
+#if defined( __cplusplus ) || ( defined( __STDC_VERSION__ ) && ( __STDC_VERSION__ >= 199901L ) )
+    #include <stdbool.h>
+#elif !defined( bool ) && !defined( false ) && !defined( true )
+    #define bool     int8_t
+    #define false    ( int8_t ) 0
+    #define true     ( int8_t ) 1
+#endif
+/** @endcond */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the loopback transport interface implementation. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Loopback"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+/* Logging implementation header include. */
+#include "logging_stack.h"
+
+/**
+ * @brief Maximum number of segments in flight in each direction of a link.
+ *
+ * A send stops early when this many segments wait for the receiver.
+ */
+#ifndef LOOPBACK_TRANSPORT_MAX_SEGMENTS
+    #define LOOPBACK_TRANSPORT_MAX_SEGMENTS    ( 64U )
+#endif
+
+/**
+ * @brief Loopback transport return status.
+ */
+typedef enum LoopbackTransportStatus
+{
+    LOOPBACK_TRANSPORT_STATUS_SUCCESS = 0,      /**< Function successfully completed. */
+    LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER /**< At least one parameter was invalid. */
+} LoopbackTransportStatus_t;
+
+/**
+ * @brief The two ends of a link.
+ */
+typedef enum LoopbackTransportEndpoint
+{
+    LOOPBACK_TRANSPORT_CLIENT = 0, /**< The end of the library under test. */
+    LOOPBACK_TRANSPORT_SERVER = 1  /**< The end of the peer it talks to. */
+} LoopbackTransportEndpoint_t;
+
+/**
+ * @brief Function returning the current time in microseconds.
+ */
+typedef uint64_t ( * LoopbackTransportGetTimeUs_t )( void );
+
+/**
+ * @brief Function called when data was sent to an endpoint.
+ *
+ * It may receive from and send on @p pNetworkContext. Sends from the callback
+ * do not call the callback of the other endpoint.
+ *
+ * @param[in] pNetworkContext The endpoint that data was sent to.
+ * @param[in] pCallbackContext The context given to #LoopbackTransport_Connect.
+ */
+typedef void ( * LoopbackTransportRecvCallback_t )( NetworkContext_t * pNetworkContext,
+                                                    void * pCallbackContext );
+
+/**
+ * @brief Properties of a link, the same in both directions.
+ */
+typedef struct LoopbackLinkConfig
+{
+    uint32_t latencyUs;      /**< @brief Time for a byte to reach the other end once it is on the wire. */
+    uint32_t bytesPerSecond; /**< @brief Rate at which sent bytes are put on the wire, or 0 for no limit. */
+
+    /**
+     * @brief Maximum size of a segment, or 0 to send each call as one segment.
+     *
+     * A receive returns the bytes of at most one segment, so a non-zero value
+     * makes the receiver reassemble messages from short reads.
+     */
+    size_t segmentSize;
+
+    /**
+     * @brief Clock of the link, or NULL to use the virtual clock.
+     *
+     * With a clock, a receive returns 0 while data is still in flight.
+     */
+    LoopbackTransportGetTimeUs_t getTimeUs;
+} LoopbackLinkConfig_t;
+
+/**
+ * @brief Send and receive counters of an endpoint.
+ */
+typedef struct LoopbackTransportMetrics
+{
+    uint32_t sendCalls;   /**< @brief Number of #LoopbackTransport_Send calls. */
+    uint32_t recvCalls;   /**< @brief Number of #LoopbackTransport_Recv calls. */
+    uint32_t emptyRecvs;  /**< @brief Number of receives that returned 0. */
+    uint64_t bytesSent;   /**< @brief Number of bytes accepted by #LoopbackTransport_Send. */
+    uint64_t bytesRecved; /**< @brief Number of bytes returned by #LoopbackTransport_Recv. */
+} LoopbackTransportMetrics_t;
+
+/**
+ * @brief Bytes sent at the same time, delivered together.
+ */
+typedef struct LoopbackSegment
+{
+    uint64_t deliveryUs; /**< @brief Time when the segment reaches the receiver. */
+    size_t length;       /**< @brief Number of bytes of the segment not yet received. */
+} LoopbackSegment_t;
+
+/**
+ * @brief One direction of a link.
+ */
+typedef struct LoopbackPipe
+{
+    uint8_t * pBuffer;  /**< @brief Ring buffer of the bytes in flight or not yet received. */
+    size_t bufferSize;  /**< @brief Size of #LoopbackPipe_t.pBuffer. */
+    size_t readOffset;  /**< @brief Offset of the first byte not yet received. */
+    size_t length;      /**< @brief Number of bytes in the buffer. */
+    uint64_t wireFreeUs; /**< @brief Time when the last byte sent leaves the sender. */
+
+    LoopbackSegment_t segments[ LOOPBACK_TRANSPORT_MAX_SEGMENTS ]; /**< @brief Ring of the segments in the buffer. */
+    size_t firstSegment;                                          /**< @brief Index of the oldest segment. */
+    size_t segmentCount;                                          /**< @brief Number of segments in the buffer. */
+} LoopbackPipe_t;
+
+struct LoopbackTransportParams;
+
+/**
+ * @brief A link between two endpoints.
+ *
+ * Created by #LoopbackTransport_CreateLink. The members must not be modified
+ * by the application.
+ */
+typedef struct LoopbackLink
+{
+    LoopbackLinkConfig_t config;                          /**< @brief Properties of the link. */
+    uint64_t virtualTimeUs;                               /**< @brief Current time of the virtual clock. */
+    LoopbackPipe_t pipes[ 2 ];                            /**< @brief Data sent by the endpoint of the same index. */
+    struct LoopbackTransportParams * pEndpoints[ 2 ];     /**< @brief Connected endpoints. */
+    bool closed[ 2 ];                                     /**< @brief Whether the endpoint of the same index disconnected. */
+    bool inCallback;                                      /**< @brief Whether a receive callback is running. */
+} LoopbackLink_t;
+
+/**
+ * @brief Definition of the network context for the loopback transport
+ * interface implementation.
+ *
+ * The members are set by #LoopbackTransport_Connect and must not be modified
+ * by the application, except for @p metrics, which may be reset.
+ */
+typedef struct LoopbackTransportParams
+{
+    LoopbackLink_t * pLink;                   /**< @brief The link of the endpoint. */
+    LoopbackTransportEndpoint_t endpoint;     /**< @brief Which end of the link it is. */
+    NetworkContext_t * pNetworkContext;       /**< @brief The network context holding these parameters. */
+    LoopbackTransportRecvCallback_t recvCallback; /**< @brief Called when data is sent to the endpoint, or NULL. */
+    void * pCallbackContext;                  /**< @brief Passed to @p recvCallback. */
+
+    LoopbackTransportMetrics_t metrics;       /**< @brief Counters since the endpoint was connected. */
+} LoopbackTransportParams_t;
+
+/**
+ * @brief Creates a link with empty pipes.
+ *
+ * @param[out] pLink The link to initialize.
+ * @param[in] pConfig Properties of the link. Copied.
+ * @param[in] pClientBuffer Buffer for the data sent by the client.
+ * @param[in] pServerBuffer Buffer for the data sent by the server.
+ * @param[in] bufferSize Size of each buffer, i.e. the number of bytes each
+ * endpoint can have in flight or not yet received by the other.
+ *
+ * @return #LOOPBACK_TRANSPORT_STATUS_SUCCESS on success;
+ *         #LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER on failure.
+ */
+LoopbackTransportStatus_t LoopbackTransport_CreateLink( LoopbackLink_t * pLink,
+                                                        const LoopbackLinkConfig_t * pConfig,
+                                                        uint8_t * pClientBuffer,
+                                                        uint8_t * pServerBuffer,
+                                                        size_t bufferSize );
+
+/**
+ * @brief Connects a network context to one end of a link.
+ *
+ * @param[out] pNetworkContext The network context. Its parameters must point
+ * to a #LoopbackTransportParams_t which remains valid until disconnected.
+ * @param[in] pLink The link.
+ * @param[in] endpoint The end of the link to connect to.
+ * @param[in] recvCallback Called when data is sent to this end, or NULL.
+ * @param[in] pCallbackContext Passed to @p recvCallback.
+ *
+ * @return #LOOPBACK_TRANSPORT_STATUS_SUCCESS on success;
+ *         #LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER on failure.
+ */
+LoopbackTransportStatus_t LoopbackTransport_Connect( NetworkContext_t * pNetworkContext,
+                                                     LoopbackLink_t * pLink,
+                                                     LoopbackTransportEndpoint_t endpoint,
+                                                     LoopbackTransportRecvCallback_t recvCallback,
+                                                     void * pCallbackContext );
+
+/**
+ * @brief Disconnects an endpoint. The other endpoint can still receive the
+ * data in flight, after which its receives and sends fail.
+ *
+ * @param[in] pNetworkContext The network context created by #LoopbackTransport_Connect.
+ *
+ * @return #LOOPBACK_TRANSPORT_STATUS_SUCCESS on success;
+ *         #LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER on failure.
+ */
+LoopbackTransportStatus_t LoopbackTransport_Disconnect( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives the data that has reached an endpoint.
+ *
+ * This can be used as the #TransportInterface.recv function. On the virtual
+ * clock, a receive with nothing delivered yet but data in flight advances the
+ * clock to its arrival, as a blocking socket would wait for it.
+ *
+ * @param[in] pNetworkContext The network context created by #LoopbackTransport_Connect.
+ * @param[out] pBuffer Buffer to receive data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes (> 0) received if successful;
+ *         0 if no data has arrived;
+ *         negative value on error or once the other endpoint disconnected.
+ */
+int32_t LoopbackTransport_Recv( NetworkContext_t * pNetworkContext,
+                                void * pBuffer,
+                                size_t bytesToRecv );
+
+/**
+ * @brief Sends data to the other endpoint.
+ *
+ * This can be used as the #TransportInterface.send function. Fewer bytes
+ * than requested are sent when the pipe buffer or its segment ring is full.
+ *
+ * @param[in] pNetworkContext The network context created by #LoopbackTransport_Connect.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent, which may be 0 when the pipe is full;
+ *         negative value on error or once either endpoint disconnected.
+ */
+int32_t LoopbackTransport_Send( NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend );
+
+/**
+ * @brief Returns the current time of a link, in microseconds.
+ *
+ * @param[in] pLink The link.
+ *
+ * @return The time of the link's clock, or of its virtual clock.
+ */
+uint64_t LoopbackTransport_GetTimeUs( const LoopbackLink_t * pLink );
+
+/**
+ * @brief Advances the virtual clock of a link, e.g. to model processing time
+ * of the server. Has no effect when the link has a clock.
+ *
+ * @param[in] pLink The link.
+ * @param[in] timeUs Number of microseconds to add.
+ */
+void LoopbackTransport_AdvanceTimeUs( LoopbackLink_t * pLink,
+                                      uint64_t timeUs );
+
+#endif /* TRANSPORT_LOOPBACK_H */
@@ -107,6 +107,36 @@ static int32_t tlsSetup( const SocketsConfig_t * pSocketsConfig,
 static TransportSocketStatus_t connectToServer( Socket_t tcpSocket,
                                                 const ServerInfo_t * pServerInfo );
 
+/**
+ * @brief Receive data from the socket of @p pSecureSocketsTransportParams.
+ *
+ * @param[in] pSecureSocketsTransportParams The connection to read from.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Size of @p pBuffer.
+ *
+ * @return Number of bytes received; 0 on timeout; negative value on error.
+ */
+static int32_t socketRecv( SecureSocketsTransportParams_t * pSecureSocketsTransportParams,
+                           uint8_t * pBuffer,
+                           size_t bytesToRecv );
+
+/**
+ * @brief Receive data through the read-ahead buffer of
+ * @p pSecureSocketsTransportParams.
+ *
+ * Buffered data is returned first. Otherwise reads shorter than the buffer
+ * refill it with one socket read, and longer reads go to the socket directly.
+ *
+ * @param[in] pSecureSocketsTransportParams The connection to read from.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes received; 0 on timeout; negative value on error.
+ */
+static int32_t readAheadRecv( SecureSocketsTransportParams_t * pSecureSocketsTransportParams,
+                              uint8_t * pBuffer,
+                              size_t bytesToRecv );
+
 /*-----------------------------------------------------------*/
 
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
@@ -164,6 +194,94 @@ int32_t SecureSocketsTransport_Send( NetworkContext_t * pNetworkContext,
 
 /*-----------------------------------------------------------*/
 
+int32_t SecureSocketsTransport_Writev( NetworkContext_t * pNetworkContext,
+                                       const SocketsIOVec_t * pIoVec,
+                                       size_t ioVecCount )
+{
+    int32_t bytesSent = 0;
+    size_t bytesToSend = 0UL;
+    size_t index = 0UL;
+
+    #if ( socketsconfigSENDV_SUPPORTED == 0 )
+        int32_t sendResult = 0;
+    #endif
+
+    if( ( pIoVec == NULL ) ||
+        ( ioVecCount == 0UL ) ||
+        ( pNetworkContext == NULL ) ||
+        ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Invalid parameter: pIoVec=%p, ioVecCount=%lu, pNetworkContext=%p",
+                    ( const void * ) pIoVec, ioVecCount, ( void * ) pNetworkContext ) );
+        bytesSent = SOCKETS_EINVAL;
+    }
+    else if( pNetworkContext->pParams->tcpSocket == SOCKETS_INVALID_SOCKET )
+    {
+        LogError( ( "Invalid parameter: pNetworkContext->pParams->tcpSocket cannot be SOCKETS_INVALID_SOCKET." ) );
+        bytesSent = SOCKETS_EINVAL;
+    }
+    else
+    {
+        for( index = 0UL; index < ioVecCount; index++ )
+        {
+            bytesToSend += pIoVec[ index ].xLength;
+        }
+
+        #if ( socketsconfigSENDV_SUPPORTED == 1 )
+            bytesSent = SOCKETS_Sendv( pNetworkContext->pParams->tcpSocket,
+                                       pIoVec,
+                                       ioVecCount,
+                                       0 );
+        #else
+            for( index = 0UL; ( index < ioVecCount ) && ( bytesSent >= 0 ); index++ )
+            {
+                if( pIoVec[ index ].xLength > 0UL )
+                {
+                    sendResult = SOCKETS_Send( pNetworkContext->pParams->tcpSocket,
+                                               pIoVec[ index ].pvBuffer,
+                                               pIoVec[ index ].xLength,
+                                               0 );
+
+                    if( sendResult < 0 )
+                    {
+                        bytesSent = sendResult;
+                    }
+                    else
+                    {
+                        bytesSent += sendResult;
+
+                        if( ( size_t ) sendResult < pIoVec[ index ].xLength )
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        #endif /* if ( socketsconfigSENDV_SUPPORTED == 1 ) */
+
+        /* If an error occurred, a negative value is returned. @ref SocketsErrors. */
+        if( bytesSent >= 0 )
+        {
+            if( bytesSent < ( int32_t ) bytesToSend )
+            {
+                LogWarn( ( "bytesSent %d < bytesToSend %lu.", bytesSent, bytesToSend ) );
+            }
+            else
+            {
+                LogInfo( ( "Successfully sent %d bytes over network.", bytesSent ) );
+            }
+        }
+        else
+        {
+            LogError( ( "Failed to send data over network. bytesSent=%d.", bytesSent ) );
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
  * on `pNetworkContext`. Indeed, the object pointed by it is not modified
  * by Secure Sockets, but other implementations of `TransportRecv_t` may do so. */
@@ -192,18 +310,22 @@ int32_t SecureSocketsTransport_Recv( NetworkContext_t * pNetworkContext,
     else
     {
         pSecureSocketsTransportParams = pNetworkContext->pParams;
-        bytesReceived = SOCKETS_Recv( pSecureSocketsTransportParams->tcpSocket,
-                                      pRecvBuffer,
-                                      bytesToRecv,
-                                      0 );
+        pSecureSocketsTransportParams->recvMetrics.recvCalls++;
 
-        if( bytesReceived == SOCKETS_EWOULDBLOCK )
+        if( pSecureSocketsTransportParams->pReadAheadBuffer != NULL )
         {
-            /* The return value EWOULDBLOCK means no data was received within
-             * the receive timeout. */
-            bytesReceived = 0;
+            bytesReceived = readAheadRecv( pSecureSocketsTransportParams,
+                                           pRecvBuffer,
+                                           bytesToRecv );
         }
-        else if( bytesReceived < 0 )
+        else
+        {
+            bytesReceived = socketRecv( pSecureSocketsTransportParams,
+                                        pRecvBuffer,
+                                        bytesToRecv );
+        }
+
+        if( bytesReceived < 0 )
         {
             LogError( ( "Failed to receive data over network. bytesReceived=%d", bytesReceived ) );
         }
@@ -232,6 +354,20 @@ int32_t SecureSocketsTransport_Recv( NetworkContext_t * pNetworkContext,
 
 /*-----------------------------------------------------------*/
 
+size_t SecureSocketsTransport_GetPendingBytes( const NetworkContext_t * pNetworkContext )
+{
+    size_t pendingBytes = 0UL;
+
+    if( ( pNetworkContext != NULL ) && ( pNetworkContext->pParams != NULL ) )
+    {
+        pendingBytes = pNetworkContext->pParams->readAheadLength;
+    }
+
+    return pendingBytes;
+}
+
+/*-----------------------------------------------------------*/
+
 static int32_t tlsSetup( const SocketsConfig_t * pSocketsConfig,
                          Socket_t tcpSocket,
                          const char * pHostName,
@@ -483,6 +619,13 @@ static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkCont
     {
         /* Set the socket in the network context. */
         pSecureSocketsTransportParams->tcpSocket = tcpSocket;
+        pSecureSocketsTransportParams->pReadAheadBuffer = pSocketsConfig->pReadAheadBuffer;
+        pSecureSocketsTransportParams->readAheadBufferSize = pSocketsConfig->readAheadBufferSize;
+        pSecureSocketsTransportParams->readAheadOffset = 0UL;
+        pSecureSocketsTransportParams->readAheadLength = 0UL;
+        ( void ) memset( &pSecureSocketsTransportParams->recvMetrics,
+                         0,
+                         sizeof( SecureSocketsTransportRecvMetrics_t ) );
     }
     else
     {
@@ -498,6 +641,87 @@ static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkCont
 
 /*-----------------------------------------------------------*/
 
+static int32_t socketRecv( SecureSocketsTransportParams_t * pSecureSocketsTransportParams,
+                           uint8_t * pBuffer,
+                           size_t bytesToRecv )
+{
+    int32_t bytesReceived = SOCKETS_SOCKET_ERROR;
+
+    pSecureSocketsTransportParams->recvMetrics.socketRecvCalls++;
+    bytesReceived = SOCKETS_Recv( pSecureSocketsTransportParams->tcpSocket,
+                                  pBuffer,
+                                  bytesToRecv,
+                                  0 );
+
+    if( bytesReceived == SOCKETS_EWOULDBLOCK )
+    {
+        /* The return value EWOULDBLOCK means no data was received within
+         * the receive timeout. */
+        bytesReceived = 0;
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t readAheadRecv( SecureSocketsTransportParams_t * pSecureSocketsTransportParams,
+                              uint8_t * pBuffer,
+                              size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0UL;
+
+    if( pSecureSocketsTransportParams->readAheadLength == 0UL )
+    {
+        if( bytesToRecv >= pSecureSocketsTransportParams->readAheadBufferSize )
+        {
+            /* Copying through the buffer would not save a socket read. */
+            bytesReceived = socketRecv( pSecureSocketsTransportParams,
+                                        pBuffer,
+                                        bytesToRecv );
+        }
+        else
+        {
+            bytesReceived = socketRecv( pSecureSocketsTransportParams,
+                                        pSecureSocketsTransportParams->pReadAheadBuffer,
+                                        pSecureSocketsTransportParams->readAheadBufferSize );
+
+            if( bytesReceived > 0 )
+            {
+                pSecureSocketsTransportParams->readAheadOffset = 0UL;
+                pSecureSocketsTransportParams->readAheadLength = ( size_t ) bytesReceived;
+                bytesReceived = 0;
+            }
+        }
+    }
+    else
+    {
+        pSecureSocketsTransportParams->recvMetrics.bufferedReads++;
+    }
+
+    if( pSecureSocketsTransportParams->readAheadLength > 0UL )
+    {
+        bytesToCopy = pSecureSocketsTransportParams->readAheadLength;
+
+        if( bytesToCopy > bytesToRecv )
+        {
+            bytesToCopy = bytesToRecv;
+        }
+
+        ( void ) memcpy( pBuffer,
+                         &pSecureSocketsTransportParams->pReadAheadBuffer[ pSecureSocketsTransportParams->readAheadOffset ],
+                         bytesToCopy );
+        pSecureSocketsTransportParams->readAheadOffset += bytesToCopy;
+        pSecureSocketsTransportParams->readAheadLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
 TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetworkContext,
                                                         const ServerInfo_t * pServerInfo,
                                                         const SocketsConfig_t * pSocketsConfig )
@@ -535,6 +759,12 @@ TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetw
         LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
         returnStatus = TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER;
     }
+    else if( ( pSocketsConfig->pReadAheadBuffer != NULL ) &&
+             ( pSocketsConfig->readAheadBufferSize == 0UL ) )
+    {
+        LogError( ( "Parameter check failed: readAheadBufferSize must be greater than 0." ) );
+        returnStatus = TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER;
+    }
     else
     {
         /* Establish the TCP connection. */
@@ -559,6 +789,14 @@ TransportSocketStatus_t SecureSocketsTransport_Disconnect( const NetworkContext_
     {
         pSecureSocketsTransportParams = pNetworkContext->pParams;
 
+        LogDebug( ( "Served %u receive calls with %u socket reads, %u from the read-ahead buffer.",
+                    ( unsigned int ) pSecureSocketsTransportParams->recvMetrics.recvCalls,
+                    ( unsigned int ) pSecureSocketsTransportParams->recvMetrics.socketRecvCalls,
+                    ( unsigned int ) pSecureSocketsTransportParams->recvMetrics.bufferedReads ) );
+
+        /* Drop data read ahead of the caller along with the connection. */
+        pSecureSocketsTransportParams->readAheadLength = 0UL;
+
         /* Call Secure Sockets shutdown function to close connection. */
         transportSocketStatus = SOCKETS_Shutdown( pSecureSocketsTransportParams->tcpSocket, SOCKETS_SHUT_RDWR );
 
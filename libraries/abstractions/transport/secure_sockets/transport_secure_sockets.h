@@ -64,13 +64,35 @@
 /* Logging implementation header include. */
 #include "logging_stack.h"
 
+/**
+ * @brief Receive counters of a connection, used to measure how many
+ * #SecureSocketsTransport_Recv calls the read-ahead buffer served without
+ * reading from the socket.
+ */
+typedef struct SecureSocketsTransportRecvMetrics
+{
+    uint32_t recvCalls;       /**< @brief Number of #SecureSocketsTransport_Recv calls. */
+    uint32_t socketRecvCalls; /**< @brief Number of SOCKETS_Recv calls made by them. */
+    uint32_t bufferedReads;   /**< @brief Number of calls served from the read-ahead buffer. */
+} SecureSocketsTransportRecvMetrics_t;
+
 /**
  * @brief Definition of the network context for the transport interface
  * implementation that uses Secure Sockets API.
+ *
+ * The read-ahead members are set by #SecureSocketsTransport_Connect from
+ * #SocketsConfig_t and must not be modified by the application.
  */
 typedef struct SecureSocketsTransportParams
 {
     Socket_t tcpSocket;
+
+    uint8_t * pReadAheadBuffer; /**< @brief Buffer holding data read ahead of the caller, or NULL. */
+    size_t readAheadBufferSize; /**< @brief Size of #SecureSocketsTransportParams_t.pReadAheadBuffer. */
+    size_t readAheadOffset;     /**< @brief Offset of the first unread byte in the read-ahead buffer. */
+    size_t readAheadLength;     /**< @brief Number of unread bytes in the read-ahead buffer. */
+
+    SecureSocketsTransportRecvMetrics_t recvMetrics; /**< @brief Receive counters since the connection was established. */
 } SecureSocketsTransportParams_t;
 
 /**
@@ -136,6 +158,23 @@ typedef struct SocketsConfig
 
     const char * pRootCa; /**< @brief String representing a trusted server Root CA certificate. */
     size_t rootCaSize;    /**< @brief Size associated with #SocketsConfig_t.pRootCa. */
+
+    /**
+     * @brief Set this to a non-NULL buffer to read ahead of the caller.
+     *
+     * Reads shorter than the buffer, such as the 1 byte MQTT fixed header,
+     * then fill the buffer with as much data as one SOCKETS_Recv call returns
+     * (for TLS, the rest of the current record) and following reads are
+     * served from memory. The buffer must remain valid until the connection
+     * is closed. Leave NULL to pass each read straight to SOCKETS_Recv.
+     *
+     * @note Data in the buffer has already left the socket, so it does not
+     * trigger SOCKETS_SO_WAKEUP_CALLBACK. A receive loop driven by that
+     * callback must keep reading while #SecureSocketsTransport_GetPendingBytes
+     * is not zero, or it may never process the buffered data.
+     */
+    uint8_t * pReadAheadBuffer;
+    size_t readAheadBufferSize; /**< @brief Size of #SocketsConfig_t.pReadAheadBuffer. */
 } SocketsConfig_t;
 
 
@@ -177,6 +216,9 @@ TransportSocketStatus_t SecureSocketsTransport_Disconnect( const NetworkContext_
  * @param[out] pBuffer Buffer to receive network data into.
  * @param[in] bytesToRecv Number of bytes requested from the network.
  *
+ * When the connection has a read-ahead buffer, the call returns buffered
+ * data if there is any, even if it is fewer than @p bytesToRecv bytes.
+ *
  * @return Number of bytes (> 0) received if successful;
  *         0 if the socket times out without reading any bytes;
  *         negative value on error.
@@ -185,6 +227,19 @@ int32_t SecureSocketsTransport_Recv( NetworkContext_t * pNetworkContext,
                                      void * pBuffer,
                                      size_t bytesToRecv );
 
+/**
+ * @brief Gets the number of bytes that #SecureSocketsTransport_Recv can
+ * return from the read-ahead buffer without reading the socket.
+ *
+ * The socket does not signal these bytes, see #SocketsConfig_t.pReadAheadBuffer.
+ *
+ * @param[in] pNetworkContext The network context created using Secure Sockets API.
+ *
+ * @return Number of buffered bytes; 0 if there are none, if the connection
+ *         has no read-ahead buffer, or if @p pNetworkContext is invalid.
+ */
+size_t SecureSocketsTransport_GetPendingBytes( const NetworkContext_t * pNetworkContext );
+
 /**
  * @brief Sends data over an established TLS session using the Secure Sockets API.
  *
@@ -201,4 +256,23 @@ int32_t SecureSocketsTransport_Send( NetworkContext_t * pNetworkContext,
                                      const void * pMessage,
                                      size_t bytesToSend );
 
+/**
+ * @brief Sends the data of several buffers, in order, over an established
+ * TLS session using the Secure Sockets API.
+ *
+ * The buffers are packed into as few TLS records as possible without first
+ * being copied into one contiguous buffer, e.g. an MQTT packet header, topic
+ * and payload can be sent in one call. Ports without SOCKETS_Sendv() (see
+ * socketsconfigSENDV_SUPPORTED) send each buffer with SOCKETS_Send().
+ *
+ * @param[in] pNetworkContext The network context created using Secure Sockets API.
+ * @param[in] pIoVec Buffers containing the bytes to send over the network stack.
+ * @param[in] ioVecCount Number of buffers in pIoVec.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+int32_t SecureSocketsTransport_Writev( NetworkContext_t * pNetworkContext,
+                                       const SocketsIOVec_t * pIoVec,
+                                       size_t ioVecCount );
+
 #endif /* TRANSPORT_SECURE_SOCKETS_H */
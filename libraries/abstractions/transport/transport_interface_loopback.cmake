@@ -0,0 +1,37 @@
+if(AFR_ENABLE_UNIT_TESTS)
+    return()
+endif()
+
+# Loopback transport, for benchmarking libraries that use the transport interface.
+afr_module(NAME transport_interface_loopback INTERNAL)
+
+set(src_dir "${CMAKE_CURRENT_LIST_DIR}/loopback")
+
+# Include filepaths for source and include.
+include( ${CMAKE_CURRENT_LIST_DIR}/transport_interface.cmake )
+
+# Add cmake files of module to metadata.
+afr_module_cmake_files(${AFR_CURRENT_MODULE}
+    ${CMAKE_CURRENT_LIST_DIR}/transport_interface.cmake
+    ${CMAKE_CURRENT_LIST_DIR}/transport_interface_loopback.cmake
+)
+
+afr_module_sources(
+    ${AFR_CURRENT_MODULE}
+    PRIVATE
+        "${src_dir}/transport_loopback.h"
+        "${src_dir}/transport_loopback.c"
+)
+
+afr_module_dependencies(
+    ${AFR_CURRENT_MODULE}
+    PUBLIC
+        AFR::common
+)
+
+afr_module_include_dirs(
+    ${AFR_CURRENT_MODULE}
+    PUBLIC
+       "${transport_interface_dir}"
+       "${src_dir}"
+)
@@ -0,0 +1,341 @@
+/*
+ * FreeRTOS Transport Loopback V1.0.0
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+/* Transport interface include. */
+#include "transport_loopback.h"
+
+/* Size of each pipe buffer of the link. */
+#define PIPE_BUFFER_LEN     ( 32U )
+
+/* Properties of the link. */
+#define LATENCY_US          ( 1000U )
+#define BYTES_PER_SECOND    ( 1000000U )
+#define SEGMENT_SIZE        ( 4U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ * It should contain a single pointer to the type of your desired transport.
+ * When using multiple transports in the same compilation unit, define this pointer as void *.
+ *
+ * @note Transport stacks are defined in amazon-freertos/libraries/abstractions/transport/loopback/transport_loopback.h.
+ */
+struct NetworkContext
+{
+    LoopbackTransportParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+static LoopbackLink_t loopbackLink;
+static LoopbackLinkConfig_t linkConfig;
+static uint8_t clientBuffer[ PIPE_BUFFER_LEN ];
+static uint8_t serverBuffer[ PIPE_BUFFER_LEN ];
+static NetworkContext_t clientContext;
+static NetworkContext_t serverContext;
+static LoopbackTransportParams_t clientParams;
+static LoopbackTransportParams_t serverParams;
+
+/* Time returned by getTimeUs. */
+static uint64_t currentTimeUs;
+
+/* Number of calls to echoCallback. */
+static uint32_t echoCallbackCount;
+
+/*-----------------------------------------------------------*/
+
+/* Clock of the loopbackLink in tests that do not use the virtual clock. */
+static uint64_t getTimeUs( void )
+{
+    return currentTimeUs;
+}
+
+/* Server that sends back whatever it receives. */
+static void echoCallback( NetworkContext_t * pNetworkContext,
+                          void * pCallbackContext )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN ];
+    int32_t bytesReceived = 0;
+
+    ( void ) pCallbackContext;
+    echoCallbackCount++;
+
+    do
+    {
+        bytesReceived = LoopbackTransport_Recv( pNetworkContext, buffer, sizeof( buffer ) );
+
+        if( bytesReceived > 0 )
+        {
+            TEST_ASSERT_EQUAL( bytesReceived, LoopbackTransport_Send( pNetworkContext, buffer, bytesReceived ) );
+        }
+    } while( bytesReceived > 0 );
+}
+
+/* Creates the loopbackLink and connects both endpoints. */
+static void connectLink( LoopbackTransportRecvCallback_t serverCallback )
+{
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_SUCCESS,
+                       LoopbackTransport_CreateLink( &loopbackLink, &linkConfig, clientBuffer,
+                                                     serverBuffer, PIPE_BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_SUCCESS,
+                       LoopbackTransport_Connect( &clientContext, &loopbackLink, LOOPBACK_TRANSPORT_CLIENT,
+                                                  NULL, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_SUCCESS,
+                       LoopbackTransport_Connect( &serverContext, &loopbackLink, LOOPBACK_TRANSPORT_SERVER,
+                                                  serverCallback, NULL ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( &linkConfig, 0, sizeof( linkConfig ) );
+    ( void ) memset( &clientParams, 0, sizeof( clientParams ) );
+    ( void ) memset( &serverParams, 0, sizeof( serverParams ) );
+    clientContext.pParams = &clientParams;
+    serverContext.pParams = &serverParams;
+    currentTimeUs = 0U;
+    echoCallbackCount = 0U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #LoopbackTransport_CreateLink and #LoopbackTransport_Connect
+ * fail with invalid parameters.
+ */
+void test_LoopbackTransport_Invalid_Params( void )
+{
+    NetworkContext_t invalidContext = { 0 };
+
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_CreateLink( NULL, &linkConfig, clientBuffer, serverBuffer, PIPE_BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_CreateLink( &loopbackLink, NULL, clientBuffer, serverBuffer, PIPE_BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_CreateLink( &loopbackLink, &linkConfig, NULL, serverBuffer, PIPE_BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_CreateLink( &loopbackLink, &linkConfig, clientBuffer, serverBuffer, 0U ) );
+
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_Connect( &invalidContext, &loopbackLink, LOOPBACK_TRANSPORT_CLIENT, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_Connect( &clientContext, &loopbackLink, LOOPBACK_TRANSPORT_CLIENT, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_Connect( &clientContext, &loopbackLink, ( LoopbackTransportEndpoint_t ) 2, NULL, NULL ) );
+
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Send( NULL, clientBuffer, 1U ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Send( &invalidContext, clientBuffer, 1U ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Send( &clientContext, NULL, 1U ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Recv( NULL, serverBuffer, 1U ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Recv( &clientContext, serverBuffer, 0U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER, LoopbackTransport_Disconnect( NULL ) );
+}
+
+/**
+ * @brief Test that data reaches the other endpoint, also across the end of
+ * the ring buffer.
+ */
+void test_LoopbackTransport_Send_Recv_Succeeds( void )
+{
+    uint8_t sendBuffer[ PIPE_BUFFER_LEN ];
+    uint8_t recvBuffer[ PIPE_BUFFER_LEN ];
+    uint32_t index = 0U;
+
+    for( index = 0U; index < PIPE_BUFFER_LEN; index++ )
+    {
+        sendBuffer[ index ] = ( uint8_t ) index;
+    }
+
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( 0, LoopbackTransport_Recv( &serverContext, recvBuffer, sizeof( recvBuffer ) ) );
+
+    for( index = 0U; index < 3U; index++ )
+    {
+        TEST_ASSERT_EQUAL( 20, LoopbackTransport_Send( &clientContext, sendBuffer, 20U ) );
+        TEST_ASSERT_EQUAL( 20, LoopbackTransport_Recv( &serverContext, recvBuffer, sizeof( recvBuffer ) ) );
+        TEST_ASSERT_EQUAL_MEMORY( sendBuffer, recvBuffer, 20U );
+    }
+
+    TEST_ASSERT_EQUAL( 3U, clientParams.metrics.sendCalls );
+    TEST_ASSERT_EQUAL( 60U, clientParams.metrics.bytesSent );
+    TEST_ASSERT_EQUAL( 4U, serverParams.metrics.recvCalls );
+    TEST_ASSERT_EQUAL( 1U, serverParams.metrics.emptyRecvs );
+    TEST_ASSERT_EQUAL( 60U, serverParams.metrics.bytesRecved );
+}
+
+/**
+ * @brief Test that a send stops when the pipe buffer is full.
+ */
+void test_LoopbackTransport_Send_Buffer_Full( void )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN + 8U ] = { 0 };
+
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( PIPE_BUFFER_LEN, LoopbackTransport_Send( &clientContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 0, LoopbackTransport_Send( &clientContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 8, LoopbackTransport_Recv( &serverContext, buffer, 8U ) );
+    TEST_ASSERT_EQUAL( 8, LoopbackTransport_Send( &clientContext, buffer, sizeof( buffer ) ) );
+}
+
+/**
+ * @brief Test that a send is split into segments, which are received one at
+ * a time.
+ */
+void test_LoopbackTransport_Fragmentation( void )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN ] = { 0 };
+
+    linkConfig.segmentSize = SEGMENT_SIZE;
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( 4, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 3, LoopbackTransport_Recv( &serverContext, buffer, 3U ) );
+    TEST_ASSERT_EQUAL( 1, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 2, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 0, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+}
+
+/**
+ * @brief Test that the virtual clock advances by the transmit time and the
+ * latency when the receiver waits for data.
+ */
+void test_LoopbackTransport_Virtual_Clock( void )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN ] = { 0 };
+
+    linkConfig.latencyUs = LATENCY_US;
+    linkConfig.bytesPerSecond = BYTES_PER_SECOND;
+    connectLink( NULL );
+
+    /* 10 bytes take 10 us at 1 MB/s, and the next 10 wait for them. */
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( 0U, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 10U + LATENCY_US, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( 20U + LATENCY_US, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+
+    LoopbackTransport_AdvanceTimeUs( &loopbackLink, 5U );
+    TEST_ASSERT_EQUAL( 25U + LATENCY_US, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+}
+
+/**
+ * @brief Test that data in flight is not received before it arrives when the
+ * loopbackLink has a clock.
+ */
+void test_LoopbackTransport_External_Clock( void )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN ] = { 0 };
+
+    linkConfig.latencyUs = LATENCY_US;
+    linkConfig.getTimeUs = getTimeUs;
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( 0, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+
+    LoopbackTransport_AdvanceTimeUs( &loopbackLink, LATENCY_US );
+    TEST_ASSERT_EQUAL( 0, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+
+    currentTimeUs = LATENCY_US;
+    TEST_ASSERT_EQUAL( LATENCY_US, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+}
+
+/**
+ * @brief Test that the server can answer from its receive callback.
+ */
+void test_LoopbackTransport_Recv_Callback( void )
+{
+    uint8_t sendBuffer[ 8 ] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t recvBuffer[ 8 ] = { 0 };
+
+    linkConfig.latencyUs = LATENCY_US;
+    connectLink( echoCallback );
+
+    TEST_ASSERT_EQUAL( 8, LoopbackTransport_Send( &clientContext, sendBuffer, sizeof( sendBuffer ) ) );
+    TEST_ASSERT_EQUAL( 1U, echoCallbackCount );
+    TEST_ASSERT_EQUAL( 8, LoopbackTransport_Recv( &clientContext, recvBuffer, sizeof( recvBuffer ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sendBuffer, recvBuffer, sizeof( sendBuffer ) );
+    TEST_ASSERT_EQUAL( 2U * LATENCY_US, LoopbackTransport_GetTimeUs( &loopbackLink ) );
+}
+
+/**
+ * @brief Test that the other endpoint receives the data in flight after a
+ * disconnect, and then fails.
+ */
+void test_LoopbackTransport_Disconnect( void )
+{
+    uint8_t buffer[ PIPE_BUFFER_LEN ] = { 0 };
+
+    connectLink( NULL );
+
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_SUCCESS, LoopbackTransport_Disconnect( &clientContext ) );
+
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Send( &clientContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Send( &serverContext, buffer, 10U ) );
+    TEST_ASSERT_EQUAL( 10, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+    TEST_ASSERT_EQUAL( -1, LoopbackTransport_Recv( &serverContext, buffer, sizeof( buffer ) ) );
+
+    TEST_ASSERT_EQUAL( LOOPBACK_TRANSPORT_STATUS_INVALID_PARAMETER,
+                       LoopbackTransport_Connect( &clientContext, &loopbackLink, LOOPBACK_TRANSPORT_CLIENT, NULL, NULL ) );
+}
+
+/*-------------------------------------------------------------------*/
+/*-----------------------End Tests-----------------------------------*/
+/*-------------------------------------------------------------------*/
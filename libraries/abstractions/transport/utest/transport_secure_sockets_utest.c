@@ -59,6 +59,9 @@
 /* The size of the buffer passed to #SecureSocketsTransport_Send and #SecureSocketsTransport_Recv. */
 #define BUFFER_LEN                         ( 4U )
 
+/* The size of the read-ahead buffer of a connection. */
+#define READ_AHEAD_BUFFER_LEN              ( 16U )
+
 /**
  * @brief Transport timeout in milliseconds for transport send.
  */
@@ -105,6 +108,7 @@ static SocketsConfig_t socketsConfig =
 };
 
 static uint8_t networkBuffer[ BUFFER_LEN ] = { 0 };
+static uint8_t readAheadBuffer[ READ_AHEAD_BUFFER_LEN ] = { 0 };
 static Socket_t mockTcpSocket = ( Socket_t ) MOCT_TCP_SOCKET;
 static NetworkContext_t networkContext = { 0 };
 static SecureSocketsTransportParams_t secureSocketsTransportParams = { 0 };
@@ -114,6 +118,7 @@ static SecureSocketsTransportParams_t secureSocketsTransportParams = { 0 };
 /* Called before each test method. */
 void setUp()
 {
+    ( void ) memset( &secureSocketsTransportParams, 0, sizeof( secureSocketsTransportParams ) );
     networkContext.pParams = &secureSocketsTransportParams;
     secureSocketsTransportParams.tcpSocket = mockTcpSocket;
 }
@@ -978,6 +983,98 @@ void test_SecureSocketsTransport_Send_Bytes_Sent_Partially( void )
 }
 
 
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Writev returns an error when passing
+ * any invalid parameters.
+ */
+void test_SecureSocketsTransport_Writev_Invalid_Params( void )
+{
+    int32_t bytesSent;
+    NetworkContext_t invalidNetworkContext = { 0 };
+    SocketsIOVec_t ioVec = { networkBuffer, BYTES_TO_SEND };
+
+    secureSocketsTransportParams.tcpSocket = SOCKETS_INVALID_SOCKET;
+    invalidNetworkContext.pParams = &secureSocketsTransportParams;
+
+    bytesSent = SecureSocketsTransport_Writev( NULL, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, bytesSent );
+
+    bytesSent = SecureSocketsTransport_Writev( &invalidNetworkContext, NULL, 1 );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, bytesSent );
+
+    bytesSent = SecureSocketsTransport_Writev( &invalidNetworkContext, &ioVec, 0 );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, bytesSent );
+
+    bytesSent = SecureSocketsTransport_Writev( &invalidNetworkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, bytesSent );
+
+    invalidNetworkContext.pParams = NULL;
+    bytesSent = SecureSocketsTransport_Writev( &invalidNetworkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( SOCKETS_EINVAL, bytesSent );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Writev returns an error when #SOCKETS_Sendv
+ * fails to send data over the network stack.
+ */
+void test_SecureSocketsTransport_Writev_Network_Error( void )
+{
+    int32_t bytesSent = 0;
+    SocketsIOVec_t ioVec[ 2 ] =
+    {
+        { networkBuffer,                       BYTES_TO_SEND / 2 },
+        { &networkBuffer[ BYTES_TO_SEND / 2 ], BYTES_TO_SEND / 2 }
+    };
+
+    SOCKETS_Sendv_ExpectAndReturn( mockTcpSocket, ioVec, 2, 0, SECURE_SOCKETS_READ_WRITE_ERROR );
+    bytesSent = SecureSocketsTransport_Writev( &networkContext, ioVec, 2 );
+    TEST_ASSERT_EQUAL( SECURE_SOCKETS_READ_WRITE_ERROR, bytesSent );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test the happy path case when #SecureSocketsTransport_Writev is able to send
+ * the bytes of every buffer over the network stack successfully.
+ */
+void test_SecureSocketsTransport_Writev_All_Bytes_Sent_Successfully( void )
+{
+    int32_t bytesSent = 0;
+    SocketsIOVec_t ioVec[ 2 ] =
+    {
+        { networkBuffer,                       BYTES_TO_SEND / 2 },
+        { &networkBuffer[ BYTES_TO_SEND / 2 ], BYTES_TO_SEND / 2 }
+    };
+
+    SOCKETS_Sendv_ExpectAndReturn( mockTcpSocket, ioVec, 2, 0, BYTES_TO_SEND );
+    bytesSent = SecureSocketsTransport_Writev( &networkContext, ioVec, 2 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test the happy path case of when #SecureSocketsTransport_Writev sends
+ * fewer bytes than the buffers hold.
+ */
+void test_SecureSocketsTransport_Writev_Bytes_Sent_Partially( void )
+{
+    int32_t bytesSent = 0;
+    SocketsIOVec_t ioVec[ 2 ] =
+    {
+        { networkBuffer,                       BYTES_TO_SEND / 2 },
+        { &networkBuffer[ BYTES_TO_SEND / 2 ], BYTES_TO_SEND / 2 }
+    };
+
+    SOCKETS_Sendv_ExpectAndReturn( mockTcpSocket, ioVec, 2, 0, BYTES_TO_SEND - 1 );
+    bytesSent = SecureSocketsTransport_Writev( &networkContext, ioVec, 2 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND - 1, bytesSent );
+}
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -1068,6 +1165,133 @@ void test_SecureSocketsTransport_Recv_Bytes_Received_Partially( void )
     TEST_ASSERT_EQUAL( BYTES_TO_RECV - 1, bytesReceived );
 }
 
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Connect rejects a read-ahead buffer
+ * without a size.
+ */
+void test_SecureSocketsTransport_Connect_Invalid_ReadAhead_Buffer( void )
+{
+    TransportSocketStatus_t returnStatus;
+    SocketsConfig_t localSocketsConfig = socketsConfig;
+
+    localSocketsConfig.pReadAheadBuffer = readAheadBuffer;
+    localSocketsConfig.readAheadBufferSize = 0U;
+    returnStatus = SecureSocketsTransport_Connect( &networkContext,
+                                                   &serverInfo,
+                                                   &localSocketsConfig );
+    TEST_ASSERT_EQUAL( TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER, returnStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Recv serves small reads from one
+ * socket read through the read-ahead buffer.
+ */
+void test_SecureSocketsTransport_Recv_ReadAhead_Serves_Small_Reads( void )
+{
+    int32_t bytesReceived = 0;
+    uint8_t record[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    uint8_t recvBuffer[ 8 ] = { 0 };
+
+    secureSocketsTransportParams.pReadAheadBuffer = readAheadBuffer;
+    secureSocketsTransportParams.readAheadBufferSize = READ_AHEAD_BUFFER_LEN;
+    SOCKETS_Recv_ExpectAndReturn( mockTcpSocket, NULL, READ_AHEAD_BUFFER_LEN, 0, sizeof( record ) );
+    SOCKETS_Recv_IgnoreArg_pvBuffer();
+    SOCKETS_Recv_ReturnMemThruPtr_pvBuffer( record, sizeof( record ) );
+
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, 1U );
+    TEST_ASSERT_EQUAL( 1, bytesReceived );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &record[ 0 ], recvBuffer, 1U );
+
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, 4U );
+    TEST_ASSERT_EQUAL( 4, bytesReceived );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &record[ 1 ], recvBuffer, 4U );
+
+    /* Only the remaining buffered bytes are returned. */
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, sizeof( recvBuffer ) );
+    TEST_ASSERT_EQUAL( 5, bytesReceived );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &record[ 5 ], recvBuffer, 5U );
+    TEST_ASSERT_EQUAL( 0U, secureSocketsTransportParams.readAheadLength );
+
+    TEST_ASSERT_EQUAL( 3U, secureSocketsTransportParams.recvMetrics.recvCalls );
+    TEST_ASSERT_EQUAL( 1U, secureSocketsTransportParams.recvMetrics.socketRecvCalls );
+    TEST_ASSERT_EQUAL( 2U, secureSocketsTransportParams.recvMetrics.bufferedReads );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_GetPendingBytes reports the bytes
+ * left in the read-ahead buffer.
+ */
+void test_SecureSocketsTransport_GetPendingBytes( void )
+{
+    int32_t bytesReceived = 0;
+    uint8_t record[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    uint8_t recvBuffer[ sizeof( record ) ] = { 0 };
+
+    TEST_ASSERT_EQUAL( 0U, SecureSocketsTransport_GetPendingBytes( NULL ) );
+    TEST_ASSERT_EQUAL( 0U, SecureSocketsTransport_GetPendingBytes( &networkContext ) );
+
+    secureSocketsTransportParams.pReadAheadBuffer = readAheadBuffer;
+    secureSocketsTransportParams.readAheadBufferSize = READ_AHEAD_BUFFER_LEN;
+    SOCKETS_Recv_ExpectAndReturn( mockTcpSocket, NULL, READ_AHEAD_BUFFER_LEN, 0, sizeof( record ) );
+    SOCKETS_Recv_IgnoreArg_pvBuffer();
+    SOCKETS_Recv_ReturnMemThruPtr_pvBuffer( record, sizeof( record ) );
+
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, 1U );
+    TEST_ASSERT_EQUAL( 1, bytesReceived );
+    TEST_ASSERT_EQUAL( sizeof( record ) - 1U, SecureSocketsTransport_GetPendingBytes( &networkContext ) );
+
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, sizeof( recvBuffer ) );
+    TEST_ASSERT_EQUAL( sizeof( record ) - 1U, bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, SecureSocketsTransport_GetPendingBytes( &networkContext ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Recv reads directly into the caller's
+ * buffer when it is at least as large as the read-ahead buffer.
+ */
+void test_SecureSocketsTransport_Recv_ReadAhead_Large_Read_Bypasses_Buffer( void )
+{
+    int32_t bytesReceived = 0;
+    uint8_t recvBuffer[ READ_AHEAD_BUFFER_LEN ] = { 0 };
+
+    secureSocketsTransportParams.pReadAheadBuffer = readAheadBuffer;
+    secureSocketsTransportParams.readAheadBufferSize = READ_AHEAD_BUFFER_LEN;
+    SOCKETS_Recv_ExpectAndReturn( mockTcpSocket, recvBuffer, READ_AHEAD_BUFFER_LEN, 0, READ_AHEAD_BUFFER_LEN );
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, recvBuffer, sizeof( recvBuffer ) );
+    TEST_ASSERT_EQUAL( READ_AHEAD_BUFFER_LEN, bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, secureSocketsTransportParams.readAheadLength );
+    TEST_ASSERT_EQUAL( 0U, secureSocketsTransportParams.recvMetrics.bufferedReads );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test that #SecureSocketsTransport_Recv reports timeouts and errors of the
+ * socket read that refills the read-ahead buffer.
+ */
+void test_SecureSocketsTransport_Recv_ReadAhead_Network_Error( void )
+{
+    int32_t bytesReceived = 0;
+
+    secureSocketsTransportParams.pReadAheadBuffer = readAheadBuffer;
+    secureSocketsTransportParams.readAheadBufferSize = READ_AHEAD_BUFFER_LEN;
+    SOCKETS_Recv_ExpectAndReturn( mockTcpSocket, readAheadBuffer, READ_AHEAD_BUFFER_LEN, 0, SOCKETS_EWOULDBLOCK );
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, networkBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    SOCKETS_Recv_ExpectAndReturn( mockTcpSocket, readAheadBuffer, READ_AHEAD_BUFFER_LEN, 0, SECURE_SOCKETS_READ_WRITE_ERROR );
+    bytesReceived = SecureSocketsTransport_Recv( &networkContext, networkBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( SECURE_SOCKETS_READ_WRITE_ERROR, bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, secureSocketsTransportParams.readAheadLength );
+}
 
 /*-------------------------------------------------------------------*/
 /*-----------------------End Tests-----------------------------------*/
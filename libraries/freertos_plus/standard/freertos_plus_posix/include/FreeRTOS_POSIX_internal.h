@@ -52,9 +52,10 @@
     typedef struct pthread_mutex_internal
     {
         BaseType_t xIsInitialized;          /**< Set to pdTRUE if this mutex is initialized, pdFALSE otherwise. */
-        StaticSemaphore_t xMutex;           /**< FreeRTOS mutex. */
+        StaticSemaphore_t xMutex;           /**< FreeRTOS mutex; a binary semaphore for PTHREAD_MUTEX_ADAPTIVE_NP. */
         TaskHandle_t xTaskOwner;            /**< Owner; used for deadlock detection and permission checks. */
         pthread_mutexattr_internal_t xAttr; /**< Mutex attributes. */
+        volatile uint32_t ulAdaptiveState;  /**< Lock word of a PTHREAD_MUTEX_ADAPTIVE_NP mutex. */
     } pthread_mutex_internal_t;
 
 /**
@@ -66,7 +67,8 @@
         .xIsInitialized = pdFALSE,           \
         .xMutex = { { 0 } },                 \
         .xTaskOwner = NULL,                  \
-        .xAttr = { .iType = 0 }              \
+        .xAttr = { .iType = 0 },             \
+        .ulAdaptiveState = 0                 \
     }                                        \
         )                                    \
     )
@@ -79,9 +81,8 @@
  */
     typedef struct pthread_cond_internal
     {
-        BaseType_t xIsInitialized;            /**< Set to pdTRUE if this condition variable is initialized, pdFALSE otherwise. */
-        StaticSemaphore_t xCondWaitSemaphore; /**< Threads block on this semaphore in pthread_cond_wait. */
-        unsigned iWaitingThreads;             /**< The number of threads currently waiting on this condition variable. */
+        BaseType_t xIsInitialized; /**< Set to pdTRUE if this condition variable is initialized, pdFALSE otherwise. */
+        Link_t xWaiterList;        /**< Threads waiting in pthread_cond_wait, highest priority first. */
     } pthread_cond_internal_t;
 
 /**
@@ -92,8 +93,7 @@
     ( ( ( pthread_cond_internal_t )         \
     {                                       \
         .xIsInitialized = pdFALSE,          \
-        .xCondWaitSemaphore = { { 0 } },    \
-        .iWaitingThreads = 0                \
+        .xWaiterList = { 0 }                \
     }                                       \
         )                                   \
     )
@@ -119,11 +119,67 @@
  */
     typedef struct pthread_barrier_internal
     {
-        unsigned uThreadCount;                   /**< Current number of threads that have entered barrier. */
-        unsigned uThreshold;                     /**< The count argument of pthread_barrier_init. */
-        StaticSemaphore_t xThreadCountSemaphore; /**< Prevents more than uThreshold threads from exiting pthread_barrier_wait at once. */
-        StaticEventGroup_t xBarrierEventGroup;   /**< FreeRTOS event group that blocks to wait on threads entering barrier. */
+        volatile uint32_t ulThreadCount;       /**< Number of threads that have entered the barrier in the current cycle. */
+        unsigned uThreshold;                   /**< The count argument of pthread_barrier_init. */
+        volatile uint32_t ulSense;             /**< Sense of the current cycle, 0 or 1. Flipped when a cycle completes. */
+        StaticEventGroup_t xBarrierEventGroup; /**< Bit ulSense is set once all threads of that cycle entered the barrier. */
     } pthread_barrier_internal_t;
 #endif /* if posixconfigENABLE_PTHREAD_BARRIER_T == 1 */
 
+/**
+ * @brief Reader-writer lock attribute object.
+ */
+#if posixconfigENABLE_PTHREAD_RWLOCKATTR_T == 1
+    typedef struct pthread_rwlockattr_internal
+    {
+        int iKind; /**< Whether readers or writers are preferred. */
+    } pthread_rwlockattr_internal_t;
+#endif
+
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+
+/**
+ * @brief Reader-writer lock.
+ */
+    typedef struct pthread_rwlock_internal
+    {
+        BaseType_t xIsInitialized;           /**< Set to pdTRUE if this rwlock is initialized, pdFALSE otherwise. */
+        StaticSemaphore_t xWriterMutex;      /**< FreeRTOS mutex held by the writer; threads blocked on it raise the writer's priority. */
+        TaskHandle_t xWriter;                /**< Owner of xWriterMutex while it write locks the rwlock; NULL otherwise. */
+        BaseType_t xWriterActive;            /**< Set to pdTRUE once xWriter excludes new readers. */
+        UBaseType_t uxReaders;               /**< Number of read locks held. */
+        UBaseType_t uxWritersWaiting;        /**< Writers that want the rwlock but do not hold it yet. */
+        pthread_rwlockattr_internal_t xAttr; /**< Rwlock attributes. */
+    } pthread_rwlock_internal_t;
+
+/**
+ * @brief Compile-time initializer of pthread_rwlock_internal_t.
+ */
+    #define FREERTOS_POSIX_RWLOCK_INITIALIZER \
+    ( ( ( pthread_rwlock_internal_t )         \
+    {                                         \
+        .xIsInitialized = pdFALSE,            \
+        .xWriterMutex = { { 0 } },            \
+        .xWriter = NULL,                      \
+        .xWriterActive = pdFALSE,             \
+        .uxReaders = 0,                       \
+        .uxWritersWaiting = 0,                \
+        .xAttr = { .iKind = 0 }               \
+    }                                         \
+        )                                     \
+    )
+#endif /* if posixconfigENABLE_PTHREAD_RWLOCK_T == 1 */
+
+#if posixconfigENABLE_PTHREAD_SPINLOCK_T == 1
+
+/**
+ * @brief Spin lock.
+ */
+    typedef struct pthread_spinlock_internal
+    {
+        volatile uint32_t ulLocked; /**< 1 while the lock is held, 0 otherwise. */
+        TaskHandle_t xOwner;        /**< Holder; used for deadlock detection and permission checks. */
+    } pthread_spinlock_internal_t;
+#endif /* if posixconfigENABLE_PTHREAD_SPINLOCK_T == 1 */
+
 #endif /* _FREERTOS_POSIX_INTERNAL_H_ */
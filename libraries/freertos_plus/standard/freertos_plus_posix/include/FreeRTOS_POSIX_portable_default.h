@@ -49,6 +49,27 @@
 #endif
 /**@} */
 
+/**
+ * @name Defaults for the threads that run SIGEV_THREAD timer notifications.
+ */
+/**@{ */
+#ifndef posixconfigTIMER_NOTIFY_THREADS
+    #define posixconfigTIMER_NOTIFY_THREADS    2 /**< Number of threads shared by all POSIX timers. */
+#endif
+
+#ifndef posixconfigTIMER_NOTIFY_QUEUE_LENGTH
+    #define posixconfigTIMER_NOTIFY_QUEUE_LENGTH    8 /**< Maximum number of notifications waiting for a thread. */
+#endif
+
+#ifndef posixconfigTIMER_NOTIFY_STACK_SIZE
+    #define posixconfigTIMER_NOTIFY_STACK_SIZE    ( configTIMER_TASK_STACK_DEPTH * sizeof( StackType_t ) ) /**< Stack size (in bytes) of each notification thread. */
+#endif
+
+#ifndef posixconfigTIMER_NOTIFY_PRIORITY
+    #define posixconfigTIMER_NOTIFY_PRIORITY    configTIMER_TASK_PRIORITY /**< Priority of the notification threads. */
+#endif
+/**@} */
+
 /**
  * @name Defaults for POSIX message queue implementation.
  */
@@ -60,6 +81,65 @@
 #ifndef posixconfigMQ_MAX_SIZE
     #define posixconfigMQ_MAX_SIZE    128 /**< Maximum size (in bytes) of each message. */
 #endif
+
+#ifndef posixconfigMQ_MAX_QUEUES
+    #define posixconfigMQ_MAX_QUEUES    16 /**< Maximum number of mqs that may have open descriptors at one time. */
+#endif
+
+#ifndef posixconfigMQ_NAME_HASH_BUCKETS
+    #define posixconfigMQ_NAME_HASH_BUCKETS    8 /**< Number of buckets in the mq name index. */
+#endif
+
+#ifndef posixconfigMQ_ZEROCOPY_SPARE_BUFFERS
+    #define posixconfigMQ_ZEROCOPY_SPARE_BUFFERS    2 /**< Buffers in an MQ_ZEROCOPY pool beyond mq_maxmsg. */
+#endif
+/**@} */
+
+/**
+ * @name Defaults for spinning locks.
+ */
+/**@{ */
+#ifndef posixconfigSPIN_COUNT
+    #define posixconfigSPIN_COUNT    100 /**< Attempts on a held spin lock or adaptive mutex before the caller sleeps or blocks. */
+#endif
+/**@} */
+
+/**
+ * @name Defaults for task notifications.
+ *
+ * Threads blocked on a condition variable, and writers waiting for the
+ * readers of a rwlock to leave, are woken with a direct to task
+ * notification on index posixconfigTASK_NOTIFY_INDEX, and waiting consumes
+ * every notification pending on that index. With configTASK_NOTIFICATION_ARRAY_ENTRIES
+ * above 1 the last index is used, so it must not be used by anything else.
+ * Otherwise index 0 is shared with xTaskNotifyGive, xTaskNotify and stream
+ * buffers, whose notifications to a waiting thread are lost.
+ */
+/**@{ */
+#ifndef posixconfigTASK_NOTIFY_INDEX
+    #define posixconfigTASK_NOTIFY_INDEX    ( configTASK_NOTIFICATION_ARRAY_ENTRIES - 1 ) /**< Task notification index used to wake blocked threads. */
+#endif
+#if ( posixconfigTASK_NOTIFY_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES )
+    #error "posixconfigTASK_NOTIFY_INDEX must be less than configTASK_NOTIFICATION_ARRAY_ENTRIES."
+#endif
+/**@} */
+
+/**
+ * @name Defaults for thread-specific data.
+ *
+ * pthread keys use FreeRTOS thread local storage pointers from
+ * posixconfigPTHREAD_KEY_TLS_INDEX to configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1,
+ * which must not be used by other libraries, e.g. FreeRTOS+FAT, or the lwIP
+ * port in sys_arch.c, which keeps each task's netconn semaphore in pointer 0.
+ *
+ * posixconfigPTHREAD_KEY_TLS_INDEX has no default. A port that wants pthread
+ * keys defines it in FreeRTOS_POSIX_portable.h; otherwise PTHREAD_KEYS_MAX is 0
+ * and the pthread key functions are not built.
+ */
+/**@{ */
+#if defined( posixconfigPTHREAD_KEY_TLS_INDEX ) && ( posixconfigPTHREAD_KEY_TLS_INDEX >= configNUM_THREAD_LOCAL_STORAGE_POINTERS )
+    #error "posixconfigPTHREAD_KEY_TLS_INDEX must be less than configNUM_THREAD_LOCAL_STORAGE_POINTERS."
+#endif
 /**@} */
 
 /**
@@ -69,13 +149,23 @@
  */
 /**@{ */
 #ifndef PTHREAD_STACK_MIN
-    #define PTHREAD_STACK_MIN    configMINIMAL_STACK_SIZE * sizeof( StackType_t ) /**< Minimum size in bytes of thread stack storage. */
+    #define PTHREAD_STACK_MIN                configMINIMAL_STACK_SIZE * sizeof( StackType_t )                               /**< Minimum size in bytes of thread stack storage. */
 #endif
 #ifndef NAME_MAX
-    #define NAME_MAX             64                                               /**< Maximum number of bytes in a filename (not including terminating null). */
+    #define NAME_MAX                         64                                                                             /**< Maximum number of bytes in a filename (not including terminating null). */
 #endif
 #ifndef SEM_VALUE_MAX
-    #define SEM_VALUE_MAX        0x7FFFU                                          /**< Maximum value of a sem_t. */
+    #define SEM_VALUE_MAX                    0x7FFFU                                                                        /**< Maximum value of a sem_t. */
+#endif
+#ifndef PTHREAD_KEYS_MAX
+    #ifdef posixconfigPTHREAD_KEY_TLS_INDEX
+        #define PTHREAD_KEYS_MAX             ( configNUM_THREAD_LOCAL_STORAGE_POINTERS - posixconfigPTHREAD_KEY_TLS_INDEX ) /**< Maximum number of pthread keys. */
+    #else
+        #define PTHREAD_KEYS_MAX             0                                                                              /**< pthread keys are disabled until the port reserves thread local storage pointers. */
+    #endif
+#endif
+#ifndef PTHREAD_DESTRUCTOR_ITERATIONS
+    #define PTHREAD_DESTRUCTOR_ITERATIONS    4                                                                              /**< Maximum number of passes over pthread key destructors at thread exit. */
 #endif
 /**@} */
 
@@ -107,6 +197,9 @@
 #ifndef posixconfigENABLE_PTHREAD_CONDATTR_T
     #define posixconfigENABLE_PTHREAD_CONDATTR_T     1 /**< pthread_condattr_t in sys/types.h */
 #endif
+#ifndef posixconfigENABLE_PTHREAD_KEY_T
+    #define posixconfigENABLE_PTHREAD_KEY_T          1 /**< pthread_key_t in sys/types.h */
+#endif
 #ifndef posixconfigENABLE_PTHREAD_MUTEX_T
     #define posixconfigENABLE_PTHREAD_MUTEX_T        1 /**< pthread_mutex_t in sys/types.h */
 #endif
@@ -143,6 +236,15 @@
 #ifndef posixconfigENABLE_PTHREAD_BARRIER_T
     #define posixconfigENABLE_PTHREAD_BARRIER_T      1 /**< pthread_barrier_t in sys/types.h */
 #endif
+#ifndef posixconfigENABLE_PTHREAD_RWLOCK_T
+    #define posixconfigENABLE_PTHREAD_RWLOCK_T       1 /**< pthread_rwlock_t in sys/types.h */
+#endif
+#ifndef posixconfigENABLE_PTHREAD_RWLOCKATTR_T
+    #define posixconfigENABLE_PTHREAD_RWLOCKATTR_T   1 /**< pthread_rwlockattr_t in sys/types.h */
+#endif
+#ifndef posixconfigENABLE_PTHREAD_SPINLOCK_T
+    #define posixconfigENABLE_PTHREAD_SPINLOCK_T     1 /**< pthread_spinlock_t in sys/types.h */
+#endif
 /**@} */
 
 #endif /* ifndef _FREERTOS_POSIX_PORTABLE_DEFAULT_H_ */
@@ -78,4 +78,25 @@
     typedef void                       * PthreadBarrierType_t;
 #endif
 
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+    typedef pthread_rwlock_internal_t  PthreadRwlockType_t;
+#else
+    typedef void                       * PthreadRwlockType_t;
+#endif
+
+#if posixconfigENABLE_PTHREAD_SPINLOCK_T == 1
+    typedef pthread_spinlock_internal_t PthreadSpinlockType_t;
+#else
+    typedef void                       * PthreadSpinlockType_t;
+#endif
+
+#if posixconfigENABLE_PTHREAD_RWLOCKATTR_T == 1
+    typedef struct pthread_rwlockattr
+    {
+        uint32_t ulpthreadRwlockAttrStorage;
+    } PthreadRwlockAttrType_t;
+#else
+    typedef void                       * PthreadRwlockAttrType_t;
+#endif
+
 #endif /* _FREERTOS_POSIX_INTERNAL_TYPES_H_ */
@@ -29,6 +29,7 @@
  */
 
 /* C standard library includes. */
+#include <stdint.h>
 #include <string.h>
 
 /* FreeRTOS+POSIX includes. */
@@ -51,18 +52,76 @@ typedef struct QueueElement
  * @brief Data structure of an mq.
  *
  * FreeRTOS isn't guaranteed to have a file-like abstraction, so message
- * queues in this implementation are stored as a linked list (in RAM).
+ * queues in this implementation are stored as linked lists (in RAM), one
+ * per bucket of the name index.
  */
 typedef struct QueueListElement
 {
-    Link_t xLink;              /**< Pointer to the next element in the list. */
-    QueueHandle_t xQueue;      /**< FreeRTOS queue handle. */
-    size_t xOpenDescriptors;   /**< Number of threads that have opened this queue. */
-    char * pcName;             /**< Null-terminated queue name. */
-    struct mq_attr xAttr;      /**< Queue attibutes. */
-    BaseType_t xPendingUnlink; /**< If pdTRUE, this queue will be unlinked once all descriptors close. */
+    Link_t xLink;               /**< Pointer to the next element in the name bucket. */
+    QueueHandle_t xQueue;       /**< FreeRTOS queue handle. */
+    size_t xOpenDescriptors;    /**< Number of threads that have opened this queue. */
+    char * pcName;              /**< Null-terminated queue name. */
+    uint32_t ulNameHash;        /**< Hash of pcName, see prvHashQueueName. */
+    mqd_t xDescriptor;          /**< Descriptor handed out while xOpenDescriptors is not 0. */
+    struct mq_attr xAttr;       /**< Queue attibutes. */
+    BaseType_t xPendingUnlink;  /**< If pdTRUE, this queue will be unlinked once all descriptors close. */
+    char * pcBufferPool;        /**< Message buffers of an MQ_ZEROCOPY queue; NULL for other queues. */
+    size_t xBufferStride;       /**< Distance in bytes between two buffers of pcBufferPool. */
+    size_t xBufferCount;        /**< Number of buffers in pcBufferPool. */
+    QueueHandle_t xFreeBuffers; /**< FreeRTOS queue of the buffers of pcBufferPool owned by nobody. */
+    uint32_t * pulHeldBuffers;  /**< One bit per buffer of pcBufferPool, set while a thread holds that buffer. */
 } QueueListElement_t;
 
+/**
+ * @brief Slot of the descriptor table.
+ *
+ * An mqd_t encodes a slot index and the generation of that slot, so that a
+ * descriptor can be validated without searching for its queue, and a stale
+ * descriptor is rejected even once its slot has been reused.
+ */
+typedef struct QueueDescriptorSlot
+{
+    QueueListElement_t * pxMessageQueue; /**< Queue owning this slot; NULL if the slot is free. */
+    uint16_t usGeneration;               /**< Incremented every time the slot is released. */
+} QueueDescriptorSlot_t;
+
+/**
+ * @brief Descriptors must fit the 16-bit index of an mqd_t.
+ */
+#if ( posixconfigMQ_MAX_QUEUES >= 0xFFFF )
+    #error "posixconfigMQ_MAX_QUEUES must be less than 0xFFFF."
+#endif
+
+/**
+ * @brief Build an mqd_t from a slot index and generation.
+ *
+ * Index 0 is reserved so that no descriptor is NULL.
+ */
+#define mqueueDESCRIPTOR( xIndex, usGeneration ) \
+    ( ( mqd_t ) ( uintptr_t ) ( ( ( uint32_t ) ( usGeneration ) << 16 ) | ( ( uint32_t ) ( xIndex ) + 1UL ) ) )
+
+/**
+ * @brief Get the slot index of an mqd_t. Out of range for invalid descriptors.
+ */
+#define mqueueDESCRIPTOR_INDEX( xDescriptor ) \
+    ( ( size_t ) ( ( ( uintptr_t ) ( xDescriptor ) & 0xFFFFUL ) - 1UL ) )
+
+/**
+ * @brief Number of 32-bit words in a bit mask of descriptor slots.
+ */
+#define mqueuePOLL_MASK_WORDS    ( ( posixconfigMQ_MAX_QUEUES + 31 ) / 32 )
+
+/**
+ * @brief A thread blocked in mq_poll.
+ */
+typedef struct QueuePollWaiter
+{
+    Link_t xLink;                                   /**< Pointer to the next waiter. */
+    SemaphoreHandle_t xWakeUp;                      /**< Given when one of the watched queues changes. */
+    uint32_t pulReadMask[ mqueuePOLL_MASK_WORDS ];  /**< Descriptor slots watched for MQ_POLLIN. */
+    uint32_t pulWriteMask[ mqueuePOLL_MASK_WORDS ]; /**< Descriptor slots watched for MQ_POLLOUT. */
+} QueuePollWaiter_t;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -87,13 +146,122 @@ static int prvCalculateTickTimeout( long lMessageQueueFlags,
  * @param[in] pxAttr mq_attr of the new queue.
  * @param[in] pcName Name of new queue.
  * @param[in] xNameLength Length of pcName.
+ * @param[in] ulNameHash Hash of pcName.
  *
- * @return pdTRUE if the queue is found; pdFALSE otherwise.
+ * @return pdTRUE if the queue is created; pdFALSE otherwise.
  */
 static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueue,
                                             const struct mq_attr * const pxAttr,
                                             const char * const pcName,
-                                            size_t xNameLength );
+                                            size_t xNameLength,
+                                            uint32_t ulNameHash );
+
+/**
+ * @brief Allocate the message buffer pool of an MQ_ZEROCOPY queue.
+ *
+ * All buffers start out on the free list.
+ * @param[in] pxMessageQueue Queue that gets the pool.
+ * @param[in] pxAttr mq_attr of the queue.
+ *
+ * @return pdTRUE if the pool is created; pdFALSE otherwise.
+ */
+static BaseType_t prvCreateBufferPool( QueueListElement_t * const pxMessageQueue,
+                                       const struct mq_attr * const pxAttr );
+
+/**
+ * @brief Check that pcBuffer is the start of a buffer of the queue's pool.
+ *
+ * @param[in] pxMessageQueue Queue owning the pool.
+ * @param[in] pcBuffer Buffer to check.
+ * @param[out] pxBuffer Index of pcBuffer in the pool, if it belongs to the pool.
+ *
+ * @return pdTRUE if pcBuffer belongs to the pool; pdFALSE otherwise.
+ */
+static BaseType_t prvIsPoolBuffer( const QueueListElement_t * const pxMessageQueue,
+                                   const char * const pcBuffer,
+                                   size_t * const pxBuffer );
+
+/**
+ * @brief Record that a thread now holds a buffer of the queue's pool.
+ *
+ * Called when mq_buffer_get or mq_buffer_receive hands a buffer over.
+ * @param[in] pxMessageQueue Queue owning the pool.
+ * @param[in] pcBuffer Buffer of the pool.
+ *
+ * @return nothing
+ */
+static void prvHoldBuffer( const QueueListElement_t * const pxMessageQueue,
+                           const char * const pcBuffer );
+
+/**
+ * @brief Take back a buffer of the queue's pool from the thread holding it.
+ *
+ * Rejects anything that is not a pool buffer held by a thread, e.g. a buffer
+ * that was already released or sent.
+ * @param[in] pxMessageQueue Queue owning the pool.
+ * @param[in] pcBuffer Buffer given back by the caller.
+ *
+ * @return pdTRUE if pcBuffer was held and is taken back; pdFALSE otherwise.
+ */
+static BaseType_t prvUnholdBuffer( const QueueListElement_t * const pxMessageQueue,
+                                   const char * const pcBuffer );
+
+/**
+ * @brief Free the memory of a message once it has left the queue.
+ *
+ * Returns pool buffers to the free list, and frees anything else.
+ * @param[in] pxMessageQueue Queue the message was sent to.
+ * @param[in] pcData Message data.
+ *
+ * @return nothing
+ */
+static void prvFreeMessageData( const QueueListElement_t * const pxMessageQueue,
+                                char * pcData );
+
+/**
+ * @brief Look up the MQ_ZEROCOPY queue referenced by a descriptor.
+ *
+ * @param[in] xMessageQueueDescriptor The descriptor to validate.
+ * @param[out] ppxMessageQueue Set to the queue when found.
+ *
+ * @return 0 if successful; EBADF if the descriptor is invalid, or ENOTSUP if
+ * the queue was not created with MQ_ZEROCOPY.
+ */
+static int prvGetZeroCopyQueue( mqd_t xMessageQueueDescriptor,
+                                QueueListElement_t ** const ppxMessageQueue );
+
+/**
+ * @brief Wake the mq_poll waiters watching a descriptor slot.
+ *
+ * @param[in] xIndex Descriptor slot of the queue that changed.
+ * @param[in] xReadable pdTRUE to wake waiters watching for MQ_POLLIN.
+ * @param[in] xWritable pdTRUE to wake waiters watching for MQ_POLLOUT.
+ *
+ * @return nothing
+ */
+static void prvWakePollWaiters( size_t xIndex,
+                                BaseType_t xReadable,
+                                BaseType_t xWritable );
+
+/**
+ * @brief Set revents of every entry of an mq_poll request.
+ *
+ * @param[in,out] pxPollFds Queues and requested events.
+ * @param[in] xPollFdCount Number of entries in pxPollFds.
+ *
+ * @return Number of entries with nonzero revents.
+ */
+static int prvPollQueues( struct mq_pollfd * const pxPollFds,
+                          size_t xPollFdCount );
+
+/**
+ * @brief Set errno after a queue operation did not complete in time.
+ *
+ * @param[in] pxMessageQueue Queue of the operation.
+ *
+ * @return nothing
+ */
+static void prvSetTimeoutErrno( const QueueListElement_t * const pxMessageQueue );
 
 /**
  * @brief Free all the resources used by a message queue.
@@ -105,18 +273,57 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
 static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQueue );
 
 /**
- * @brief Attempt to find the queue identified by pcName or xMqId in the queue list.
+ * @brief Attempt to find the queue named pcName in the name index.
  *
- * Matches queues by pcName first; if pcName is NULL, matches by xMqId.
+ * Must be called with xQueueListMutex held.
  * @param[out] ppxQueueListElement Output parameter set when queue is found.
  * @param[in] pcName A queue name to match.
- * @param[in] xMessageQueueDescriptor A queue descriptor to match.
+ * @param[in] ulNameHash Hash of pcName.
  *
  * @return pdTRUE if the queue is found; pdFALSE otherwise.
  */
-static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListElement,
+static BaseType_t prvFindQueueByName( QueueListElement_t ** const ppxQueueListElement,
                                       const char * const pcName,
-                                      mqd_t xMessageQueueDescriptor );
+                                      uint32_t ulNameHash );
+
+/**
+ * @brief Look up the queue referenced by a descriptor.
+ *
+ * Runs in O(1) and does not take xQueueListMutex.
+ * @param[in] xMessageQueueDescriptor The descriptor to validate.
+ *
+ * @return The queue if the descriptor is valid; NULL otherwise.
+ */
+static QueueListElement_t * prvGetQueueFromDescriptor( mqd_t xMessageQueueDescriptor );
+
+/**
+ * @brief Hash a queue name for the name index (32-bit FNV-1a).
+ *
+ * @param[in] pcName Null-terminated queue name.
+ *
+ * @return Hash of pcName.
+ */
+static uint32_t prvHashQueueName( const char * const pcName );
+
+/**
+ * @brief Assign a free descriptor table slot to a queue.
+ *
+ * Must be called with xQueueListMutex held. Sets pxMessageQueue->xDescriptor.
+ * @param[in] pxMessageQueue The queue that needs a descriptor.
+ *
+ * @return pdTRUE if a slot was assigned; pdFALSE if the table is full.
+ */
+static BaseType_t prvAllocateDescriptor( QueueListElement_t * const pxMessageQueue );
+
+/**
+ * @brief Release the descriptor table slot of a queue, invalidating its descriptor.
+ *
+ * Must be called with xQueueListMutex held.
+ * @param[in] pxMessageQueue The queue whose descriptor is released.
+ *
+ * @return nothing
+ */
+static void prvReleaseDescriptor( const QueueListElement_t * const pxMessageQueue );
 
 /**
  * @brief Initialize the queue list.
@@ -145,9 +352,20 @@ static BaseType_t prvValidateQueueName( const char * const pcName,
 static StaticSemaphore_t xQueueListMutex = { { 0 }, .u = { 0 } };
 
 /**
- * @brief Head of the linked list of queues.
+ * @brief Heads of the linked lists of queues, indexed by name hash.
+ */
+static Link_t xQueueNameBuckets[ posixconfigMQ_NAME_HASH_BUCKETS ] = { { 0 } };
+
+/**
+ * @brief Descriptor table. Written with xQueueListMutex held and inside a
+ * critical section; read inside a critical section only.
  */
-static Link_t xQueueListHead = { 0 };
+static QueueDescriptorSlot_t xQueueDescriptors[ posixconfigMQ_MAX_QUEUES ] = { { 0 } };
+
+/**
+ * @brief Threads blocked in mq_poll. Guarded by suspending the scheduler.
+ */
+static Link_t xPollWaiters = { 0 };
 
 /*-----------------------------------------------------------*/
 
@@ -203,7 +421,8 @@ static int prvCalculateTickTimeout( long lMessageQueueFlags,
 static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueue,
                                             const struct mq_attr * const pxAttr,
                                             const char * const pcName,
-                                            size_t xNameLength )
+                                            size_t xNameLength,
+                                            uint32_t ulNameHash )
 {
     BaseType_t xStatus = pdTRUE;
 
@@ -247,6 +466,44 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
             /* Copy queue name. Copying xNameLength+1 will cause strncpy to add
              * the null-terminator. */
             ( void ) strncpy( ( *ppxMessageQueue )->pcName, pcName, xNameLength + 1 );
+            ( *ppxMessageQueue )->ulNameHash = ulNameHash;
+        }
+    }
+
+    if( xStatus == pdTRUE )
+    {
+        /* Only MQ_ZEROCOPY queues have a buffer pool. */
+        ( *ppxMessageQueue )->pcBufferPool = NULL;
+        ( *ppxMessageQueue )->xBufferStride = 0;
+        ( *ppxMessageQueue )->xBufferCount = 0;
+        ( *ppxMessageQueue )->xFreeBuffers = NULL;
+        ( *ppxMessageQueue )->pulHeldBuffers = NULL;
+
+        if( ( ( pxAttr->mq_flags & MQ_ZEROCOPY ) != 0 ) &&
+            ( prvCreateBufferPool( *ppxMessageQueue, pxAttr ) == pdFALSE ) )
+        {
+            vPortFree( ( *ppxMessageQueue )->pcName );
+            vQueueDelete( ( *ppxMessageQueue )->xQueue );
+            vPortFree( *ppxMessageQueue );
+            xStatus = pdFALSE;
+        }
+    }
+
+    if( xStatus == pdTRUE )
+    {
+        /* Give the new queue a descriptor. */
+        if( prvAllocateDescriptor( *ppxMessageQueue ) == pdFALSE )
+        {
+            if( ( *ppxMessageQueue )->pcBufferPool != NULL )
+            {
+                vQueueDelete( ( *ppxMessageQueue )->xFreeBuffers );
+                vPortFree( ( *ppxMessageQueue )->pcBufferPool );
+            }
+
+            vPortFree( ( *ppxMessageQueue )->pcName );
+            vQueueDelete( ( *ppxMessageQueue )->xQueue );
+            vPortFree( *ppxMessageQueue );
+            xStatus = pdFALSE;
         }
     }
 
@@ -261,8 +518,9 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
         /* A newly-created queue will not be pending unlink. */
         ( *ppxMessageQueue )->xPendingUnlink = pdFALSE;
 
-        /* Add the new queue to the list. */
-        listADD( &xQueueListHead, &( *ppxMessageQueue )->xLink );
+        /* Add the new queue to its name bucket. */
+        listADD( &xQueueNameBuckets[ ulNameHash % posixconfigMQ_NAME_HASH_BUCKETS ],
+                 &( *ppxMessageQueue )->xLink );
     }
 
     return xStatus;
@@ -270,17 +528,287 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
 
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvCreateBufferPool( QueueListElement_t * const pxMessageQueue,
+                                       const struct mq_attr * const pxAttr )
+{
+    BaseType_t xStatus = pdTRUE;
+    size_t xBuffer = 0;
+    size_t xHeldWords = 0;
+    char * pcBuffer = NULL;
+
+    /* Keep every buffer aligned like a pvPortMalloc allocation. */
+    pxMessageQueue->xBufferStride = ( ( size_t ) pxAttr->mq_msgsize + portBYTE_ALIGNMENT_MASK ) &
+                                    ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+    /* Spare buffers let threads fill and drain messages while the queue is full. */
+    pxMessageQueue->xBufferCount = ( size_t ) pxAttr->mq_maxmsg + posixconfigMQ_ZEROCOPY_SPARE_BUFFERS;
+
+    /* The bit mask of held buffers follows the buffers, in the same allocation.
+     * It is aligned because the stride is. */
+    xHeldWords = ( pxMessageQueue->xBufferCount + 31 ) / 32;
+
+    pxMessageQueue->pcBufferPool = pvPortMalloc( ( pxMessageQueue->xBufferStride * pxMessageQueue->xBufferCount ) +
+                                                 ( xHeldWords * sizeof( uint32_t ) ) );
+
+    if( pxMessageQueue->pcBufferPool == NULL )
+    {
+        xStatus = pdFALSE;
+    }
+    else
+    {
+        /* No thread holds a buffer yet. */
+        pxMessageQueue->pulHeldBuffers = ( uint32_t * ) ( void * )
+                                         ( pxMessageQueue->pcBufferPool + ( pxMessageQueue->xBufferStride * pxMessageQueue->xBufferCount ) );
+        ( void ) memset( pxMessageQueue->pulHeldBuffers, 0x00, xHeldWords * sizeof( uint32_t ) );
+    }
+
+    if( xStatus == pdTRUE )
+    {
+        pxMessageQueue->xFreeBuffers = xQueueCreate( pxMessageQueue->xBufferCount, sizeof( char * ) );
+
+        if( pxMessageQueue->xFreeBuffers == NULL )
+        {
+            vPortFree( pxMessageQueue->pcBufferPool );
+            pxMessageQueue->pcBufferPool = NULL;
+            xStatus = pdFALSE;
+        }
+    }
+
+    if( xStatus == pdTRUE )
+    {
+        /* Put every buffer on the free list. This never blocks because the
+         * free list has room for all of them. */
+        for( xBuffer = 0; xBuffer < pxMessageQueue->xBufferCount; xBuffer++ )
+        {
+            pcBuffer = pxMessageQueue->pcBufferPool + ( xBuffer * pxMessageQueue->xBufferStride );
+            ( void ) xQueueSend( pxMessageQueue->xFreeBuffers, &pcBuffer, 0 );
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvIsPoolBuffer( const QueueListElement_t * const pxMessageQueue,
+                                   const char * const pcBuffer,
+                                   size_t * const pxBuffer )
+{
+    BaseType_t xStatus = pdFALSE;
+    size_t xOffset = 0;
+
+    if( ( pcBuffer != NULL ) && ( pcBuffer >= pxMessageQueue->pcBufferPool ) )
+    {
+        xOffset = ( size_t ) ( pcBuffer - pxMessageQueue->pcBufferPool );
+
+        if( ( xOffset < ( pxMessageQueue->xBufferStride * pxMessageQueue->xBufferCount ) ) &&
+            ( ( xOffset % pxMessageQueue->xBufferStride ) == 0 ) )
+        {
+            *pxBuffer = xOffset / pxMessageQueue->xBufferStride;
+            xStatus = pdTRUE;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvHoldBuffer( const QueueListElement_t * const pxMessageQueue,
+                           const char * const pcBuffer )
+{
+    size_t xBuffer = ( size_t ) ( pcBuffer - pxMessageQueue->pcBufferPool ) / pxMessageQueue->xBufferStride;
+
+    taskENTER_CRITICAL();
+    {
+        pxMessageQueue->pulHeldBuffers[ xBuffer / 32 ] |= 1UL << ( xBuffer % 32 );
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvUnholdBuffer( const QueueListElement_t * const pxMessageQueue,
+                                   const char * const pcBuffer )
+{
+    BaseType_t xStatus = pdFALSE;
+    size_t xBuffer = 0;
+    uint32_t ulBit = 0;
+
+    if( prvIsPoolBuffer( pxMessageQueue, pcBuffer, &xBuffer ) == pdTRUE )
+    {
+        ulBit = 1UL << ( xBuffer % 32 );
+
+        /* Test and clear together, so that only one of two threads giving
+         * back the same buffer succeeds. */
+        taskENTER_CRITICAL();
+        {
+            if( ( pxMessageQueue->pulHeldBuffers[ xBuffer / 32 ] & ulBit ) != 0 )
+            {
+                pxMessageQueue->pulHeldBuffers[ xBuffer / 32 ] &= ~ulBit;
+                xStatus = pdTRUE;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFreeMessageData( const QueueListElement_t * const pxMessageQueue,
+                                char * pcData )
+{
+    if( pxMessageQueue->pcBufferPool != NULL )
+    {
+        /* The free list has room for every buffer, so this never blocks. */
+        ( void ) xQueueSend( pxMessageQueue->xFreeBuffers, &pcData, 0 );
+    }
+    else
+    {
+        vPortFree( pcData );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvGetZeroCopyQueue( mqd_t xMessageQueueDescriptor,
+                                QueueListElement_t ** const ppxMessageQueue )
+{
+    int iStatus = 0;
+
+    *ppxMessageQueue = prvGetQueueFromDescriptor( xMessageQueueDescriptor );
+
+    if( *ppxMessageQueue == NULL )
+    {
+        iStatus = EBADF;
+    }
+    else if( ( *ppxMessageQueue )->pcBufferPool == NULL )
+    {
+        iStatus = ENOTSUP;
+    }
+    else
+    {
+        iStatus = 0;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvWakePollWaiters( size_t xIndex,
+                                BaseType_t xReadable,
+                                BaseType_t xWritable )
+{
+    Link_t * pxLink = NULL;
+    QueuePollWaiter_t * pxWaiter = NULL;
+    uint32_t ulBit = 1UL << ( xIndex % 32 );
+
+    /* Skip the scheduler lock when nobody polls. A waiter registers before it
+     * checks the queues, so a waiter missed here sees the queue's new state. */
+    if( listIS_EMPTY( &xPollWaiters ) == false )
+    {
+        vTaskSuspendAll();
+
+        listFOR_EACH( pxLink, &xPollWaiters )
+        {
+            pxWaiter = listCONTAINER( pxLink, QueuePollWaiter_t, xLink );
+
+            if( ( ( xReadable == pdTRUE ) && ( ( pxWaiter->pulReadMask[ xIndex / 32 ] & ulBit ) != 0 ) ) ||
+                ( ( xWritable == pdTRUE ) && ( ( pxWaiter->pulWriteMask[ xIndex / 32 ] & ulBit ) != 0 ) ) )
+            {
+                ( void ) xSemaphoreGive( pxWaiter->xWakeUp );
+            }
+        }
+
+        ( void ) xTaskResumeAll();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvPollQueues( struct mq_pollfd * const pxPollFds,
+                          size_t xPollFdCount )
+{
+    int iReady = 0;
+    size_t i = 0;
+    QueueListElement_t * pxMessageQueue = NULL;
+
+    for( i = 0; i < xPollFdCount; i++ )
+    {
+        pxPollFds[ i ].revents = 0;
+        pxMessageQueue = prvGetQueueFromDescriptor( pxPollFds[ i ].mqdes );
+
+        if( pxMessageQueue == NULL )
+        {
+            pxPollFds[ i ].revents = MQ_POLLNVAL;
+        }
+        else
+        {
+            if( ( ( pxPollFds[ i ].events & MQ_POLLIN ) != 0 ) &&
+                ( uxQueueMessagesWaiting( pxMessageQueue->xQueue ) > 0 ) )
+            {
+                pxPollFds[ i ].revents |= MQ_POLLIN;
+            }
+
+            if( ( ( pxPollFds[ i ].events & MQ_POLLOUT ) != 0 ) &&
+                ( uxQueueSpacesAvailable( pxMessageQueue->xQueue ) > 0 ) )
+            {
+                pxPollFds[ i ].revents |= MQ_POLLOUT;
+            }
+        }
+
+        if( pxPollFds[ i ].revents != 0 )
+        {
+            iReady++;
+        }
+    }
+
+    return iReady;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSetTimeoutErrno( const QueueListElement_t * const pxMessageQueue )
+{
+    if( pxMessageQueue->xAttr.mq_flags & O_NONBLOCK )
+    {
+        /* Set errno to EAGAIN for nonblocking mq. */
+        errno = EAGAIN;
+    }
+    else
+    {
+        /* Otherwise, set errno to ETIMEDOUT. */
+        errno = ETIMEDOUT;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQueue )
 {
     QueueElement_t xQueueElement = { 0 };
 
     /* Free all data in the queue. It's assumed that no more data will be added
-     * to the queue, so xQueueReceive does not block. */
+     * to the queue, so xQueueReceive does not block. Pool buffers are freed
+     * with the pool. */
     while( xQueueReceive( pxMessageQueue->xQueue,
                           ( void * ) &xQueueElement,
                           0 ) == pdTRUE )
     {
-        vPortFree( xQueueElement.pcData );
+        if( pxMessageQueue->pcBufferPool == NULL )
+        {
+            vPortFree( xQueueElement.pcData );
+        }
+    }
+
+    /* Free the buffer pool of an MQ_ZEROCOPY queue. */
+    if( pxMessageQueue->pcBufferPool != NULL )
+    {
+        vQueueDelete( pxMessageQueue->xFreeBuffers );
+        vPortFree( pxMessageQueue->pcBufferPool );
     }
 
     /* Free memory used by this message queue. */
@@ -291,34 +819,26 @@ static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQue
 
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListElement,
+static BaseType_t prvFindQueueByName( QueueListElement_t ** const ppxQueueListElement,
                                       const char * const pcName,
-                                      mqd_t xMessageQueueDescriptor )
+                                      uint32_t ulNameHash )
 {
     Link_t * pxQueueListLink = NULL;
     QueueListElement_t * pxMessageQueue = NULL;
     BaseType_t xQueueFound = pdFALSE;
 
-    /* Iterate through the list of queues. */
-    listFOR_EACH( pxQueueListLink, &xQueueListHead )
+    /* Iterate through the queues whose names fall in the same bucket. */
+    listFOR_EACH( pxQueueListLink, &xQueueNameBuckets[ ulNameHash % posixconfigMQ_NAME_HASH_BUCKETS ] )
     {
         pxMessageQueue = listCONTAINER( pxQueueListLink, QueueListElement_t, xLink );
 
-        /* Match by name first if provided. */
-        if( ( pcName != NULL ) && ( strcmp( pxMessageQueue->pcName, pcName ) == 0 ) )
+        /* Compare the full hash first to skip most strcmp calls. */
+        if( ( pxMessageQueue->ulNameHash == ulNameHash ) &&
+            ( strcmp( pxMessageQueue->pcName, pcName ) == 0 ) )
         {
             xQueueFound = pdTRUE;
             break;
         }
-        /* If name doesn't match, match by descriptor. */
-        else
-        {
-            if( ( mqd_t ) pxMessageQueue == xMessageQueueDescriptor )
-            {
-                xQueueFound = pdTRUE;
-                break;
-            }
-        }
     }
 
     /* If the queue was found, set the output parameter. */
@@ -327,7 +847,90 @@ static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListEl
         *ppxQueueListElement = pxMessageQueue;
     }
 
-    return xQueueFound;
+    return xQueueFound;
+}
+
+/*-----------------------------------------------------------*/
+
+static QueueListElement_t * prvGetQueueFromDescriptor( mqd_t xMessageQueueDescriptor )
+{
+    QueueListElement_t * pxMessageQueue = NULL;
+    size_t xIndex = mqueueDESCRIPTOR_INDEX( xMessageQueueDescriptor );
+
+    if( xIndex < ( size_t ) posixconfigMQ_MAX_QUEUES )
+    {
+        /* The critical section keeps the queue pointer and generation
+         * consistent with each other. */
+        taskENTER_CRITICAL();
+
+        /* Re-encoding the descriptor also rejects values with stray bits set. */
+        if( mqueueDESCRIPTOR( xIndex, xQueueDescriptors[ xIndex ].usGeneration ) == xMessageQueueDescriptor )
+        {
+            pxMessageQueue = xQueueDescriptors[ xIndex ].pxMessageQueue;
+        }
+
+        taskEXIT_CRITICAL();
+    }
+
+    return pxMessageQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHashQueueName( const char * const pcName )
+{
+    uint32_t ulHash = 2166136261UL;
+    size_t i = 0;
+
+    for( i = 0; pcName[ i ] != '\0'; i++ )
+    {
+        ulHash ^= ( uint32_t ) ( uint8_t ) pcName[ i ];
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAllocateDescriptor( QueueListElement_t * const pxMessageQueue )
+{
+    BaseType_t xStatus = pdFALSE;
+    size_t xIndex = 0;
+
+    /* Only xQueueListMutex holders claim slots, so the search itself does
+     * not need a critical section. */
+    for( xIndex = 0; xIndex < ( size_t ) posixconfigMQ_MAX_QUEUES; xIndex++ )
+    {
+        if( xQueueDescriptors[ xIndex ].pxMessageQueue == NULL )
+        {
+            taskENTER_CRITICAL();
+            xQueueDescriptors[ xIndex ].pxMessageQueue = pxMessageQueue;
+            taskEXIT_CRITICAL();
+
+            pxMessageQueue->xDescriptor = mqueueDESCRIPTOR( xIndex, xQueueDescriptors[ xIndex ].usGeneration );
+            xStatus = pdTRUE;
+            break;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseDescriptor( const QueueListElement_t * const pxMessageQueue )
+{
+    size_t xIndex = mqueueDESCRIPTOR_INDEX( pxMessageQueue->xDescriptor );
+
+    /* Bumping the generation makes every copy of the old descriptor stale. */
+    taskENTER_CRITICAL();
+    xQueueDescriptors[ xIndex ].pxMessageQueue = NULL;
+    xQueueDescriptors[ xIndex ].usGeneration++;
+    taskEXIT_CRITICAL();
+
+    /* Let mq_poll report the descriptor as invalid. */
+    prvWakePollWaiters( xIndex, pdTRUE, pdTRUE );
 }
 
 /*-----------------------------------------------------------*/
@@ -336,6 +939,7 @@ static void prvInitializeQueueList( void )
 {
     /* Keep track of whether the queue list has been initialized. */
     static BaseType_t xQueueListInitialized = pdFALSE;
+    size_t xBucket = 0;
 
     /* Check if queue list needs to be initialized. */
     if( xQueueListInitialized == pdFALSE )
@@ -349,9 +953,16 @@ static void prvInitializeQueueList( void )
          * section. */
         if( xQueueListInitialized == pdFALSE )
         {
-            /* Initialize the queue list mutex and list head. */
+            /* Initialize the queue list mutex and name bucket heads. */
             ( void ) xSemaphoreCreateMutexStatic( &xQueueListMutex );
-            listINIT_HEAD( &xQueueListHead );
+
+            for( xBucket = 0; xBucket < ( size_t ) posixconfigMQ_NAME_HASH_BUCKETS; xBucket++ )
+            {
+                listINIT_HEAD( &xQueueNameBuckets[ xBucket ] );
+            }
+
+            listINIT_HEAD( &xPollWaiters );
+
             xQueueListInitialized = pdTRUE;
         }
 
@@ -398,7 +1009,7 @@ static BaseType_t prvValidateQueueName( const char * const pcName,
 int mq_close( mqd_t mqdes )
 {
     int iStatus = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
+    QueueListElement_t * pxMessageQueue = NULL;
     BaseType_t xQueueRemoved = pdFALSE;
 
     /* Initialize the queue list, if needed. */
@@ -408,8 +1019,11 @@ int mq_close( mqd_t mqdes )
      * never fail because it blocks forever. */
     ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
-    /* Attempt to find the message queue based on the given descriptor. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdTRUE )
+    /* Look up the message queue referenced by the given descriptor. Slots are
+     * only released with xQueueListMutex held, so the result stays valid. */
+    pxMessageQueue = prvGetQueueFromDescriptor( mqdes );
+
+    if( pxMessageQueue != NULL )
     {
         /* Decrement the number of open descriptors. */
         if( pxMessageQueue->xOpenDescriptors > 0 )
@@ -420,6 +1034,9 @@ int mq_close( mqd_t mqdes )
         /* Check if the queue has any more open descriptors. */
         if( pxMessageQueue->xOpenDescriptors == 0 )
         {
+            /* Invalidate the descriptor. */
+            prvReleaseDescriptor( pxMessageQueue );
+
             /* If no open descriptors remain and mq_unlink has already been called,
              * remove the queue. */
             if( pxMessageQueue->xPendingUnlink == pdTRUE )
@@ -462,19 +1079,17 @@ int mq_getattr( mqd_t mqdes,
                 struct mq_attr * mqstat )
 {
     int iStatus = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
-
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
+    QueueListElement_t * pxMessageQueue = NULL;
 
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdTRUE )
+    pxMessageQueue = prvGetQueueFromDescriptor( mqdes );
+
+    if( pxMessageQueue != NULL )
     {
-        /* Update the number of messages in the queue and copy the attributes
-         * into mqstat. */
-        pxMessageQueue->xAttr.mq_curmsgs = ( long ) uxQueueMessagesWaiting( pxMessageQueue->xQueue );
+        /* Copy the attributes into mqstat, then fill in the number of
+         * messages in the queue. */
         *mqstat = pxMessageQueue->xAttr;
+        mqstat->mq_curmsgs = ( long ) uxQueueMessagesWaiting( pxMessageQueue->xQueue );
     }
     else
     {
@@ -483,9 +1098,6 @@ int mq_getattr( mqd_t mqdes,
         iStatus = -1;
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
-
     return iStatus;
 }
 
@@ -497,7 +1109,9 @@ mqd_t mq_open( const char * name,
                struct mq_attr * attr )
 {
     mqd_t xMessageQueue = NULL;
+    QueueListElement_t * pxMessageQueue = NULL;
     size_t xNameLength = 0;
+    uint32_t ulNameHash = 0;
 
     /* Default mq_attr. */
     struct mq_attr xQueueCreationAttr =
@@ -539,10 +1153,10 @@ mqd_t mq_open( const char * name,
          * never fail because it blocks forever. */
         ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
-        /* Search the queue list to check if the queue exists. */
-        if( prvFindQueueInList( ( QueueListElement_t ** ) &xMessageQueue,
-                                name,
-                                ( mqd_t ) NULL ) == pdTRUE )
+        /* Search the name index to check if the queue exists. */
+        ulNameHash = prvHashQueueName( name );
+
+        if( prvFindQueueByName( &pxMessageQueue, name, ulNameHash ) == pdTRUE )
         {
             /* If the mq exists, check that this function wasn't called with
              * O_CREAT and O_EXCL. */
@@ -554,7 +1168,7 @@ mqd_t mq_open( const char * name,
             else
             {
                 /* Check if the mq has been unlinked and is pending removal. */
-                if( ( ( QueueListElement_t * ) xMessageQueue )->xPendingUnlink == pdTRUE )
+                if( pxMessageQueue->xPendingUnlink == pdTRUE )
                 {
                     /* Queue pending deletion. Don't allow it to be re-opened. */
                     errno = EINVAL;
@@ -563,7 +1177,8 @@ mqd_t mq_open( const char * name,
                 else
                 {
                     /* Increase count of open file descriptors for queue. */
-                    ( ( QueueListElement_t * ) xMessageQueue )->xOpenDescriptors++;
+                    pxMessageQueue->xOpenDescriptors++;
+                    xMessageQueue = pxMessageQueue->xDescriptor;
                 }
             }
         }
@@ -579,18 +1194,23 @@ mqd_t mq_open( const char * name,
                     xQueueCreationAttr = *attr;
                 }
 
-                /* Copy oflags. */
-                xQueueCreationAttr.mq_flags = ( long ) oflag;
+                /* Copy oflags, keeping MQ_ZEROCOPY from the attributes. */
+                xQueueCreationAttr.mq_flags = ( long ) oflag | ( xQueueCreationAttr.mq_flags & MQ_ZEROCOPY );
 
                 /* Create the new message queue. */
-                if( prvCreateNewMessageQueue( ( QueueListElement_t ** ) &xMessageQueue,
+                if( prvCreateNewMessageQueue( &pxMessageQueue,
                                               &xQueueCreationAttr,
                                               name,
-                                              xNameLength ) == pdFALSE )
+                                              xNameLength,
+                                              ulNameHash ) == pdFALSE )
                 {
                     errno = ENOSPC;
                     xMessageQueue = ( mqd_t ) -1;
                 }
+                else
+                {
+                    xMessageQueue = pxMessageQueue->xDescriptor;
+                }
             }
             else
             {
@@ -637,18 +1257,16 @@ ssize_t mq_timedreceive( mqd_t mqdes,
     ssize_t xStatus = 0;
     int iCalculateTimeoutReturn = 0;
     TickType_t xTimeoutTicks = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
+    QueueListElement_t * pxMessageQueue = NULL;
     QueueElement_t xReceiveData = { 0 };
 
     /* Silence warnings about unused parameters. */
     ( void ) msg_prio;
 
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
-
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdFALSE )
+    pxMessageQueue = prvGetQueueFromDescriptor( mqdes );
+
+    if( pxMessageQueue == NULL )
     {
         /* Queue not found; bad descriptor. */
         errno = EBADF;
@@ -680,9 +1298,6 @@ ssize_t mq_timedreceive( mqd_t mqdes,
         }
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
-
     if( xStatus == 0 )
     {
         /* Receive data from the FreeRTOS queue. */
@@ -691,17 +1306,7 @@ ssize_t mq_timedreceive( mqd_t mqdes,
                            xTimeoutTicks ) == pdFALSE )
         {
             /* If queue receive fails, set the appropriate errno. */
-            if( pxMessageQueue->xAttr.mq_flags & O_NONBLOCK )
-            {
-                /* Set errno to EAGAIN for nonblocking mq. */
-                errno = EAGAIN;
-            }
-            else
-            {
-                /* Otherwise, set errno to ETIMEDOUT. */
-                errno = ETIMEDOUT;
-            }
-
+            prvSetTimeoutErrno( pxMessageQueue );
             xStatus = -1;
         }
     }
@@ -713,7 +1318,10 @@ ssize_t mq_timedreceive( mqd_t mqdes,
 
         /* Copy received data into given buffer, then free it. */
         ( void ) memcpy( msg_ptr, xReceiveData.pcData, xReceiveData.xDataSize );
-        vPortFree( xReceiveData.pcData );
+        prvFreeMessageData( pxMessageQueue, xReceiveData.pcData );
+
+        /* The queue has room for another message. */
+        prvWakePollWaiters( mqueueDESCRIPTOR_INDEX( mqdes ), pdFALSE, pdTRUE );
     }
 
     return xStatus;
@@ -729,18 +1337,16 @@ int mq_timedsend( mqd_t mqdes,
 {
     int iStatus = 0, iCalculateTimeoutReturn = 0;
     TickType_t xTimeoutTicks = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
+    QueueListElement_t * pxMessageQueue = NULL;
     QueueElement_t xSendData = { 0 };
 
     /* Silence warnings about unused parameters. */
     ( void ) msg_prio;
 
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
-
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdFALSE )
+    pxMessageQueue = prvGetQueueFromDescriptor( mqdes );
+
+    if( pxMessageQueue == NULL )
     {
         /* Queue not found; bad descriptor. */
         errno = EBADF;
@@ -772,11 +1378,38 @@ int mq_timedsend( mqd_t mqdes,
         }
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
+    /* Take a buffer from the pool of an MQ_ZEROCOPY queue. */
+    if( ( iStatus == 0 ) && ( pxMessageQueue->pcBufferPool != NULL ) )
+    {
+        xSendData.xDataSize = msg_len;
+
+        if( xQueueReceive( pxMessageQueue->xFreeBuffers,
+                           &xSendData.pcData,
+                           xTimeoutTicks ) == pdFALSE )
+        {
+            prvSetTimeoutErrno( pxMessageQueue );
+            iStatus = -1;
+        }
+        else
+        {
+            /* Copy the data to send. */
+            ( void ) memcpy( xSendData.pcData, msg_ptr, msg_len );
 
+            /* Waiting for the buffer used up part of the timeout. */
+            iCalculateTimeoutReturn = prvCalculateTickTimeout( pxMessageQueue->xAttr.mq_flags,
+                                                               abstime,
+                                                               &xTimeoutTicks );
+
+            if( iCalculateTimeoutReturn != 0 )
+            {
+                prvFreeMessageData( pxMessageQueue, xSendData.pcData );
+                errno = iCalculateTimeoutReturn;
+                iStatus = -1;
+            }
+        }
+    }
     /* Allocate memory for the message. */
-    if( iStatus == 0 )
+    else if( iStatus == 0 )
     {
         xSendData.xDataSize = msg_len;
         xSendData.pcData = pvPortMalloc( msg_len );
@@ -803,22 +1436,18 @@ int mq_timedsend( mqd_t mqdes,
                         xTimeoutTicks ) == pdFALSE )
         {
             /* If queue send fails, set the appropriate errno. */
-            if( pxMessageQueue->xAttr.mq_flags & O_NONBLOCK )
-            {
-                /* Set errno to EAGAIN for nonblocking mq. */
-                errno = EAGAIN;
-            }
-            else
-            {
-                /* Otherwise, set errno to ETIMEDOUT. */
-                errno = ETIMEDOUT;
-            }
+            prvSetTimeoutErrno( pxMessageQueue );
 
             /* Free the allocated queue data. */
-            vPortFree( xSendData.pcData );
+            prvFreeMessageData( pxMessageQueue, xSendData.pcData );
 
             iStatus = -1;
         }
+        else
+        {
+            /* The queue has a message to receive. */
+            prvWakePollWaiters( mqueueDESCRIPTOR_INDEX( mqdes ), pdTRUE, pdFALSE );
+        }
     }
 
     return iStatus;
@@ -851,7 +1480,7 @@ int mq_unlink( const char * name )
         ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
         /* Check if the named queue exists. */
-        if( prvFindQueueInList( &pxMessageQueue, name, ( mqd_t ) NULL ) == pdTRUE )
+        if( prvFindQueueByName( &pxMessageQueue, name, prvHashQueueName( name ) ) == pdTRUE )
         {
             /* If the queue exists and there are no open descriptors to it,
              * remove it from the list. */
@@ -891,3 +1520,295 @@ int mq_unlink( const char * name )
 }
 
 /*-----------------------------------------------------------*/
+
+char * mq_buffer_get( mqd_t mqdes,
+                      const struct timespec * abstime )
+{
+    int iStatus = 0;
+    TickType_t xTimeoutTicks = 0;
+    QueueListElement_t * pxMessageQueue = NULL;
+    char * pcBuffer = NULL;
+
+    /* Find the zero-copy mq referenced by mqdes. */
+    iStatus = prvGetZeroCopyQueue( mqdes, &pxMessageQueue );
+
+    if( iStatus == 0 )
+    {
+        /* Convert abstime to a tick timeout. */
+        iStatus = prvCalculateTickTimeout( pxMessageQueue->xAttr.mq_flags,
+                                           abstime,
+                                           &xTimeoutTicks );
+    }
+
+    if( iStatus != 0 )
+    {
+        errno = iStatus;
+    }
+    else
+    {
+        /* Take a buffer off the free list. */
+        if( xQueueReceive( pxMessageQueue->xFreeBuffers,
+                           &pcBuffer,
+                           xTimeoutTicks ) == pdFALSE )
+        {
+            prvSetTimeoutErrno( pxMessageQueue );
+            pcBuffer = NULL;
+        }
+        else
+        {
+            prvHoldBuffer( pxMessageQueue, pcBuffer );
+        }
+    }
+
+    return pcBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+int mq_buffer_send( mqd_t mqdes,
+                    char * msg_buf,
+                    size_t msg_len,
+                    const struct timespec * abstime )
+{
+    int iStatus = 0;
+    TickType_t xTimeoutTicks = 0;
+    QueueListElement_t * pxMessageQueue = NULL;
+    QueueElement_t xSendData = { 0 };
+
+    /* Find the zero-copy mq referenced by mqdes. */
+    iStatus = prvGetZeroCopyQueue( mqdes, &pxMessageQueue );
+
+    /* Verify that mq_msgsize is large enough. */
+    if( ( iStatus == 0 ) && ( msg_len > ( size_t ) pxMessageQueue->xAttr.mq_msgsize ) )
+    {
+        iStatus = EMSGSIZE;
+    }
+
+    if( iStatus == 0 )
+    {
+        /* Convert abstime to a tick timeout. */
+        iStatus = prvCalculateTickTimeout( pxMessageQueue->xAttr.mq_flags,
+                                           abstime,
+                                           &xTimeoutTicks );
+    }
+
+    /* Only buffers of this queue's pool held by a thread may be sent. Take
+     * msg_buf back before queueing it, because a receiver may hold it as soon
+     * as it is queued. */
+    if( ( iStatus == 0 ) && ( prvUnholdBuffer( pxMessageQueue, msg_buf ) == pdFALSE ) )
+    {
+        iStatus = EINVAL;
+    }
+
+    if( iStatus != 0 )
+    {
+        errno = iStatus;
+        iStatus = -1;
+    }
+    else
+    {
+        /* Queue the pointer only. */
+        xSendData.pcData = msg_buf;
+        xSendData.xDataSize = msg_len;
+
+        if( xQueueSend( pxMessageQueue->xQueue,
+                        &xSendData,
+                        xTimeoutTicks ) == pdFALSE )
+        {
+            /* The caller keeps ownership of msg_buf. */
+            prvHoldBuffer( pxMessageQueue, msg_buf );
+            prvSetTimeoutErrno( pxMessageQueue );
+            iStatus = -1;
+        }
+        else
+        {
+            /* The queue has a message to receive. */
+            prvWakePollWaiters( mqueueDESCRIPTOR_INDEX( mqdes ), pdTRUE, pdFALSE );
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ssize_t mq_buffer_receive( mqd_t mqdes,
+                           char ** msg_buf,
+                           const struct timespec * abstime )
+{
+    int iStatus = 0;
+    ssize_t xStatus = 0;
+    TickType_t xTimeoutTicks = 0;
+    QueueListElement_t * pxMessageQueue = NULL;
+    QueueElement_t xReceiveData = { 0 };
+
+    /* Find the zero-copy mq referenced by mqdes. */
+    iStatus = prvGetZeroCopyQueue( mqdes, &pxMessageQueue );
+
+    if( ( iStatus == 0 ) && ( msg_buf == NULL ) )
+    {
+        iStatus = EINVAL;
+    }
+
+    if( iStatus == 0 )
+    {
+        /* Convert abstime to a tick timeout. */
+        iStatus = prvCalculateTickTimeout( pxMessageQueue->xAttr.mq_flags,
+                                           abstime,
+                                           &xTimeoutTicks );
+    }
+
+    if( iStatus != 0 )
+    {
+        errno = iStatus;
+        xStatus = -1;
+    }
+    else
+    {
+        if( xQueueReceive( pxMessageQueue->xQueue,
+                           &xReceiveData,
+                           xTimeoutTicks ) == pdFALSE )
+        {
+            prvSetTimeoutErrno( pxMessageQueue );
+            xStatus = -1;
+        }
+        else
+        {
+            /* Hand the buffer over to the caller. */
+            prvHoldBuffer( pxMessageQueue, xReceiveData.pcData );
+            *msg_buf = xReceiveData.pcData;
+            xStatus = ( ssize_t ) xReceiveData.xDataSize;
+
+            /* The queue has room for another message. */
+            prvWakePollWaiters( mqueueDESCRIPTOR_INDEX( mqdes ), pdFALSE, pdTRUE );
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int mq_buffer_release( mqd_t mqdes,
+                       char * msg_buf )
+{
+    int iStatus = 0;
+    QueueListElement_t * pxMessageQueue = NULL;
+
+    /* Find the zero-copy mq referenced by mqdes. */
+    iStatus = prvGetZeroCopyQueue( mqdes, &pxMessageQueue );
+
+    /* Only buffers of this queue's pool held by a thread may be released.
+     * This rejects a buffer released twice, or released after being sent. */
+    if( ( iStatus == 0 ) && ( prvUnholdBuffer( pxMessageQueue, msg_buf ) == pdFALSE ) )
+    {
+        iStatus = EINVAL;
+    }
+
+    /* Put the buffer back on the free list. The free list has room for every
+     * buffer, so this never blocks. */
+    if( iStatus == 0 )
+    {
+        ( void ) xQueueSend( pxMessageQueue->xFreeBuffers, &msg_buf, 0 );
+    }
+
+    if( iStatus != 0 )
+    {
+        errno = iStatus;
+        iStatus = -1;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int mq_poll( struct mq_pollfd * fds,
+             size_t nfds,
+             const struct timespec * abstime )
+{
+    int iStatus = 0;
+    int iReady = 0;
+    size_t i = 0;
+    size_t xIndex = 0;
+    TickType_t xTimeoutTicks = 0;
+    TimeOut_t xTimeOut = { 0 };
+    StaticSemaphore_t xWakeUpBuffer = { { 0 }, .u = { 0 } };
+    QueuePollWaiter_t xWaiter = { 0 };
+
+    /* Initialize the queue list, if needed. */
+    prvInitializeQueueList();
+
+    if( ( fds == NULL ) && ( nfds > 0 ) )
+    {
+        iStatus = EINVAL;
+    }
+
+    if( iStatus == 0 )
+    {
+        /* Convert abstime to a tick timeout. */
+        iStatus = prvCalculateTickTimeout( 0, abstime, &xTimeoutTicks );
+
+        /* A timeout in the past only checks the queues once. */
+        if( iStatus == ETIMEDOUT )
+        {
+            xTimeoutTicks = 0;
+            iStatus = 0;
+        }
+    }
+
+    if( iStatus == 0 )
+    {
+        /* Record which descriptor slots this thread waits on. */
+        for( i = 0; i < nfds; i++ )
+        {
+            xIndex = mqueueDESCRIPTOR_INDEX( fds[ i ].mqdes );
+
+            if( xIndex < ( size_t ) posixconfigMQ_MAX_QUEUES )
+            {
+                if( ( fds[ i ].events & MQ_POLLIN ) != 0 )
+                {
+                    xWaiter.pulReadMask[ xIndex / 32 ] |= 1UL << ( xIndex % 32 );
+                }
+
+                if( ( fds[ i ].events & MQ_POLLOUT ) != 0 )
+                {
+                    xWaiter.pulWriteMask[ xIndex / 32 ] |= 1UL << ( xIndex % 32 );
+                }
+            }
+        }
+
+        xWaiter.xWakeUp = xSemaphoreCreateBinaryStatic( &xWakeUpBuffer );
+
+        /* Register before checking the queues so that no change is missed. */
+        vTaskSuspendAll();
+        listADD( &xPollWaiters, &xWaiter.xLink );
+        ( void ) xTaskResumeAll();
+
+        vTaskSetTimeOutState( &xTimeOut );
+        iReady = prvPollQueues( fds, nfds );
+
+        while( ( iReady == 0 ) && ( xTaskCheckForTimeOut( &xTimeOut, &xTimeoutTicks ) == pdFALSE ) )
+        {
+            /* Wait for a send, receive or close on one of the queues. */
+            ( void ) xSemaphoreTake( xWaiter.xWakeUp, xTimeoutTicks );
+            iReady = prvPollQueues( fds, nfds );
+        }
+
+        vTaskSuspendAll();
+        listREMOVE( &xWaiter.xLink );
+        ( void ) xTaskResumeAll();
+
+        vSemaphoreDelete( xWaiter.xWakeUp );
+    }
+
+    if( iStatus != 0 )
+    {
+        errno = iStatus;
+        iReady = -1;
+    }
+
+    return iReady;
+}
+
+/*-----------------------------------------------------------*/
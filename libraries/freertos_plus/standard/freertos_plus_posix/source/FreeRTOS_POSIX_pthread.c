@@ -64,8 +64,49 @@ typedef struct pthread_internal
     StaticSemaphore_t xJoinBarrier;       /**< Synchronizes the two callers of pthread_join. */
     StaticSemaphore_t xJoinMutex;         /**< Ensures that only one other thread may join this thread. */
     void * xReturn;                       /**< Return value of pvStartRoutine. */
+    #if ( PTHREAD_KEYS_MAX > 0 )
+        struct pthread_internal * pxNextThread; /**< Next thread in pxThreadList. */
+    #endif
 } pthread_internal_t;
 
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    #ifndef posixconfigPTHREAD_KEY_TLS_INDEX
+        #error "PTHREAD_KEYS_MAX is set, so posixconfigPTHREAD_KEY_TLS_INDEX must be defined."
+    #endif
+
+/**
+ * @brief Thread-specific data key.
+ *
+ * The value bound to key i lives in FreeRTOS thread local storage pointer
+ * posixconfigPTHREAD_KEY_TLS_INDEX + i of each task.
+ */
+    typedef struct pthread_key_internal
+    {
+        BaseType_t xInUse;                  /**< pdTRUE between pthread_key_create and pthread_key_delete. */
+        void ( * pvDestructor )( void * ); /**< Called with a thread's non-NULL value when it exits. */
+    } pthread_key_internal_t;
+
+/**
+ * @brief Calls the destructors of the calling thread's non-NULL key values.
+ *
+ * Destructors may bind new values, so this repeats up to
+ * PTHREAD_DESTRUCTOR_ITERATIONS times while any destructor was called.
+ */
+    static void prvRunKeyDestructors( void );
+
+/**
+ * @brief All pthread keys. Written in a critical section.
+ */
+    static pthread_key_internal_t xKeys[ PTHREAD_KEYS_MAX ] = { { 0 } };
+
+/**
+ * @brief Threads that have not yet exited, so that pthread_key_delete can
+ * clear their values. Accessed with the scheduler suspended.
+ */
+    static pthread_internal_t * pxThreadList = NULL;
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
 /**
  * @brief Terminates the calling thread.
  *
@@ -97,10 +138,77 @@ static const pthread_attr_internal_t xDefaultThreadAttributes =
 
 /*-----------------------------------------------------------*/
 
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    static void prvRunKeyDestructors( void )
+    {
+        BaseType_t xIteration = 0, xDestructorCalled = pdTRUE;
+        pthread_key_t xKey = 0;
+        void * pvValue = NULL;
+        void ( * pvDestructor )( void * ) = NULL;
+
+        for( xIteration = 0;
+             ( xIteration < PTHREAD_DESTRUCTOR_ITERATIONS ) && ( xDestructorCalled == pdTRUE );
+             xIteration++ )
+        {
+            xDestructorCalled = pdFALSE;
+
+            for( xKey = 0; xKey < PTHREAD_KEYS_MAX; xKey++ )
+            {
+                /* Read the value and its destructor together, so that a
+                 * concurrent pthread_key_delete cannot pair this value with the
+                 * destructor of a new key. Clear the value before calling the
+                 * destructor, as POSIX requires. */
+                taskENTER_CRITICAL();
+                pvValue = pvTaskGetThreadLocalStoragePointer( NULL, posixconfigPTHREAD_KEY_TLS_INDEX + xKey );
+                pvDestructor = ( xKeys[ xKey ].xInUse == pdTRUE ) ? xKeys[ xKey ].pvDestructor : NULL;
+
+                if( ( pvValue != NULL ) && ( pvDestructor != NULL ) )
+                {
+                    vTaskSetThreadLocalStoragePointer( NULL, posixconfigPTHREAD_KEY_TLS_INDEX + xKey, NULL );
+                }
+
+                taskEXIT_CRITICAL();
+
+                if( ( pvValue != NULL ) && ( pvDestructor != NULL ) )
+                {
+                    pvDestructor( pvValue );
+                    xDestructorCalled = pdTRUE;
+                }
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
 static void prvExitThread( void )
 {
     pthread_internal_t * pxThread = ( pthread_internal_t * ) pthread_self();
 
+    #if ( PTHREAD_KEYS_MAX > 0 )
+        pthread_internal_t ** ppxLink = NULL;
+
+        /* Free thread-specific data while the thread can still be joined. */
+        prvRunKeyDestructors();
+
+        /* This thread no longer uses its values, so pthread_key_delete can
+         * stop clearing them. */
+        vTaskSuspendAll();
+
+        for( ppxLink = &pxThreadList; *ppxLink != NULL; ppxLink = &( *ppxLink )->pxNextThread )
+        {
+            if( *ppxLink == pxThread )
+            {
+                *ppxLink = pxThread->pxNextThread;
+                break;
+            }
+        }
+
+        ( void ) xTaskResumeAll();
+    #endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
     /* If this thread is joinable, wait for a call to pthread_join. */
     if( pthreadIS_JOINABLE( pxThread->xAttr.usSchedPriorityDetachState ) )
     {
@@ -354,6 +462,11 @@ int pthread_create( pthread_t * thread,
             /* Store the pointer to the thread object in the task tag. */
             vTaskSetApplicationTaskTag( pxThread->xTaskHandle, ( TaskHookFunction_t ) pxThread );
 
+            #if ( PTHREAD_KEYS_MAX > 0 )
+                pxThread->pxNextThread = pxThreadList;
+                pxThreadList = pxThread;
+            #endif
+
             /* Set the thread object for the user. */
             *thread = ( pthread_t ) pxThread;
         }
@@ -382,6 +495,24 @@ int pthread_getschedparam( pthread_t thread,
 
 /*-----------------------------------------------------------*/
 
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    void * pthread_getspecific( pthread_key_t key )
+    {
+        void * pvValue = NULL;
+
+        if( ( key >= 0 ) && ( key < PTHREAD_KEYS_MAX ) )
+        {
+            pvValue = pvTaskGetThreadLocalStoragePointer( NULL, posixconfigPTHREAD_KEY_TLS_INDEX + key );
+        }
+
+        return pvValue;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
 int pthread_equal( pthread_t t1,
                    pthread_t t2 )
 {
@@ -534,6 +665,91 @@ int pthread_detach( pthread_t pthread )
 
 /*-----------------------------------------------------------*/
 
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    int pthread_key_create( pthread_key_t * key,
+                            void ( * destructor )( void * ) )
+    {
+        int iStatus = EAGAIN;
+        pthread_key_t xKey = 0;
+
+        taskENTER_CRITICAL();
+
+        for( xKey = 0; xKey < PTHREAD_KEYS_MAX; xKey++ )
+        {
+            if( xKeys[ xKey ].xInUse == pdFALSE )
+            {
+                xKeys[ xKey ].xInUse = pdTRUE;
+                xKeys[ xKey ].pvDestructor = destructor;
+                iStatus = 0;
+                break;
+            }
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( iStatus == 0 )
+        {
+            *key = xKey;
+        }
+
+        return iStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    int pthread_key_delete( pthread_key_t key )
+    {
+        int iStatus = 0;
+        pthread_internal_t * pxThread = NULL;
+
+        if( ( key < 0 ) || ( key >= PTHREAD_KEYS_MAX ) )
+        {
+            iStatus = EINVAL;
+        }
+
+        if( iStatus == 0 )
+        {
+            /* Suspend all tasks so that no thread exits or binds a value while
+             * the key is cleared. */
+            vTaskSuspendAll();
+
+            taskENTER_CRITICAL();
+
+            if( xKeys[ key ].xInUse == pdFALSE )
+            {
+                iStatus = EINVAL;
+            }
+            else
+            {
+                xKeys[ key ].xInUse = pdFALSE;
+                xKeys[ key ].pvDestructor = NULL;
+            }
+
+            taskEXIT_CRITICAL();
+
+            /* A later pthread_key_create may return the same key, which must
+             * then be NULL in every thread. Values are not destroyed. */
+            if( iStatus == 0 )
+            {
+                for( pxThread = pxThreadList; pxThread != NULL; pxThread = pxThread->pxNextThread )
+                {
+                    vTaskSetThreadLocalStoragePointer( pxThread->xTaskHandle, posixconfigPTHREAD_KEY_TLS_INDEX + key, NULL );
+                }
+
+                vTaskSetThreadLocalStoragePointer( NULL, posixconfigPTHREAD_KEY_TLS_INDEX + key, NULL );
+            }
+
+            ( void ) xTaskResumeAll();
+        }
+
+        return iStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
 pthread_t pthread_self( void )
 {
     /* Return a reference to this pthread object, which is stored in the
@@ -567,3 +783,27 @@ int pthread_setschedparam( pthread_t thread,
 }
 
 /*-----------------------------------------------------------*/
+
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    int pthread_setspecific( pthread_key_t key,
+                             const void * value )
+    {
+        int iStatus = 0;
+
+        /* Only a key from pthread_key_create may be bound to a value. */
+        if( ( key < 0 ) || ( key >= PTHREAD_KEYS_MAX ) || ( xKeys[ key ].xInUse == pdFALSE ) )
+        {
+            iStatus = EINVAL;
+        }
+        else
+        {
+            vTaskSetThreadLocalStoragePointer( NULL, posixconfigPTHREAD_KEY_TLS_INDEX + key, ( void * ) value );
+        }
+
+        return iStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
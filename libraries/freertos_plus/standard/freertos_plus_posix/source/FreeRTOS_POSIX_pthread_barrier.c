@@ -36,21 +36,10 @@
 #include "FreeRTOS_POSIX/errno.h"
 #include "FreeRTOS_POSIX/pthread.h"
 
-#include "atomic.h"
-
-/*
- * @brief barrier max count
- *
- * Barriers are implemented on FreeRTOS event groups, of which 8 bits are usable
- * when configUSE_16_BIT_TICKS is 1. Otherwise, 24 bits are usable.
+/**
+ * @brief The event group bit that releases the threads of a cycle with the given sense.
  */
-/**@{ */
-#if ( configUSE_16_BIT_TICKS == 1 )
-    #define posixPTHREAD_BARRIER_MAX_COUNT    ( 8 )
-#else
-    #define posixPTHREAD_BARRIER_MAX_COUNT    ( 24 )
-#endif
-/**@} */
+#define barrierRELEASE_BIT( ulSense )    ( ( EventBits_t ) 1 << ( ulSense ) )
 
 /*-----------------------------------------------------------*/
 
@@ -60,7 +49,6 @@ int pthread_barrier_destroy( pthread_barrier_t * barrier )
 
     /* Free all resources used by the barrier. */
     ( void ) vEventGroupDelete( ( EventGroupHandle_t ) &pxBarrier->xBarrierEventGroup );
-    ( void ) vSemaphoreDelete( ( SemaphoreHandle_t ) &pxBarrier->xThreadCountSemaphore );
 
     return 0;
 }
@@ -83,33 +71,16 @@ int pthread_barrier_init( pthread_barrier_t * barrier,
         iStatus = EINVAL;
     }
 
-    /* Ensure that count will fit in a FreeRTOS event group. */
-    if( iStatus == 0 )
-    {
-        if( count > posixPTHREAD_BARRIER_MAX_COUNT )
-        {
-            /* No memory exists in the event group for more than
-             * posixPTHREAD_BARRIER_MAX_COUNT threads. */
-            iStatus = ENOMEM;
-        }
-    }
-
     if( iStatus == 0 )
     {
-        /* Set the current thread count and threshold. */
-        pxNewBarrier->uThreadCount = 0;
+        /* Set the current thread count, threshold and sense. */
+        pxNewBarrier->ulThreadCount = 0;
         pxNewBarrier->uThreshold = count;
+        pxNewBarrier->ulSense = 0;
 
         /* Create the FreeRTOS event group. This call will not fail when its
          * argument isn't NULL. */
         ( void ) xEventGroupCreateStatic( &pxNewBarrier->xBarrierEventGroup );
-
-        /* Create the semaphore that prevents more than count threads from being
-         * unblocked by a single successful pthread_barrier_wait. This semaphore
-         * counts down from count and cannot decrement below 0. */
-        ( void ) xSemaphoreCreateCountingStatic( ( UBaseType_t ) count, /* Max count. */
-                                                 ( UBaseType_t ) count, /* Initial count. */
-                                                 &pxNewBarrier->xThreadCountSemaphore );
     }
 
     return iStatus;
@@ -120,45 +91,46 @@ int pthread_barrier_init( pthread_barrier_t * barrier,
 int pthread_barrier_wait( pthread_barrier_t * barrier )
 {
     int iStatus = 0;
-    unsigned i = 0; /* Loop iterator. */
     pthread_barrier_internal_t * pxBarrier = ( pthread_barrier_internal_t * ) ( barrier );
-    unsigned uThreadNumber = 0;
-
-    /* Decrement the number of threads waiting on this barrier. This will prevent more
-     * than pxBarrier->uThreshold threads from being unblocked by a single successful
-     * pthread_barrier_wait call.
-     *
-     * This call will never fail because it blocks forever.
-     */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &pxBarrier->xThreadCountSemaphore, portMAX_DELAY );
-
-    uThreadNumber = Atomic_Increment_u32( ( uint32_t * ) &pxBarrier->uThreadCount );
-
-    /* Set the bit in the event group representing this thread, then wait for the other
-     * threads to set their bit. This call should wait forever until all threads have set
-     * their bit, so the return value is ignored. */
-    ( void ) xEventGroupSync( ( EventGroupHandle_t ) &pxBarrier->xBarrierEventGroup,
-                              1 << uThreadNumber,                 /* Which bit in the event group to set. */
-                              ( 1 << pxBarrier->uThreshold ) - 1, /* Wait for all threads to set their bits. */
-                              portMAX_DELAY );
-
-    /* The first thread to enter the barrier gets PTHREAD_BARRIER_SERIAL_THREAD as its
-     * return value and resets xThreadCountSemaphore. */
-
-    if( uThreadNumber == 0 )
+    uint32_t ulSense = 0;
+
+    /* Suspend all tasks so that reading the sense, entering the cycle and
+     * starting the next cycle happen together. Otherwise a thread of the next
+     * cycle could read the sense of this one and pass straight through it. */
+    vTaskSuspendAll();
+
+    ulSense = pxBarrier->ulSense;
+    pxBarrier->ulThreadCount++;
+
+    if( pxBarrier->ulThreadCount == ( uint32_t ) pxBarrier->uThreshold )
     {
+        /* The last thread to enter gets PTHREAD_BARRIER_SERIAL_THREAD as its
+         * return value, and completes the cycle. */
         iStatus = PTHREAD_BARRIER_SERIAL_THREAD;
 
-        /* uThreadCount can be safely changed without locking xThreadCountMutex
-         * because xThreadCountSemaphore is currently 0. */
-        pxBarrier->uThreadCount = 0;
+        /* Block the threads of the next cycle before any of them can enter. */
+        ( void ) xEventGroupClearBits( ( EventGroupHandle_t ) &pxBarrier->xBarrierEventGroup,
+                                       barrierRELEASE_BIT( ulSense ^ 1U ) );
+        pxBarrier->ulThreadCount = 0;
+        pxBarrier->ulSense = ulSense ^ 1U;
 
-        /* Reset xThreadCountSemaphore. This allows more threads to enter the
-         * barrier, starting a new cycle. */
-        for( i = 0; i < pxBarrier->uThreshold; i++ )
-        {
-            xSemaphoreGive( ( SemaphoreHandle_t ) &pxBarrier->xThreadCountSemaphore );
-        }
+        /* Release all threads of this cycle at once. The bit stays set, so
+         * threads that have not started waiting yet do not block. */
+        ( void ) xEventGroupSetBits( ( EventGroupHandle_t ) &pxBarrier->xBarrierEventGroup,
+                                     barrierRELEASE_BIT( ulSense ) );
+    }
+
+    ( void ) xTaskResumeAll();
+
+    if( iStatus != PTHREAD_BARRIER_SERIAL_THREAD )
+    {
+        /* Wait for the last thread of this cycle. This call should wait forever,
+         * so the return value is ignored. */
+        ( void ) xEventGroupWaitBits( ( EventGroupHandle_t ) &pxBarrier->xBarrierEventGroup,
+                                      barrierRELEASE_BIT( ulSense ), /* Bit of this cycle. */
+                                      pdFALSE,                       /* Leave it set for the other threads. */
+                                      pdTRUE,
+                                      portMAX_DELAY );
     }
 
     return iStatus;
@@ -28,16 +28,25 @@
  * @brief Implementation of condition variable functions in pthread.h
  */
 
-/* C standard library includes. */
-#include <limits.h>
-
 /* FreeRTOS+POSIX includes. */
 #include "FreeRTOS_POSIX.h"
 #include "FreeRTOS_POSIX/errno.h"
 #include "FreeRTOS_POSIX/pthread.h"
 #include "FreeRTOS_POSIX/utils.h"
 
-#include "atomic.h"
+/**
+ * @brief A thread blocked in pthread_cond_wait.
+ *
+ * Lives on the stack of the waiting thread. Waiters are woken with a direct
+ * to task notification on index posixconfigTASK_NOTIFY_INDEX.
+ */
+typedef struct PthreadCondWaiter
+{
+    Link_t xLink;                  /**< Pointer to the next waiter of the condition variable. */
+    TaskHandle_t xTask;            /**< The waiting task. */
+    UBaseType_t uxPriority;        /**< Priority of xTask when it started waiting. */
+    volatile BaseType_t xSignaled; /**< Set to pdTRUE when the waiter is removed from the list by a signal. */
+} PthreadCondWaiter_t;
 
 /**
  * @brief Initialize a PTHREAD_COND_INITIALIZER cond.
@@ -50,6 +59,28 @@
  */
 static void prvInitializeStaticCond( pthread_cond_internal_t * pxCond );
 
+/**
+ * @brief Add a waiter to a cond, behind all waiters of the same or higher priority.
+ *
+ * Must be called with the scheduler suspended.
+ * @param[in] pxCond The cond to wait on.
+ * @param[in] pxWaiter The waiter to add.
+ *
+ * @return nothing
+ */
+static void prvInsertWaiter( pthread_cond_internal_t * pxCond,
+                             PthreadCondWaiter_t * pxWaiter );
+
+/**
+ * @brief Remove the first waiter of a cond and wake it.
+ *
+ * Must be called with the scheduler suspended.
+ * @param[in] pxCond The cond to signal.
+ *
+ * @return pdTRUE if a waiter was woken; pdFALSE if no thread was waiting.
+ */
+static BaseType_t prvWakeFirstWaiter( pthread_cond_internal_t * pxCond );
+
 /*-----------------------------------------------------------*/
 
 static void prvInitializeStaticCond( pthread_cond_internal_t * pxCond )
@@ -66,11 +97,9 @@ static void prvInitializeStaticCond( pthread_cond_internal_t * pxCond )
          * section. */
         if( pxCond->xIsInitialized == pdFALSE )
         {
-            /* Set the members of the cond. The semaphore create calls will never fail
-             * when their arguments aren't NULL. */
+            /* Set the members of the cond. */
+            listINIT_HEAD( &pxCond->xWaiterList );
             pxCond->xIsInitialized = pdTRUE;
-            ( void ) xSemaphoreCreateCountingStatic( INT_MAX, 0U, &pxCond->xCondWaitSemaphore );
-            pxCond->iWaitingThreads = 0;
         }
 
         /* Exit the critical section. */
@@ -78,61 +107,79 @@ static void prvInitializeStaticCond( pthread_cond_internal_t * pxCond )
     }
 }
 
-/**
- * @brief Check "atomically" if iLocalWaitingThreads == pxCond->iWaitingThreads and decrement.
- */
-static void prvTestAndDecrement( pthread_cond_t * pxCond,
-                                 unsigned iLocalWaitingThreads )
+/*-----------------------------------------------------------*/
+
+static void prvInsertWaiter( pthread_cond_internal_t * pxCond,
+                             PthreadCondWaiter_t * pxWaiter )
 {
-    /* Test local copy of threads waiting is larger than zero. */
-    while( iLocalWaitingThreads > 0 )
-    {
-        /* Test-and-set. Atomically check whether the copy in memory has changed.
-         * And, if not decrease the copy of threads waiting in memory. */
-        if( ATOMIC_COMPARE_AND_SWAP_SUCCESS == Atomic_CompareAndSwap_u32( ( uint32_t * ) &pxCond->iWaitingThreads, ( uint32_t ) iLocalWaitingThreads - 1, ( uint32_t ) iLocalWaitingThreads ) )
+    Link_t * pxLink = NULL;
+
+    #if ( INCLUDE_uxTaskPriorityGet == 1 )
+        PthreadCondWaiter_t * pxOtherWaiter = NULL;
+
+        /* Find the first waiter of lower priority. Equal priorities stay FIFO. */
+        listFOR_EACH( pxLink, &pxCond->xWaiterList )
         {
-            /* Signal one succeeded. Break. */
-            break;
+            pxOtherWaiter = listCONTAINER( pxLink, PthreadCondWaiter_t, xLink );
+
+            if( pxOtherWaiter->uxPriority < pxWaiter->uxPriority )
+            {
+                break;
+            }
         }
+    #else
+        /* Without task priorities, waiters are woken in FIFO order. */
+        pxLink = &pxCond->xWaiterList;
+    #endif /* if ( INCLUDE_uxTaskPriorityGet == 1 ) */
+
+    /* Insert in front of pxLink. When the loop above found no waiter of lower
+     * priority, pxLink is the list head, i.e. this adds at the tail. */
+    listADD( pxLink->pxPrev, &pxWaiter->xLink );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWakeFirstWaiter( pthread_cond_internal_t * pxCond )
+{
+    Link_t * pxLink = NULL;
+    PthreadCondWaiter_t * pxWaiter = NULL;
+    BaseType_t xWoken = pdFALSE;
+
+    listPOP( &pxCond->xWaiterList, pxLink );
 
-        /* Local copy may be out dated. Reload, and retry. */
-        iLocalWaitingThreads = pxCond->iWaitingThreads;
+    if( pxLink != NULL )
+    {
+        pxWaiter = listCONTAINER( pxLink, PthreadCondWaiter_t, xLink );
+
+        /* Mark the waiter before notifying it; once it has been removed from
+         * the list, it relies on this flag to tell a signal from a timeout. */
+        pxWaiter->xSignaled = pdTRUE;
+        ( void ) xTaskNotifyGiveIndexed( pxWaiter->xTask, posixconfigTASK_NOTIFY_INDEX );
+        xWoken = pdTRUE;
     }
+
+    return xWoken;
 }
 
 /*-----------------------------------------------------------*/
 
 int pthread_cond_broadcast( pthread_cond_t * cond )
 {
-    unsigned i = 0;
     pthread_cond_internal_t * pxCond = ( pthread_cond_internal_t * ) ( cond );
 
     /* If the cond is uninitialized, perform initialization. */
     prvInitializeStaticCond( pxCond );
 
-    /* Local copy of number of threads waiting. */
-    unsigned iLocalWaitingThreads = pxCond->iWaitingThreads;
+    /* Wake all waiters in one pass. Woken tasks only run once the scheduler
+     * is resumed. */
+    vTaskSuspendAll();
 
-    /* Test local copy of threads waiting is larger than zero. */
-    while( iLocalWaitingThreads > 0 )
+    while( prvWakeFirstWaiter( pxCond ) == pdTRUE )
     {
-        /* Test-and-set. Atomically check whether the copy in memory has changed.
-         * And, if not set the copy of threads waiting in memory to zero. */
-        if( ATOMIC_COMPARE_AND_SWAP_SUCCESS == Atomic_CompareAndSwap_u32( ( uint32_t * ) &pxCond->iWaitingThreads, 0, ( uint32_t ) iLocalWaitingThreads ) )
-        {
-            /* Unblock all. */
-            for( i = 0; i < iLocalWaitingThreads; i++ )
-            {
-                ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxCond->xCondWaitSemaphore );
-            }
-
-            break;
-        }
-
-        /* Local copy is out dated. Reload, and retry. */
-        iLocalWaitingThreads = pxCond->iWaitingThreads;
     }
 
+    ( void ) xTaskResumeAll();
+
     return 0;
 }
 
@@ -140,10 +187,8 @@ int pthread_cond_broadcast( pthread_cond_t * cond )
 
 int pthread_cond_destroy( pthread_cond_t * cond )
 {
-    pthread_cond_internal_t * pxCond = ( pthread_cond_internal_t * ) ( cond );
-
-    /* Free all resources in use by the cond. */
-    vSemaphoreDelete( ( SemaphoreHandle_t ) &pxCond->xCondWaitSemaphore );
+    /* A cond does not own any FreeRTOS objects. */
+    ( void ) cond;
 
     return 0;
 }
@@ -166,12 +211,9 @@ int pthread_cond_init( pthread_cond_t * cond,
 
     if( iStatus == 0 )
     {
-        /* Set the members of the cond. The semaphore create calls will never fail
-         * when their arguments aren't NULL. */
+        /* Set the members of the cond. */
+        listINIT_HEAD( &pxCond->xWaiterList );
         pxCond->xIsInitialized = pdTRUE;
-
-        ( void ) xSemaphoreCreateCountingStatic( INT_MAX, 0U, &pxCond->xCondWaitSemaphore );
-        pxCond->iWaitingThreads = 0;
     }
 
     return iStatus;
@@ -186,26 +228,10 @@ int pthread_cond_signal( pthread_cond_t * cond )
     /* If the cond is uninitialized, perform initialization. */
     prvInitializeStaticCond( pxCond );
 
-    /* Local copy of number of threads waiting. */
-    unsigned iLocalWaitingThreads = pxCond->iWaitingThreads;
-
-    /* Test local copy of threads waiting is larger than zero. */
-    while( iLocalWaitingThreads > 0 )
-    {
-        /* Test-and-set. Atomically check whether the copy in memory has changed.
-         * And, if not decrease the copy of threads waiting in memory. */
-        if( ATOMIC_COMPARE_AND_SWAP_SUCCESS == Atomic_CompareAndSwap_u32( ( uint32_t * ) &pxCond->iWaitingThreads, ( uint32_t ) iLocalWaitingThreads - 1, ( uint32_t ) iLocalWaitingThreads ) )
-        {
-            /* Unblock one. */
-            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxCond->xCondWaitSemaphore );
-
-            /* Signal one succeeded. Break. */
-            break;
-        }
-
-        /* Local copy may be out dated. Reload, and retry. */
-        iLocalWaitingThreads = pxCond->iWaitingThreads;
-    }
+    /* Wake the waiter at the head of the list. */
+    vTaskSuspendAll();
+    ( void ) prvWakeFirstWaiter( pxCond );
+    ( void ) xTaskResumeAll();
 
     return 0;
 }
@@ -216,10 +242,13 @@ int pthread_cond_timedwait( pthread_cond_t * cond,
                             pthread_mutex_t * mutex,
                             const struct timespec * abstime )
 {
-    unsigned iLocalWaitingThreads = 0;
     int iStatus = 0;
+    int iLockStatus = 0;
+    BaseType_t xMutexUnlocked = pdFALSE;
     pthread_cond_internal_t * pxCond = ( pthread_cond_internal_t * ) ( cond );
     TickType_t xDelay = portMAX_DELAY;
+    TimeOut_t xTimeOut = { 0 };
+    PthreadCondWaiter_t xWaiter = { 0 };
 
     /* If the cond is uninitialized, perform initialization. */
     prvInitializeStaticCond( pxCond );
@@ -240,46 +269,83 @@ int pthread_cond_timedwait( pthread_cond_t * cond,
         }
     }
 
-    /* Increase the counter of threads blocking on condition variable, then
-     * unlock mutex. */
+    /* Join the waiter list, then unlock mutex. Joining first ensures that a
+     * signal sent right after the unlock is not lost. */
     if( iStatus == 0 )
     {
-        /* Atomically increments thread waiting by 1, and
-         * stores number of threads waiting before increment. */
-        iLocalWaitingThreads = Atomic_Increment_u32( ( uint32_t * ) &pxCond->iWaitingThreads );
+        xWaiter.xTask = xTaskGetCurrentTaskHandle();
+        xWaiter.xSignaled = pdFALSE;
+
+        #if ( INCLUDE_uxTaskPriorityGet == 1 )
+            xWaiter.uxPriority = uxTaskPriorityGet( NULL );
+        #endif
+
+        vTaskSuspendAll();
+        prvInsertWaiter( pxCond, &xWaiter );
+        ( void ) xTaskResumeAll();
 
         iStatus = pthread_mutex_unlock( mutex );
-    }
 
-    /* Wait on the condition variable. */
-    if( iStatus == 0 )
-    {
-        if( xSemaphoreTake( ( SemaphoreHandle_t ) &pxCond->xCondWaitSemaphore,
-                            xDelay ) == pdPASS )
+        if( iStatus == 0 )
         {
-            /* When successful, relock mutex. */
-            iStatus = pthread_mutex_lock( mutex );
+            xMutexUnlocked = pdTRUE;
         }
         else
         {
-            /* Timeout. Relock mutex and decrement number of waiting threads. */
-            iStatus = ETIMEDOUT;
-            ( void ) pthread_mutex_lock( mutex );
-
-            /* Atomically decrements thread waiting by 1.
-             * If iLocalWaitingThreads is updated by other thread(s) in between,
-             * this implementation guarantees to decrement by 1 based on the
-             * value currently in pxCond->iWaitingThreads. */
-            prvTestAndDecrement( pxCond, iLocalWaitingThreads + 1 );
+            /* Leave the waiter list if no signal did so already. */
+            vTaskSuspendAll();
+
+            if( xWaiter.xSignaled == pdFALSE )
+            {
+                listREMOVE( &xWaiter.xLink );
+            }
+
+            ( void ) xTaskResumeAll();
         }
     }
-    else
+
+    /* Wait on the condition variable. */
+    if( xMutexUnlocked == pdTRUE )
     {
-        /* Atomically decrements thread waiting by 1.
-         * If iLocalWaitingThreads is updated by other thread(s) in between,
-         * this implementation guarantees to decrement by 1 based on the
-         * value currently in pxCond->iWaitingThreads. */
-        prvTestAndDecrement( pxCond, iLocalWaitingThreads + 1 );
+        vTaskSetTimeOutState( &xTimeOut );
+
+        /* Notifications not sent by a signal are ignored. */
+        while( xWaiter.xSignaled == pdFALSE )
+        {
+            ( void ) ulTaskNotifyTakeIndexed( posixconfigTASK_NOTIFY_INDEX, pdTRUE, xDelay );
+
+            if( ( xWaiter.xSignaled == pdFALSE ) &&
+                ( xTaskCheckForTimeOut( &xTimeOut, &xDelay ) == pdTRUE ) )
+            {
+                /* Timeout. Leave the waiter list if no signal did so already. */
+                vTaskSuspendAll();
+
+                if( xWaiter.xSignaled == pdFALSE )
+                {
+                    listREMOVE( &xWaiter.xLink );
+                    iStatus = ETIMEDOUT;
+                }
+
+                ( void ) xTaskResumeAll();
+
+                break;
+            }
+        }
+
+        /* A signal that arrived after the last ulTaskNotifyTakeIndexed left its
+         * notification pending; clear it. */
+        if( xWaiter.xSignaled == pdTRUE )
+        {
+            ( void ) ulTaskNotifyTakeIndexed( posixconfigTASK_NOTIFY_INDEX, pdTRUE, 0 );
+        }
+
+        /* Relock mutex. A timeout is reported even if relocking succeeds. */
+        iLockStatus = pthread_mutex_lock( mutex );
+
+        if( iStatus == 0 )
+        {
+            iStatus = iLockStatus;
+        }
     }
 
     return iStatus;
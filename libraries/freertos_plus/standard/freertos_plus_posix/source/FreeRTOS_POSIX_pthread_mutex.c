@@ -38,6 +38,18 @@
 #include "FreeRTOS_POSIX/pthread.h"
 #include "FreeRTOS_POSIX/utils.h"
 
+/* FreeRTOS includes. */
+#include "atomic.h"
+
+/**
+ * @defgroup Values of the lock word of a PTHREAD_MUTEX_ADAPTIVE_NP mutex.
+ */
+/**@{ */
+#define mutexADAPTIVE_UNLOCKED     ( 0U ) /**< Not held. */
+#define mutexADAPTIVE_LOCKED       ( 1U ) /**< Held; no thread is blocked on the semaphore. */
+#define mutexADAPTIVE_CONTENDED    ( 2U ) /**< Held; threads may be blocked on the semaphore. */
+/**@} */
+
 /**
  * @brief Initialize a PTHREAD_MUTEX_INITIALIZER mutex.
  *
@@ -49,6 +61,29 @@
  */
 static void prvInitializeStaticMutex( pthread_mutex_internal_t * pxMutex );
 
+/**
+ * @brief Atomically replace the lock word of an adaptive mutex.
+ *
+ * @param[in] pxMutex The mutex.
+ * @param[in] ulNewState The new value of the lock word.
+ *
+ * @return The previous value of the lock word.
+ */
+static uint32_t prvAdaptiveExchange( pthread_mutex_internal_t * pxMutex,
+                                     uint32_t ulNewState );
+
+/**
+ * @brief Lock an adaptive mutex.
+ *
+ * Spins on the lock word, then blocks on the mutex's binary semaphore.
+ * @param[in] pxMutex The mutex to lock.
+ * @param[in] xDelay How long to block.
+ *
+ * @return pdPASS if the mutex was locked; pdFAIL on timeout.
+ */
+static BaseType_t prvAdaptiveTake( pthread_mutex_internal_t * pxMutex,
+                                   TickType_t xDelay );
+
 /**
  * @brief Default pthread_mutexattr_t.
  */
@@ -94,6 +129,73 @@ static void prvInitializeStaticMutex( pthread_mutex_internal_t * pxMutex )
 
 /*-----------------------------------------------------------*/
 
+static uint32_t prvAdaptiveExchange( pthread_mutex_internal_t * pxMutex,
+                                     uint32_t ulNewState )
+{
+    uint32_t ulOldState = 0U;
+
+    do
+    {
+        ulOldState = pxMutex->ulAdaptiveState;
+    } while( Atomic_CompareAndSwap_u32( &pxMutex->ulAdaptiveState,
+                                        ulNewState,
+                                        ulOldState ) != ATOMIC_COMPARE_AND_SWAP_SUCCESS );
+
+    return ulOldState;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAdaptiveTake( pthread_mutex_internal_t * pxMutex,
+                                   TickType_t xDelay )
+{
+    BaseType_t xTaken = pdFAIL;
+    UBaseType_t uxSpins = 0U;
+    TimeOut_t xTimeOut = { 0 };
+
+    /* The owner may release the mutex within a few instructions; on SMP ports
+     * it may be running on another core. Retry before going to the kernel. */
+    for( uxSpins = 0U; ( uxSpins < posixconfigSPIN_COUNT ) && ( xTaken == pdFAIL ); uxSpins++ )
+    {
+        if( Atomic_CompareAndSwap_u32( &pxMutex->ulAdaptiveState,
+                                       mutexADAPTIVE_LOCKED,
+                                       mutexADAPTIVE_UNLOCKED ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+        {
+            xTaken = pdPASS;
+        }
+    }
+
+    if( xTaken == pdFAIL )
+    {
+        vTaskSetTimeOutState( &xTimeOut );
+
+        while( xTaken == pdFAIL )
+        {
+            /* Mark the mutex contended so that its owner wakes a blocked thread
+             * on unlock. If the mutex was released meanwhile, this locks it; it
+             * stays marked contended since other threads may still be blocked. */
+            if( prvAdaptiveExchange( pxMutex, mutexADAPTIVE_CONTENDED ) == mutexADAPTIVE_UNLOCKED )
+            {
+                xTaken = pdPASS;
+            }
+            else if( xSemaphoreTake( ( SemaphoreHandle_t ) &pxMutex->xMutex, xDelay ) == pdPASS )
+            {
+                /* Woken by an unlock, but another thread may lock the mutex
+                 * first. Retry with the remaining time. */
+                ( void ) xTaskCheckForTimeOut( &xTimeOut, &xDelay );
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    return xTaken;
+}
+
+/*-----------------------------------------------------------*/
+
 int pthread_mutex_destroy( pthread_mutex_t * mutex )
 {
     pthread_mutex_internal_t * pxMutex = ( pthread_mutex_internal_t * ) ( mutex );
@@ -142,6 +244,12 @@ int pthread_mutex_init( pthread_mutex_t * mutex,
             /* Recursive mutex. */
             ( void ) xSemaphoreCreateRecursiveMutexStatic( &pxMutex->xMutex );
         }
+        else if( pxMutex->xAttr.iType == PTHREAD_MUTEX_ADAPTIVE_NP )
+        {
+            /* Adaptive mutex. The semaphore only blocks threads that found
+             * the lock word held. */
+            ( void ) xSemaphoreCreateBinaryStatic( &pxMutex->xMutex );
+        }
         else
         {
             /* All other mutex types. */
@@ -227,6 +335,20 @@ int pthread_mutex_timedlock( pthread_mutex_t * mutex,
         {
             xFreeRTOSMutexTakeStatus = xSemaphoreTakeRecursive( ( SemaphoreHandle_t ) &pxMutex->xMutex, xDelay );
         }
+        else if( pxMutex->xAttr.iType == PTHREAD_MUTEX_ADAPTIVE_NP )
+        {
+            /* Uncontended locks do not call into the kernel. */
+            if( Atomic_CompareAndSwap_u32( &pxMutex->ulAdaptiveState,
+                                           mutexADAPTIVE_LOCKED,
+                                           mutexADAPTIVE_UNLOCKED ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+            {
+                xFreeRTOSMutexTakeStatus = pdPASS;
+            }
+            else
+            {
+                xFreeRTOSMutexTakeStatus = prvAdaptiveTake( pxMutex, xDelay );
+            }
+        }
         else
         {
             xFreeRTOSMutexTakeStatus = xSemaphoreTake( ( SemaphoreHandle_t ) &pxMutex->xMutex, xDelay );
@@ -289,7 +411,18 @@ int pthread_mutex_unlock( pthread_mutex_t * mutex )
         iStatus = EPERM;
     }
 
-    if( iStatus == 0 )
+    if( ( iStatus == 0 ) && ( pxMutex->xAttr.iType == PTHREAD_MUTEX_ADAPTIVE_NP ) )
+    {
+        /* Clear the owner first; the next owner sets it once it has the lock.
+         * Only wake a blocked thread, through the kernel, if there may be one. */
+        pxMutex->xTaskOwner = NULL;
+
+        if( prvAdaptiveExchange( pxMutex, mutexADAPTIVE_UNLOCKED ) == mutexADAPTIVE_CONTENDED )
+        {
+            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxMutex->xMutex );
+        }
+    }
+    else if( iStatus == 0 )
     {
         /* Suspend the scheduler so that
          * mutex is unlocked AND owner is updated atomically */
@@ -359,6 +492,7 @@ int pthread_mutexattr_settype( pthread_mutexattr_t * attr,
         case PTHREAD_MUTEX_NORMAL:
         case PTHREAD_MUTEX_RECURSIVE:
         case PTHREAD_MUTEX_ERRORCHECK:
+        case PTHREAD_MUTEX_ADAPTIVE_NP:
             pxAttr->iType = type;
             break;
 
@@ -0,0 +1,565 @@
+/*
+ * FreeRTOS POSIX V1.2.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file FreeRTOS_POSIX_pthread_rwlock.c
+ * @brief Implementation of read-write lock functions in pthread.h
+ */
+
+/* C standard library includes. */
+#include <stddef.h>
+
+/* FreeRTOS+POSIX includes. */
+#include "FreeRTOS_POSIX.h"
+#include "FreeRTOS_POSIX/errno.h"
+#include "FreeRTOS_POSIX/pthread.h"
+#include "FreeRTOS_POSIX/utils.h"
+
+/**
+ * @brief Initialize a PTHREAD_RWLOCK_INITIALIZER rwlock.
+ *
+ * PTHREAD_RWLOCK_INITIALIZER sets a flag for a rwlock to be initialized later.
+ * This function performs the initialization.
+ * @param[in] pxRwlock The rwlock to initialize.
+ *
+ * @return nothing
+ */
+static void prvInitializeStaticRwlock( pthread_rwlock_internal_t * pxRwlock );
+
+/**
+ * @brief Convert an absolute timeout to a delay in ticks.
+ *
+ * @param[in] abstime Absolute timeout, or NULL to wait forever.
+ * @param[out] pxDelay The delay. 0 if abstime has already passed.
+ *
+ * @return 0 on success; EINVAL if abstime is invalid.
+ */
+static int prvGetDelay( const struct timespec * abstime,
+                        TickType_t * pxDelay );
+
+/**
+ * @brief Take a read lock.
+ *
+ * @param[in] pxRwlock The rwlock to lock.
+ * @param[in] xDelay How long to wait for a writer to release the rwlock.
+ *
+ * @return 0 on success; EDEADLK or ETIMEDOUT otherwise.
+ */
+static int prvReadLock( pthread_rwlock_internal_t * pxRwlock,
+                        TickType_t xDelay );
+
+/**
+ * @brief Take a write lock.
+ *
+ * @param[in] pxRwlock The rwlock to lock.
+ * @param[in] xDelay How long to wait for other writers and readers to release the rwlock.
+ *
+ * @return 0 on success; EDEADLK or ETIMEDOUT otherwise.
+ */
+static int prvWriteLock( pthread_rwlock_internal_t * pxRwlock,
+                         TickType_t xDelay );
+
+/**
+ * @brief Default pthread_rwlockattr_t.
+ */
+static const pthread_rwlockattr_internal_t xDefaultRwlockAttributes =
+{
+    .iKind = PTHREAD_RWLOCK_DEFAULT_NP,
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvInitializeStaticRwlock( pthread_rwlock_internal_t * pxRwlock )
+{
+    /* Check if the rwlock needs to be initialized. */
+    if( pxRwlock->xIsInitialized == pdFALSE )
+    {
+        /* Rwlock initialization must be in a critical section to prevent two
+         * threads from initializing it at the same time. */
+        taskENTER_CRITICAL();
+
+        /* Check again that the rwlock is still uninitialized, i.e. it wasn't
+         * initialized while this function was waiting to enter the critical
+         * section. */
+        if( pxRwlock->xIsInitialized == pdFALSE )
+        {
+            pxRwlock->xAttr = xDefaultRwlockAttributes;
+            ( void ) xSemaphoreCreateMutexStatic( &pxRwlock->xWriterMutex );
+            pxRwlock->xIsInitialized = pdTRUE;
+        }
+
+        /* Exit the critical section. */
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvGetDelay( const struct timespec * abstime,
+                        TickType_t * pxDelay )
+{
+    int iStatus = 0;
+    struct timespec xCurrentTime = { 0 };
+
+    *pxDelay = portMAX_DELAY;
+
+    if( abstime != NULL )
+    {
+        /* Get current time */
+        if( clock_gettime( CLOCK_REALTIME, &xCurrentTime ) != 0 )
+        {
+            iStatus = EINVAL;
+        }
+        else
+        {
+            iStatus = UTILS_AbsoluteTimespecToDeltaTicks( abstime, &xCurrentTime, pxDelay );
+        }
+
+        /* If abstime was in the past, still attempt to lock the rwlock without
+         * blocking, per POSIX spec. */
+        if( iStatus == ETIMEDOUT )
+        {
+            *pxDelay = 0;
+            iStatus = 0;
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvReadLock( pthread_rwlock_internal_t * pxRwlock,
+                        TickType_t xDelay )
+{
+    int iStatus = 0;
+    BaseType_t xLocked = pdFALSE;
+
+    /* A writer that read locks would wait on its own writer mutex. */
+    if( pxRwlock->xWriter == xTaskGetCurrentTaskHandle() )
+    {
+        iStatus = EDEADLK;
+    }
+
+    /* Readers only count themselves in unless a writer holds the rwlock or,
+     * when writers are preferred, is waiting for it. */
+    if( iStatus == 0 )
+    {
+        vTaskSuspendAll();
+
+        if( ( pxRwlock->xWriterActive == pdFALSE ) &&
+            ( ( pxRwlock->xAttr.iKind != PTHREAD_RWLOCK_PREFER_WRITER_NP ) ||
+              ( pxRwlock->uxWritersWaiting == 0U ) ) )
+        {
+            pxRwlock->uxReaders++;
+            xLocked = pdTRUE;
+        }
+
+        ( void ) xTaskResumeAll();
+    }
+
+    /* Otherwise, queue on the writer mutex. This lends the priority of the
+     * reader to the writer holding it. */
+    if( ( iStatus == 0 ) && ( xLocked == pdFALSE ) )
+    {
+        if( xSemaphoreTake( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex, xDelay ) == pdPASS )
+        {
+            /* No writer can hold the rwlock while this thread holds the writer
+             * mutex. */
+            vTaskSuspendAll();
+            pxRwlock->uxReaders++;
+            ( void ) xTaskResumeAll();
+
+            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex );
+        }
+        else
+        {
+            iStatus = ETIMEDOUT;
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvWriteLock( pthread_rwlock_internal_t * pxRwlock,
+                         TickType_t xDelay )
+{
+    int iStatus = 0;
+    BaseType_t xLocked = pdFALSE, xReadersSeen = pdFALSE;
+    TimeOut_t xTimeOut = { 0 };
+
+    /* The writer mutex is not recursive. */
+    if( pxRwlock->xWriter == xTaskGetCurrentTaskHandle() )
+    {
+        iStatus = EDEADLK;
+    }
+
+    if( iStatus == 0 )
+    {
+        vTaskSetTimeOutState( &xTimeOut );
+
+        /* Count this writer as waiting so that, when writers are preferred,
+         * new readers queue behind it. */
+        vTaskSuspendAll();
+        pxRwlock->uxWritersWaiting++;
+        ( void ) xTaskResumeAll();
+
+        /* Writers are serialized by the writer mutex. Readers and writers
+         * blocked on it raise the priority of the writer that holds it. */
+        if( xSemaphoreTake( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex, xDelay ) == pdPASS )
+        {
+            vTaskSuspendAll();
+            pxRwlock->xWriter = xTaskGetCurrentTaskHandle();
+            ( void ) xTaskResumeAll();
+        }
+        else
+        {
+            vTaskSuspendAll();
+            pxRwlock->uxWritersWaiting--;
+            ( void ) xTaskResumeAll();
+
+            iStatus = ETIMEDOUT;
+        }
+    }
+
+    /* Wait for the readers to leave. The last one notifies xWriter on index
+     * posixconfigTASK_NOTIFY_INDEX. */
+    while( ( iStatus == 0 ) && ( xLocked == pdFALSE ) )
+    {
+        vTaskSuspendAll();
+
+        if( pxRwlock->uxReaders == 0U )
+        {
+            pxRwlock->xWriterActive = pdTRUE;
+            pxRwlock->uxWritersWaiting--;
+            xLocked = pdTRUE;
+        }
+        else if( xTaskCheckForTimeOut( &xTimeOut, &xDelay ) == pdTRUE )
+        {
+            pxRwlock->xWriter = NULL;
+            pxRwlock->uxWritersWaiting--;
+            iStatus = ETIMEDOUT;
+        }
+        else
+        {
+            xReadersSeen = pdTRUE;
+        }
+
+        ( void ) xTaskResumeAll();
+
+        if( iStatus == ETIMEDOUT )
+        {
+            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex );
+        }
+        else if( xLocked == pdFALSE )
+        {
+            ( void ) ulTaskNotifyTakeIndexed( posixconfigTASK_NOTIFY_INDEX, pdTRUE, xDelay );
+        }
+    }
+
+    /* A reader that left after the last ulTaskNotifyTakeIndexed left its
+     * notification pending; clear it. */
+    if( xReadersSeen == pdTRUE )
+    {
+        ( void ) ulTaskNotifyTakeIndexed( posixconfigTASK_NOTIFY_INDEX, pdTRUE, 0 );
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_destroy( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+
+    if( pxRwlock->xIsInitialized == pdTRUE )
+    {
+        /* Do not free the writer mutex while any thread holds or waits for it. */
+        if( ( pxRwlock->uxReaders != 0U ) ||
+            ( pxRwlock->xWriter != NULL ) ||
+            ( pxRwlock->uxWritersWaiting != 0U ) )
+        {
+            iStatus = EBUSY;
+        }
+        else
+        {
+            vSemaphoreDelete( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex );
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_init( pthread_rwlock_t * rwlock,
+                         const pthread_rwlockattr_t * attr )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) rwlock;
+
+    if( pxRwlock == NULL )
+    {
+        /* No memory. */
+        iStatus = ENOMEM;
+    }
+
+    if( iStatus == 0 )
+    {
+        *pxRwlock = FREERTOS_POSIX_RWLOCK_INITIALIZER;
+
+        /* No attributes given, use default attributes. */
+        if( attr == NULL )
+        {
+            pxRwlock->xAttr = xDefaultRwlockAttributes;
+        }
+        /* Otherwise, use provided attributes. */
+        else
+        {
+            pxRwlock->xAttr = *( ( pthread_rwlockattr_internal_t * ) ( attr ) );
+        }
+
+        /* Writers hold a FreeRTOS mutex for priority inheritance. */
+        if( xSemaphoreCreateMutexStatic( &pxRwlock->xWriterMutex ) == NULL )
+        {
+            iStatus = EAGAIN;
+        }
+        else
+        {
+            pxRwlock->xIsInitialized = pdTRUE;
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_rdlock( pthread_rwlock_t * rwlock )
+{
+    return pthread_rwlock_timedrdlock( rwlock, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_timedrdlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+    TickType_t xDelay = portMAX_DELAY;
+
+    /* If rwlock in uninitialized, perform initialization. */
+    prvInitializeStaticRwlock( pxRwlock );
+
+    iStatus = prvGetDelay( abstime, &xDelay );
+
+    if( iStatus == 0 )
+    {
+        iStatus = prvReadLock( pxRwlock, xDelay );
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_timedwrlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+    TickType_t xDelay = portMAX_DELAY;
+
+    /* If rwlock in uninitialized, perform initialization. */
+    prvInitializeStaticRwlock( pxRwlock );
+
+    iStatus = prvGetDelay( abstime, &xDelay );
+
+    if( iStatus == 0 )
+    {
+        iStatus = prvWriteLock( pxRwlock, xDelay );
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_tryrdlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+
+    /* If rwlock in uninitialized, perform initialization. */
+    prvInitializeStaticRwlock( pxRwlock );
+
+    iStatus = prvReadLock( pxRwlock, 0 );
+
+    /* POSIX specifies that this function should return EBUSY instead of
+     * ETIMEDOUT for attempting to lock a locked rwlock. */
+    if( iStatus == ETIMEDOUT )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_trywrlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+
+    /* If rwlock in uninitialized, perform initialization. */
+    prvInitializeStaticRwlock( pxRwlock );
+
+    iStatus = prvWriteLock( pxRwlock, 0 );
+
+    /* POSIX specifies that this function should return EBUSY instead of
+     * ETIMEDOUT for attempting to lock a locked rwlock. */
+    if( iStatus == ETIMEDOUT )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_unlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    BaseType_t xWriteUnlocked = pdFALSE;
+    pthread_rwlock_internal_t * pxRwlock = ( pthread_rwlock_internal_t * ) ( rwlock );
+
+    /* If rwlock in uninitialized, perform initialization. */
+    prvInitializeStaticRwlock( pxRwlock );
+
+    vTaskSuspendAll();
+
+    if( ( pxRwlock->xWriterActive == pdTRUE ) &&
+        ( pxRwlock->xWriter == xTaskGetCurrentTaskHandle() ) )
+    {
+        /* Release a write lock. */
+        pxRwlock->xWriterActive = pdFALSE;
+        pxRwlock->xWriter = NULL;
+        xWriteUnlocked = pdTRUE;
+    }
+    else if( pxRwlock->uxReaders > 0U )
+    {
+        /* Release a read lock. The last reader lets a waiting writer in. */
+        pxRwlock->uxReaders--;
+
+        if( ( pxRwlock->uxReaders == 0U ) && ( pxRwlock->xWriter != NULL ) )
+        {
+            ( void ) xTaskNotifyGiveIndexed( pxRwlock->xWriter, posixconfigTASK_NOTIFY_INDEX );
+        }
+    }
+    else
+    {
+        iStatus = EPERM;
+    }
+
+    ( void ) xTaskResumeAll();
+
+    /* Hand the writer mutex to the highest priority thread blocked on it. This
+     * also restores the priority of this thread if it was raised. */
+    if( xWriteUnlocked == pdTRUE )
+    {
+        ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxRwlock->xWriterMutex );
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_wrlock( pthread_rwlock_t * rwlock )
+{
+    return pthread_rwlock_timedwrlock( rwlock, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlockattr_destroy( pthread_rwlockattr_t * attr )
+{
+    ( void ) attr;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlockattr_getkind_np( const pthread_rwlockattr_t * attr,
+                                   int * pref )
+{
+    pthread_rwlockattr_internal_t * pxAttr = ( pthread_rwlockattr_internal_t * ) ( attr );
+
+    *pref = pxAttr->iKind;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlockattr_init( pthread_rwlockattr_t * attr )
+{
+    *( ( pthread_rwlockattr_internal_t * ) ( attr ) ) = xDefaultRwlockAttributes;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlockattr_setkind_np( pthread_rwlockattr_t * attr,
+                                   int pref )
+{
+    int iStatus = 0;
+    pthread_rwlockattr_internal_t * pxAttr = ( pthread_rwlockattr_internal_t * ) ( attr );
+
+    switch( pref )
+    {
+        case PTHREAD_RWLOCK_PREFER_READER_NP:
+        case PTHREAD_RWLOCK_PREFER_WRITER_NP:
+            pxAttr->iKind = pref;
+            break;
+
+        default:
+            iStatus = EINVAL;
+            break;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,175 @@
+/*
+ * FreeRTOS POSIX V1.2.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file FreeRTOS_POSIX_pthread_spin.c
+ * @brief Implementation of spin lock functions in pthread.h
+ */
+
+/* C standard library includes. */
+#include <stddef.h>
+
+/* FreeRTOS+POSIX includes. */
+#include "FreeRTOS_POSIX.h"
+#include "FreeRTOS_POSIX/errno.h"
+#include "FreeRTOS_POSIX/pthread.h"
+
+/* FreeRTOS includes. */
+#include "atomic.h"
+
+/**
+ * @brief Attempt to take a spin lock once.
+ *
+ * @param[in] pxLock The spin lock.
+ *
+ * @return pdPASS if the lock was taken; pdFAIL if it is held.
+ */
+static BaseType_t prvTryLock( pthread_spinlock_internal_t * pxLock );
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTryLock( pthread_spinlock_internal_t * pxLock )
+{
+    BaseType_t xTaken = pdFAIL;
+
+    /* Read the lock word before writing it, so that threads spinning on a held
+     * lock do not keep taking it away from the other cores' caches. */
+    if( ( pxLock->ulLocked == 0U ) &&
+        ( Atomic_CompareAndSwap_u32( &pxLock->ulLocked, 1U, 0U ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS ) )
+    {
+        pxLock->xOwner = xTaskGetCurrentTaskHandle();
+        xTaken = pdPASS;
+    }
+
+    return xTaken;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_spin_destroy( pthread_spinlock_t * lock )
+{
+    int iStatus = 0;
+    pthread_spinlock_internal_t * pxLock = ( pthread_spinlock_internal_t * ) ( lock );
+
+    /* A spin lock does not own any FreeRTOS objects. */
+    if( pxLock->ulLocked != 0U )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_spin_init( pthread_spinlock_t * lock,
+                       int pshared )
+{
+    int iStatus = 0;
+    pthread_spinlock_internal_t * pxLock = ( pthread_spinlock_internal_t * ) ( lock );
+
+    if( ( pshared != PTHREAD_PROCESS_PRIVATE ) && ( pshared != PTHREAD_PROCESS_SHARED ) )
+    {
+        iStatus = EINVAL;
+    }
+
+    if( iStatus == 0 )
+    {
+        pxLock->ulLocked = 0U;
+        pxLock->xOwner = NULL;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_spin_lock( pthread_spinlock_t * lock )
+{
+    int iStatus = 0;
+    UBaseType_t uxSpins = 0U;
+    pthread_spinlock_internal_t * pxLock = ( pthread_spinlock_internal_t * ) ( lock );
+
+    /* Only the holder can have set xOwner to itself. */
+    if( ( pxLock->ulLocked != 0U ) && ( pxLock->xOwner == xTaskGetCurrentTaskHandle() ) )
+    {
+        iStatus = EDEADLK;
+    }
+
+    while( ( iStatus == 0 ) && ( prvTryLock( pxLock ) == pdFAIL ) )
+    {
+        uxSpins++;
+
+        /* The holder may be a preempted thread of lower priority, which cannot
+         * run while this thread spins. Let it run. */
+        if( uxSpins >= posixconfigSPIN_COUNT )
+        {
+            uxSpins = 0U;
+            vTaskDelay( 1 );
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_spin_trylock( pthread_spinlock_t * lock )
+{
+    int iStatus = 0;
+    pthread_spinlock_internal_t * pxLock = ( pthread_spinlock_internal_t * ) ( lock );
+
+    if( prvTryLock( pxLock ) == pdFAIL )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_spin_unlock( pthread_spinlock_t * lock )
+{
+    int iStatus = 0;
+    pthread_spinlock_internal_t * pxLock = ( pthread_spinlock_internal_t * ) ( lock );
+
+    if( ( pxLock->ulLocked == 0U ) || ( pxLock->xOwner != xTaskGetCurrentTaskHandle() ) )
+    {
+        iStatus = EPERM;
+    }
+
+    if( iStatus == 0 )
+    {
+        /* Clear the owner before releasing the lock, so that it cannot
+         * overwrite the next holder. */
+        pxLock->xOwner = NULL;
+        ( void ) Atomic_AND_u32( &pxLock->ulLocked, 0U );
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
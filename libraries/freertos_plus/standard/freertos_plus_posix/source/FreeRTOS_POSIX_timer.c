@@ -39,7 +39,8 @@
 #include "FreeRTOS_POSIX/time.h"
 #include "FreeRTOS_POSIX/utils.h"
 
-/* FreeRTOS timer include. */
+/* FreeRTOS includes. */
+#include "queue.h"
 #include "timers.h"
 
 /* Timespec zero check macros. */
@@ -54,14 +55,164 @@ typedef struct timer_internal
     StaticTimer_t xTimerBuffer;  /**< Memory that holds the FreeRTOS timer. */
     struct sigevent xTimerEvent; /**< What to do when this timer expires. */
     TickType_t xTimerPeriod;     /**< Period of this timer. */
+    int iOverrunCount;           /**< Expirations dropped because the notification queue was full, since timer_create. */
 } timer_internal_t;
 
+/**
+ * @brief A pending SIGEV_THREAD notification.
+ *
+ * Notifications are queued by value, so a timer may be deleted while its last
+ * notification is still queued.
+ */
+typedef struct TimerNotification
+{
+    void ( * pvNotifyFunction )( union sigval ); /**< Notification function. */
+    union sigval xValue;                         /**< Argument of the notification function. */
+} TimerNotification_t;
+
+/**
+ * @brief Creates the notification threads and their queue, once.
+ *
+ * @return pdTRUE if at least one notification thread exists; pdFALSE otherwise.
+ */
+static BaseType_t prvInitializeNotificationPool( void );
+
+/**
+ * @brief Checks that the notification threads can honour the thread attributes
+ * requested for a timer's notifications.
+ *
+ * @param[in] pxAttr Requested attributes; NULL for default attributes.
+ *
+ * @return pdTRUE if the notification threads have at least the requested stack
+ * size and priority; pdFALSE otherwise.
+ */
+static BaseType_t prvNotificationPoolSatisfies( const pthread_attr_t * const pxAttr );
+
+/**
+ * @brief Runs queued notification functions, forever.
+ *
+ * @param[in] pvArgs Unused.
+ *
+ * @return Never returns.
+ */
+static void * prvNotificationThread( void * pvArgs );
+
+/**
+ * @brief Queue of SIGEV_THREAD notifications shared by all timers.
+ */
+static QueueHandle_t xNotificationQueue = NULL;
+
+/**
+ * @brief Memory that holds xNotificationQueue and its items.
+ */
+static StaticQueue_t xNotificationQueueBuffer;
+static uint8_t ucNotificationQueueStorage[ posixconfigTIMER_NOTIFY_QUEUE_LENGTH * sizeof( TimerNotification_t ) ]; /**< Items of xNotificationQueue. */
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvInitializeNotificationPool( void )
+{
+    BaseType_t xThreadCount = 0;
+    pthread_t xThread;
+    pthread_attr_t xAttr;
+    struct sched_param xSchedParam = { .sched_priority = posixconfigTIMER_NOTIFY_PRIORITY };
+
+    /* Suspend all tasks so that only one caller creates the pool, as in
+     * pthread_create. */
+    vTaskSuspendAll();
+
+    if( xNotificationQueue == NULL )
+    {
+        ( void ) pthread_attr_init( &xAttr );
+        ( void ) pthread_attr_setdetachstate( &xAttr, PTHREAD_CREATE_DETACHED );
+        ( void ) pthread_attr_setstacksize( &xAttr, posixconfigTIMER_NOTIFY_STACK_SIZE );
+        ( void ) pthread_attr_setschedparam( &xAttr, &xSchedParam );
+
+        /* Create the queue first; the threads block on it immediately. */
+        xNotificationQueue = xQueueCreateStatic( posixconfigTIMER_NOTIFY_QUEUE_LENGTH,
+                                                 sizeof( TimerNotification_t ),
+                                                 ucNotificationQueueStorage,
+                                                 &xNotificationQueueBuffer );
+
+        for( xThreadCount = 0; xThreadCount < posixconfigTIMER_NOTIFY_THREADS; xThreadCount++ )
+        {
+            if( pthread_create( &xThread, &xAttr, prvNotificationThread, NULL ) != 0 )
+            {
+                break;
+            }
+        }
+
+        ( void ) pthread_attr_destroy( &xAttr );
+
+        /* Without any thread, leave the pool uninitialized for the next call
+         * to retry. */
+        if( xThreadCount == 0 )
+        {
+            vQueueDelete( xNotificationQueue );
+            xNotificationQueue = NULL;
+        }
+    }
+
+    ( void ) xTaskResumeAll();
+
+    return ( xNotificationQueue != NULL ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvNotificationPoolSatisfies( const pthread_attr_t * const pxAttr )
+{
+    BaseType_t xStatus = pdTRUE;
+    size_t xStackSize = 0;
+    struct sched_param xSchedParam = { 0 };
+
+    if( pxAttr != NULL )
+    {
+        ( void ) pthread_attr_getstacksize( pxAttr, &xStackSize );
+        ( void ) pthread_attr_getschedparam( pxAttr, &xSchedParam );
+
+        /* A notification function needing a larger stack would overflow the
+         * stack of a notification thread, and one needing a higher priority
+         * would be delayed by everything running above the pool. A lower
+         * priority is not honoured, but is not harmful either. */
+        if( ( xStackSize > ( size_t ) posixconfigTIMER_NOTIFY_STACK_SIZE ) ||
+            ( xSchedParam.sched_priority > ( int ) posixconfigTIMER_NOTIFY_PRIORITY ) )
+        {
+            xStatus = pdFALSE;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvNotificationThread( void * pvArgs )
+{
+    TimerNotification_t xNotification;
+
+    /* Silence warnings about unused parameters. */
+    ( void ) pvArgs;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( xNotificationQueue, &xNotification, portMAX_DELAY ) == pdTRUE )
+        {
+            ( *xNotification.pvNotifyFunction )( xNotification.xValue );
+        }
+    }
+
+    /* Silence compiler warnings about return values. This line will never be
+     * reached. */
+    return NULL;
+}
+
 /*-----------------------------------------------------------*/
 
 void prvTimerCallback( TimerHandle_t xOpaqueTimerHandle )
 {
     timer_internal_t * pxTimer = ( timer_internal_t * ) pvTimerGetTimerID( xOpaqueTimerHandle );
-    pthread_t xTimerNotificationThread;
+    TimerNotification_t xNotification;
 
     /* The value of the timer ID, set in timer_create, should not be NULL. */
     configASSERT( pxTimer != NULL );
@@ -77,21 +228,17 @@ void prvTimerCallback( TimerHandle_t xOpaqueTimerHandle )
         xTimerChangePeriod( xOpaqueTimerHandle, pxTimer->xTimerPeriod, 0 );
     }
 
-    /* Create the timer notification thread if requested. */
+    /* Hand the notification to the notification threads. This runs in the
+     * timer service task, so it must not block; if every notification thread
+     * is busy and the queue is full, count an overrun instead. */
     if( pxTimer->xTimerEvent.sigev_notify == SIGEV_THREAD )
     {
-        /* if the user has provided thread attributes, create a thread
-         * with the provided attributes. Otherwise dispatch callback directly */
-        if( pxTimer->xTimerEvent.sigev_notify_attributes == NULL )
-        {
-            ( *pxTimer->xTimerEvent.sigev_notify_function )( pxTimer->xTimerEvent.sigev_value );
-        }
-        else
+        xNotification.pvNotifyFunction = pxTimer->xTimerEvent.sigev_notify_function;
+        xNotification.xValue = pxTimer->xTimerEvent.sigev_value;
+
+        if( xQueueSend( xNotificationQueue, &xNotification, 0 ) != pdTRUE )
         {
-            ( void ) pthread_create( &xTimerNotificationThread,
-                                     pxTimer->xTimerEvent.sigev_notify_attributes,
-                                     ( void * ( * )( void * ) )pxTimer->xTimerEvent.sigev_notify_function,
-                                     pxTimer->xTimerEvent.sigev_value.sival_ptr );
+            pxTimer->iOverrunCount++;
         }
     }
 }
@@ -116,6 +263,26 @@ int timer_create( clockid_t clockid,
         iStatus = -1;
     }
 
+    /* Notification functions run in the shared notification threads, which
+     * are created with fixed attributes. */
+    if( ( iStatus == 0 ) &&
+        ( evp->sigev_notify == SIGEV_THREAD ) &&
+        ( prvNotificationPoolSatisfies( evp->sigev_notify_attributes ) == pdFALSE ) )
+    {
+        errno = ENOTSUP;
+        iStatus = -1;
+    }
+
+    /* Start the notification threads on first use. */
+    if( ( iStatus == 0 ) && ( evp->sigev_notify == SIGEV_THREAD ) )
+    {
+        if( prvInitializeNotificationPool() == pdFALSE )
+        {
+            errno = EAGAIN;
+            iStatus = -1;
+        }
+    }
+
     /* Allocate memory for a new timer object. */
     if( iStatus == 0 )
     {
@@ -133,6 +300,7 @@ int timer_create( clockid_t clockid,
         /* Copy the event notification structure and set the current timer period. */
         pxTimer->xTimerEvent = *evp;
         pxTimer->xTimerPeriod = 0;
+        pxTimer->iOverrunCount = 0;
 
         /* Create a new FreeRTOS timer. This call will not fail because the
          * memory for it has already been allocated, so the output parameter is
@@ -179,10 +347,13 @@ int timer_delete( timer_t timerid )
 
 int timer_getoverrun( timer_t timerid )
 {
-    /* Silence warnings about unused parameters. */
-    ( void ) timerid;
+    TimerHandle_t xOpaqueTimerHandle = ( TimerHandle_t ) timerid;
+    timer_internal_t * pxTimer = ( timer_internal_t * ) pvTimerGetTimerID( xOpaqueTimerHandle );
 
-    return 0;
+    /* The value of the timer ID, set in timer_create, should not be NULL. */
+    configASSERT( pxTimer != NULL );
+
+    return pxTimer->iOverrunCount;
 }
 
 /*-----------------------------------------------------------*/
@@ -0,0 +1,826 @@
+/*
+ * FreeRTOS POSIX V1.2.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_test_posix_benchmark.c
+ * @brief Latency benchmarks comparing FreeRTOS+POSIX with native FreeRTOS.
+ *
+ * Every benchmark runs once with the POSIX primitive and once with the native
+ * FreeRTOS primitive it is built on, for each number of contending threads in
+ * posixtestBENCHMARK_THREAD_COUNTS. The contending threads are pthreads in
+ * both runs, so the difference between the two results is the overhead of the
+ * POSIX layer. The samples are:
+ *
+ * - mutex: time to acquire a mutex that the other threads hold across a yield.
+ * - cond_signal: time from a signal to the woken thread owning the mutex.
+ * - mqueue: time from a send to the receiving thread returning.
+ * - semaphore: time from a post to the waiting thread returning.
+ * - timer: deviation of the interval between expirations of periodic timers
+ *   from their period, with one timer per thread.
+ *
+ * Each run is reported as a single line of JSON (JSON Lines) through
+ * configPRINTF, for example:
+ *
+ * {"benchmark":"FreeRTOS_POSIX","primitive":"semaphore","api":"posix",
+ *  "threads":4,"samples":1000,"latency_us":{"min":0,"p50":12,"p99":40,
+ *  "max":95,"avg":14}}
+ *
+ * Latency resolution is limited by posixtestBENCHMARK_GET_TIME_US(), which
+ * defaults to the RTOS tick. Ports with a free running high resolution
+ * counter should override it.
+ */
+
+/* C standard library includes. */
+#include <stddef.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "timers.h"
+
+/* FreeRTOS+POSIX includes. */
+#include "FreeRTOS_POSIX.h"
+#include "FreeRTOS_POSIX/errno.h"
+#include "FreeRTOS_POSIX/fcntl.h"
+#include "FreeRTOS_POSIX/mqueue.h"
+#include "FreeRTOS_POSIX/pthread.h"
+#include "FreeRTOS_POSIX/semaphore.h"
+#include "FreeRTOS_POSIX/time.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/**
+ * @defgroup Configuration constants for the benchmarks.
+ */
+/**@{ */
+#ifndef posixtestBENCHMARK_THREAD_COUNTS
+    #define posixtestBENCHMARK_THREAD_COUNTS    1, 4 /**< Comma separated list of contending thread counts to sweep. */
+#endif
+
+#ifndef posixtestBENCHMARK_MAX_THREADS
+    #define posixtestBENCHMARK_MAX_THREADS    ( 4 ) /**< Largest entry of posixtestBENCHMARK_THREAD_COUNTS. */
+#endif
+
+#ifndef posixtestBENCHMARK_SAMPLES
+    #define posixtestBENCHMARK_SAMPLES    ( 1000 ) /**< Samples taken by each run. */
+#endif
+
+#ifndef posixtestBENCHMARK_TIMER_SAMPLES
+    #define posixtestBENCHMARK_TIMER_SAMPLES    ( 200 ) /**< Samples taken by each run of the timer benchmark; no more than posixtestBENCHMARK_SAMPLES. */
+#endif
+
+#ifndef posixtestBENCHMARK_TIMER_PERIOD_MS
+    #define posixtestBENCHMARK_TIMER_PERIOD_MS    ( 10 ) /**< Period of the timers in the timer benchmark; less than 1000. */
+#endif
+
+#ifndef posixtestBENCHMARK_TIMEOUT_MS
+    #define posixtestBENCHMARK_TIMEOUT_MS    ( 1000 ) /**< How long the test runner waits for a sample beyond the expected time. */
+#endif
+
+/**
+ * @brief Current time in microseconds. Only differences between two readings
+ * are used, so the counter may wrap.
+ */
+#ifndef posixtestBENCHMARK_GET_TIME_US
+    #define posixtestBENCHMARK_GET_TIME_US()    ( ( uint32_t ) xTaskGetTickCount() * ( 1000000UL / configTICK_RATE_HZ ) )
+#endif
+/**@} */
+
+/**
+ * @brief The primitives measured by the benchmarks.
+ */
+typedef enum BenchmarkPrimitive
+{
+    benchmarkMUTEX = 0,   /**< pthread_mutex_t or a FreeRTOS mutex. */
+    benchmarkCOND_SIGNAL, /**< pthread_cond_t or a FreeRTOS semaphore and mutex. */
+    benchmarkMQUEUE,      /**< mqd_t or a FreeRTOS queue. */
+    benchmarkSEMAPHORE,   /**< sem_t or a FreeRTOS counting semaphore. */
+    benchmarkTIMER        /**< timer_t or a FreeRTOS software timer. */
+} BenchmarkPrimitive_t;
+
+/**
+ * @brief State shared by the test runner and the threads of one run.
+ */
+typedef struct BenchmarkContext
+{
+    BenchmarkPrimitive_t ePrimitive;    /**< Primitive measured by this run. */
+    BaseType_t xNative;                 /**< pdTRUE to use the native FreeRTOS primitive. */
+    uint32_t ulSamplesPerThread;        /**< Samples taken by each mutex thread or timer. */
+    pthread_mutex_t xMutex;             /**< POSIX mutex. */
+    pthread_cond_t xCond;               /**< POSIX condition variable. */
+    sem_t xSemaphore;                   /**< POSIX semaphore. */
+    mqd_t xMq;                          /**< POSIX message queue. */
+    SemaphoreHandle_t xNativeMutex;     /**< FreeRTOS mutex. */
+    SemaphoreHandle_t xNativeSemaphore; /**< FreeRTOS counting semaphore. */
+    QueueHandle_t xNativeQueue;         /**< FreeRTOS queue. */
+    SemaphoreHandle_t xDone;            /**< Given by a thread once it records a sample. */
+    volatile uint32_t ulStartUs;        /**< Time at which the test runner signalled the current round. */
+    volatile int iRound;                /**< Round number published by the test runner. */
+    volatile int iConsumed;             /**< Last round seen by a thread. */
+    volatile uint32_t ulSampleCount;    /**< Samples recorded by the threads waiting for a signal. */
+    volatile BaseType_t xStop;          /**< Set when the threads waiting for a signal should exit. */
+} BenchmarkContext_t;
+
+/**
+ * @brief The samples of one mutex thread or timer.
+ */
+typedef struct BenchmarkSlot
+{
+    BenchmarkContext_t * pxContext; /**< Context of the run. */
+    uint32_t * pulSamples;          /**< Where this thread or timer records its samples. */
+    volatile uint32_t ulCount;      /**< Samples recorded so far. */
+    uint32_t ulExpirations;         /**< Expirations seen by this timer. */
+    uint32_t ulLastUs;              /**< Time of this timer's last expiration. */
+} BenchmarkSlot_t;
+
+/**
+ * @brief Values of the "primitive" field, indexed by BenchmarkPrimitive_t.
+ */
+static const char * const pcPrimitiveNames[] =
+{
+    "mutex",
+    "cond_signal",
+    "mqueue",
+    "semaphore",
+    "timer"
+};
+
+/**
+ * @brief Contending thread counts to sweep.
+ */
+static const int iThreadCounts[] = { posixtestBENCHMARK_THREAD_COUNTS };
+
+static BenchmarkContext_t xContext;
+static BenchmarkSlot_t xSlots[ posixtestBENCHMARK_MAX_THREADS ];
+static uint32_t ulSamples[ posixtestBENCHMARK_SAMPLES ];
+
+/*-----------------------------------------------------------*/
+
+static void prvSortSamples( uint32_t ulSampleCount )
+{
+    uint32_t i = 0, j = 0, ulSample = 0;
+
+    /* Insertion sort, as FreeRTOS+POSIX does not depend on stdlib.h. */
+    for( i = 1U; i < ulSampleCount; i++ )
+    {
+        ulSample = ulSamples[ i ];
+
+        for( j = i; ( j > 0U ) && ( ulSamples[ j - 1U ] > ulSample ); j-- )
+        {
+            ulSamples[ j ] = ulSamples[ j - 1U ];
+        }
+
+        ulSamples[ j ] = ulSample;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReportSamples( const BenchmarkContext_t * pxContext,
+                              int iThreads,
+                              uint32_t ulSampleCount )
+{
+    uint32_t ulIndex = 0;
+    uint64_t ullSampleSum = 0U;
+    uint32_t ulMin = 0U, ulP50 = 0U, ulP99 = 0U, ulMax = 0U, ulAvg = 0U;
+
+    if( ulSampleCount > 0U )
+    {
+        prvSortSamples( ulSampleCount );
+
+        for( ulIndex = 0U; ulIndex < ulSampleCount; ulIndex++ )
+        {
+            ullSampleSum += ulSamples[ ulIndex ];
+        }
+
+        ulMin = ulSamples[ 0 ];
+        ulP50 = ulSamples[ ( ulSampleCount * 50U ) / 100U ];
+        ulP99 = ulSamples[ ( ( ulSampleCount * 99U ) / 100U < ulSampleCount ) ? ( ulSampleCount * 99U ) / 100U : ulSampleCount - 1U ];
+        ulMax = ulSamples[ ulSampleCount - 1U ];
+        ulAvg = ( uint32_t ) ( ullSampleSum / ulSampleCount );
+    }
+
+    configPRINTF( ( "{\"benchmark\":\"FreeRTOS_POSIX\",\"primitive\":\"%s\",\"api\":\"%s\","
+                    "\"threads\":%d,\"samples\":%u,"
+                    "\"latency_us\":{\"min\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u,\"avg\":%u}}\r\n",
+                    pcPrimitiveNames[ pxContext->ePrimitive ],
+                    ( pxContext->xNative == pdTRUE ) ? "freertos" : "posix",
+                    iThreads,
+                    ( unsigned int ) ulSampleCount,
+                    ( unsigned int ) ulMin,
+                    ( unsigned int ) ulP50,
+                    ( unsigned int ) ulP99,
+                    ( unsigned int ) ulMax,
+                    ( unsigned int ) ulAvg ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCreatePrimitives( BenchmarkContext_t * pxContext,
+                                 BenchmarkPrimitive_t ePrimitive,
+                                 BaseType_t xNative )
+{
+    struct mq_attr xQueueAttributes =
+    {
+        .mq_flags   = 0,
+        .mq_maxmsg  = posixconfigMQ_MAX_MESSAGES,
+        .mq_msgsize = sizeof( uint32_t ),
+        .mq_curmsgs = 0
+    };
+
+    ( void ) memset( pxContext, 0x00, sizeof( BenchmarkContext_t ) );
+    pxContext->ePrimitive = ePrimitive;
+    pxContext->xNative = xNative;
+
+    TEST_ASSERT_EQUAL_INT( 0, pthread_mutex_init( &pxContext->xMutex, NULL ) );
+    TEST_ASSERT_EQUAL_INT( 0, pthread_cond_init( &pxContext->xCond, NULL ) );
+    TEST_ASSERT_EQUAL_INT( 0, sem_init( &pxContext->xSemaphore, 0, 0 ) );
+
+    pxContext->xMq = mq_open( "/benchmark", O_CREAT | O_RDWR, 0600, &xQueueAttributes );
+    TEST_ASSERT_NOT_EQUAL( ( mqd_t ) -1, pxContext->xMq );
+
+    pxContext->xNativeMutex = xSemaphoreCreateMutex();
+    TEST_ASSERT_NOT_NULL( pxContext->xNativeMutex );
+    pxContext->xNativeSemaphore = xSemaphoreCreateCounting( posixtestBENCHMARK_MAX_THREADS, 0 );
+    TEST_ASSERT_NOT_NULL( pxContext->xNativeSemaphore );
+    pxContext->xNativeQueue = xQueueCreate( posixconfigMQ_MAX_MESSAGES, sizeof( uint32_t ) );
+    TEST_ASSERT_NOT_NULL( pxContext->xNativeQueue );
+    pxContext->xDone = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL( pxContext->xDone );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDestroyPrimitives( BenchmarkContext_t * pxContext )
+{
+    ( void ) pthread_mutex_destroy( &pxContext->xMutex );
+    ( void ) pthread_cond_destroy( &pxContext->xCond );
+    ( void ) sem_destroy( &pxContext->xSemaphore );
+    ( void ) mq_close( pxContext->xMq );
+    ( void ) mq_unlink( "/benchmark" );
+    vSemaphoreDelete( pxContext->xNativeMutex );
+    vSemaphoreDelete( pxContext->xNativeSemaphore );
+    vQueueDelete( pxContext->xNativeQueue );
+    vSemaphoreDelete( pxContext->xDone );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvMutexThread( void * pvArgs )
+{
+    uint32_t ulStartUs = 0;
+    BenchmarkSlot_t * pxSlot = ( BenchmarkSlot_t * ) pvArgs;
+    BenchmarkContext_t * pxContext = pxSlot->pxContext;
+
+    while( pxSlot->ulCount < pxContext->ulSamplesPerThread )
+    {
+        ulStartUs = posixtestBENCHMARK_GET_TIME_US();
+
+        if( pxContext->xNative == pdTRUE )
+        {
+            ( void ) xSemaphoreTake( pxContext->xNativeMutex, portMAX_DELAY );
+        }
+        else
+        {
+            ( void ) pthread_mutex_lock( &pxContext->xMutex );
+        }
+
+        pxSlot->pulSamples[ pxSlot->ulCount ] = posixtestBENCHMARK_GET_TIME_US() - ulStartUs;
+        pxSlot->ulCount++;
+
+        /* Hold the mutex across a yield so the other threads block on it. */
+        taskYIELD();
+
+        if( pxContext->xNative == pdTRUE )
+        {
+            ( void ) xSemaphoreGive( pxContext->xNativeMutex );
+        }
+        else
+        {
+            ( void ) pthread_mutex_unlock( &pxContext->xMutex );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWaitForSignal( BenchmarkContext_t * pxContext,
+                                    uint32_t * pulStartUs )
+{
+    switch( pxContext->ePrimitive )
+    {
+        case benchmarkCOND_SIGNAL:
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xSemaphoreTake( pxContext->xNativeSemaphore, portMAX_DELAY );
+                ( void ) xSemaphoreTake( pxContext->xNativeMutex, portMAX_DELAY );
+                *pulStartUs = pxContext->ulStartUs;
+                ( void ) xSemaphoreGive( pxContext->xNativeMutex );
+            }
+            else
+            {
+                ( void ) pthread_mutex_lock( &pxContext->xMutex );
+
+                while( ( pxContext->iRound == pxContext->iConsumed ) && ( pxContext->xStop == pdFALSE ) )
+                {
+                    ( void ) pthread_cond_wait( &pxContext->xCond, &pxContext->xMutex );
+                }
+
+                pxContext->iConsumed = pxContext->iRound;
+                *pulStartUs = pxContext->ulStartUs;
+                ( void ) pthread_mutex_unlock( &pxContext->xMutex );
+            }
+
+            break;
+
+        case benchmarkMQUEUE:
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xQueueReceive( pxContext->xNativeQueue, pulStartUs, portMAX_DELAY );
+            }
+            else
+            {
+                ( void ) mq_receive( pxContext->xMq, ( char * ) pulStartUs, sizeof( uint32_t ), NULL );
+            }
+
+            break;
+
+        default:
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xSemaphoreTake( pxContext->xNativeSemaphore, portMAX_DELAY );
+            }
+            else
+            {
+                ( void ) sem_wait( &pxContext->xSemaphore );
+            }
+
+            *pulStartUs = pxContext->ulStartUs;
+            break;
+    }
+
+    return ( pxContext->xStop == pdFALSE ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvWaiterThread( void * pvArgs )
+{
+    uint32_t ulStartUs = 0;
+    BenchmarkContext_t * pxContext = ( BenchmarkContext_t * ) pvArgs;
+
+    while( prvWaitForSignal( pxContext, &ulStartUs ) == pdTRUE )
+    {
+        /* Only one thread is woken per round, so there is no race on the
+         * sample count. */
+        if( pxContext->ulSampleCount < posixtestBENCHMARK_SAMPLES )
+        {
+            ulSamples[ pxContext->ulSampleCount ] = posixtestBENCHMARK_GET_TIME_US() - ulStartUs;
+            pxContext->ulSampleCount++;
+        }
+
+        ( void ) xSemaphoreGive( pxContext->xDone );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSignalWaiter( BenchmarkContext_t * pxContext )
+{
+    uint32_t ulStartUs = 0;
+
+    switch( pxContext->ePrimitive )
+    {
+        case benchmarkCOND_SIGNAL:
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xSemaphoreTake( pxContext->xNativeMutex, portMAX_DELAY );
+                pxContext->ulStartUs = posixtestBENCHMARK_GET_TIME_US();
+                ( void ) xSemaphoreGive( pxContext->xNativeSemaphore );
+                ( void ) xSemaphoreGive( pxContext->xNativeMutex );
+            }
+            else
+            {
+                ( void ) pthread_mutex_lock( &pxContext->xMutex );
+                pxContext->iRound++;
+                pxContext->ulStartUs = posixtestBENCHMARK_GET_TIME_US();
+                ( void ) pthread_cond_signal( &pxContext->xCond );
+                ( void ) pthread_mutex_unlock( &pxContext->xMutex );
+            }
+
+            break;
+
+        case benchmarkMQUEUE:
+            ulStartUs = posixtestBENCHMARK_GET_TIME_US();
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xQueueSend( pxContext->xNativeQueue, &ulStartUs, portMAX_DELAY );
+            }
+            else
+            {
+                ( void ) mq_send( pxContext->xMq, ( const char * ) &ulStartUs, sizeof( uint32_t ), 0 );
+            }
+
+            break;
+
+        default:
+            pxContext->ulStartUs = posixtestBENCHMARK_GET_TIME_US();
+
+            if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xSemaphoreGive( pxContext->xNativeSemaphore );
+            }
+            else
+            {
+                ( void ) sem_post( &pxContext->xSemaphore );
+            }
+
+            break;
+    }
+
+    /* Wait for the woken thread to record its sample. */
+    return xSemaphoreTake( pxContext->xDone, pdMS_TO_TICKS( posixtestBENCHMARK_TIMEOUT_MS ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStopWaiters( BenchmarkContext_t * pxContext,
+                            int iThreads )
+{
+    int i = 0;
+    uint32_t ulStartUs = 0;
+
+    if( ( pxContext->ePrimitive == benchmarkCOND_SIGNAL ) && ( pxContext->xNative == pdFALSE ) )
+    {
+        ( void ) pthread_mutex_lock( &pxContext->xMutex );
+        pxContext->xStop = pdTRUE;
+        ( void ) pthread_cond_broadcast( &pxContext->xCond );
+        ( void ) pthread_mutex_unlock( &pxContext->xMutex );
+    }
+    else
+    {
+        pxContext->xStop = pdTRUE;
+
+        /* Wake every waiting thread so it sees xStop. */
+        for( i = 0; i < iThreads; i++ )
+        {
+            if( pxContext->ePrimitive == benchmarkMQUEUE )
+            {
+                if( pxContext->xNative == pdTRUE )
+                {
+                    ( void ) xQueueSend( pxContext->xNativeQueue, &ulStartUs, portMAX_DELAY );
+                }
+                else
+                {
+                    ( void ) mq_send( pxContext->xMq, ( const char * ) &ulStartUs, sizeof( uint32_t ), 0 );
+                }
+            }
+            else if( pxContext->xNative == pdTRUE )
+            {
+                ( void ) xSemaphoreGive( pxContext->xNativeSemaphore );
+            }
+            else
+            {
+                ( void ) sem_post( &pxContext->xSemaphore );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunWaiterBenchmark( BenchmarkPrimitive_t ePrimitive,
+                                   BaseType_t xNative,
+                                   int iThreads )
+{
+    int i = 0;
+    BaseType_t xSignalled = pdTRUE;
+    pthread_t xThreads[ posixtestBENCHMARK_MAX_THREADS ] = { ( pthread_t ) NULL };
+
+    prvCreatePrimitives( &xContext, ePrimitive, xNative );
+
+    /* All of the threads wait on the same primitive and each round wakes
+     * exactly one of them. */
+    for( i = 0; i < iThreads; i++ )
+    {
+        ( void ) pthread_create( &xThreads[ i ], NULL, prvWaiterThread, &xContext );
+    }
+
+    for( i = 0; ( i < posixtestBENCHMARK_SAMPLES ) && ( xSignalled == pdTRUE ); i++ )
+    {
+        xSignalled = prvSignalWaiter( &xContext );
+    }
+
+    prvStopWaiters( &xContext, iThreads );
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        if( xThreads[ i ] != ( pthread_t ) NULL )
+        {
+            ( void ) pthread_join( xThreads[ i ], NULL );
+        }
+    }
+
+    prvReportSamples( &xContext, iThreads, xContext.ulSampleCount );
+    prvDestroyPrimitives( &xContext );
+
+    TEST_ASSERT_EQUAL_UINT32( posixtestBENCHMARK_SAMPLES, xContext.ulSampleCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunMutexBenchmark( BaseType_t xNative,
+                                  int iThreads )
+{
+    int i = 0;
+    uint32_t ulSampleCount = 0;
+    pthread_t xThreads[ posixtestBENCHMARK_MAX_THREADS ] = { ( pthread_t ) NULL };
+
+    prvCreatePrimitives( &xContext, benchmarkMUTEX, xNative );
+    xContext.ulSamplesPerThread = posixtestBENCHMARK_SAMPLES / ( uint32_t ) iThreads;
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        xSlots[ i ].pxContext = &xContext;
+        xSlots[ i ].pulSamples = &ulSamples[ ( uint32_t ) i * xContext.ulSamplesPerThread ];
+        xSlots[ i ].ulCount = 0U;
+    }
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        ( void ) pthread_create( &xThreads[ i ], NULL, prvMutexThread, &xSlots[ i ] );
+    }
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        if( xThreads[ i ] != ( pthread_t ) NULL )
+        {
+            ( void ) pthread_join( xThreads[ i ], NULL );
+            ulSampleCount += xSlots[ i ].ulCount;
+        }
+    }
+
+    prvReportSamples( &xContext, iThreads, ulSampleCount );
+    prvDestroyPrimitives( &xContext );
+
+    TEST_ASSERT_EQUAL_UINT32( xContext.ulSamplesPerThread * ( uint32_t ) iThreads, ulSampleCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTimerExpired( BenchmarkSlot_t * pxSlot )
+{
+    uint32_t ulNowUs = posixtestBENCHMARK_GET_TIME_US();
+    uint32_t ulIntervalUs = ulNowUs - pxSlot->ulLastUs;
+    const uint32_t ulPeriodUs = posixtestBENCHMARK_TIMER_PERIOD_MS * 1000UL;
+
+    /* The first expiration has no previous one to measure from. */
+    if( ( pxSlot->ulExpirations > 0U ) &&
+        ( pxSlot->ulCount < pxSlot->pxContext->ulSamplesPerThread ) )
+    {
+        pxSlot->pulSamples[ pxSlot->ulCount ] = ( ulIntervalUs > ulPeriodUs ) ? ( ulIntervalUs - ulPeriodUs ) : ( ulPeriodUs - ulIntervalUs );
+        pxSlot->ulCount++;
+    }
+
+    pxSlot->ulExpirations++;
+    pxSlot->ulLastUs = ulNowUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPosixTimerCallback( union sigval xValue )
+{
+    prvTimerExpired( ( BenchmarkSlot_t * ) xValue.sival_ptr );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvNativeTimerCallback( TimerHandle_t xTimer )
+{
+    prvTimerExpired( ( BenchmarkSlot_t * ) pvTimerGetTimerID( xTimer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunTimerBenchmark( BaseType_t xNative,
+                                  int iThreads )
+{
+    int i = 0;
+    uint32_t ulSampleCount = 0, ulWaitedMs = 0, ulTimeoutMs = 0;
+    timer_t xTimers[ posixtestBENCHMARK_MAX_THREADS ] = { NULL };
+    TimerHandle_t xNativeTimers[ posixtestBENCHMARK_MAX_THREADS ] = { NULL };
+    struct sigevent xNotificationEvent = { 0 };
+    struct itimerspec xTimerSpec = { 0 };
+
+    prvCreatePrimitives( &xContext, benchmarkTIMER, xNative );
+    xContext.ulSamplesPerThread = posixtestBENCHMARK_TIMER_SAMPLES / ( uint32_t ) iThreads;
+    ulTimeoutMs = ( ( xContext.ulSamplesPerThread + 1U ) * posixtestBENCHMARK_TIMER_PERIOD_MS ) + posixtestBENCHMARK_TIMEOUT_MS;
+
+    xNotificationEvent.sigev_notify = SIGEV_THREAD;
+    xNotificationEvent.sigev_notify_function = prvPosixTimerCallback;
+    xTimerSpec.it_value.tv_nsec = posixtestBENCHMARK_TIMER_PERIOD_MS * 1000000L;
+    xTimerSpec.it_interval.tv_nsec = posixtestBENCHMARK_TIMER_PERIOD_MS * 1000000L;
+
+    /* Every timer shares the timer service task, and the POSIX timers also
+     * share the SIGEV_THREAD notification threads. */
+    for( i = 0; i < iThreads; i++ )
+    {
+        ( void ) memset( &xSlots[ i ], 0x00, sizeof( BenchmarkSlot_t ) );
+        xSlots[ i ].pxContext = &xContext;
+        xSlots[ i ].pulSamples = &ulSamples[ ( uint32_t ) i * xContext.ulSamplesPerThread ];
+
+        if( xNative == pdTRUE )
+        {
+            xNativeTimers[ i ] = xTimerCreate( posixconfigTIMER_NAME,
+                                               pdMS_TO_TICKS( posixtestBENCHMARK_TIMER_PERIOD_MS ),
+                                               pdTRUE,
+                                               &xSlots[ i ],
+                                               prvNativeTimerCallback );
+
+            if( xNativeTimers[ i ] != NULL )
+            {
+                ( void ) xTimerStart( xNativeTimers[ i ], portMAX_DELAY );
+            }
+        }
+        else
+        {
+            xNotificationEvent.sigev_value.sival_ptr = &xSlots[ i ];
+
+            if( timer_create( CLOCK_REALTIME, &xNotificationEvent, &xTimers[ i ] ) == 0 )
+            {
+                ( void ) timer_settime( xTimers[ i ], 0, &xTimerSpec, NULL );
+            }
+        }
+    }
+
+    /* Wait for every timer to record its samples. The timers run
+     * concurrently, so they share one timeout. */
+    for( i = 0; ( i < iThreads ) && ( ulWaitedMs < ulTimeoutMs ); )
+    {
+        if( xSlots[ i ].ulCount < xContext.ulSamplesPerThread )
+        {
+            vTaskDelay( pdMS_TO_TICKS( posixtestBENCHMARK_TIMER_PERIOD_MS ) );
+            ulWaitedMs += posixtestBENCHMARK_TIMER_PERIOD_MS;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        if( xNativeTimers[ i ] != NULL )
+        {
+            ( void ) xTimerDelete( xNativeTimers[ i ], portMAX_DELAY );
+        }
+
+        if( xTimers[ i ] != NULL )
+        {
+            ( void ) timer_delete( xTimers[ i ] );
+        }
+    }
+
+    /* Let any notification that is still queued run before the slots are
+     * reused. */
+    vTaskDelay( pdMS_TO_TICKS( 2 * posixtestBENCHMARK_TIMER_PERIOD_MS ) );
+
+    for( i = 0; i < iThreads; i++ )
+    {
+        ulSampleCount += xSlots[ i ].ulCount;
+    }
+
+    prvReportSamples( &xContext, iThreads, ulSampleCount );
+    prvDestroyPrimitives( &xContext );
+
+    TEST_ASSERT_EQUAL_UINT32( xContext.ulSamplesPerThread * ( uint32_t ) iThreads, ulSampleCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunBenchmark( BenchmarkPrimitive_t ePrimitive )
+{
+    size_t xIndex = 0;
+    BaseType_t xNative = pdFALSE;
+    int iThreads = 0;
+
+    for( xIndex = 0; xIndex < ( sizeof( iThreadCounts ) / sizeof( iThreadCounts[ 0 ] ) ); xIndex++ )
+    {
+        iThreads = iThreadCounts[ xIndex ];
+        TEST_ASSERT_GREATER_OR_EQUAL( 1, iThreads );
+        TEST_ASSERT_LESS_OR_EQUAL( posixtestBENCHMARK_MAX_THREADS, iThreads );
+
+        /* Run the POSIX primitive first, then the native one it is built on. */
+        for( xNative = pdFALSE; xNative <= pdTRUE; xNative++ )
+        {
+            if( ePrimitive == benchmarkMUTEX )
+            {
+                prvRunMutexBenchmark( xNative, iThreads );
+            }
+            else if( ePrimitive == benchmarkTIMER )
+            {
+                prvRunTimerBenchmark( xNative, iThreads );
+            }
+            else
+            {
+                prvRunWaiterBenchmark( ePrimitive, xNative, iThreads );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_POSIX_BENCHMARK );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_POSIX_BENCHMARK )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_POSIX_BENCHMARK )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_POSIX_BENCHMARK )
+{
+    RUN_TEST_CASE( Full_POSIX_BENCHMARK, mutex );
+    RUN_TEST_CASE( Full_POSIX_BENCHMARK, cond_signal );
+    RUN_TEST_CASE( Full_POSIX_BENCHMARK, mqueue );
+    RUN_TEST_CASE( Full_POSIX_BENCHMARK, semaphore );
+    RUN_TEST_CASE( Full_POSIX_BENCHMARK, timer );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_BENCHMARK, mutex )
+{
+    prvRunBenchmark( benchmarkMUTEX );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_BENCHMARK, cond_signal )
+{
+    prvRunBenchmark( benchmarkCOND_SIGNAL );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_BENCHMARK, mqueue )
+{
+    prvRunBenchmark( benchmarkMQUEUE );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_BENCHMARK, semaphore )
+{
+    prvRunBenchmark( benchmarkSEMAPHORE );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_BENCHMARK, timer )
+{
+    prvRunBenchmark( benchmarkTIMER );
+}
@@ -36,6 +36,7 @@
 #include "FreeRTOS_POSIX/errno.h"
 #include "FreeRTOS_POSIX/fcntl.h"
 #include "FreeRTOS_POSIX/mqueue.h"
+#include "FreeRTOS_POSIX/pthread.h"
 
 /* Test framework includes. */
 #include "unity.h"
@@ -64,6 +65,25 @@ struct mq_attr xDefaultQueueAttr =
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Thread that sends posixtestMQ_SMALL_MESSAGE to a queue.
+ *
+ * @param[in] pvArg Pointer to the mqd_t of the queue.
+ *
+ * @return NULL
+ */
+static void * prvSendSmallMessageThread( void * pvArg )
+{
+    ( void ) mq_send( *( ( mqd_t * ) pvArg ),
+                      posixtestMQ_SMALL_MESSAGE,
+                      posixtestMQ_SMALL_MESSAGE_SIZE,
+                      0 );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
 TEST_GROUP( Full_POSIX_MQUEUE );
 
 /*-----------------------------------------------------------*/
@@ -93,6 +113,9 @@ TEST_GROUP_RUNNER( Full_POSIX_MQUEUE )
     RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive );
     /*RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_invalidParams ); */
     RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_nonblock );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_stale_descriptor );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_buffer_send_receive );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_poll );
 }
 
 /*-----------------------------------------------------------*/
@@ -550,3 +573,183 @@ TEST( Full_POSIX_MQUEUE, mq_send_receive_nonblock )
 }
 
 /*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_stale_descriptor )
+{
+    int iStatus = 0;
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD, xMqId2 = posixtestMQ_INVALID_MQD;
+    mqd_t xStaleMqId = posixtestMQ_INVALID_MQD;
+
+    if( TEST_PROTECT() )
+    {
+        xMqId = mq_open( posixtestMQ_DEFAULT_NAME, O_CREAT, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+
+        /* Close and unlink the queue, keeping a copy of its descriptor. */
+        xStaleMqId = xMqId;
+        iStatus = mq_close( xMqId );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xMqId = posixtestMQ_INVALID_MQD;
+        iStatus = mq_unlink( posixtestMQ_DEFAULT_NAME );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        /* A new queue may reuse the slot, but must not reuse the descriptor. */
+        xMqId2 = mq_open( posixtestMQ_DEFAULT_NAME "2", O_CREAT, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId2 );
+        TEST_ASSERT_NOT_EQUAL( xStaleMqId, xMqId2 );
+
+        /* The stale descriptor must be rejected. */
+        iStatus = mq_send( xStaleMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EBADF, errno );
+
+        iStatus = mq_close( xStaleMqId );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EBADF, errno );
+
+        /* The new queue is unaffected. */
+        iStatus = mq_send( xMqId2, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    }
+
+    /* Clean up resources used by test. */
+    ( void ) mq_close( xMqId );
+    ( void ) mq_close( xMqId2 );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME "2" );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_buffer_send_receive )
+{
+    int iStatus = 0;
+    ssize_t xLength = 0;
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD;
+    char * volatile pcBuffer = NULL;
+    char * pcReceived = NULL;
+    char pcReceiveBuffer[ posixtestMQ_SMALL_MESSAGE_SIZE ] = { 0 };
+    struct mq_attr xZeroCopyQueueAttr = xDefaultQueueAttr;
+
+    xZeroCopyQueueAttr.mq_flags = MQ_ZEROCOPY;
+
+    if( TEST_PROTECT() )
+    {
+        xMqId = mq_open( posixtestMQ_DEFAULT_NAME,
+                         O_CREAT | O_RDWR | O_NONBLOCK,
+                         posixtestMQ_DEFAULT_MODE,
+                         &xZeroCopyQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+
+        /* Fill a pool buffer and pass it through the queue by pointer. */
+        pcBuffer = mq_buffer_get( xMqId, NULL );
+        TEST_ASSERT_NOT_NULL( pcBuffer );
+        ( void ) memcpy( pcBuffer, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE );
+
+        iStatus = mq_buffer_send( xMqId, pcBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        xLength = mq_buffer_receive( xMqId, &pcReceived, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, xLength );
+        TEST_ASSERT_EQUAL_PTR( pcBuffer, pcReceived );
+        TEST_ASSERT_EQUAL_STRING( posixtestMQ_SMALL_MESSAGE, pcReceived );
+
+        iStatus = mq_buffer_release( xMqId, pcReceived );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        pcBuffer = NULL;
+
+        /* A buffer that is no longer held can be neither released nor sent. */
+        iStatus = mq_buffer_release( xMqId, pcReceived );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EINVAL, errno );
+
+        iStatus = mq_buffer_send( xMqId, pcReceived, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EINVAL, errno );
+
+        /* The standard functions work on a zero-copy queue, too. */
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        xLength = mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, xLength );
+        TEST_ASSERT_EQUAL_STRING( posixtestMQ_SMALL_MESSAGE, pcReceiveBuffer );
+
+        /* An empty nonblocking queue has nothing to hand over. */
+        xLength = mq_buffer_receive( xMqId, &pcReceived, NULL );
+        TEST_ASSERT_EQUAL_INT( -1, xLength );
+        TEST_ASSERT_EQUAL_INT( EAGAIN, errno );
+    }
+
+    /* Clean up resources used by test. */
+    if( pcBuffer != NULL )
+    {
+        ( void ) mq_buffer_release( xMqId, pcBuffer );
+    }
+
+    ( void ) mq_close( xMqId );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_poll )
+{
+    int iStatus = 0;
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD, xMqId2 = posixtestMQ_INVALID_MQD;
+    mqd_t xSendMqId = posixtestMQ_INVALID_MQD;
+    pthread_t xSenderThread;
+    volatile BaseType_t xSenderCreated = pdFALSE;
+    struct mq_pollfd pxPollFds[ 2 ];
+    struct timespec xPastTimeout = { 0 };
+
+    if( TEST_PROTECT() )
+    {
+        xMqId = mq_open( posixtestMQ_DEFAULT_NAME, O_CREAT, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+        xMqId2 = mq_open( posixtestMQ_DEFAULT_NAME "2", O_CREAT, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId2 );
+
+        pxPollFds[ 0 ].mqdes = xMqId;
+        pxPollFds[ 0 ].events = MQ_POLLIN;
+        pxPollFds[ 1 ].mqdes = xMqId2;
+        pxPollFds[ 1 ].events = MQ_POLLIN;
+
+        /* Both queues are empty; a timeout in the past returns at once. */
+        iStatus = mq_poll( pxPollFds, 2, &xPastTimeout );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        /* Block until another thread sends to the second queue. */
+        xSendMqId = xMqId2;
+        iStatus = pthread_create( &xSenderThread, NULL, prvSendSmallMessageThread, &xSendMqId );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xSenderCreated = pdTRUE;
+
+        iStatus = mq_poll( pxPollFds, 2, NULL );
+        TEST_ASSERT_EQUAL_INT( 1, iStatus );
+        TEST_ASSERT_EQUAL_INT( 0, pxPollFds[ 0 ].revents );
+        TEST_ASSERT_EQUAL_INT( MQ_POLLIN, pxPollFds[ 1 ].revents );
+
+        /* A closed descriptor is reported as invalid. */
+        iStatus = mq_close( xMqId );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xMqId = posixtestMQ_INVALID_MQD;
+
+        iStatus = mq_poll( pxPollFds, 1, NULL );
+        TEST_ASSERT_EQUAL_INT( 1, iStatus );
+        TEST_ASSERT_EQUAL_INT( MQ_POLLNVAL, pxPollFds[ 0 ].revents );
+    }
+
+    /* Clean up resources used by test. */
+    if( xSenderCreated == pdTRUE )
+    {
+        ( void ) pthread_join( xSenderThread, NULL );
+    }
+
+    ( void ) mq_close( xMqId );
+    ( void ) mq_close( xMqId2 );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME "2" );
+}
+
+/*-----------------------------------------------------------*/
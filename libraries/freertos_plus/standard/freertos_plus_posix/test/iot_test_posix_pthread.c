@@ -48,6 +48,8 @@
 /**@{ */
 #define posixtestPTHREAD_DETACHED_WAIT_NANOSECONDS           ( 100000000 ) /**< How long to wait for a detached thread to finish. */
 #define posixtestPTHREAD_COND_BROADCAST_NUMBER_OF_THREADS    ( 4 )         /**< Number of threads that wait on a pthread_cond_broadcast. */
+#define posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS           ( 25 )        /**< More threads than the 24 bits of an event group. */
+#define posixtestPTHREAD_BARRIER_CYCLES                      ( 3 )         /**< Number of times the threads wait on the barrier. */
 /**@} */
 
 /**
@@ -60,6 +62,15 @@ typedef struct SignalCondThreadArgs
     pthread_cond_t * pxCond; /**< Condition variable. */
 } SignalCondThreadArgs_t;
 
+/**
+ * @brief The arguments to prvKeyThread, also bound to the key by that thread.
+ */
+typedef struct KeyThreadArgs
+{
+    pthread_key_t xKey;   /**< Key the thread binds its arguments to. */
+    int iDestructorCalls; /**< Incremented by prvKeyDestructor. */
+} KeyThreadArgs_t;
+
 /*-----------------------------------------------------------*/
 
 static void * prvComputeSquareThread( void * pvArgs )
@@ -109,6 +120,33 @@ static void * prvBarrierThread( void * pvArgs )
 
 /*-----------------------------------------------------------*/
 
+static void * prvBarrierCyclesThread( void * pvArgs )
+{
+    pthread_barrier_t * pxBarrier = ( pthread_barrier_t * ) pvArgs;
+    intptr_t xSerialCount = 0;
+    int i = 0, iStatus = 0;
+
+    /* Wait on the barrier several times, counting PTHREAD_BARRIER_SERIAL_THREAD.
+     * Any other non-zero status is returned as a negative count. */
+    for( i = 0; ( i < posixtestPTHREAD_BARRIER_CYCLES ) && ( xSerialCount >= 0 ); i++ )
+    {
+        iStatus = pthread_barrier_wait( pxBarrier );
+
+        if( iStatus == PTHREAD_BARRIER_SERIAL_THREAD )
+        {
+            xSerialCount++;
+        }
+        else if( iStatus != 0 )
+        {
+            xSerialCount = -1;
+        }
+    }
+
+    return ( void * ) xSerialCount;
+}
+
+/*-----------------------------------------------------------*/
+
 static void * prvSignalCondThread( void * pvArgs )
 {
     SignalCondThreadArgs_t * pxArgs = ( SignalCondThreadArgs_t * ) pvArgs;
@@ -227,6 +265,107 @@ static void * prvWaitCondThread( void * pvArgs )
 
 /*-----------------------------------------------------------*/
 
+static void * prvWriteLockThread( void * pvArgs )
+{
+    pthread_rwlock_t * pxRwlock = ( pthread_rwlock_t * ) pvArgs;
+    intptr_t xStatus = 0;
+
+    /* Write lock the rwlock, then release it and exit. */
+    xStatus = ( intptr_t ) pthread_rwlock_wrlock( pxRwlock );
+
+    if( xStatus == 0 )
+    {
+        xStatus = ( intptr_t ) pthread_rwlock_unlock( pxRwlock );
+    }
+
+    pthread_exit( ( void * ) xStatus );
+
+    /* Silence compiler warnings about return values. This line will never be
+     * reached. */
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvLockMutexThread( void * pvArgs )
+{
+    pthread_mutex_t * pxMutex = ( pthread_mutex_t * ) pvArgs;
+    intptr_t xStatus = 0;
+
+    /* Lock the mutex, then release it and exit. */
+    xStatus = ( intptr_t ) pthread_mutex_lock( pxMutex );
+
+    if( xStatus == 0 )
+    {
+        xStatus = ( intptr_t ) pthread_mutex_unlock( pxMutex );
+    }
+
+    pthread_exit( ( void * ) xStatus );
+
+    /* Silence compiler warnings about return values. This line will never be
+     * reached. */
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvSpinLockThread( void * pvArgs )
+{
+    pthread_spinlock_t * pxLock = ( pthread_spinlock_t * ) pvArgs;
+    intptr_t xStatus = 0;
+
+    /* Lock the spin lock, then release it and exit. */
+    xStatus = ( intptr_t ) pthread_spin_lock( pxLock );
+
+    if( xStatus == 0 )
+    {
+        xStatus = ( intptr_t ) pthread_spin_unlock( pxLock );
+    }
+
+    pthread_exit( ( void * ) xStatus );
+
+    /* Silence compiler warnings about return values. This line will never be
+     * reached. */
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    static void prvKeyDestructor( void * pvValue )
+    {
+        KeyThreadArgs_t * pxArgs = ( KeyThreadArgs_t * ) pvValue;
+
+        pxArgs->iDestructorCalls++;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * prvKeyThread( void * pvArgs )
+    {
+        KeyThreadArgs_t * pxArgs = ( KeyThreadArgs_t * ) pvArgs;
+        intptr_t xStatus = EINVAL;
+
+        /* A new thread starts with a NULL value for the key. Bind the arguments
+         * to it; they are passed to prvKeyDestructor when this thread exits. */
+        if( pthread_getspecific( pxArgs->xKey ) == NULL )
+        {
+            xStatus = ( intptr_t ) pthread_setspecific( pxArgs->xKey, pxArgs );
+        }
+
+        if( ( xStatus == 0 ) && ( pthread_getspecific( pxArgs->xKey ) != pxArgs ) )
+        {
+            xStatus = EINVAL;
+        }
+
+        return ( void * ) xStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
+
 static void prvTestMutexLockUnlock( int iMutexType )
 {
     int iStatus = 0, iType = -1;
@@ -333,9 +472,17 @@ TEST_GROUP_RUNNER( Full_POSIX_PTHREAD )
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_attr_init_destroy );
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_mutex_lock_unlock );
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_mutex_trylock_timedlock );
+    RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_mutex_adaptive );
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_barrier );
+    RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_barrier_many_threads );
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_cond_signal );
     RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_cond_broadcast );
+    RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_rwlock_lock_unlock );
+    RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_rwlock_prefer_writer );
+    RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_spin_lock_unlock );
+    #if ( PTHREAD_KEYS_MAX > 0 )
+        RUN_TEST_CASE( Full_POSIX_PTHREAD, pthread_key );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -768,6 +915,72 @@ TEST( Full_POSIX_PTHREAD, pthread_mutex_trylock_timedlock )
 
 /*-----------------------------------------------------------*/
 
+TEST( Full_POSIX_PTHREAD, pthread_mutex_adaptive )
+{
+    int iStatus = 0, iType = -1;
+    intptr_t xThreadReturnValue = 0;
+    volatile BaseType_t xMutexCreated = pdFALSE, xThreadCreated = pdFALSE;
+    pthread_mutex_t xMutex;
+    pthread_mutexattr_t xMutexAttr;
+    pthread_t xNewThread;
+    struct timespec xTimeout;
+
+    /* Create an ADAPTIVE mutex. */
+    TEST_ASSERT_EQUAL_INT( 0, pthread_mutexattr_init( &xMutexAttr ) );
+    TEST_ASSERT_EQUAL_INT( 0, pthread_mutexattr_settype( &xMutexAttr, PTHREAD_MUTEX_ADAPTIVE_NP ) );
+    TEST_ASSERT_EQUAL_INT( 0, pthread_mutexattr_gettype( &xMutexAttr, &iType ) );
+    TEST_ASSERT_EQUAL_INT( PTHREAD_MUTEX_ADAPTIVE_NP, iType );
+
+    iStatus = pthread_mutex_init( &xMutex, &xMutexAttr );
+    ( void ) pthread_mutexattr_destroy( &xMutexAttr );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    xMutexCreated = pdTRUE;
+
+    if( TEST_PROTECT() )
+    {
+        /* Lock the mutex. */
+        iStatus = pthread_mutex_lock( &xMutex );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        /* Attempt to lock a locked mutex. */
+        iStatus = pthread_mutex_trylock( &xMutex );
+        TEST_ASSERT_EQUAL_INT( EBUSY, iStatus );
+
+        /* Set an absolute timeout of 100 ms. Spinning must not outlast it. */
+        ( void ) clock_gettime( CLOCK_REALTIME, &xTimeout );
+        ( void ) UTILS_TimespecAddNanoseconds( &xTimeout, 100000000LL, &xTimeout );
+
+        iStatus = pthread_mutex_timedlock( &xMutex, &xTimeout );
+        TEST_ASSERT_EQUAL_INT( ETIMEDOUT, iStatus );
+
+        /* Create a thread that spins, then blocks on the locked mutex. */
+        iStatus = pthread_create( &xNewThread, NULL, prvLockMutexThread, &xMutex );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xThreadCreated = pdTRUE;
+
+        /* Wait 100 ms for the thread to block on the mutex. */
+        vTaskDelay( pdMS_TO_TICKS( 100 ) );
+    }
+
+    /* Unlock the mutex, which must wake the blocked thread. */
+    iStatus = pthread_mutex_unlock( &xMutex );
+
+    if( xThreadCreated == pdTRUE )
+    {
+        ( void ) pthread_join( xNewThread, ( void ** ) &xThreadReturnValue );
+    }
+
+    if( xMutexCreated == pdTRUE )
+    {
+        ( void ) pthread_mutex_destroy( &xMutex );
+    }
+
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    TEST_ASSERT_EQUAL_INT( 0, ( int ) xThreadReturnValue );
+}
+
+/*-----------------------------------------------------------*/
+
 TEST( Full_POSIX_PTHREAD, pthread_barrier )
 {
     int iStatus = 0;
@@ -822,6 +1035,54 @@ TEST( Full_POSIX_PTHREAD, pthread_barrier )
 
 /*-----------------------------------------------------------*/
 
+TEST( Full_POSIX_PTHREAD, pthread_barrier_many_threads )
+{
+    int iStatus = 0, i = 0, iThreadsCreated = 0;
+    intptr_t xThreadReturnValue = 0, xSerialCount = 0;
+    pthread_t xThreads[ posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS ];
+    pthread_barrier_t xBarrier = { 0 };
+
+    /* The count is no longer limited by the bits of an event group. */
+    iStatus = pthread_barrier_init( &xBarrier, NULL, posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    /* Create the threads, which go through the barrier together several times. */
+    for( iThreadsCreated = 0; iThreadsCreated < posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS; iThreadsCreated++ )
+    {
+        if( pthread_create( &xThreads[ iThreadsCreated ], NULL, prvBarrierCyclesThread, &xBarrier ) != 0 )
+        {
+            break;
+        }
+    }
+
+    /* Join the threads, unless one could not be created; the others would
+     * wait on the barrier forever. */
+    if( iThreadsCreated == posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS )
+    {
+        for( i = 0; i < posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS; i++ )
+        {
+            ( void ) pthread_join( xThreads[ i ], ( void ** ) &xThreadReturnValue );
+
+            if( xThreadReturnValue < 0 )
+            {
+                iStatus = EINVAL;
+            }
+
+            xSerialCount += xThreadReturnValue;
+        }
+
+        ( void ) pthread_barrier_destroy( &xBarrier );
+    }
+
+    TEST_ASSERT_EQUAL_INT( posixtestPTHREAD_BARRIER_NUMBER_OF_THREADS, iThreadsCreated );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    /* Exactly one thread per cycle received PTHREAD_BARRIER_SERIAL_THREAD. */
+    TEST_ASSERT_EQUAL_INT( posixtestPTHREAD_BARRIER_CYCLES, ( int ) xSerialCount );
+}
+
+/*-----------------------------------------------------------*/
+
 TEST( Full_POSIX_PTHREAD, pthread_cond_signal )
 {
     int iStatus = 0;
@@ -945,3 +1206,224 @@ TEST( Full_POSIX_PTHREAD, pthread_cond_broadcast )
 }
 
 /*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_PTHREAD, pthread_rwlock_lock_unlock )
+{
+    int iStatus = 0;
+    pthread_rwlock_t xRwlock = PTHREAD_RWLOCK_INITIALIZER;
+    struct timespec xTimeout;
+
+    /* Check that several read locks can be held at once. */
+    iStatus = pthread_rwlock_rdlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    iStatus = pthread_rwlock_tryrdlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    /* Attempt to write lock a read locked rwlock. */
+    iStatus = pthread_rwlock_trywrlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( EBUSY, iStatus );
+
+    /* Set an absolute timeout of 100 ms. */
+    ( void ) clock_gettime( CLOCK_REALTIME, &xTimeout );
+    ( void ) UTILS_TimespecAddNanoseconds( &xTimeout, 100000000LL, &xTimeout );
+
+    iStatus = pthread_rwlock_timedwrlock( &xRwlock, &xTimeout );
+    TEST_ASSERT_EQUAL_INT( ETIMEDOUT, iStatus );
+
+    /* Release both read locks. A third unlock has nothing to release. */
+    TEST_ASSERT_EQUAL_INT( 0, pthread_rwlock_unlock( &xRwlock ) );
+    TEST_ASSERT_EQUAL_INT( 0, pthread_rwlock_unlock( &xRwlock ) );
+    TEST_ASSERT_EQUAL_INT( EPERM, pthread_rwlock_unlock( &xRwlock ) );
+
+    /* Check that a write lock excludes readers and is not recursive. */
+    iStatus = pthread_rwlock_wrlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    TEST_ASSERT_EQUAL_INT( EDEADLK, pthread_rwlock_tryrdlock( &xRwlock ) );
+    TEST_ASSERT_EQUAL_INT( EDEADLK, pthread_rwlock_trywrlock( &xRwlock ) );
+    TEST_ASSERT_EQUAL_INT( EBUSY, pthread_rwlock_destroy( &xRwlock ) );
+
+    iStatus = pthread_rwlock_unlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    iStatus = pthread_rwlock_destroy( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_PTHREAD, pthread_rwlock_prefer_writer )
+{
+    int iStatus = 0;
+    intptr_t xThreadReturnValue = 0;
+    volatile BaseType_t xThreadCreated = pdFALSE;
+    pthread_t xWriterThread;
+    pthread_rwlockattr_t xRwlockAttr;
+    pthread_rwlock_t xRwlock;
+
+    /* Create a rwlock that prefers writers. */
+    TEST_ASSERT_EQUAL_INT( 0, pthread_rwlockattr_init( &xRwlockAttr ) );
+    TEST_ASSERT_EQUAL_INT( EINVAL, pthread_rwlockattr_setkind_np( &xRwlockAttr, -1 ) );
+    TEST_ASSERT_EQUAL_INT( 0, pthread_rwlockattr_setkind_np( &xRwlockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NP ) );
+
+    iStatus = pthread_rwlock_init( &xRwlock, &xRwlockAttr );
+    ( void ) pthread_rwlockattr_destroy( &xRwlockAttr );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    /* Read lock the rwlock. */
+    iStatus = pthread_rwlock_rdlock( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    if( TEST_PROTECT() )
+    {
+        /* Create a writer, which blocks until the read lock is released. */
+        iStatus = pthread_create( &xWriterThread, NULL, prvWriteLockThread, &xRwlock );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xThreadCreated = pdTRUE;
+
+        /* Wait 100 ms for the writer to block on the rwlock. */
+        vTaskDelay( pdMS_TO_TICKS( 100 ) );
+
+        /* A waiting writer keeps out new readers. */
+        iStatus = pthread_rwlock_tryrdlock( &xRwlock );
+        TEST_ASSERT_EQUAL_INT( EBUSY, iStatus );
+    }
+
+    /* Release the read lock to let the writer in. */
+    iStatus = pthread_rwlock_unlock( &xRwlock );
+
+    if( xThreadCreated == pdTRUE )
+    {
+        ( void ) pthread_join( xWriterThread, ( void ** ) &xThreadReturnValue );
+    }
+
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    TEST_ASSERT_EQUAL_INT( 0, ( int ) xThreadReturnValue );
+
+    iStatus = pthread_rwlock_destroy( &xRwlock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_PTHREAD, pthread_spin_lock_unlock )
+{
+    int iStatus = 0;
+    intptr_t xThreadReturnValue = 0;
+    volatile BaseType_t xThreadCreated = pdFALSE;
+    pthread_t xNewThread;
+    pthread_spinlock_t xLock;
+
+    /* Only PTHREAD_PROCESS_PRIVATE and PTHREAD_PROCESS_SHARED are valid. */
+    iStatus = pthread_spin_init( &xLock, -1 );
+    TEST_ASSERT_EQUAL_INT( EINVAL, iStatus );
+
+    iStatus = pthread_spin_init( &xLock, PTHREAD_PROCESS_PRIVATE );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    /* Unlock a spin lock that is not held. */
+    iStatus = pthread_spin_unlock( &xLock );
+    TEST_ASSERT_EQUAL_INT( EPERM, iStatus );
+
+    /* Lock the spin lock. */
+    iStatus = pthread_spin_lock( &xLock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+    if( TEST_PROTECT() )
+    {
+        /* A held spin lock cannot be taken again or destroyed. */
+        TEST_ASSERT_EQUAL_INT( EBUSY, pthread_spin_trylock( &xLock ) );
+        TEST_ASSERT_EQUAL_INT( EDEADLK, pthread_spin_lock( &xLock ) );
+        TEST_ASSERT_EQUAL_INT( EBUSY, pthread_spin_destroy( &xLock ) );
+
+        /* Create a thread that spins on the held lock. */
+        iStatus = pthread_create( &xNewThread, NULL, prvSpinLockThread, &xLock );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xThreadCreated = pdTRUE;
+
+        /* Wait 100 ms for the thread to start spinning. */
+        vTaskDelay( pdMS_TO_TICKS( 100 ) );
+    }
+
+    /* Release the spin lock to let the thread in. */
+    iStatus = pthread_spin_unlock( &xLock );
+
+    if( xThreadCreated == pdTRUE )
+    {
+        ( void ) pthread_join( xNewThread, ( void ** ) &xThreadReturnValue );
+    }
+
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    TEST_ASSERT_EQUAL_INT( 0, ( int ) xThreadReturnValue );
+
+    iStatus = pthread_spin_destroy( &xLock );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( PTHREAD_KEYS_MAX > 0 )
+
+    TEST( Full_POSIX_PTHREAD, pthread_key )
+    {
+        int iStatus = 0;
+        intptr_t xThreadReturnValue = 0;
+        volatile BaseType_t xKeyCreated = pdFALSE;
+        pthread_t xNewThread;
+        KeyThreadArgs_t xArgs = { 0 };
+
+        iStatus = pthread_key_create( &xArgs.xKey, prvKeyDestructor );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xKeyCreated = pdTRUE;
+
+        if( TEST_PROTECT() )
+        {
+            /* Bind a value in this thread. */
+            TEST_ASSERT_NULL( pthread_getspecific( xArgs.xKey ) );
+            TEST_ASSERT_EQUAL_INT( 0, pthread_setspecific( xArgs.xKey, &xArgs ) );
+            TEST_ASSERT_EQUAL_PTR( &xArgs, pthread_getspecific( xArgs.xKey ) );
+
+            /* Another thread has its own value, destroyed when it exits. */
+            iStatus = pthread_create( &xNewThread, NULL, prvKeyThread, &xArgs );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+            iStatus = pthread_join( xNewThread, ( void ** ) &xThreadReturnValue );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            TEST_ASSERT_EQUAL_INT( 0, ( int ) xThreadReturnValue );
+            TEST_ASSERT_EQUAL_INT( 1, xArgs.iDestructorCalls );
+
+            /* This thread's value is unaffected. */
+            TEST_ASSERT_EQUAL_PTR( &xArgs, pthread_getspecific( xArgs.xKey ) );
+            TEST_ASSERT_EQUAL_INT( 0, pthread_setspecific( xArgs.xKey, NULL ) );
+
+            /* A deleted key cannot be used. */
+            TEST_ASSERT_EQUAL_INT( 0, pthread_key_delete( xArgs.xKey ) );
+            xKeyCreated = pdFALSE;
+            TEST_ASSERT_EQUAL_INT( EINVAL, pthread_key_delete( xArgs.xKey ) );
+            TEST_ASSERT_EQUAL_INT( EINVAL, pthread_setspecific( xArgs.xKey, &xArgs ) );
+
+            /* A key reused after pthread_key_delete starts out NULL again. */
+            iStatus = pthread_key_create( &xArgs.xKey, prvKeyDestructor );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            xKeyCreated = pdTRUE;
+            TEST_ASSERT_EQUAL_INT( 0, pthread_setspecific( xArgs.xKey, &xArgs ) );
+            TEST_ASSERT_EQUAL_INT( 0, pthread_key_delete( xArgs.xKey ) );
+            xKeyCreated = pdFALSE;
+
+            iStatus = pthread_key_create( &xArgs.xKey, prvKeyDestructor );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            xKeyCreated = pdTRUE;
+            TEST_ASSERT_NULL( pthread_getspecific( xArgs.xKey ) );
+        }
+
+        if( xKeyCreated == pdTRUE )
+        {
+            ( void ) pthread_setspecific( xArgs.xKey, NULL );
+            ( void ) pthread_key_delete( xArgs.xKey );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( PTHREAD_KEYS_MAX > 0 ) */
@@ -73,6 +73,24 @@
 #define posixtestBARRIER_STRESS_COUNT    ( 12 )    /**< The count argument for the barriers. */
 /**@} */
 
+/**
+ * @defgroup Configuration constants for the condition variable latency test.
+ */
+/**@{ */
+#define posixtestCOND_LATENCY_ROUND_TRIPS          ( 1000 ) /**< Signal/wait round trips in the ping-pong test. */
+#define posixtestCOND_LATENCY_BROADCAST_ROUNDS     ( 200 )  /**< Broadcasts in the broadcast test. */
+#define posixtestCOND_LATENCY_NUMBER_OF_WAITERS    ( 8 )    /**< Threads woken by each broadcast. */
+/**@} */
+
+/**
+ * @defgroup Configuration constants for the rwlock reader scalability test.
+ */
+/**@{ */
+#define posixtestRWLOCK_STRESS_MAX_READERS     ( 8 )  /**< Largest number of reader threads; the test doubles from 1. */
+#define posixtestRWLOCK_STRESS_LOOKUPS         ( 10 ) /**< Lookups done by each reader thread. */
+#define posixtestRWLOCK_STRESS_LOOKUP_TICKS    ( 1 )  /**< Ticks a reader blocks for while holding the lock. */
+/**@} */
+
 /**
  * @brief The arguments to prvChangeErrnoThread.
  */
@@ -101,6 +119,27 @@ typedef struct BarrierTestThreadArgs
     volatile int * piWaitingThreads; /**< How many threads are waiting on pxBarrier. */
 } BarrierTestThreadArgs_t;
 
+/**
+ * @brief The arguments to the condition variable latency test threads.
+ */
+typedef struct CondLatencyThreadArgs
+{
+    pthread_mutex_t * pxMutex;   /**< Mutex protecting the shared state below. */
+    pthread_cond_t * pxCond;     /**< Condition variable the test threads wait on. */
+    pthread_cond_t * pxDoneCond; /**< Condition variable the test runner waits on. */
+    volatile int * piRound;      /**< Round number published by the test runner. */
+    volatile int * piAcks;       /**< Test threads which have seen the current round. */
+} CondLatencyThreadArgs_t;
+
+/**
+ * @brief The arguments to the rwlock reader scalability test threads.
+ */
+typedef struct RwlockReaderThreadArgs
+{
+    pthread_rwlock_t * pxRwlock; /**< Rwlock to read lock; NULL to use pxMutex. */
+    pthread_mutex_t * pxMutex;   /**< Mutex to lock when pxRwlock is NULL. */
+} RwlockReaderThreadArgs_t;
+
 /*-----------------------------------------------------------*/
 
 static void * prvChangeErrnoThread( void * pvArgs )
@@ -302,6 +341,131 @@ static void * prvBarrierTestThread( void * pvArgs )
 
 /*-----------------------------------------------------------*/
 
+static void * prvCondPingPongThread( void * pvArgs )
+{
+    intptr_t iResult = 1;
+    int i = 0;
+    CondLatencyThreadArgs_t * pxArgs = ( CondLatencyThreadArgs_t * ) pvArgs;
+
+    for( i = 0; ( i < posixtestCOND_LATENCY_ROUND_TRIPS ) && ( iResult == 1 ); i++ )
+    {
+        ( void ) pthread_mutex_lock( pxArgs->pxMutex );
+
+        /* Wait for the test runner to start round i + 1. */
+        while( ( *( pxArgs->piRound ) == i ) && ( iResult == 1 ) )
+        {
+            iResult = ( intptr_t ) ( pthread_cond_wait( pxArgs->pxCond, pxArgs->pxMutex ) == 0 );
+        }
+
+        /* Answer the test runner. */
+        ( *( pxArgs->piAcks ) )++;
+        ( void ) pthread_cond_signal( pxArgs->pxDoneCond );
+
+        ( void ) pthread_mutex_unlock( pxArgs->pxMutex );
+    }
+
+    return ( void * ) iResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvCondBroadcastThread( void * pvArgs )
+{
+    intptr_t iResult = 1;
+    int i = 0;
+    CondLatencyThreadArgs_t * pxArgs = ( CondLatencyThreadArgs_t * ) pvArgs;
+
+    for( i = 0; ( i < posixtestCOND_LATENCY_BROADCAST_ROUNDS ) && ( iResult == 1 ); i++ )
+    {
+        ( void ) pthread_mutex_lock( pxArgs->pxMutex );
+
+        /* Wait for the test runner to broadcast round i + 1. */
+        while( ( *( pxArgs->piRound ) == i ) && ( iResult == 1 ) )
+        {
+            iResult = ( intptr_t ) ( pthread_cond_wait( pxArgs->pxCond, pxArgs->pxMutex ) == 0 );
+        }
+
+        /* The last thread to see the round wakes the test runner. */
+        ( *( pxArgs->piAcks ) )++;
+
+        if( *( pxArgs->piAcks ) == posixtestCOND_LATENCY_NUMBER_OF_WAITERS )
+        {
+            ( void ) pthread_cond_signal( pxArgs->pxDoneCond );
+        }
+
+        ( void ) pthread_mutex_unlock( pxArgs->pxMutex );
+    }
+
+    return ( void * ) iResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvRwlockReaderThread( void * pvArgs )
+{
+    intptr_t iResult = 1;
+    int i = 0;
+    RwlockReaderThreadArgs_t * pxArgs = ( RwlockReaderThreadArgs_t * ) pvArgs;
+
+    for( i = 0; ( i < posixtestRWLOCK_STRESS_LOOKUPS ) && ( iResult == 1 ); i++ )
+    {
+        if( pxArgs->pxRwlock != NULL )
+        {
+            iResult = ( intptr_t ) ( pthread_rwlock_rdlock( pxArgs->pxRwlock ) == 0 );
+        }
+        else
+        {
+            iResult = ( intptr_t ) ( pthread_mutex_lock( pxArgs->pxMutex ) == 0 );
+        }
+
+        if( iResult == 1 )
+        {
+            /* Simulate a lookup that blocks, e.g. on flash, while holding the
+             * lock. */
+            vTaskDelay( posixtestRWLOCK_STRESS_LOOKUP_TICKS );
+
+            if( pxArgs->pxRwlock != NULL )
+            {
+                ( void ) pthread_rwlock_unlock( pxArgs->pxRwlock );
+            }
+            else
+            {
+                ( void ) pthread_mutex_unlock( pxArgs->pxMutex );
+            }
+        }
+    }
+
+    return ( void * ) iResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static TickType_t prvRunReaders( RwlockReaderThreadArgs_t * pxArgs,
+                                 int iNumberOfReaders,
+                                 intptr_t * pxThreadReturnStatus )
+{
+    int i = 0;
+    pthread_t xReaderThreads[ posixtestRWLOCK_STRESS_MAX_READERS ] = { ( pthread_t ) NULL };
+    TickType_t xStartTime = xTaskGetTickCount();
+
+    for( i = 0; i < iNumberOfReaders; i++ )
+    {
+        ( void ) pthread_create( &xReaderThreads[ i ], NULL, prvRwlockReaderThread, pxArgs );
+    }
+
+    for( i = 0; i < iNumberOfReaders; i++ )
+    {
+        if( xReaderThreads[ i ] != ( pthread_t ) NULL )
+        {
+            ( void ) pthread_join( xReaderThreads[ i ], ( void ** ) &pxThreadReturnStatus[ i ] );
+        }
+    }
+
+    return xTaskGetTickCount() - xStartTime;
+}
+
+/*-----------------------------------------------------------*/
+
 TEST_GROUP( Full_POSIX_STRESS );
 
 /*-----------------------------------------------------------*/
@@ -324,6 +488,9 @@ TEST_GROUP_RUNNER( Full_POSIX_STRESS )
     RUN_TEST_CASE( Full_POSIX_STRESS, mqueue );
     RUN_TEST_CASE( Full_POSIX_STRESS, pthread_mutex );
     RUN_TEST_CASE( Full_POSIX_STRESS, pthread_barrier_overflow );
+    RUN_TEST_CASE( Full_POSIX_STRESS, pthread_cond_signal_latency );
+    RUN_TEST_CASE( Full_POSIX_STRESS, pthread_cond_broadcast_latency );
+    RUN_TEST_CASE( Full_POSIX_STRESS, pthread_rwlock_reader_scalability );
 }
 
 /*-----------------------------------------------------------*/
@@ -598,3 +765,211 @@ TEST( Full_POSIX_STRESS, pthread_barrier_overflow )
 }
 
 /*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_STRESS, pthread_cond_signal_latency )
+{
+    int i = 0;
+    volatile int iRound = 0, iAcks = 0;
+    pthread_mutex_t xMutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t xCond = PTHREAD_COND_INITIALIZER, xDoneCond = PTHREAD_COND_INITIALIZER;
+    pthread_t xPingPongThread = ( pthread_t ) NULL;
+    intptr_t xThreadReturnStatus = 0;
+    CondLatencyThreadArgs_t xThreadArguments = { 0 };
+    TickType_t xStartTime = 0, xElapsedTime = 0;
+
+    /* Set the thread arguments. */
+    xThreadArguments.pxMutex = &xMutex;
+    xThreadArguments.pxCond = &xCond;
+    xThreadArguments.pxDoneCond = &xDoneCond;
+    xThreadArguments.piRound = &iRound;
+    xThreadArguments.piAcks = &iAcks;
+
+    TEST_ASSERT_EQUAL_INT( 0, pthread_create( &xPingPongThread,
+                                              NULL,
+                                              prvCondPingPongThread,
+                                              &xThreadArguments ) );
+
+    if( TEST_PROTECT() )
+    {
+        xStartTime = xTaskGetTickCount();
+
+        /* Each round trip is one signal to the test thread and one back. */
+        for( i = 1; i <= posixtestCOND_LATENCY_ROUND_TRIPS; i++ )
+        {
+            ( void ) pthread_mutex_lock( &xMutex );
+
+            iRound = i;
+            ( void ) pthread_cond_signal( &xCond );
+
+            while( iAcks < i )
+            {
+                ( void ) pthread_cond_wait( &xDoneCond, &xMutex );
+            }
+
+            ( void ) pthread_mutex_unlock( &xMutex );
+        }
+
+        xElapsedTime = xTaskGetTickCount() - xStartTime;
+
+        configPRINTF( ( "pthread_cond signal: %d round trips in %u ms.\r\n",
+                        posixtestCOND_LATENCY_ROUND_TRIPS,
+                        ( unsigned ) ( xElapsedTime * portTICK_PERIOD_MS ) ) );
+
+        ( void ) pthread_join( xPingPongThread, ( void ** ) &xThreadReturnStatus );
+        xPingPongThread = ( pthread_t ) NULL;
+
+        TEST_ASSERT_EQUAL_INT( posixtestCOND_LATENCY_ROUND_TRIPS, iAcks );
+        TEST_ASSERT_EQUAL_INT( 1, xThreadReturnStatus );
+    }
+
+    /* Release the test thread if an assertion failed before it finished. */
+    if( xPingPongThread != ( pthread_t ) NULL )
+    {
+        ( void ) pthread_mutex_lock( &xMutex );
+        iRound = posixtestCOND_LATENCY_ROUND_TRIPS;
+        ( void ) pthread_cond_signal( &xCond );
+        ( void ) pthread_mutex_unlock( &xMutex );
+        ( void ) pthread_join( xPingPongThread, NULL );
+    }
+
+    ( void ) pthread_cond_destroy( &xDoneCond );
+    ( void ) pthread_cond_destroy( &xCond );
+    ( void ) pthread_mutex_destroy( &xMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_STRESS, pthread_cond_broadcast_latency )
+{
+    int i = 0;
+    volatile int iRound = 0, iAcks = 0;
+    pthread_mutex_t xMutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t xCond = PTHREAD_COND_INITIALIZER, xDoneCond = PTHREAD_COND_INITIALIZER;
+    pthread_t xWaiterThreads[ posixtestCOND_LATENCY_NUMBER_OF_WAITERS ] = { ( pthread_t ) NULL };
+    intptr_t xThreadReturnStatus[ posixtestCOND_LATENCY_NUMBER_OF_WAITERS ] = { 0 };
+    CondLatencyThreadArgs_t xThreadArguments = { 0 };
+    TickType_t xStartTime = 0, xElapsedTime = 0;
+
+    /* Set the thread arguments. */
+    xThreadArguments.pxMutex = &xMutex;
+    xThreadArguments.pxCond = &xCond;
+    xThreadArguments.pxDoneCond = &xDoneCond;
+    xThreadArguments.piRound = &iRound;
+    xThreadArguments.piAcks = &iAcks;
+
+    for( i = 0; i < posixtestCOND_LATENCY_NUMBER_OF_WAITERS; i++ )
+    {
+        ( void ) pthread_create( &xWaiterThreads[ i ],
+                                 NULL,
+                                 prvCondBroadcastThread,
+                                 &xThreadArguments );
+    }
+
+    if( TEST_PROTECT() )
+    {
+        xStartTime = xTaskGetTickCount();
+
+        /* Each round is one broadcast which must wake every test thread. */
+        for( i = 1; i <= posixtestCOND_LATENCY_BROADCAST_ROUNDS; i++ )
+        {
+            ( void ) pthread_mutex_lock( &xMutex );
+
+            iAcks = 0;
+            iRound = i;
+            ( void ) pthread_cond_broadcast( &xCond );
+
+            while( iAcks < posixtestCOND_LATENCY_NUMBER_OF_WAITERS )
+            {
+                ( void ) pthread_cond_wait( &xDoneCond, &xMutex );
+            }
+
+            ( void ) pthread_mutex_unlock( &xMutex );
+        }
+
+        xElapsedTime = xTaskGetTickCount() - xStartTime;
+
+        configPRINTF( ( "pthread_cond broadcast: %d rounds of %d waiters in %u ms.\r\n",
+                        posixtestCOND_LATENCY_BROADCAST_ROUNDS,
+                        posixtestCOND_LATENCY_NUMBER_OF_WAITERS,
+                        ( unsigned ) ( xElapsedTime * portTICK_PERIOD_MS ) ) );
+
+        for( i = 0; i < posixtestCOND_LATENCY_NUMBER_OF_WAITERS; i++ )
+        {
+            ( void ) pthread_join( xWaiterThreads[ i ], ( void ** ) &xThreadReturnStatus[ i ] );
+            xWaiterThreads[ i ] = ( pthread_t ) NULL;
+        }
+
+        for( i = 0; i < posixtestCOND_LATENCY_NUMBER_OF_WAITERS; i++ )
+        {
+            TEST_ASSERT_EQUAL_INT( 1, xThreadReturnStatus[ i ] );
+        }
+    }
+
+    /* Release any test threads left waiting if an assertion failed. */
+    ( void ) pthread_mutex_lock( &xMutex );
+    iRound = posixtestCOND_LATENCY_BROADCAST_ROUNDS;
+    ( void ) pthread_cond_broadcast( &xCond );
+    ( void ) pthread_mutex_unlock( &xMutex );
+
+    for( i = 0; i < posixtestCOND_LATENCY_NUMBER_OF_WAITERS; i++ )
+    {
+        if( xWaiterThreads[ i ] != ( pthread_t ) NULL )
+        {
+            ( void ) pthread_join( xWaiterThreads[ i ], NULL );
+        }
+    }
+
+    ( void ) pthread_cond_destroy( &xDoneCond );
+    ( void ) pthread_cond_destroy( &xCond );
+    ( void ) pthread_mutex_destroy( &xMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_STRESS, pthread_rwlock_reader_scalability )
+{
+    int i = 0, iNumberOfReaders = 0;
+    pthread_rwlock_t xRwlock = PTHREAD_RWLOCK_INITIALIZER;
+    pthread_mutex_t xMutex = PTHREAD_MUTEX_INITIALIZER;
+    intptr_t xThreadReturnStatus[ posixtestRWLOCK_STRESS_MAX_READERS ] = { 0 };
+    RwlockReaderThreadArgs_t xRwlockArguments = { 0 }, xMutexArguments = { 0 };
+    TickType_t xRwlockTime = 0, xMutexTime = 0;
+
+    /* Set the thread arguments. */
+    xRwlockArguments.pxRwlock = &xRwlock;
+    xMutexArguments.pxMutex = &xMutex;
+
+    for( iNumberOfReaders = 1; iNumberOfReaders <= posixtestRWLOCK_STRESS_MAX_READERS; iNumberOfReaders *= 2 )
+    {
+        /* Readers holding a rwlock overlap; readers holding a mutex do not. */
+        ( void ) memset( xThreadReturnStatus, 0x00, sizeof( xThreadReturnStatus ) );
+        xRwlockTime = prvRunReaders( &xRwlockArguments, iNumberOfReaders, xThreadReturnStatus );
+
+        for( i = 0; i < iNumberOfReaders; i++ )
+        {
+            TEST_ASSERT_EQUAL_INT( 1, xThreadReturnStatus[ i ] );
+        }
+
+        ( void ) memset( xThreadReturnStatus, 0x00, sizeof( xThreadReturnStatus ) );
+        xMutexTime = prvRunReaders( &xMutexArguments, iNumberOfReaders, xThreadReturnStatus );
+
+        for( i = 0; i < iNumberOfReaders; i++ )
+        {
+            TEST_ASSERT_EQUAL_INT( 1, xThreadReturnStatus[ i ] );
+        }
+
+        configPRINTF( ( "pthread_rwlock: %d readers x %d lookups in %u ms; pthread_mutex: %u ms.\r\n",
+                        iNumberOfReaders,
+                        posixtestRWLOCK_STRESS_LOOKUPS,
+                        ( unsigned ) ( xRwlockTime * portTICK_PERIOD_MS ),
+                        ( unsigned ) ( xMutexTime * portTICK_PERIOD_MS ) ) );
+    }
+
+    /* With the most readers, the rwlock must beat the mutex. */
+    TEST_ASSERT_LESS_THAN( xMutexTime, xRwlockTime );
+
+    ( void ) pthread_rwlock_destroy( &xRwlock );
+    ( void ) pthread_mutex_destroy( &xMutex );
+}
+
+/*-----------------------------------------------------------*/
@@ -63,6 +63,13 @@ static void * prvTimerCallbackThread( void * pvArg );
  */
 static void * prvTimerCallback( void * pvArg );
 
+/**
+ * @brief Timer notification function that blocks on a semaphore.
+ *
+ * @param[in] xValue sival_ptr points to the sem_t to wait on.
+ */
+static void prvBlockingTimerCallback( union sigval xValue );
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -83,6 +90,11 @@ typedef struct TimerCallbackThreadReturn
  */
 static sem_t xSemaphore = { 0 };
 
+/**
+ * @brief Holds prvBlockingTimerCallback in its notification thread.
+ */
+static sem_t xBlockingSemaphore = { 0 };
+
 /**
  * @brief The default event notification structure.
  */
@@ -136,6 +148,14 @@ static void * prvTimerCallback( void * pvArg )
 
 /*-----------------------------------------------------------*/
 
+static void prvBlockingTimerCallback( union sigval xValue )
+{
+    /* Occupy a notification thread until the test releases it. */
+    ( void ) sem_wait( ( sem_t * ) xValue.sival_ptr );
+}
+
+/*-----------------------------------------------------------*/
+
 TEST_GROUP( Full_POSIX_TIMER );
 
 /*-----------------------------------------------------------*/
@@ -168,6 +188,10 @@ TEST_GROUP_RUNNER( Full_POSIX_TIMER )
     RUN_TEST_CASE( Full_POSIX_TIMER, timer_settime_abstime_in_past );
     RUN_TEST_CASE( Full_POSIX_TIMER, timer_settime_ovalue );
     RUN_TEST_CASE( Full_POSIX_TIMER, timer_periodic );
+
+    #if ( posixconfigTIMER_NOTIFY_THREADS > 1 )
+        RUN_TEST_CASE( Full_POSIX_TIMER, timer_blocked_notification );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -177,6 +201,7 @@ TEST( Full_POSIX_TIMER, timer_create )
     int iStatus = 0;
     timer_t xTimer = NULL;
     struct sigevent xNotificationEvent = xDefaultSigevent;
+    pthread_attr_t xTimerCallbackAttributes;
 
     /* Creation of a timer with NULL sigevent, which implies SIGEV_SIGNAL,
      * should fail. */
@@ -190,6 +215,19 @@ TEST( Full_POSIX_TIMER, timer_create )
     TEST_ASSERT_EQUAL_INT( -1, iStatus );
     TEST_ASSERT_EQUAL_INT( ENOTSUP, errno );
 
+    /* Creation of a timer whose notifications need a larger stack than the
+     * notification threads have should fail. */
+    xNotificationEvent.sigev_notify = SIGEV_THREAD;
+    xNotificationEvent.sigev_notify_attributes = &xTimerCallbackAttributes;
+    iStatus = pthread_attr_init( &xTimerCallbackAttributes );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    iStatus = pthread_attr_setstacksize( &xTimerCallbackAttributes, posixconfigTIMER_NOTIFY_STACK_SIZE + 1 );
+    TEST_ASSERT_EQUAL_INT( 0, iStatus );
+    iStatus = timer_create( CLOCK_REALTIME, &xNotificationEvent, &xTimer );
+    TEST_ASSERT_EQUAL_INT( -1, iStatus );
+    TEST_ASSERT_EQUAL_INT( ENOTSUP, errno );
+    ( void ) pthread_attr_destroy( &xTimerCallbackAttributes );
+
     /* Create a timer with valid parameters. */
     iStatus = timer_create( CLOCK_REALTIME, &xDefaultSigevent, &xTimer );
     TEST_ASSERT_EQUAL_INT( 0, iStatus );
@@ -396,7 +434,8 @@ TEST( Full_POSIX_TIMER, timer_settime_abstime_with_pthread_attr )
     pthread_attr_t xTimerCallbackAttributes;
     volatile BaseType_t xTimerCreated = pdFALSE, xThreadAttributesCreated = pdFALSE;
 
-    /* Set pointer for thread attributes, which should create callback thread  */
+    /* Set pointer for thread attributes. The default attributes fit the timer
+     * notification threads, so the callback runs in one of them. */
     xNotificationEvent.sigev_notify_attributes = &xTimerCallbackAttributes;
 
     /* Set pointer for thread return values. */
@@ -432,8 +471,8 @@ TEST( Full_POSIX_TIMER, timer_settime_abstime_with_pthread_attr )
         /* Wait for the timer callback to release the semaphore. */
         ( void ) sem_wait( &xSemaphore );
 
-        /* Join the timer callback thread. */
-        ( void ) pthread_join( xThreadReturnValues.xTimerCallbackThread, NULL );
+        /* The callback ran in a pthread, which is not joinable. */
+        TEST_ASSERT_NOT_NULL( xThreadReturnValues.xTimerCallbackThread );
 
         /* Check the timer callback thread's return value. */
         TEST_ASSERT_EQUAL_INT( 0, xThreadReturnValues.iStatus );
@@ -680,3 +719,65 @@ TEST( Full_POSIX_TIMER, timer_periodic )
         ( void ) timer_delete( xTimer );
     }
 }
+
+/*-----------------------------------------------------------*/
+
+#if ( posixconfigTIMER_NOTIFY_THREADS > 1 )
+
+    TEST( Full_POSIX_TIMER, timer_blocked_notification )
+    {
+        int iStatus = 0;
+        volatile BaseType_t xBlockingTimerCreated = pdFALSE, xTimerCreated = pdFALSE;
+        timer_t xBlockingTimer = NULL, xTimer = NULL;
+        struct sigevent xBlockingEvent = xDefaultSigevent;
+        struct itimerspec xBlockingTimeout = { { 0 }, { 0 } }, xTimeout = { { 0 }, { 0 } };
+        struct timespec xWaitTimeout = { 0 };
+
+        TEST_ASSERT_EQUAL_INT( 0, sem_init( &xBlockingSemaphore, 0, 0 ) );
+
+        /* The first timer's notification function blocks until released. */
+        xBlockingEvent.sigev_notify_function = prvBlockingTimerCallback;
+        xBlockingEvent.sigev_value.sival_ptr = &xBlockingSemaphore;
+        xBlockingTimeout.it_value.tv_nsec = posixtestSHORT_TIMER_DELAY_NANOSECONDS;
+        xTimeout.it_value.tv_nsec = 2 * posixtestSHORT_TIMER_DELAY_NANOSECONDS;
+
+        if( TEST_PROTECT() )
+        {
+            iStatus = timer_create( CLOCK_REALTIME, &xBlockingEvent, &xBlockingTimer );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            xBlockingTimerCreated = pdTRUE;
+
+            iStatus = timer_create( CLOCK_REALTIME, &xDefaultSigevent, &xTimer );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            xTimerCreated = pdTRUE;
+
+            /* Arm the blocking timer, then the second timer to expire after it. */
+            iStatus = timer_settime( xBlockingTimer, 0, &xBlockingTimeout, NULL );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+            iStatus = timer_settime( xTimer, 0, &xTimeout, NULL );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+            /* The second timer's notification must still run within 1 second. */
+            ( void ) clock_gettime( CLOCK_REALTIME, &xWaitTimeout );
+            xWaitTimeout.tv_sec += 1;
+
+            iStatus = sem_timedwait( &xSemaphore, &xWaitTimeout );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        }
+
+        /* Release the blocked notification thread. */
+        ( void ) sem_post( &xBlockingSemaphore );
+
+        if( xBlockingTimerCreated == pdTRUE )
+        {
+            ( void ) timer_delete( xBlockingTimer );
+        }
+
+        if( xTimerCreated == pdTRUE )
+        {
+            ( void ) timer_delete( xTimer );
+        }
+    }
+
+#endif /* if ( posixconfigTIMER_NOTIFY_THREADS > 1 ) */
@@ -46,6 +46,151 @@
 
 /**@} */
 
+/**
+ * @defgroup TlsHandshakeStatus TLS Handshake Status Codes
+ * @brief Status codes returned by TLS_ConnectStart and TLS_ConnectStep while
+ * the handshake is waiting on the network.
+ */
+/**@{ */
+#define TLS_WANT_READ     ( 1 ) /*!< Step again once the socket is readable. */
+#define TLS_WANT_WRITE    ( 2 ) /*!< Step again once the socket is writable. */
+
+/**@} */
+
+/**
+ * @brief Number of TLS sessions kept in RAM for resumption, one per
+ * destination (server name) and connection settings. Zero disables session
+ * resumption.
+ *
+ * When enabled, TLS_Connect offers the session of the last successful
+ * connection to the same destination, by session ID or session ticket. A
+ * resumed handshake skips certificate chain verification, key exchange and
+ * the client signature. So a session is only offered if the connection has
+ * the same server certificate to trust, ALPN list and client certificate as
+ * the one that negotiated it.
+ */
+#ifndef tlsconfigSESSION_CACHE_ENTRIES
+    #define tlsconfigSESSION_CACHE_ENTRIES    ( 0 )
+#endif
+
+/**
+ * @brief Size of the buffer passed to the #TLSSessionLoad_t callback. Larger
+ * persisted sessions are not resumed. Persisted sessions include a 32 byte
+ * digest of the connection settings.
+ */
+#ifndef tlsconfigSESSION_MAX_LENGTH
+    #define tlsconfigSESSION_MAX_LENGTH    ( 2048 )
+#endif
+
+/**
+ * @brief Size of the buffer of PKCS #11 random bytes used to seed the DRBG of
+ * every TLS context. Zero disables the pool.
+ *
+ * When enabled, entropy requests are served from RAM and the pool is refilled
+ * with one C_GenerateRandom call once it drops below
+ * tlsconfigENTROPY_POOL_LOW_WATER bytes. This avoids a token round trip, e.g.
+ * over I2C to a secure element, for every small request.
+ *
+ * The first TLS_Init fills the pool and creates a task which does the refills
+ * through its own PKCS #11 session, so requests do not wait on the token. If
+ * the task cannot be created, the task that drained the pool refills it.
+ * Requests made before the first TLS_Init, and the part of a request that the
+ * pool cannot serve, are generated directly.
+ */
+#ifndef tlsconfigENTROPY_POOL_SIZE
+    #define tlsconfigENTROPY_POOL_SIZE    ( 0 )
+#endif
+
+/**
+ * @brief Priority of the task refilling the entropy pool.
+ */
+#ifndef tlsconfigENTROPY_REFILL_TASK_PRIORITY
+    #define tlsconfigENTROPY_REFILL_TASK_PRIORITY    ( tskIDLE_PRIORITY )
+#endif
+
+/**
+ * @brief Stack size, in words, of the task refilling the entropy pool. It
+ * opens its PKCS #11 session, so it needs the stack of C_OpenSession and
+ * C_GenerateRandom of the port.
+ */
+#ifndef tlsconfigENTROPY_REFILL_TASK_STACK_SIZE
+    #define tlsconfigENTROPY_REFILL_TASK_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+/**
+ * @brief Fill level of the entropy pool below which a refill is started.
+ */
+#ifndef tlsconfigENTROPY_POOL_LOW_WATER
+    #define tlsconfigENTROPY_POOL_LOW_WATER    ( tlsconfigENTROPY_POOL_SIZE / 2 )
+#endif
+
+/**
+ * @brief Largest write-combining buffer allocated per TLS context. The buffer
+ * holds one record, of the negotiated maximum fragment length, up to this size.
+ */
+#ifndef tlsconfigWRITE_COMBINE_MAX_LENGTH
+    #define tlsconfigWRITE_COMBINE_MAX_LENGTH    ( 4096 )
+#endif
+
+/**
+ * @brief Value of TLSParams_t::ulWriteCombineMaxAgeMs to combine writes
+ * until TLS_Recv or TLS_Flush.
+ */
+#define tlsWRITE_COMBINE_NO_MAX_AGE    ( 0xFFFFFFFFUL )
+
+/**
+ * @brief Handshake counters and timings of all TLS connections.
+ * @param[out] ulFullHandshakes Number of successful full handshakes.
+ * @param[out] ulResumedHandshakes Number of successful resumed handshakes.
+ * @param[out] ulFullHandshakeTimeMs Total duration of the full handshakes.
+ * @param[out] ulResumedHandshakeTimeMs Total duration of the resumed handshakes.
+ * @param[out] ulLastHandshakeTimeMs Duration of the last successful handshake.
+ */
+typedef struct xTLS_HANDSHAKE_STATS
+{
+    uint32_t ulFullHandshakes;
+    uint32_t ulResumedHandshakes;
+    uint32_t ulFullHandshakeTimeMs;
+    uint32_t ulResumedHandshakeTimeMs;
+    uint32_t ulLastHandshakeTimeMs;
+} TLSHandshakeStats_t;
+
+/**
+ * @brief Application data counters of a TLS connection.
+ * @param[out] ulRecordsSent Number of records sent by TLS_Send and TLS_Flush.
+ * @param[out] ulRecordsReceived Number of records read by TLS_Recv.
+ */
+typedef struct xTLS_CONNECTION_STATS
+{
+    uint32_t ulRecordsSent;
+    uint32_t ulRecordsReceived;
+} TLSConnectionStats_t;
+
+/**
+ * @brief Defines callback type for persisting a TLS session, e.g. to flash,
+ * so that it can be resumed after a reset.
+ * @param[in] pcDestination Server name the session was established with.
+ * @param[in] pucSession Serialized session, with a digest of the connection
+ * settings. It contains the session keys and must be stored securely.
+ * @param[in] xSessionLength Length of previous parameter in bytes.
+ */
+typedef void ( * TLSSessionStore_t )( const char * pcDestination,
+                                      const unsigned char * pucSession,
+                                      size_t xSessionLength );
+
+/**
+ * @brief Defines callback type for loading a persisted TLS session.
+ * @param[in] pcDestination Server name to load the session of.
+ * @param[out] pucBuffer Buffer to copy the serialized session into, as it was
+ * passed to #TLSSessionStore_t. It is not resumed if the connection settings
+ * differ.
+ * @param[in] xBufferLength Length of previous parameter in bytes.
+ * @return Length of the session, or zero if there is none that fits.
+ */
+typedef size_t ( * TLSSessionLoad_t )( const char * pcDestination,
+                                       unsigned char * pucBuffer,
+                                       size_t xBufferLength );
+
 /**
  * @brief Defines callback type for receiving bytes from the network.
  *
@@ -84,6 +229,15 @@ typedef BaseType_t ( * NetworkSend_t )( void * pvCallerContext,
  * @param[in] pxNetworkSend Caller-defined network send function pointer.
  * @param[in] pvCallerContext Caller-defined context handle to be used with callback
  * functions.
+ * @param[in] ulWriteCombineMaxAgeMs Zero to encrypt every TLS_Send call into
+ * its own records. Otherwise small writes are combined into full records, and
+ * are sent by TLS_Recv, by TLS_Flush, or once the oldest of them is this many
+ * milliseconds old. With configUSE_TIMERS and INCLUDE_xTimerPendFunctionCall
+ * set to 1, a software timer sends aged data from the timer service task, so
+ * pxNetworkSend should not block for long. It does not wait for a task using
+ * the context, and an error is returned by the next call. Without timers, aged
+ * data is sent by the next TLS_Send. Use tlsWRITE_COMBINE_NO_MAX_AGE to only
+ * flush from TLS_Recv and TLS_Flush.
  */
 typedef struct xTLS_PARAMS
 {
@@ -97,6 +251,8 @@ typedef struct xTLS_PARAMS
     NetworkRecv_t pxNetworkRecv;
     NetworkSend_t pxNetworkSend;
     void * pvCallerContext;
+
+    uint32_t ulWriteCombineMaxAgeMs;
 } TLSParams_t;
 
 /**
@@ -119,6 +275,36 @@ BaseType_t TLS_Init( void ** ppvContext,
  */
 BaseType_t TLS_Connect( void * pvContext );
 
+/**
+ * @brief Starts a TLS handshake which does not block on the network.
+ *
+ * The handshake proceeds as far as the network allows. When it has to wait,
+ * TLS_WANT_READ or TLS_WANT_WRITE is returned and TLS_ConnectStep must be
+ * called once the socket is ready. This lets one task drive the handshakes
+ * of several connections, e.g. from a select loop.
+ *
+ * The network callbacks of TLSParams_t must not block; returning zero or
+ * -pdFREERTOS_ERRNO_EWOULDBLOCK means that no data or no buffer space is
+ * available yet. Sends may also return -pdFREERTOS_ERRNO_ENOSPC.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ *
+ * @return Zero if the handshake completed, TLS_WANT_READ or TLS_WANT_WRITE
+ * if it is waiting on the network. Error return codes have the high bit set.
+ */
+BaseType_t TLS_ConnectStart( void * pvContext );
+
+/**
+ * @brief Resumes a handshake started by TLS_ConnectStart.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ *
+ * @return Zero if the handshake completed, TLS_WANT_READ or TLS_WANT_WRITE
+ * if it is waiting on the network. Error return codes have the high bit set,
+ * and the handshake must then be started again.
+ */
+BaseType_t TLS_ConnectStep( void * pvContext );
+
 /**
  * @brief Reads the requested number of bytes from the secure connection
  *
@@ -133,6 +319,35 @@ BaseType_t TLS_Recv( void * pvContext,
                      unsigned char * pucReadBuffer,
                      size_t xReadLength );
 
+/**
+ * @brief Exposes decrypted data of the secure connection in place, without
+ * copying it into a caller buffer.
+ *
+ * Reads and decrypts the next record if none is buffered. The data stays
+ * valid until TLS_RecvConsume, TLS_Recv, or TLS_Cleanup is called; another
+ * call returns the same data until it is consumed.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ * @param ppucData Set to the decrypted data.
+ *
+ * @return Number of bytes at *ppucData, at most one record. Zero if no data
+ * was received. Error return codes have the high bit set.
+ */
+BaseType_t TLS_RecvPeek( void * pvContext,
+                         const unsigned char ** ppucData );
+
+/**
+ * @brief Releases data exposed by TLS_RecvPeek.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ * @param xLength Number of bytes the caller is done with, from the start of
+ * the data. Larger values are limited to the data available.
+ *
+ * @return Number of bytes released. Error return codes have the high bit set.
+ */
+BaseType_t TLS_RecvConsume( void * pvContext,
+                            size_t xLength );
+
 /**
  * @brief Writes the requested number of bytes to the secure connection.
  *
@@ -140,12 +355,25 @@ BaseType_t TLS_Recv( void * pvContext,
  * @param pucMsg Byte array of data to be encrypted and then sent to the network.
  * @param xMsgLength Length in bytes of write buffer.
  *
+ * @note With write combining, the bytes are counted as sent once buffered.
+ *
  * @return Number of bytes read. Error return codes have the high bit set.
  */
 BaseType_t TLS_Send( void * pvContext,
                      const unsigned char * pucMsg,
                      size_t xMsgLength );
 
+/**
+ * @brief Encrypts and sends the writes combined so far, see
+ * TLSParams_t::ulWriteCombineMaxAgeMs.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ *
+ * @return Zero if nothing is left to send. A positive number of bytes still
+ * buffered if the network would block. Error return codes have the high bit set.
+ */
+BaseType_t TLS_Flush( void * pvContext );
+
 /**
  * @brief Frees resources consumed by the TLS context.
  *
@@ -175,4 +403,57 @@ typedef BaseType_t (* DateIsInThePast_t)( BaseType_t day,
  */
 void TLS_setDateIsInThePastFunction( DateIsInThePast_t dateIsInThePast );
 
+/**
+ * @brief Get the handshake counters and timings of all TLS connections, e.g.
+ * to measure the savings of session resumption.
+ * @param[out] pxStats Snapshot of the counters.
+ */
+void TLS_GetHandshakeStats( TLSHandshakeStats_t * pxStats );
+
+/**
+ * @brief Get the application data counters of a TLS connection.
+ * @param[in] pvContext Opaque context handle for TLS library.
+ * @param[out] pxStats Snapshot of the counters, zero if pvContext is NULL.
+ */
+void TLS_GetConnectionStats( void * pvContext,
+                             TLSConnectionStats_t * pxStats );
+
+/**
+ * @brief Set the callbacks used to persist TLS sessions across resets.
+ *
+ * Sessions are stored after every full handshake, and loaded when there is
+ * no session for the destination in RAM. Has no effect unless
+ * tlsconfigSESSION_CACHE_ENTRIES is non-zero.
+ * @param[in] xStore Callback to persist a session, or NULL.
+ * @param[in] xLoad Callback to load a persisted session, or NULL.
+ */
+void TLS_setSessionPersistenceFunctions( TLSSessionStore_t xStore,
+                                         TLSSessionLoad_t xLoad );
+
+/**
+ * @brief Forget every cached TLS session, e.g. after the client credentials
+ * were changed. Persisted sessions must be erased by the application.
+ */
+void TLS_FlushSessionCache( void );
+
+/**
+ * @brief Make new TLS contexts read the client credentials and the default
+ * root certificates from the token again, e.g. after provisioning new ones.
+ *
+ * The PKCS #11 session, private key handle and parsed certificates are shared
+ * by all open TLS contexts. Contexts opened before the flush keep using the
+ * previous credentials until they are cleaned up.
+ */
+void TLS_FlushCredentialCache( void );
+
+/**
+ * @brief Get random bytes from the PKCS #11 token, through the entropy pool
+ * if tlsconfigENTROPY_POOL_SIZE is non-zero. Each byte is handed out once.
+ * @param[out] pucOutput Buffer for the random bytes.
+ * @param[in] xLength Number of bytes to generate.
+ * @return pdPASS on success, pdFAIL if the token failed.
+ */
+BaseType_t TLS_GetEntropy( unsigned char * pucOutput,
+                           size_t xLength );
+
 #endif /* ifndef __AWS__TLS__H__ */
@@ -31,6 +31,8 @@
 #include "core_pkcs11_config.h"
 #include "core_pkcs11.h"
 #include "task.h"
+#include "semphr.h"
+#include "timers.h"
 #include "aws_clientcredential_keys.h"
 #include "iot_default_root_certificates.h"
 #include "core_pki_utils.h"
@@ -44,11 +46,24 @@
 #include "mbedtls/pk.h"
 #include "mbedtls/pk_internal.h"
 #include "mbedtls/debug.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/version.h"
 
 #ifdef MBEDTLS_DEBUG_C
     #define tlsDEBUG_VERBOSE    4
 #endif
 
+/* TLS_RecvPeek exposes the decrypted record in place, through a field of the
+ * SSL context that mbedTLS 3 made private. */
+#if ( MBEDTLS_VERSION_NUMBER >= 0x03000000 )
+    #error "TLS_RecvPeek requires mbedTLS 2."
+#endif
+
+/**
+ * @brief Size of the stack buffer TLS_RecvConsume reads consumed data into.
+ */
+#define tlsRECV_CONSUME_CHUNK_LENGTH    ( 64 )
+
 /* Custom mbedtls utls include. */
 #include "mbedtls_error.h"
 
@@ -86,6 +101,64 @@ static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
     ( mbedtls_strerror_lowlevel( mbedTlsCode ) != NULL ) ? \
     mbedtls_strerror_lowlevel( mbedTlsCode ) : pNoLowLevelMbedTlsCodeStr
 
+/**
+ * @brief Whether a software timer flushes combined writes once they reach
+ * their maximum age. Without it they are flushed by the next call on the
+ * context.
+ */
+#if ( ( configUSE_TIMERS == 1 ) && ( INCLUDE_xTimerPendFunctionCall == 1 ) )
+    #define tlsWRITE_DEADLINE_TIMER    1
+#else
+    #define tlsWRITE_DEADLINE_TIMER    0
+#endif
+
+
+/**
+ * @brief PKCS #11 session and parsed credentials shared by all TLS contexts.
+ *
+ * The first context to need an item loads it from the token, later contexts
+ * reuse it. The object is freed when its last context is cleaned up.
+ *
+ * @param[in] ulReferences Number of TLS contexts using the object.
+ * @param[in] pxP11FunctionList PKCS#11 function list structure.
+ * @param[in] xP11Session PKCS#11 session shared by the contexts.
+ * @param[in] xP11PrivateKey Handle of the device private key.
+ * @param[in] xKeyType Type of the device private key.
+ * @param[in] xClientLoaded Whether the private key and xMbedX509Cli are loaded.
+ * @param[in] xMbedX509Cli Client certificate chain.
+ * @param[in] xRootLoaded Whether xMbedX509CA is loaded.
+ * @param[in] xMbedX509CA Default server root certificates.
+ */
+typedef struct TLSCredentials
+{
+    uint32_t ulReferences;
+    CK_FUNCTION_LIST_PTR pxP11FunctionList;
+    CK_SESSION_HANDLE xP11Session;
+    CK_OBJECT_HANDLE xP11PrivateKey;
+    CK_KEY_TYPE xKeyType;
+    BaseType_t xClientLoaded;
+    mbedtls_x509_crt xMbedX509Cli;
+    BaseType_t xRootLoaded;
+    mbedtls_x509_crt xMbedX509CA;
+} TLSCredentials_t;
+
+/**
+ * @brief Deadline of the writes combined by a TLS context. It is freed by the
+ * timer service task once the timer is deleted, as the callback may still be
+ * running when the context is cleaned up.
+ *
+ * @param[in] xTimer One-shot timer, started when the write buffer stops being
+ * empty, that flushes it.
+ * @param[in] xLock Guards the write buffer of the context, and the writes to
+ * its mbedTLS context.
+ * @param[in] pxCtx The TLS context, or NULL once it is cleaned up.
+ */
+typedef struct TLSWriteDeadline
+{
+    TimerHandle_t xTimer;
+    SemaphoreHandle_t xLock;
+    struct TLSContext * pxCtx;
+} TLSWriteDeadline_t;
 
 /**
  * @brief Internal context structure.
@@ -99,12 +172,31 @@ static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
  * @param[out] xTLSHandshakeState Indicates the state of the TLS handshake.
  * @param[out] xMbedSslCtx Connection context for mbedTLS.
  * @param[out] xMbedSslConfig Configuration context for mbedTLS.
- * @param[out] xMbedX509CA Server certificate context for mbedTLS.
- * @param[out] xMbedX509Cli Client certificate context for mbedTLS.
+ * @param[out] xMbedX509CA Custom server certificate context for mbedTLS.
  * @param[out] mbedPkAltCtx RSA crypto implementation context for mbedTLS.
- * @param[out] pxP11FunctionList PKCS#11 function list structure.
- * @param[out] xP11Session PKCS#11 session context.
- * @param[out] xP11PrivateKey PKCS#11 private key context.
+ * @param[out] pxCredentials Shared PKCS#11 session, private key and
+ * certificates, see #TLSCredentials_t.
+ * @param[out] ucSessionDigest Digest of the settings the session is cached
+ * under, see prvSessionCacheDigest.
+ * @param[out] xSessionOffered Whether a cached session was offered to the server.
+ * @param[out] xCertificateVerified Whether the server sent its certificate,
+ * i.e. the handshake was not resumed.
+ * @param[in] xWriteMaxAgeTicks Age of buffered writes at which they are
+ * flushed, or zero to disable write combining.
+ * @param[out] pucWriteBuffer Write-combining buffer of one record.
+ * @param[out] xWriteBufferSize Size of pucWriteBuffer.
+ * @param[out] xWriteBufferLength Number of bytes waiting in pucWriteBuffer.
+ * @param[out] xWriteBufferStart Tick count when the oldest byte was buffered.
+ * @param[out] pxWriteDeadline Timer flushing the buffer, or NULL without one.
+ * @param[out] xWriteDeadlineResult Error of the last flush by the timer, which
+ * is returned by the next call on the context.
+ * @param[out] xReading Whether a task is reading, in which case the timer does
+ * not use the mbedTLS context.
+ * @param[out] xHandshakeStepping Whether a handshake started by TLS_ConnectStart
+ * is in progress.
+ * @param[out] xHandshakeStart Tick count when the handshake started.
+ * @param[out] xPKCSResult Result of loading the client credentials.
+ * @param[out] xStats Application data counters of the connection.
  */
 typedef struct TLSContext
 {
@@ -123,16 +215,35 @@ typedef struct TLSContext
     mbedtls_ssl_context xMbedSslCtx;
     mbedtls_ssl_config xMbedSslConfig;
     mbedtls_x509_crt xMbedX509CA;
-    mbedtls_x509_crt xMbedX509Cli;
     mbedtls_pk_context xMbedPkCtx;
     mbedtls_pk_info_t xMbedPkInfo;
     mbedtls_ctr_drbg_context xMbedDrbgCtx;
 
     /* PKCS#11. */
-    CK_FUNCTION_LIST_PTR pxP11FunctionList;
-    CK_SESSION_HANDLE xP11Session;
-    CK_OBJECT_HANDLE xP11PrivateKey;
-    CK_KEY_TYPE xKeyType;
+    TLSCredentials_t * pxCredentials;
+
+    /* Session resumption. */
+    unsigned char ucSessionDigest[ cryptoSHA256_DIGEST_BYTES ];
+    BaseType_t xSessionOffered;
+    BaseType_t xCertificateVerified;
+
+    /* Write combining. */
+    TickType_t xWriteMaxAgeTicks;
+    unsigned char * pucWriteBuffer;
+    size_t xWriteBufferSize;
+    size_t xWriteBufferLength;
+    TickType_t xWriteBufferStart;
+    TLSWriteDeadline_t * pxWriteDeadline;
+    BaseType_t xWriteDeadlineResult;
+    BaseType_t xReading;
+
+    /* Handshake. */
+    BaseType_t xHandshakeStepping;
+    TickType_t xHandshakeStart;
+    CK_RV xPKCSResult;
+
+    /* Statistics. */
+    TLSConnectionStats_t xStats;
 } TLSContext_t;
 
 #define TLS_HANDSHAKE_NOT_STARTED    ( 0 )      /* Must be 0 */
@@ -146,6 +257,103 @@ static BaseType_t prvDefault_DateIsInThePast( BaseType_t day,
                                               BaseType_t year );
 static DateIsInThePast_t pDateIsInThePast = prvDefault_DateIsInThePast;
 
+/**
+ * @brief Handshake counters of all connections, guarded by suspending the
+ * scheduler.
+ */
+static TLSHandshakeStats_t xHandshakeStats = { 0 };
+
+#if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief A cached TLS session.
+ *
+ * @param[in] pcDestination Heap copy of the server name, or NULL if unused.
+ * @param[in] pucSession Digest of the connection settings, followed by the
+ * session serialized with mbedtls_ssl_session_save. This is also the format
+ * handed to the persistence callbacks.
+ * @param[in] xSessionLength Length of pucSession.
+ * @param[in] ulLastUsed Value of ulSessionCacheClock when last used.
+ */
+    typedef struct TLSSessionCacheEntry
+    {
+        char * pcDestination;
+        unsigned char * pucSession;
+        size_t xSessionLength;
+        uint32_t ulLastUsed;
+    } TLSSessionCacheEntry_t;
+
+/**
+ * @brief Session cache, guarded by suspending the scheduler. Entries are
+ * replaced least recently used first.
+ */
+    static TLSSessionCacheEntry_t xSessionCache[ tlsconfigSESSION_CACHE_ENTRIES ];
+    static uint32_t ulSessionCacheClock = 0;
+
+    static TLSSessionStore_t xSessionStore = NULL;
+    static TLSSessionLoad_t xSessionLoad = NULL;
+#endif /* if ( tlsconfigSESSION_CACHE_ENTRIES > 0 ) */
+
+/**
+ * @brief Serializes use of xEntropySession.
+ */
+static SemaphoreHandle_t xEntropyLock = NULL;
+
+/**
+ * @brief PKCS #11 session used by TLS_GetEntropy for what the pool cannot
+ * serve, guarded by xEntropyLock.
+ */
+static CK_SESSION_HANDLE xEntropySession = CK_INVALID_HANDLE;
+
+/**
+ * @brief Number of TLS contexts, guarded by suspending the scheduler. The
+ * entropy sessions are closed when the last context is cleaned up.
+ */
+static uint32_t ulEntropyUsers = 0;
+
+#if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+
+/**
+ * @brief Random bytes not handed out yet, at the start of ucEntropyPool. The
+ * length is guarded by suspending the scheduler. Bytes are taken from the end
+ * and zeroized, so a refill in progress owns the bytes past the length it
+ * found when it started.
+ */
+    static unsigned char ucEntropyPool[ tlsconfigENTROPY_POOL_SIZE ];
+    static size_t xEntropyPoolLength = 0;
+    static BaseType_t xEntropyRefillPending = pdFALSE;
+
+/**
+ * @brief Serializes refills of the pool and use of xEntropyRefillSession.
+ * Readers of the pool never take it, so they do not wait on the token.
+ */
+    static SemaphoreHandle_t xEntropyRefillLock = NULL;
+
+/**
+ * @brief PKCS #11 session used to refill the pool, guarded by
+ * xEntropyRefillLock.
+ */
+    static CK_SESSION_HANDLE xEntropyRefillSession = CK_INVALID_HANDLE;
+
+/**
+ * @brief Whether the pool was started by TLS_Init, and the task refilling it,
+ * or NULL if the task could not be created.
+ */
+    static BaseType_t xEntropyPoolStarted = pdFALSE;
+    static TaskHandle_t xEntropyRefillTask = NULL;
+#endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
+
+/**
+ * @brief Guards pxCredentialCache, the reference counts and lazy loading of
+ * #TLSCredentials_t, and operations on the shared PKCS #11 session.
+ */
+static SemaphoreHandle_t xCredentialLock = NULL;
+
+/**
+ * @brief Credentials handed to new TLS contexts, or NULL if there are none.
+ */
+static TLSCredentials_t * pxCredentialCache = NULL;
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -153,7 +361,179 @@ static DateIsInThePast_t pDateIsInThePast = prvDefault_DateIsInThePast;
  */
 
 /**
- * @brief TLS internal context rundown helper routine.
+ * @brief Create a mutex on first use. Racing callers create it once.
+ *
+ * @param[in,out] pxLock The mutex handle, NULL until created.
+ *
+ * @return pdPASS if the mutex exists, pdFAIL if it could not be created.
+ */
+static BaseType_t prvCreateLockOnce( SemaphoreHandle_t * pxLock )
+{
+    if( *pxLock == NULL )
+    {
+        vTaskSuspendAll();
+        {
+            if( *pxLock == NULL )
+            {
+                *pxLock = xSemaphoreCreateMutex();
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+    return ( *pxLock != NULL ) ? pdPASS : pdFAIL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get a reference to the shared credentials, opening the shared
+ * PKCS #11 session if there are none yet.
+ *
+ * @param[out] ppxCredentials The shared credentials.
+ *
+ * @return CKR_OK on success, otherwise the PKCS #11 error.
+ */
+static CK_RV prvCredentialsAcquire( TLSCredentials_t ** ppxCredentials )
+{
+    CK_RV xResult = CKR_OK;
+    CK_C_GetFunctionList xCkGetFunctionList = NULL;
+    TLSCredentials_t * pxCredentials = NULL;
+
+    if( prvCreateLockOnce( &xCredentialLock ) != pdPASS )
+    {
+        xResult = CKR_HOST_MEMORY;
+    }
+    else
+    {
+        ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+
+        if( NULL == pxCredentialCache )
+        {
+            pxCredentials = ( TLSCredentials_t * ) pvPortMalloc( sizeof( TLSCredentials_t ) ); /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+            if( NULL == pxCredentials )
+            {
+                xResult = CKR_HOST_MEMORY;
+            }
+            else
+            {
+                memset( pxCredentials, 0, sizeof( TLSCredentials_t ) );
+                mbedtls_x509_crt_init( &pxCredentials->xMbedX509Cli );
+                mbedtls_x509_crt_init( &pxCredentials->xMbedX509CA );
+
+                /* Get the function pointer list for the PKCS#11 module. */
+                xCkGetFunctionList = C_GetFunctionList;
+                xResult = xCkGetFunctionList( &pxCredentials->pxP11FunctionList );
+            }
+
+            /* Ensure that the PKCS #11 module is initialized and create a session. */
+            if( xResult == CKR_OK )
+            {
+                xResult = xInitializePkcs11Session( &pxCredentials->xP11Session );
+
+                /* It is ok if the module was previously initialized. */
+                if( ( xResult == CKR_CRYPTOKI_ALREADY_INITIALIZED ) || ( CKR_USER_ALREADY_LOGGED_IN == xResult ) )
+                {
+                    xResult = CKR_OK;
+                }
+            }
+
+            if( xResult == CKR_OK )
+            {
+                pxCredentialCache = pxCredentials;
+            }
+            else if( NULL != pxCredentials )
+            {
+                vPortFree( pxCredentials );
+            }
+        }
+
+        if( xResult == CKR_OK )
+        {
+            pxCredentialCache->ulReferences++;
+            *ppxCredentials = pxCredentialCache;
+        }
+
+        ( void ) xSemaphoreGive( xCredentialLock );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drop a reference to shared credentials, freeing them and closing
+ * their session with the last reference.
+ *
+ * @param[in] pxCredentials Credentials from prvCredentialsAcquire.
+ */
+static void prvCredentialsRelease( TLSCredentials_t * pxCredentials )
+{
+    ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+
+    pxCredentials->ulReferences--;
+
+    if( 0U == pxCredentials->ulReferences )
+    {
+        if( pxCredentialCache == pxCredentials )
+        {
+            pxCredentialCache = NULL;
+        }
+
+        mbedtls_x509_crt_free( &pxCredentials->xMbedX509Cli );
+        mbedtls_x509_crt_free( &pxCredentials->xMbedX509CA );
+
+        if( ( NULL != pxCredentials->pxP11FunctionList ) &&
+            ( NULL != pxCredentials->pxP11FunctionList->C_CloseSession ) &&
+            ( CK_INVALID_HANDLE != pxCredentials->xP11Session ) )
+        {
+            pxCredentials->pxP11FunctionList->C_CloseSession( pxCredentials->xP11Session ); /*lint !e534 This function always return CKR_OK. */
+        }
+
+        vPortFree( pxCredentials );
+    }
+
+    ( void ) xSemaphoreGive( xCredentialLock );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take the lock shared with the write deadline timer, if the context
+ * has one.
+ *
+ * @param[in] pxCtx The TLS context.
+ */
+static void prvWriteLock( TLSContext_t * pxCtx )
+{
+    if( NULL != pxCtx->pxWriteDeadline )
+    {
+        ( void ) xSemaphoreTake( pxCtx->pxWriteDeadline->xLock, portMAX_DELAY );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Give the lock taken by prvWriteLock.
+ *
+ * @param[in] pxCtx The TLS context.
+ */
+static void prvWriteUnlock( TLSContext_t * pxCtx )
+{
+    if( NULL != pxCtx->pxWriteDeadline )
+    {
+        ( void ) xSemaphoreGive( pxCtx->pxWriteDeadline->xLock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief TLS internal context rundown helper routine. Must not be called with
+ * the write lock held.
  *
  * @param[in] pvContext Caller context.
  */
@@ -161,22 +541,27 @@ static void prvFreeContext( TLSContext_t * pxCtx )
 {
     if( NULL != pxCtx )
     {
+        /* The write deadline timer may be flushing. */
+        prvWriteLock( pxCtx );
+
         /* Cleanup mbedTLS. */
         mbedtls_ssl_close_notify( &pxCtx->xMbedSslCtx ); /*lint !e534 The error is already taken care of inside mbedtls_ssl_close_notify*/
         mbedtls_ssl_free( &pxCtx->xMbedSslCtx );
         mbedtls_ssl_config_free( &pxCtx->xMbedSslConfig );
         mbedtls_ctr_drbg_free( &pxCtx->xMbedDrbgCtx );
 
-        /* Cleanup PKCS11 only if the handshake was started. */
-        if( ( TLS_HANDSHAKE_NOT_STARTED != pxCtx->xTLSHandshakeState ) &&
-            ( NULL != pxCtx->pxP11FunctionList ) &&
-            ( NULL != pxCtx->pxP11FunctionList->C_CloseSession ) &&
-            ( CK_INVALID_HANDLE != pxCtx->xP11Session ) )
+        /* Data still buffered is lost with the connection. */
+        if( NULL != pxCtx->pucWriteBuffer )
         {
-            pxCtx->pxP11FunctionList->C_CloseSession( pxCtx->xP11Session ); /*lint !e534 This function always return CKR_OK. */
+            vPortFree( pxCtx->pucWriteBuffer );
+            pxCtx->pucWriteBuffer = NULL;
+            pxCtx->xWriteBufferLength = 0;
         }
 
+        pxCtx->xWriteDeadlineResult = 0;
         pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_NOT_STARTED;
+
+        prvWriteUnlock( pxCtx );
     }
 }
 
@@ -203,8 +588,18 @@ static int prvNetworkSend( void * pvContext,
                            size_t xDataLength )
 {
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    int lResult = ( int ) pxCtx->xNetworkSend( pxCtx->pvCallerContext, pucData, xDataLength );
+
+    /* A stepped handshake returns to the caller instead of retrying. */
+    if( ( pdTRUE == pxCtx->xHandshakeStepping ) &&
+        ( ( 0 == lResult ) ||
+          ( -pdFREERTOS_ERRNO_EWOULDBLOCK == lResult ) ||
+          ( -pdFREERTOS_ERRNO_ENOSPC == lResult ) ) )
+    {
+        lResult = MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
 
-    return ( int ) pxCtx->xNetworkSend( pxCtx->pvCallerContext, pucData, xDataLength );
+    return lResult;
 }
 
 /*-----------------------------------------------------------*/
@@ -223,8 +618,17 @@ static int prvNetworkRecv( void * pvContext,
                            size_t xReceiveLength )
 {
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    int lResult = ( int ) pxCtx->xNetworkRecv( pxCtx->pvCallerContext, pucReceiveBuffer, xReceiveLength );
+
+    /* A stepped handshake returns to the caller instead of retrying.
+     * pdFREERTOS_ERRNO_EAGAIN has the same value as EWOULDBLOCK. */
+    if( ( pdTRUE == pxCtx->xHandshakeStepping ) &&
+        ( ( 0 == lResult ) || ( -pdFREERTOS_ERRNO_EWOULDBLOCK == lResult ) ) )
+    {
+        lResult = MBEDTLS_ERR_SSL_WANT_READ;
+    }
 
-    return ( int ) pxCtx->xNetworkRecv( pxCtx->pvCallerContext, pucReceiveBuffer, xReceiveLength );
+    return lResult;
 }
 
 /*-----------------------------------------------------------*/
@@ -276,10 +680,14 @@ static int prvCheckCertificate( void * pvContext,
                                 int lPathCount,
                                 uint32_t * pulFlags )
 {
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
     /* Unreferenced parameters. */
-    ( void ) ( pvContext );
     ( void ) ( lPathCount );
 
+    /* Only a full handshake carries the server certificate. */
+    pxCtx->xCertificateVerified = pdTRUE;
+
     BaseType_t day = pxCertificate->valid_to.day;
     BaseType_t month = pxCertificate->valid_to.mon;
     BaseType_t year = pxCertificate->valid_to.year;
@@ -322,6 +730,7 @@ static int prvPrivateKeySigningCallback( void * pvContext,
     CK_RV xResult = CKR_OK;
     int lFinalResult = 0;
     TLSContext_t * pxTLSContext = ( TLSContext_t * ) pvContext;
+    TLSCredentials_t * pxCredentials = pxTLSContext->pxCredentials;
     CK_MECHANISM xMech = { 0 };
     CK_BYTE xToBeSigned[ 256 ];
     CK_ULONG xToBeSignedLen = sizeof( xToBeSigned );
@@ -338,7 +747,7 @@ static int prvPrivateKeySigningCallback( void * pvContext,
     }
 
     /* Format the hash data to be signed. */
-    if( CKK_RSA == pxTLSContext->xKeyType )
+    if( CKK_RSA == pxCredentials->xKeyType )
     {
         xMech.mechanism = CKM_RSA_PKCS;
 
@@ -349,7 +758,7 @@ static int prvPrivateKeySigningCallback( void * pvContext,
         xResult = vAppendSHA256AlgorithmIdentifierSequence( ( uint8_t * ) pucHash, xToBeSigned );
         xToBeSignedLen = pkcs11RSA_SIGNATURE_INPUT_LENGTH;
     }
-    else if( CKK_EC == pxTLSContext->xKeyType )
+    else if( CKK_EC == pxCredentials->xKeyType )
     {
         xMech.mechanism = CKM_ECDSA;
         memcpy( xToBeSigned, pucHash, xHashLen );
@@ -362,23 +771,28 @@ static int prvPrivateKeySigningCallback( void * pvContext,
 
     if( CKR_OK == xResult )
     {
+        /* Other contexts may sign with the shared session concurrently. */
+        ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+
         /* Use the PKCS#11 module to sign. */
-        xResult = pxTLSContext->pxP11FunctionList->C_SignInit( pxTLSContext->xP11Session,
-                                                               &xMech,
-                                                               pxTLSContext->xP11PrivateKey );
-    }
+        xResult = pxCredentials->pxP11FunctionList->C_SignInit( pxCredentials->xP11Session,
+                                                                &xMech,
+                                                                pxCredentials->xP11PrivateKey );
 
-    if( CKR_OK == xResult )
-    {
-        *pxSigLen = sizeof( xToBeSigned );
-        xResult = pxTLSContext->pxP11FunctionList->C_Sign( ( CK_SESSION_HANDLE ) pxTLSContext->xP11Session,
-                                                           xToBeSigned,
-                                                           xToBeSignedLen,
-                                                           pucSig,
-                                                           ( CK_ULONG_PTR ) pxSigLen );
+        if( CKR_OK == xResult )
+        {
+            *pxSigLen = sizeof( xToBeSigned );
+            xResult = pxCredentials->pxP11FunctionList->C_Sign( ( CK_SESSION_HANDLE ) pxCredentials->xP11Session,
+                                                                xToBeSigned,
+                                                                xToBeSignedLen,
+                                                                pucSig,
+                                                                ( CK_ULONG_PTR ) pxSigLen );
+        }
+
+        ( void ) xSemaphoreGive( xCredentialLock );
     }
 
-    if( ( xResult == CKR_OK ) && ( CKK_EC == pxTLSContext->xKeyType ) )
+    if( ( xResult == CKR_OK ) && ( CKK_EC == pxCredentials->xKeyType ) )
     {
         /* PKCS #11 for P256 returns a 64-byte signature with 32 bytes for R and 32 bytes for S.
          * This must be converted to an ASN.1 encoded array. */
@@ -409,14 +823,14 @@ static int prvPrivateKeySigningCallback( void * pvContext,
  * out of storage, into RAM, and then into an mbedTLS certificate context
  * object.
  *
- * @param[in] pxTlsContext Caller TLS context.
+ * @param[in] pxCredentials Shared credentials, with the lock taken.
  * @param[in] pcLabelName PKCS #11 certificate object label.
  * @param[in] xClass PKCS #11 certificate object class.
  * @param[out] pxCertificateContext Certificate context.
  *
  * @return Zero on success.
  */
-static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
+static int prvReadCertificateIntoContext( TLSCredentials_t * pxCredentials,
                                           char * pcLabelName,
                                           CK_OBJECT_CLASS xClass,
                                           mbedtls_x509_crt * pxCertificateContext )
@@ -426,7 +840,7 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
     CK_OBJECT_HANDLE xCertObj = 0;
 
     /* Get the handle of the certificate. */
-    xResult = xFindObjectWithLabelAndClass( pxTlsContext->xP11Session,
+    xResult = xFindObjectWithLabelAndClass( pxCredentials->xP11Session,
                                             pcLabelName,
                                             strlen( pcLabelName ),
                                             xClass,
@@ -443,10 +857,10 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
         xTemplate.type = CKA_VALUE;
         xTemplate.ulValueLen = 0;
         xTemplate.pValue = NULL;
-        xResult = ( BaseType_t ) pxTlsContext->pxP11FunctionList->C_GetAttributeValue( pxTlsContext->xP11Session,
-                                                                                       xCertObj,
-                                                                                       &xTemplate,
-                                                                                       1 );
+        xResult = ( BaseType_t ) pxCredentials->pxP11FunctionList->C_GetAttributeValue( pxCredentials->xP11Session,
+                                                                                         xCertObj,
+                                                                                         &xTemplate,
+                                                                                         1 );
     }
 
     /* Create a buffer for the certificate. */
@@ -463,10 +877,10 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
     /* Export the certificate. */
     if( 0 == xResult )
     {
-        xResult = ( BaseType_t ) pxTlsContext->pxP11FunctionList->C_GetAttributeValue( pxTlsContext->xP11Session,
-                                                                                       xCertObj,
-                                                                                       &xTemplate,
-                                                                                       1 );
+        xResult = ( BaseType_t ) pxCredentials->pxP11FunctionList->C_GetAttributeValue( pxCredentials->xP11Session,
+                                                                                         xCertObj,
+                                                                                         &xTemplate,
+                                                                                         1 );
     }
 
     /* Decode the certificate. */
@@ -489,50 +903,36 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Helper for setting up potentially hardware-based cryptographic context
- * for the client TLS certificate and private key.
+ * @brief Helper for reading the device private key handle and the client
+ * certificate chain out of storage into the shared credentials.
  *
- * @param Caller context.
+ * @param[in] pxCredentials Shared credentials, with the lock taken.
  *
  * @return Zero on success.
  */
-static int prvInitializeClientCredential( TLSContext_t * pxCtx )
+static int prvLoadClientCredential( TLSCredentials_t * pxCredentials )
 {
     BaseType_t xResult = CKR_OK;
     CK_ATTRIBUTE xTemplate[ 2 ];
-    mbedtls_pk_type_t xKeyAlgo = ( mbedtls_pk_type_t ) ~0;
     char * pcJitrCertificate = keyJITR_DEVICE_CERTIFICATE_AUTHORITY_PEM;
 
-    /* Initialize the mbed contexts. */
-    mbedtls_x509_crt_init( &pxCtx->xMbedX509Cli );
-
-    if( pxCtx->xP11Session == CK_INVALID_HANDLE )
-    {
-        xResult = CKR_SESSION_HANDLE_INVALID;
-        TLS_PRINT( ( "Error: PKCS #11 session was not initialized.\r\n" ) );
-    }
-
     /* Put the module in authenticated mode. */
-    if( CKR_OK == xResult )
-    {
-        pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_STARTED;
-        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_Login( pxCtx->xP11Session,
-                                                                    CKU_USER,
-                                                                    ( CK_UTF8CHAR_PTR ) configPKCS11_DEFAULT_USER_PIN,
-                                                                    sizeof( configPKCS11_DEFAULT_USER_PIN ) - 1 );
-    }
+    xResult = ( BaseType_t ) pxCredentials->pxP11FunctionList->C_Login( pxCredentials->xP11Session,
+                                                                        CKU_USER,
+                                                                        ( CK_UTF8CHAR_PTR ) configPKCS11_DEFAULT_USER_PIN,
+                                                                        sizeof( configPKCS11_DEFAULT_USER_PIN ) - 1 );
 
     if( ( CKR_OK == xResult ) || ( CKR_USER_ALREADY_LOGGED_IN == xResult ) )
     {
         /* Get the handle of the device private key. */
-        xResult = xFindObjectWithLabelAndClass( pxCtx->xP11Session,
+        xResult = xFindObjectWithLabelAndClass( pxCredentials->xP11Session,
                                                 pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
                                                 sizeof( pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS ) - 1,
                                                 CKO_PRIVATE_KEY,
-                                                &pxCtx->xP11PrivateKey );
+                                                &pxCredentials->xP11PrivateKey );
     }
 
-    if( ( CKR_OK == xResult ) && ( pxCtx->xP11PrivateKey == CK_INVALID_HANDLE ) )
+    if( ( CKR_OK == xResult ) && ( pxCredentials->xP11PrivateKey == CK_INVALID_HANDLE ) )
     {
         xResult = TLS_ERROR_NO_PRIVATE_KEY;
         TLS_PRINT( ( "ERROR: Private key not found. " ) );
@@ -542,71 +942,42 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
     if( xResult == CKR_OK )
     {
         xTemplate[ 0 ].type = CKA_KEY_TYPE;
-        xTemplate[ 0 ].pValue = &pxCtx->xKeyType;
+        xTemplate[ 0 ].pValue = &pxCredentials->xKeyType;
         xTemplate[ 0 ].ulValueLen = sizeof( CK_KEY_TYPE );
-        xResult = pxCtx->pxP11FunctionList->C_GetAttributeValue( pxCtx->xP11Session,
-                                                                 pxCtx->xP11PrivateKey,
-                                                                 xTemplate,
-                                                                 1 );
-    }
-
-    /* Map the PKCS #11 key type to an mbedTLS algorithm. */
-    if( xResult == CKR_OK )
-    {
-        switch( pxCtx->xKeyType )
-        {
-            case CKK_RSA:
-                xKeyAlgo = MBEDTLS_PK_RSA;
-                break;
-
-            case CKK_EC:
-                xKeyAlgo = MBEDTLS_PK_ECKEY;
-                break;
-
-            default:
-                xResult = CKR_ATTRIBUTE_VALUE_INVALID;
-                break;
-        }
-    }
-
-    /* Map the mbedTLS algorithm to its internal metadata. */
-    if( xResult == CKR_OK )
-    {
-        memcpy( &pxCtx->xMbedPkInfo, mbedtls_pk_info_from_type( xKeyAlgo ), sizeof( mbedtls_pk_info_t ) );
-
-        pxCtx->xMbedPkInfo.sign_func = prvPrivateKeySigningCallback;
-        pxCtx->xMbedPkCtx.pk_info = &pxCtx->xMbedPkInfo;
-        pxCtx->xMbedPkCtx.pk_ctx = pxCtx;
+        xResult = pxCredentials->pxP11FunctionList->C_GetAttributeValue( pxCredentials->xP11Session,
+                                                                         pxCredentials->xP11PrivateKey,
+                                                                         xTemplate,
+                                                                         1 );
     }
 
     /* Get the handle of the device client certificate. */
     if( xResult == CKR_OK )
     {
-        xResult = prvReadCertificateIntoContext( pxCtx,
+        xResult = prvReadCertificateIntoContext( pxCredentials,
                                                  pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
                                                  CKO_CERTIFICATE,
-                                                 &pxCtx->xMbedX509Cli );
+                                                 &pxCredentials->xMbedX509Cli );
     }
 
     /* Add a Just-in-Time Registration (JITR) device issuer certificate, if
-     * present, to the TLS context handle. */
+     * present, to the client certificate chain. */
     if( xResult == CKR_OK )
     {
         /* Prioritize a statically defined certificate over one in storage. */
         if( ( NULL != pcJitrCertificate ) &&
             ( 0 != strcmp( "", pcJitrCertificate ) ) )
         {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509Cli,
+            xResult = mbedtls_x509_crt_parse( &pxCredentials->xMbedX509Cli,
                                               ( const unsigned char * ) pcJitrCertificate,
                                               1 + strlen( pcJitrCertificate ) );
         }
         else
         {
             /* Check for a device JITR certificate in storage. */
-            xResult = prvReadCertificateIntoContext( pxCtx,
+            xResult = prvReadCertificateIntoContext( pxCredentials,
                                                      pkcs11configLABEL_JITP_CERTIFICATE,
                                                      CKO_CERTIFICATE,
-                                                     &pxCtx->xMbedX509Cli );
+                                                     &pxCredentials->xMbedX509Cli );
 
             /* It is optional to have a JITR certificate in storage. */
             if( CKR_OBJECT_HANDLE_INVALID == xResult )
@@ -616,12 +987,12 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
         }
     }
 
-    /* Attach the client certificate(s) and private key to the TLS configuration. */
-    if( 0 == xResult )
+    if( xResult != CKR_OK )
     {
-        xResult = mbedtls_ssl_conf_own_cert( &pxCtx->xMbedSslConfig,
-                                             &pxCtx->xMbedX509Cli,
-                                             &pxCtx->xMbedPkCtx );
+        /* Try again on the next connection, e.g. once provisioned. */
+        mbedtls_x509_crt_free( &pxCredentials->xMbedX509Cli );
+        mbedtls_x509_crt_init( &pxCredentials->xMbedX509Cli );
+        pxCredentials->xP11PrivateKey = CK_INVALID_HANDLE;
     }
 
     return xResult;
@@ -630,48 +1001,1131 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Helper to seed the entropy module used by the DRBG. Periodically this
- * this function will be called to get more random data from the TRNG.
+ * @brief Helper for setting up potentially hardware-based cryptographic context
+ * for the client TLS certificate and private key. The credentials are read
+ * from the token by the first context that needs them and shared afterwards.
  *
- * @param[in] tlsContext The TLS context.
- * @param[out] outputBuffer The output buffer to return the generated random data.
- * @param[in] outputBufferLength Length of the output buffer.
+ * @param Caller context.
  *
- * @return Zero on success, otherwise a negative error code telling the cause of the error.
+ * @return Zero on success.
  */
-static int prvEntropyCallback( void * tlsContext,
-                               unsigned char * outputBuffer,
-                               size_t outputBufferLength )
+static int prvInitializeClientCredential( TLSContext_t * pxCtx )
 {
-    int ret = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
-    CK_RV xResult = CKR_OK;
-    TLSContext_t * pxCtx = ( TLSContext_t * ) tlsContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    BaseType_t xResult = CKR_OK;
+    mbedtls_pk_type_t xKeyAlgo = ( mbedtls_pk_type_t ) ~0;
+    TLSCredentials_t * pxCredentials = pxCtx->pxCredentials;
 
-    if( pxCtx->xP11Session != CK_INVALID_HANDLE )
+    if( ( NULL == pxCredentials ) || ( pxCredentials->xP11Session == CK_INVALID_HANDLE ) )
     {
-        xResult = C_GenerateRandom( pxCtx->xP11Session,
-                                    outputBuffer,
-                                    outputBufferLength );
+        xResult = CKR_SESSION_HANDLE_INVALID;
+        TLS_PRINT( ( "Error: PKCS #11 session was not initialized.\r\n" ) );
+    }
+
+    /* Load the credentials, unless another context already did. */
+    if( CKR_OK == xResult )
+    {
+        pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_STARTED;
+
+        ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+
+        if( pdFALSE == pxCredentials->xClientLoaded )
+        {
+            xResult = prvLoadClientCredential( pxCredentials );
+
+            if( CKR_OK == xResult )
+            {
+                pxCredentials->xClientLoaded = pdTRUE;
+            }
+        }
+
+        ( void ) xSemaphoreGive( xCredentialLock );
+    }
+
+    /* Map the PKCS #11 key type to an mbedTLS algorithm. */
+    if( xResult == CKR_OK )
+    {
+        switch( pxCredentials->xKeyType )
+        {
+            case CKK_RSA:
+                xKeyAlgo = MBEDTLS_PK_RSA;
+                break;
+
+            case CKK_EC:
+                xKeyAlgo = MBEDTLS_PK_ECKEY;
+                break;
+
+            default:
+                xResult = CKR_ATTRIBUTE_VALUE_INVALID;
+                break;
+        }
+    }
+
+    /* Map the mbedTLS algorithm to its internal metadata. */
+    if( xResult == CKR_OK )
+    {
+        memcpy( &pxCtx->xMbedPkInfo, mbedtls_pk_info_from_type( xKeyAlgo ), sizeof( mbedtls_pk_info_t ) );
+
+        pxCtx->xMbedPkInfo.sign_func = prvPrivateKeySigningCallback;
+        pxCtx->xMbedPkCtx.pk_info = &pxCtx->xMbedPkInfo;
+        pxCtx->xMbedPkCtx.pk_ctx = pxCtx;
+    }
+
+    /* Attach the client certificate(s) and private key to the TLS configuration.
+     * The shared chain is not modified once loaded. */
+    if( 0 == xResult )
+    {
+        xResult = mbedtls_ssl_conf_own_cert( &pxCtx->xMbedSslConfig,
+                                             &pxCredentials->xMbedX509Cli,
+                                             &pxCtx->xMbedPkCtx );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Helper for parsing the default server root certificates.
+ *
+ * @param[out] pxRootCertificates Certificate context.
+ *
+ * @return Zero on success.
+ */
+static int prvParseDefaultRootCertificates( mbedtls_x509_crt * pxRootCertificates )
+{
+    int xResult = 0;
+
+    xResult = mbedtls_x509_crt_parse( pxRootCertificates,
+                                      ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
+                                      tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
+
+    if( 0 == xResult )
+    {
+        xResult = mbedtls_x509_crt_parse( pxRootCertificates,
+                                          ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
+                                          tlsATS1_ROOT_CERTIFICATE_LENGTH );
+    }
+
+    if( 0 == xResult )
+    {
+        xResult = mbedtls_x509_crt_parse( pxRootCertificates,
+                                          ( const unsigned char * ) tlsATS3_ROOT_CERTIFICATE_PEM,
+                                          tlsATS3_ROOT_CERTIFICATE_LENGTH );
+    }
+
+    if( 0 == xResult )
+    {
+        xResult = mbedtls_x509_crt_parse( pxRootCertificates,
+                                          ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
+                                          tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Helper to seed the entropy module used by the DRBG. Periodically this
+ * this function will be called to get more random data from the TRNG.
+ *
+ * @param[in] tlsContext The TLS context.
+ * @param[out] outputBuffer The output buffer to return the generated random data.
+ * @param[in] outputBufferLength Length of the output buffer.
+ *
+ * @return Zero on success, otherwise a negative error code telling the cause of the error.
+ */
+static int prvEntropyCallback( void * tlsContext,
+                               unsigned char * outputBuffer,
+                               size_t outputBufferLength )
+{
+    int ret = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+    CK_RV xResult = CKR_OK;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) tlsContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+        ( void ) pxCtx;
+
+        if( TLS_GetEntropy( outputBuffer, outputBufferLength ) != pdPASS )
+        {
+            xResult = CKR_FUNCTION_FAILED;
+        }
+    #else
+        if( ( NULL != pxCtx->pxCredentials ) &&
+            ( pxCtx->pxCredentials->xP11Session != CK_INVALID_HANDLE ) )
+        {
+            /* The session is shared with the other TLS contexts. */
+            ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+            xResult = C_GenerateRandom( pxCtx->pxCredentials->xP11Session,
+                                        outputBuffer,
+                                        outputBufferLength );
+            ( void ) xSemaphoreGive( xCredentialLock );
+        }
+        else
+        {
+            xResult = CKR_SESSION_HANDLE_INVALID;
+            TLS_PRINT( ( "Error: PKCS #11 session was not initialized.\r\n" ) );
+        }
+    #endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
+
+    if( xResult == CKR_OK )
+    {
+        ret = 0;
     }
     else
     {
-        xResult = CKR_SESSION_HANDLE_INVALID;
-        TLS_PRINT( ( "Error: PKCS #11 session was not initialized.\r\n" ) );
+        TLS_PRINT( ( "Error: PKCS #11 C_GenerateRandom failed with error code:" \
+                     "%d\r\n", xResult ) );
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generate random bytes with an entropy session, opening it on first
+ * use. Call with the lock of the session taken.
+ *
+ * @param[in,out] pxSession The session, CK_INVALID_HANDLE until opened.
+ * @param[out] pucOutput Buffer for the random bytes.
+ * @param[in] xLength Number of bytes to generate.
+ *
+ * @return CKR_OK on success, otherwise the PKCS #11 error.
+ */
+static CK_RV prvEntropyGenerate( CK_SESSION_HANDLE * pxSession,
+                                 unsigned char * pucOutput,
+                                 size_t xLength )
+{
+    CK_RV xResult = CKR_OK;
+
+    if( *pxSession == CK_INVALID_HANDLE )
+    {
+        xResult = xInitializePkcs11Session( pxSession );
+
+        /* It is ok if the module was previously initialized. */
+        if( ( xResult == CKR_CRYPTOKI_ALREADY_INITIALIZED ) || ( CKR_USER_ALREADY_LOGGED_IN == xResult ) )
+        {
+            xResult = CKR_OK;
+        }
+
+        if( xResult != CKR_OK )
+        {
+            *pxSession = CK_INVALID_HANDLE;
+        }
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = C_GenerateRandom( *pxSession, pucOutput, xLength );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Close an entropy session, if open. Call with its lock taken.
+ *
+ * @param[in,out] pxSession The session, CK_INVALID_HANDLE once closed.
+ */
+static void prvEntropyClose( CK_SESSION_HANDLE * pxSession )
+{
+    if( *pxSession != CK_INVALID_HANDLE )
+    {
+        ( void ) C_CloseSession( *pxSession );
+        *pxSession = CK_INVALID_HANDLE;
+    }
+}
+
+#if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Top up the entropy pool with one batch from the token. Call with
+ * xEntropyRefillLock taken. The token is read without blocking the pool, and
+ * the new bytes are published with the scheduler suspended.
+ */
+    static void prvEntropyPoolRefill( void )
+    {
+        CK_RV xResult = CKR_OK;
+        size_t xStart = 0;
+        size_t xFresh = 0;
+
+        /* Concurrent readers only shrink the pool, so the bytes past xStart
+         * belong to this refill until it publishes them. */
+        vTaskSuspendAll();
+        {
+            xStart = xEntropyPoolLength;
+        }
+        ( void ) xTaskResumeAll();
+
+        xFresh = tlsconfigENTROPY_POOL_SIZE - xStart;
+
+        if( xFresh > 0U )
+        {
+            xResult = prvEntropyGenerate( &xEntropyRefillSession, &ucEntropyPool[ xStart ], xFresh );
+        }
+
+        vTaskSuspendAll();
+        {
+            if( xResult == CKR_OK )
+            {
+                /* Move the new bytes down to what is left of the pool, then
+                 * clear the copies left behind. */
+                ( void ) memmove( &ucEntropyPool[ xEntropyPoolLength ],
+                                  &ucEntropyPool[ xStart ],
+                                  xFresh );
+                xEntropyPoolLength += xFresh;
+            }
+
+            mbedtls_platform_zeroize( &ucEntropyPool[ xEntropyPoolLength ],
+                                      tlsconfigENTROPY_POOL_SIZE - xEntropyPoolLength );
+            xEntropyRefillPending = pdFALSE;
+        }
+        ( void ) xTaskResumeAll();
+
+        if( xResult != CKR_OK )
+        {
+            TLS_PRINT( ( "Error: Entropy pool refill failed with error code: %d\r\n", xResult ) );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Task refilling the entropy pool whenever TLS_GetEntropy notifies it.
+ *
+ * @param[in] pvParameters Unused.
+ */
+    static void prvEntropyRefillTask( void * pvParameters )
+    {
+        ( void ) pvParameters;
+
+        for( ; ; )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+            ( void ) xSemaphoreTake( xEntropyRefillLock, portMAX_DELAY );
+            prvEntropyPoolRefill();
+            ( void ) xSemaphoreGive( xEntropyRefillLock );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start the entropy pool on the first call: create the refill task and
+ * fill the pool in the calling task, so that the first handshake is served
+ * from it.
+ */
+    static void prvEntropyPoolStart( void )
+    {
+        if( ( pdFALSE == xEntropyPoolStarted ) &&
+            ( prvCreateLockOnce( &xEntropyRefillLock ) == pdPASS ) )
+        {
+            ( void ) xSemaphoreTake( xEntropyRefillLock, portMAX_DELAY );
+
+            if( pdFALSE == xEntropyPoolStarted )
+            {
+                if( xTaskCreate( prvEntropyRefillTask,
+                                 "TLSEntropy",
+                                 tlsconfigENTROPY_REFILL_TASK_STACK_SIZE,
+                                 NULL,
+                                 tlsconfigENTROPY_REFILL_TASK_PRIORITY,
+                                 &xEntropyRefillTask ) != pdPASS )
+                {
+                    /* Refill in the tasks that drain the pool instead. */
+                    xEntropyRefillTask = NULL;
+                    TLS_PRINT( ( "WARN: Failed to create the entropy refill task.\r\n" ) );
+                }
+
+                prvEntropyPoolRefill();
+                xEntropyPoolStarted = pdTRUE;
+            }
+
+            ( void ) xSemaphoreGive( xEntropyRefillLock );
+        }
+    }
+
+#endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
+
+#if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Digest the settings that decide whether a server is trusted: the
+ * custom server certificates, the ALPN list and the client certificate chain.
+ * Resuming a session skips the verification these settings control, so a
+ * session is only offered to connections with the same digest.
+ *
+ * @param[in] pxCtx TLS context, with its client credentials initialized.
+ */
+    static void prvSessionCacheDigest( TLSContext_t * pxCtx )
+    {
+        mbedtls_sha256_context xSha256;
+        const mbedtls_x509_crt * pxCertificate = NULL;
+        uint32_t ulLength = 0;
+        uint32_t ulIndex;
+
+        mbedtls_sha256_init( &xSha256 );
+        ( void ) mbedtls_sha256_starts_ret( &xSha256, 0 );
+
+        /* Each item is prefixed with its length, zero for the default root
+         * certificates. */
+        if( NULL != pxCtx->pcServerCertificate )
+        {
+            ulLength = pxCtx->ulServerCertificateLength;
+        }
+
+        ( void ) mbedtls_sha256_update_ret( &xSha256, ( const unsigned char * ) &ulLength, sizeof( ulLength ) );
+        ( void ) mbedtls_sha256_update_ret( &xSha256, ( const unsigned char * ) pxCtx->pcServerCertificate, ulLength );
+
+        ulLength = 0;
+
+        if( NULL != pxCtx->ppcAlpnProtocols )
+        {
+            while( NULL != pxCtx->ppcAlpnProtocols[ ulLength ] )
+            {
+                ulLength++;
+            }
+        }
+
+        ( void ) mbedtls_sha256_update_ret( &xSha256, ( const unsigned char * ) &ulLength, sizeof( ulLength ) );
+
+        for( ulIndex = 0; ulIndex < ulLength; ulIndex++ )
+        {
+            ( void ) mbedtls_sha256_update_ret( &xSha256,
+                                                ( const unsigned char * ) pxCtx->ppcAlpnProtocols[ ulIndex ],
+                                                strlen( pxCtx->ppcAlpnProtocols[ ulIndex ] ) + 1U );
+        }
+
+        /* The shared chain is not modified once loaded. */
+        if( pdTRUE == pxCtx->pxCredentials->xClientLoaded )
+        {
+            pxCertificate = &pxCtx->pxCredentials->xMbedX509Cli;
+        }
+
+        while( ( NULL != pxCertificate ) && ( 0U != pxCertificate->raw.len ) )
+        {
+            ulLength = ( uint32_t ) pxCertificate->raw.len;
+            ( void ) mbedtls_sha256_update_ret( &xSha256, ( const unsigned char * ) &ulLength, sizeof( ulLength ) );
+            ( void ) mbedtls_sha256_update_ret( &xSha256, pxCertificate->raw.p, pxCertificate->raw.len );
+            pxCertificate = pxCertificate->next;
+        }
+
+        ( void ) mbedtls_sha256_finish_ret( &xSha256, pxCtx->ucSessionDigest );
+        mbedtls_sha256_free( &xSha256 );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the cache entry of a destination and settings. Call with the
+ * scheduler suspended.
+ *
+ * @param[in] pcDestination Server name.
+ * @param[in] pucDigest Digest of the settings, see prvSessionCacheDigest.
+ *
+ * @return The entry, or NULL if there is none.
+ */
+    static TLSSessionCacheEntry_t * prvSessionCacheFind( const char * pcDestination,
+                                                         const unsigned char * pucDigest )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        uint32_t ulIndex;
+
+        for( ulIndex = 0; ulIndex < tlsconfigSESSION_CACHE_ENTRIES; ulIndex++ )
+        {
+            if( ( NULL != xSessionCache[ ulIndex ].pcDestination ) &&
+                ( 0 == strcmp( xSessionCache[ ulIndex ].pcDestination, pcDestination ) ) &&
+                ( 0 == memcmp( xSessionCache[ ulIndex ].pucSession, pucDigest, cryptoSHA256_DIGEST_BYTES ) ) )
+            {
+                pxEntry = &xSessionCache[ ulIndex ];
+                break;
+            }
+        }
+
+        return pxEntry;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free a cache entry. Call with the scheduler suspended.
+ *
+ * @param[in] pxEntry Entry to free.
+ */
+    static void prvSessionCacheFreeEntry( TLSSessionCacheEntry_t * pxEntry )
+    {
+        if( NULL != pxEntry->pucSession )
+        {
+            /* The serialized session contains the session keys. */
+            mbedtls_platform_zeroize( pxEntry->pucSession, pxEntry->xSessionLength );
+            vPortFree( pxEntry->pucSession );
+        }
+
+        vPortFree( pxEntry->pcDestination );
+        memset( pxEntry, 0, sizeof( TLSSessionCacheEntry_t ) );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Offer the cached or persisted session of the destination, if any,
+ * for the coming handshake.
+ *
+ * @param[in] pxCtx TLS context with its SSL context set up.
+ */
+    static void prvSessionCacheOffer( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        unsigned char * pucSession = NULL;
+        size_t xSessionLength = 0;
+        mbedtls_ssl_session xSession;
+
+        prvSessionCacheDigest( pxCtx );
+
+        vTaskSuspendAll();
+        {
+            pxEntry = prvSessionCacheFind( pxCtx->pcDestination, pxCtx->ucSessionDigest );
+
+            if( NULL != pxEntry )
+            {
+                pucSession = pvPortMalloc( pxEntry->xSessionLength );
+
+                if( NULL != pucSession )
+                {
+                    memcpy( pucSession, pxEntry->pucSession, pxEntry->xSessionLength );
+                    xSessionLength = pxEntry->xSessionLength;
+                    pxEntry->ulLastUsed = ++ulSessionCacheClock;
+                }
+            }
+        }
+        ( void ) xTaskResumeAll();
+
+        if( ( NULL == pxEntry ) && ( NULL != xSessionLoad ) )
+        {
+            pucSession = pvPortMalloc( tlsconfigSESSION_MAX_LENGTH );
+
+            if( NULL != pucSession )
+            {
+                xSessionLength = xSessionLoad( pxCtx->pcDestination,
+                                               pucSession,
+                                               tlsconfigSESSION_MAX_LENGTH );
+
+                /* Only resume a session persisted under the same settings. */
+                if( ( xSessionLength <= cryptoSHA256_DIGEST_BYTES ) ||
+                    ( xSessionLength > tlsconfigSESSION_MAX_LENGTH ) ||
+                    ( 0 != memcmp( pucSession, pxCtx->ucSessionDigest, cryptoSHA256_DIGEST_BYTES ) ) )
+                {
+                    mbedtls_platform_zeroize( pucSession, tlsconfigSESSION_MAX_LENGTH );
+                    xSessionLength = 0;
+                }
+            }
+        }
+
+        if( xSessionLength > 0U )
+        {
+            mbedtls_ssl_session_init( &xSession );
+
+            if( ( 0 == mbedtls_ssl_session_load( &xSession,
+                                                 &pucSession[ cryptoSHA256_DIGEST_BYTES ],
+                                                 xSessionLength - cryptoSHA256_DIGEST_BYTES ) ) &&
+                ( 0 == mbedtls_ssl_set_session( &pxCtx->xMbedSslCtx, &xSession ) ) )
+            {
+                pxCtx->xSessionOffered = pdTRUE;
+            }
+
+            mbedtls_ssl_session_free( &xSession );
+            mbedtls_platform_zeroize( pucSession, xSessionLength );
+        }
+
+        vPortFree( pucSession );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Cache the session negotiated by a successful handshake, and persist
+ * it if the handshake was a full one.
+ *
+ * @param[in] pxCtx TLS context of the connection.
+ */
+    static void prvSessionCacheSave( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        mbedtls_ssl_session xSession;
+        unsigned char * pucSession = NULL;
+        size_t xSessionLength = 0;
+        char * pcDestination = NULL;
+        size_t xDestinationLength = strlen( pxCtx->pcDestination ) + 1U;
+        BaseType_t xResumable = pdFALSE;
+        uint32_t ulIndex;
+
+        mbedtls_ssl_session_init( &xSession );
+
+        if( 0 == mbedtls_ssl_get_session( &pxCtx->xMbedSslCtx, &xSession ) )
+        {
+            xResumable = ( xSession.id_len > 0U ) ? pdTRUE : pdFALSE;
+
+            #if defined( MBEDTLS_SSL_SESSION_TICKETS )
+                if( xSession.ticket_len > 0U )
+                {
+                    xResumable = pdTRUE;
+                }
+            #endif
+        }
+
+        /* Serialize the session after the digest of the settings; the first
+         * call only computes its length. */
+        if( ( pdTRUE == xResumable ) &&
+            ( MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL == mbedtls_ssl_session_save( &xSession, NULL, 0, &xSessionLength ) ) )
+        {
+            pucSession = pvPortMalloc( cryptoSHA256_DIGEST_BYTES + xSessionLength );
+            pcDestination = pvPortMalloc( xDestinationLength );
+
+            if( ( NULL == pucSession ) || ( NULL == pcDestination ) ||
+                ( 0 != mbedtls_ssl_session_save( &xSession,
+                                                 &pucSession[ cryptoSHA256_DIGEST_BYTES ],
+                                                 xSessionLength,
+                                                 &xSessionLength ) ) )
+            {
+                vPortFree( pucSession );
+                vPortFree( pcDestination );
+                pucSession = NULL;
+            }
+        }
+
+        mbedtls_ssl_session_free( &xSession );
+
+        if( NULL != pucSession )
+        {
+            memcpy( pucSession, pxCtx->ucSessionDigest, cryptoSHA256_DIGEST_BYTES );
+            xSessionLength += cryptoSHA256_DIGEST_BYTES;
+            memcpy( pcDestination, pxCtx->pcDestination, xDestinationLength );
+
+            if( ( NULL != xSessionStore ) && ( pdFALSE == pxCtx->xSessionOffered ) )
+            {
+                xSessionStore( pcDestination, pucSession, xSessionLength );
+            }
+
+            vTaskSuspendAll();
+            {
+                pxEntry = prvSessionCacheFind( pcDestination, pxCtx->ucSessionDigest );
+
+                /* Otherwise take a free entry, or the least recently used one. */
+                for( ulIndex = 0; ( NULL == pxEntry ) && ( ulIndex < tlsconfigSESSION_CACHE_ENTRIES ); ulIndex++ )
+                {
+                    if( NULL == xSessionCache[ ulIndex ].pcDestination )
+                    {
+                        pxEntry = &xSessionCache[ ulIndex ];
+                    }
+                }
+
+                if( NULL == pxEntry )
+                {
+                    pxEntry = &xSessionCache[ 0 ];
+
+                    for( ulIndex = 1; ulIndex < tlsconfigSESSION_CACHE_ENTRIES; ulIndex++ )
+                    {
+                        if( xSessionCache[ ulIndex ].ulLastUsed < pxEntry->ulLastUsed )
+                        {
+                            pxEntry = &xSessionCache[ ulIndex ];
+                        }
+                    }
+                }
+
+                prvSessionCacheFreeEntry( pxEntry );
+                pxEntry->pcDestination = pcDestination;
+                pxEntry->pucSession = pucSession;
+                pxEntry->xSessionLength = xSessionLength;
+                pxEntry->ulLastUsed = ++ulSessionCacheClock;
+            }
+            ( void ) xTaskResumeAll();
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drop the cached session of a destination and settings, e.g. after
+ * it failed a handshake.
+ *
+ * @param[in] pcDestination Server name.
+ * @param[in] pucDigest Digest of the settings, see prvSessionCacheDigest.
+ */
+    static void prvSessionCacheRemove( const char * pcDestination,
+                                       const unsigned char * pucDigest )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+
+        vTaskSuspendAll();
+        {
+            pxEntry = prvSessionCacheFind( pcDestination, pucDigest );
+
+            if( NULL != pxEntry )
+            {
+                prvSessionCacheFreeEntry( pxEntry );
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+#endif /* if ( tlsconfigSESSION_CACHE_ENTRIES > 0 ) */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Encrypt and send data, in as many records as needed.
+ *
+ * @param[in] pxCtx The TLS context.
+ * @param[in] pucMsg Data to send.
+ * @param[in] xMsgLength Length of pucMsg.
+ *
+ * @return Number of bytes sent, which is less than xMsgLength if the network
+ * would block. A negative error code on failure, in which case the caller
+ * invalidates the context once it gave the write lock.
+ */
+static BaseType_t prvSslWrite( TLSContext_t * pxCtx,
+                               const unsigned char * pucMsg,
+                               size_t xMsgLength )
+{
+    BaseType_t xResult = 0;
+    size_t xWritten = 0;
+
+    while( xWritten < xMsgLength )
+    {
+        xResult = mbedtls_ssl_write( &pxCtx->xMbedSslCtx,
+                                     pucMsg + xWritten,
+                                     xMsgLength - xWritten );
+
+        if( 0 < xResult )
+        {
+            /* Sent a record, so update the tally and keep looping. */
+            xWritten += ( size_t ) xResult;
+            pxCtx->xStats.ulRecordsSent++;
+        }
+        else if( ( 0 == xResult ) || ( -pdFREERTOS_ERRNO_ENOSPC == xResult ) )
+        {
+            /* No data sent. The secure sockets
+             * API supports non-blocking send, so stop the loop but don't
+             * flag an error. */
+            xResult = 0;
+            break;
+        }
+        else if( MBEDTLS_ERR_SSL_WANT_WRITE != xResult )
+        {
+            /* Hard error: stop. */
+            break;
+        }
+    }
+
+    if( 0 <= xResult )
+    {
+        xResult = ( BaseType_t ) xWritten;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start the write deadline of a context, if it has one, when data
+ * starts waiting in its buffer.
+ *
+ * @param[in] pxCtx The TLS context, with the write lock held.
+ */
+static void prvWriteDeadlineStart( TLSContext_t * pxCtx )
+{
+    #if ( tlsWRITE_DEADLINE_TIMER == 1 )
+        /* If the timer queue is full, the next call flushes aged data. */
+        if( NULL != pxCtx->pxWriteDeadline )
+        {
+            ( void ) xTimerReset( pxCtx->pxWriteDeadline->xTimer, 0 );
+        }
+    #else
+        ( void ) pxCtx;
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the combined writes as one record.
+ *
+ * @param[in] pxCtx The TLS context, with the write lock held.
+ *
+ * @return Zero, with the unsent bytes left at the start of the buffer if the
+ * network would block. A negative error code on failure, in which case the
+ * caller invalidates the context once it gave the write lock.
+ */
+static BaseType_t prvWriteBufferFlush( TLSContext_t * pxCtx )
+{
+    BaseType_t xResult = 0;
+
+    if( 0U != pxCtx->xWriteBufferLength )
+    {
+        xResult = prvSslWrite( pxCtx, pxCtx->pucWriteBuffer, pxCtx->xWriteBufferLength );
+
+        if( 0 < xResult )
+        {
+            pxCtx->xWriteBufferLength -= ( size_t ) xResult;
+            ( void ) memmove( pxCtx->pucWriteBuffer,
+                              &pxCtx->pucWriteBuffer[ xResult ],
+                              pxCtx->xWriteBufferLength );
+
+            /* What is left, if anything, is retried on the next flush. */
+            pxCtx->xWriteBufferStart = xTaskGetTickCount();
+            xResult = 0;
+
+            if( 0U != pxCtx->xWriteBufferLength )
+            {
+                prvWriteDeadlineStart( pxCtx );
+            }
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( tlsWRITE_DEADLINE_TIMER == 1 )
+
+/**
+ * @brief Free a write deadline once its timer is deleted. Runs in the timer
+ * service task, after the deletion queued before it.
+ *
+ * @param[in] pvDeadline The #TLSWriteDeadline_t.
+ * @param[in] ulUnused Unused.
+ */
+    static void prvWriteDeadlineFree( void * pvDeadline,
+                                      uint32_t ulUnused )
+    {
+        TLSWriteDeadline_t * pxDeadline = ( TLSWriteDeadline_t * ) pvDeadline; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+        ( void ) ulUnused;
+
+        vSemaphoreDelete( pxDeadline->xLock );
+        vPortFree( pxDeadline );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Flush the writes of a context once the oldest reaches its maximum
+ * age. Runs in the timer service task, so it never waits for the lock: a task
+ * holding it flushes aged data itself, and the timer retries one period later.
+ *
+ * @param[in] xTimer The deadline timer.
+ */
+    static void prvWriteDeadlineCallback( TimerHandle_t xTimer )
+    {
+        TLSWriteDeadline_t * pxDeadline = ( TLSWriteDeadline_t * ) pvTimerGetTimerID( xTimer ); /*lint !e9087 !e9079 Allow casting void* to other types. */
+        TLSContext_t * pxCtx = NULL;
+
+        if( pdTRUE == xSemaphoreTake( pxDeadline->xLock, 0 ) )
+        {
+            pxCtx = pxDeadline->pxCtx;
+
+            if( ( NULL != pxCtx ) &&
+                ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) &&
+                ( NULL != pxCtx->pucWriteBuffer ) &&
+                ( 0 == pxCtx->xWriteDeadlineResult ) )
+            {
+                if( pdTRUE == pxCtx->xReading )
+                {
+                    /* mbedTLS contexts are not shared between tasks. The
+                     * reader flushed before reading, this is what was
+                     * buffered since. */
+                    ( void ) xTimerReset( xTimer, 0 );
+                }
+                else
+                {
+                    /* The owning task frees the context on its next call. */
+                    pxCtx->xWriteDeadlineResult = prvWriteBufferFlush( pxCtx );
+                }
+            }
+
+            ( void ) xSemaphoreGive( pxDeadline->xLock );
+        }
+        else
+        {
+            ( void ) xTimerReset( xTimer, 0 );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create the write deadline of a context. Without it, writes are
+ * flushed by the next call on the context once they are old enough.
+ *
+ * @param[in] pxCtx The TLS context, with a write buffer.
+ */
+    static void prvWriteDeadlineCreate( TLSContext_t * pxCtx )
+    {
+        TLSWriteDeadline_t * pxDeadline = NULL;
+
+        pxDeadline = ( TLSWriteDeadline_t * ) pvPortMalloc( sizeof( TLSWriteDeadline_t ) ); /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+        if( NULL != pxDeadline )
+        {
+            pxDeadline->pxCtx = pxCtx;
+            pxDeadline->xLock = xSemaphoreCreateMutex();
+            pxDeadline->xTimer = xTimerCreate( "TLSFlush",
+                                               pxCtx->xWriteMaxAgeTicks,
+                                               pdFALSE,
+                                               pxDeadline,
+                                               prvWriteDeadlineCallback );
+
+            if( ( NULL != pxDeadline->xLock ) && ( NULL != pxDeadline->xTimer ) )
+            {
+                pxCtx->pxWriteDeadline = pxDeadline;
+            }
+            else
+            {
+                if( NULL != pxDeadline->xLock )
+                {
+                    vSemaphoreDelete( pxDeadline->xLock );
+                }
+
+                if( NULL != pxDeadline->xTimer )
+                {
+                    ( void ) xTimerDelete( pxDeadline->xTimer, portMAX_DELAY );
+                }
+
+                vPortFree( pxDeadline );
+                pxDeadline = NULL;
+            }
+        }
+
+        if( NULL == pxDeadline )
+        {
+            TLS_PRINT( ( "WARN: Failed to create the TLS write deadline, writes are flushed by the next call.\r\n" ) );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stop the write deadline of a context before the context is freed.
+ *
+ * @param[in] pxCtx The TLS context.
+ */
+    static void prvWriteDeadlineDelete( TLSContext_t * pxCtx )
+    {
+        TLSWriteDeadline_t * pxDeadline = pxCtx->pxWriteDeadline;
+
+        if( NULL != pxDeadline )
+        {
+            /* A callback that already started finds no context. */
+            ( void ) xSemaphoreTake( pxDeadline->xLock, portMAX_DELAY );
+            pxDeadline->pxCtx = NULL;
+            ( void ) xSemaphoreGive( pxDeadline->xLock );
+
+            pxCtx->pxWriteDeadline = NULL;
+
+            /* Commands are processed in order, so the timer is deleted before
+             * the deadline is freed. */
+            if( ( pdPASS != xTimerDelete( pxDeadline->xTimer, portMAX_DELAY ) ) ||
+                ( pdPASS != xTimerPendFunctionCall( prvWriteDeadlineFree, pxDeadline, 0, portMAX_DELAY ) ) )
+            {
+                TLS_PRINT( ( "WARN: Failed to delete the TLS write deadline.\r\n" ) );
+            }
+        }
+    }
+
+#endif /* if ( tlsWRITE_DEADLINE_TIMER == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Allocate the write-combining buffer of a connected context, sized to
+ * the largest record payload negotiated, and its deadline. Writes are not
+ * combined if the allocation fails.
+ *
+ * @param[in] pxCtx The TLS context.
+ */
+static void prvWriteBufferCreate( TLSContext_t * pxCtx )
+{
+    int lMaxPayload = mbedtls_ssl_get_max_out_record_payload( &pxCtx->xMbedSslCtx );
+
+    if( lMaxPayload > 0 )
+    {
+        pxCtx->xWriteBufferSize = ( size_t ) lMaxPayload;
+
+        if( pxCtx->xWriteBufferSize > tlsconfigWRITE_COMBINE_MAX_LENGTH )
+        {
+            pxCtx->xWriteBufferSize = tlsconfigWRITE_COMBINE_MAX_LENGTH;
+        }
+
+        pxCtx->pucWriteBuffer = pvPortMalloc( pxCtx->xWriteBufferSize ); /*lint !e9079 Allow casting void* to other types. */
+        pxCtx->xWriteBufferLength = 0;
     }
 
-    if( xResult == CKR_OK )
+    if( NULL == pxCtx->pucWriteBuffer )
     {
-        ret = 0;
+        TLS_PRINT( ( "WARN: Failed to allocate the TLS write buffer, writes are not combined.\r\n" ) );
     }
-    else
+
+    #if ( tlsWRITE_DEADLINE_TIMER == 1 )
+        if( ( NULL != pxCtx->pucWriteBuffer ) &&
+            ( portMAX_DELAY != pxCtx->xWriteMaxAgeTicks ) &&
+            ( NULL == pxCtx->pxWriteDeadline ) )
+        {
+            prvWriteDeadlineCreate( pxCtx );
+        }
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Buffer data until a record is full, sending every full record.
+ * Data in full records that does not need to be combined is sent without
+ * being copied.
+ *
+ * @param[in] pxCtx The TLS context, with a write buffer and the write lock
+ * held.
+ * @param[in] pucMsg Data to send.
+ * @param[in] xMsgLength Length of pucMsg.
+ *
+ * @return Number of bytes sent or buffered, which is less than xMsgLength if
+ * the network would block. A negative error code on failure, in which case
+ * the caller invalidates the context once it gave the write lock.
+ */
+static BaseType_t prvWriteBufferSend( TLSContext_t * pxCtx,
+                                      const unsigned char * pucMsg,
+                                      size_t xMsgLength )
+{
+    BaseType_t xResult = 0;
+    size_t xAccepted = 0;
+    size_t xCopy = 0;
+
+    while( ( 0 <= xResult ) && ( xAccepted < xMsgLength ) )
     {
-        TLS_PRINT( ( "Error: PKCS #11 C_GenerateRandom failed with error code:" \
-                     "%d\r\n", xResult ) );
+        if( ( 0U == pxCtx->xWriteBufferLength ) &&
+            ( ( xMsgLength - xAccepted ) >= pxCtx->xWriteBufferSize ) )
+        {
+            /* Whole records, no need to combine them. */
+            xCopy = ( xMsgLength - xAccepted ) - ( ( xMsgLength - xAccepted ) % pxCtx->xWriteBufferSize );
+            xResult = prvSslWrite( pxCtx, &pucMsg[ xAccepted ], xCopy );
+
+            if( 0 <= xResult )
+            {
+                xAccepted += ( size_t ) xResult;
+
+                if( ( size_t ) xResult < xCopy )
+                {
+                    /* The network would block. */
+                    break;
+                }
+            }
+        }
+        else
+        {
+            xCopy = pxCtx->xWriteBufferSize - pxCtx->xWriteBufferLength;
+
+            if( xCopy > ( xMsgLength - xAccepted ) )
+            {
+                xCopy = xMsgLength - xAccepted;
+            }
+
+            if( 0U == pxCtx->xWriteBufferLength )
+            {
+                pxCtx->xWriteBufferStart = xTaskGetTickCount();
+                prvWriteDeadlineStart( pxCtx );
+            }
+
+            ( void ) memcpy( &pxCtx->pucWriteBuffer[ pxCtx->xWriteBufferLength ],
+                             &pucMsg[ xAccepted ],
+                             xCopy );
+            pxCtx->xWriteBufferLength += xCopy;
+            xAccepted += xCopy;
+
+            /* Send the record once full. */
+            if( pxCtx->xWriteBufferLength == pxCtx->xWriteBufferSize )
+            {
+                xResult = prvWriteBufferFlush( pxCtx );
+
+                if( ( 0 <= xResult ) && ( 0U != pxCtx->xWriteBufferLength ) )
+                {
+                    /* The network would block. */
+                    break;
+                }
+            }
+        }
     }
 
-    return ret;
+    /* Send the buffered data once it reaches its maximum age, in case the
+     * deadline timer could not. */
+    if( ( 0 <= xResult ) &&
+        ( 0U != pxCtx->xWriteBufferLength ) &&
+        ( portMAX_DELAY != pxCtx->xWriteMaxAgeTicks ) &&
+        ( ( xTaskGetTickCount() - pxCtx->xWriteBufferStart ) >= pxCtx->xWriteMaxAgeTicks ) )
+    {
+        xResult = prvWriteBufferFlush( pxCtx );
+    }
+
+    if( 0 <= xResult )
+    {
+        xResult = ( BaseType_t ) xAccepted;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Flush the combined writes before reading, since the peer cannot
+ * answer what is still buffered, and keep the deadline timer off the mbedTLS
+ * context until prvReadEnd.
+ *
+ * @param[in] pxCtx The TLS context.
+ *
+ * @return Zero, or a negative error code of the flush.
+ */
+static BaseType_t prvReadStart( TLSContext_t * pxCtx )
+{
+    BaseType_t xResult = 0;
+
+    prvWriteLock( pxCtx );
+
+    xResult = pxCtx->xWriteDeadlineResult;
+
+    if( ( 0 == xResult ) && ( NULL != pxCtx->pucWriteBuffer ) )
+    {
+        xResult = prvWriteBufferFlush( pxCtx );
+    }
+
+    pxCtx->xReading = pdTRUE;
+
+    prvWriteUnlock( pxCtx );
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief End a read started by prvReadStart.
+ *
+ * @param[in] pxCtx The TLS context.
+ */
+static void prvReadEnd( TLSContext_t * pxCtx )
+{
+    prvWriteLock( pxCtx );
+    pxCtx->xReading = pdFALSE;
+    prvWriteUnlock( pxCtx );
 }
 
+/*-----------------------------------------------------------*/
+
 /*
  * Interface routines.
  */
@@ -682,7 +2136,6 @@ BaseType_t TLS_Init( void ** ppvContext,
     BaseType_t xResult = CKR_OK;
     int mbedTLSResult = 0;
     TLSContext_t * pxCtx = NULL;
-    CK_C_GetFunctionList xCkGetFunctionList = NULL;
 
     /* Allocate an internal context. */
     pxCtx = ( TLSContext_t * ) pvPortMalloc( sizeof( TLSContext_t ) ); /*lint !e9087 !e9079 Allow casting void* to other types. */
@@ -692,6 +2145,17 @@ BaseType_t TLS_Init( void ** ppvContext,
         memset( pxCtx, 0, sizeof( TLSContext_t ) );
         *ppvContext = pxCtx;
 
+        /* Released by TLS_Cleanup, which is also called if this fails. */
+        vTaskSuspendAll();
+        {
+            ulEntropyUsers++;
+        }
+        ( void ) xTaskResumeAll();
+
+        #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+            prvEntropyPoolStart();
+        #endif
+
         /* Initialize the context. */
         pxCtx->pcDestination = pxParams->pcDestination;
         pxCtx->pcServerCertificate = pxParams->pcServerCertificate;
@@ -702,22 +2166,20 @@ BaseType_t TLS_Init( void ** ppvContext,
         pxCtx->xNetworkSend = pxParams->pxNetworkSend;
         pxCtx->pvCallerContext = pxParams->pvCallerContext;
 
-        /* Get the function pointer list for the PKCS#11 module. */
-        xCkGetFunctionList = C_GetFunctionList;
-        xResult = ( BaseType_t ) xCkGetFunctionList( &pxCtx->pxP11FunctionList );
-
-        /* Ensure that the PKCS #11 module is initialized and create a session. */
-        if( xResult == CKR_OK )
+        if( tlsWRITE_COMBINE_NO_MAX_AGE == pxParams->ulWriteCombineMaxAgeMs )
         {
-            xResult = xInitializePkcs11Session( &pxCtx->xP11Session );
-
-            /* It is ok if the module was previously initialized. */
-            if( ( xResult == CKR_CRYPTOKI_ALREADY_INITIALIZED ) || ( CKR_USER_ALREADY_LOGGED_IN == xResult ) )
-            {
-                xResult = CKR_OK;
-            }
+            pxCtx->xWriteMaxAgeTicks = portMAX_DELAY;
+        }
+        else if( 0U != pxParams->ulWriteCombineMaxAgeMs )
+        {
+            /* At least one tick, zero means disabled. */
+            pxCtx->xWriteMaxAgeTicks = pdMS_TO_TICKS( pxParams->ulWriteCombineMaxAgeMs ) + 1U;
         }
 
+        /* Share the PKCS #11 session, and the credentials read through it,
+         * with the other TLS contexts. */
+        xResult = ( BaseType_t ) prvCredentialsAcquire( &pxCtx->pxCredentials );
+
         if( xResult == CKR_OK )
         {
             mbedtls_ctr_drbg_init( &pxCtx->xMbedDrbgCtx );
@@ -765,11 +2227,20 @@ BaseType_t TLS_Init( void ** ppvContext,
 
 /*-----------------------------------------------------------*/
 
-BaseType_t TLS_Connect( void * pvContext )
+/**
+ * @brief Helper for configuring mbedTLS for a new handshake.
+ *
+ * @param[in] pxCtx Caller context.
+ *
+ * @return Zero on success.
+ */
+static BaseType_t prvConnectSetup( TLSContext_t * pxCtx )
 {
     BaseType_t xResult = 0;
-    CK_RV xPKCSResult = CKR_OK;
-    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    pxCtx->xPKCSResult = CKR_OK;
+    pxCtx->xSessionOffered = pdFALSE;
+    pxCtx->xCertificateVerified = pdFALSE;
 
     /* Initialize mbedTLS structures. */
     mbedtls_ssl_init( &pxCtx->xMbedSslCtx );
@@ -792,31 +2263,26 @@ BaseType_t TLS_Connect( void * pvContext )
     }
     else
     {
-        xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                          ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
-                                          tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
+        /* The default root certificates are parsed once and shared. */
+        ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
 
-        if( 0 == xResult )
+        if( pdFALSE == pxCtx->pxCredentials->xRootLoaded )
         {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                              ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
-                                              tlsATS1_ROOT_CERTIFICATE_LENGTH );
+            xResult = prvParseDefaultRootCertificates( &pxCtx->pxCredentials->xMbedX509CA );
 
             if( 0 == xResult )
             {
-                xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                                  ( const unsigned char * ) tlsATS3_ROOT_CERTIFICATE_PEM,
-                                                  tlsATS3_ROOT_CERTIFICATE_LENGTH );
-
-                if( 0 == xResult )
-                {
-                    xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                                      ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
-                                                      tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
-                }
+                pxCtx->pxCredentials->xRootLoaded = pdTRUE;
+            }
+            else
+            {
+                mbedtls_x509_crt_free( &pxCtx->pxCredentials->xMbedX509CA );
+                mbedtls_x509_crt_init( &pxCtx->pxCredentials->xMbedX509CA );
             }
         }
 
+        ( void ) xSemaphoreGive( xCredentialLock );
+
         if( 0 != xResult )
         {
             /* Default root certificates should be in aws_default_root_certificate.h */
@@ -856,7 +2322,14 @@ BaseType_t TLS_Connect( void * pvContext )
         mbedtls_ssl_conf_rng( &pxCtx->xMbedSslConfig, &prvGenerateRandomBytes, pxCtx ); /*lint !e546 Nothing wrong here. */
 
         /* Set issuer certificate. */
-        mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, &pxCtx->xMbedX509CA, NULL );
+        if( NULL != pxCtx->pcServerCertificate )
+        {
+            mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, &pxCtx->xMbedX509CA, NULL );
+        }
+        else
+        {
+            mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, &pxCtx->pxCredentials->xMbedX509CA, NULL );
+        }
 
         /* Configure the SSL context to contain device credentials (eg device cert
          * and private key) obtained from the PKCS #11 layer.  The result of
@@ -866,7 +2339,7 @@ BaseType_t TLS_Connect( void * pvContext )
          * are not loaded. This allows the TLS layer to still connect to servers
          * that do not require mutual authentication. If the server does
          * require mutual authentication, the handshake will fail. */
-        xPKCSResult = prvInitializeClientCredential( pxCtx );
+        pxCtx->xPKCSResult = prvInitializeClientCredential( pxCtx );
     }
 
     if( ( 0 == xResult ) && ( NULL != pxCtx->ppcAlpnProtocols ) )
@@ -911,6 +2384,14 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = mbedtls_ssl_set_hostname( &pxCtx->xMbedSslCtx, pxCtx->pcDestination );
     }
 
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        /* Offer the session of the previous connection to this server. */
+        if( ( 0 == xResult ) && ( NULL != pxCtx->pcDestination ) )
+        {
+            prvSessionCacheOffer( pxCtx );
+        }
+    #endif
+
     /* Set the socket callbacks. */
     if( 0 == xResult )
     {
@@ -920,44 +2401,117 @@ BaseType_t TLS_Connect( void * pvContext )
                              prvNetworkRecv,
                              NULL );
 
-        /* Negotiate. */
-        while( 0 != ( xResult = mbedtls_ssl_handshake( &pxCtx->xMbedSslCtx ) ) )
-        {
-            if( ( MBEDTLS_ERR_SSL_WANT_READ != xResult ) &&
-                ( MBEDTLS_ERR_SSL_WANT_WRITE != xResult ) )
-            {
-                /* There was an unexpected error. Per mbedTLS API documentation,
-                 * ensure that upstream clean-up code doesn't accidentally use
-                 * a context that failed the handshake. */
-                prvFreeContext( pxCtx );
+        pxCtx->xHandshakeStart = xTaskGetTickCount();
+    }
 
-                if( xPKCSResult != CKR_OK )
-                {
-                    TLS_PRINT( ( "ERROR: The handshake failed and it is likely "
-                                 "due to a failure in PKCS #11. Consider enabling "
-                                 "error logging in PKCS #11 or checking if your device "
-                                 "is properly provisioned with client credentials. "
-                                 "PKCS #11 error=0x(%0X). TLS handshake error=%s : %s \r\n",
-                                 xPKCSResult,
-                                 mbedtlsHighLevelCodeOrDefault( xResult ),
-                                 mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-                }
-                else
-                {
-                    TLS_PRINT( ( "ERROR: TLS handshake failed trying to connect. %s : %s \r\n",
-                                 mbedtlsHighLevelCodeOrDefault( xResult ),
-                                 mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-                }
+    return xResult;
+}
 
-                break;
-            }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Helper for advancing the handshake as far as the network allows.
+ *
+ * @param[in] pxCtx Caller context.
+ *
+ * @return Zero once the handshake is complete, MBEDTLS_ERR_SSL_WANT_READ or
+ * MBEDTLS_ERR_SSL_WANT_WRITE if it is waiting on the network, or another
+ * mbedTLS error code.
+ */
+static BaseType_t prvConnectStep( TLSContext_t * pxCtx )
+{
+    BaseType_t xResult = mbedtls_ssl_handshake( &pxCtx->xMbedSslCtx );
+
+    if( ( 0 != xResult ) &&
+        ( MBEDTLS_ERR_SSL_WANT_READ != xResult ) &&
+        ( MBEDTLS_ERR_SSL_WANT_WRITE != xResult ) )
+    {
+        /* There was an unexpected error. Per mbedTLS API documentation,
+         * ensure that upstream clean-up code doesn't accidentally use
+         * a context that failed the handshake. */
+        prvFreeContext( pxCtx );
+
+        if( pxCtx->xPKCSResult != CKR_OK )
+        {
+            TLS_PRINT( ( "ERROR: The handshake failed and it is likely "
+                         "due to a failure in PKCS #11. Consider enabling "
+                         "error logging in PKCS #11 or checking if your device "
+                         "is properly provisioned with client credentials. "
+                         "PKCS #11 error=0x(%0X). TLS handshake error=%s : %s \r\n",
+                         pxCtx->xPKCSResult,
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
+        }
+        else
+        {
+            TLS_PRINT( ( "ERROR: TLS handshake failed trying to connect. %s : %s \r\n",
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
         }
     }
 
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Helper for recording the outcome of a finished handshake.
+ *
+ * @param[in] pxCtx Caller context.
+ * @param[in] xResult Result of the setup or of the last handshake step.
+ *
+ * @return Zero on success. Error return codes have the high bit set.
+ */
+static BaseType_t prvConnectFinish( TLSContext_t * pxCtx,
+                                    BaseType_t xResult )
+{
+    uint32_t ulHandshakeTimeMs = 0;
+
+    pxCtx->xHandshakeStepping = pdFALSE;
+
     /* Keep track of successful completion of the handshake. */
     if( 0 == xResult )
     {
         pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_SUCCESSFUL;
+
+        if( 0U != pxCtx->xWriteMaxAgeTicks )
+        {
+            prvWriteBufferCreate( pxCtx );
+        }
+
+        ulHandshakeTimeMs = ( uint32_t ) ( ( xTaskGetTickCount() - pxCtx->xHandshakeStart ) * portTICK_PERIOD_MS );
+
+        vTaskSuspendAll();
+        {
+            if( ( pdTRUE == pxCtx->xSessionOffered ) && ( pdFALSE == pxCtx->xCertificateVerified ) )
+            {
+                xHandshakeStats.ulResumedHandshakes++;
+                xHandshakeStats.ulResumedHandshakeTimeMs += ulHandshakeTimeMs;
+            }
+            else
+            {
+                xHandshakeStats.ulFullHandshakes++;
+                xHandshakeStats.ulFullHandshakeTimeMs += ulHandshakeTimeMs;
+            }
+
+            xHandshakeStats.ulLastHandshakeTimeMs = ulHandshakeTimeMs;
+        }
+        ( void ) xTaskResumeAll();
+
+        #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+            if( NULL != pxCtx->pcDestination )
+            {
+                /* A server that rejected the offered session did a full
+                 * handshake, so the offered session is not persisted again. */
+                if( pdTRUE == pxCtx->xCertificateVerified )
+                {
+                    pxCtx->xSessionOffered = pdFALSE;
+                }
+
+                prvSessionCacheSave( pxCtx );
+            }
+        #endif
     }
     else if( xResult > 0 )
     {
@@ -966,9 +2520,92 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = TLS_ERROR_HANDSHAKE_FAILED;
     }
 
-    /* Free up allocated memory. */
-    mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
-    mbedtls_x509_crt_free( &pxCtx->xMbedX509Cli );
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        if( ( 0 != xResult ) && ( pdTRUE == pxCtx->xSessionOffered ) && ( NULL != pxCtx->pcDestination ) )
+        {
+            /* Do not offer a session which may have caused the failure again. */
+            prvSessionCacheRemove( pxCtx->pcDestination, pxCtx->ucSessionDigest );
+        }
+    #endif
+
+    /* Free up allocated memory. The shared certificates stay cached. */
+    mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_Connect( void * pvContext )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    xResult = prvConnectSetup( pxCtx );
+
+    /* Negotiate. */
+    if( 0 == xResult )
+    {
+        do
+        {
+            xResult = prvConnectStep( pxCtx );
+        } while( ( MBEDTLS_ERR_SSL_WANT_READ == xResult ) ||
+                 ( MBEDTLS_ERR_SSL_WANT_WRITE == xResult ) );
+    }
+
+    return prvConnectFinish( pxCtx, xResult );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_ConnectStart( void * pvContext )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    xResult = prvConnectSetup( pxCtx );
+
+    if( 0 == xResult )
+    {
+        pxCtx->xHandshakeStepping = pdTRUE;
+        xResult = TLS_ConnectStep( pxCtx );
+    }
+    else
+    {
+        xResult = prvConnectFinish( pxCtx, xResult );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_ConnectStep( void * pvContext )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    if( ( NULL == pxCtx ) || ( pdFALSE == pxCtx->xHandshakeStepping ) )
+    {
+        xResult = TLS_ERROR_HANDSHAKE_FAILED;
+    }
+    else
+    {
+        xResult = prvConnectStep( pxCtx );
+
+        if( MBEDTLS_ERR_SSL_WANT_READ == xResult )
+        {
+            xResult = TLS_WANT_READ;
+        }
+        else if( MBEDTLS_ERR_SSL_WANT_WRITE == xResult )
+        {
+            xResult = TLS_WANT_WRITE;
+        }
+        else
+        {
+            xResult = prvConnectFinish( pxCtx, xResult );
+        }
+    }
 
     return xResult;
 }
@@ -982,13 +2619,21 @@ BaseType_t TLS_Recv( void * pvContext,
     BaseType_t xResult = 0;
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
     size_t xRead = 0;
+    size_t xBuffered = 0;
 
-    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    if( NULL != pxCtx )
+    {
+        xResult = prvReadStart( pxCtx );
+    }
+
+    if( ( 0 <= xResult ) && ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
     {
         /* This routine will return however many bytes are returned from from mbedtls_ssl_read
          * immediately unless MBEDTLS_ERR_SSL_WANT_READ is returned, in which case we try again. */
         do
         {
+            /* Data returned while nothing is buffered comes from a new record. */
+            xBuffered = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
             xResult = mbedtls_ssl_read( &pxCtx->xMbedSslCtx,
                                         pucReadBuffer + xRead,
                                         xReadLength - xRead );
@@ -997,6 +2642,11 @@ BaseType_t TLS_Recv( void * pvContext,
             {
                 /* Got data, so update the tally and keep looping. */
                 xRead += ( size_t ) xResult;
+
+                if( 0U == xBuffered )
+                {
+                    pxCtx->xStats.ulRecordsReceived++;
+                }
             }
 
             /* If xResult == 0, then no data was received (and there is no error).
@@ -1004,11 +2654,16 @@ BaseType_t TLS_Recv( void * pvContext,
              * but don't flag an error. */
         } while( ( xResult == MBEDTLS_ERR_SSL_WANT_READ ) );
     }
-    else
+    else if( 0 <= xResult )
     {
         xResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
 
+    if( NULL != pxCtx )
+    {
+        prvReadEnd( pxCtx );
+    }
+
     if( xResult >= 0 )
     {
         xResult = ( BaseType_t ) xRead;
@@ -1024,51 +2679,220 @@ BaseType_t TLS_Recv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
-BaseType_t TLS_Send( void * pvContext,
-                     const unsigned char * pucMsg,
-                     size_t xMsgLength )
+BaseType_t TLS_RecvPeek( void * pvContext,
+                         const unsigned char ** ppucData )
 {
     BaseType_t xResult = 0;
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
-    size_t xWritten = 0;
+    unsigned char ucUnused = 0;
+    size_t xBuffered = 0;
 
-    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    if( NULL == ppucData )
+    {
+        xResult = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    else
     {
-        while( xWritten < xMsgLength )
+        *ppucData = NULL;
+
+        if( NULL != pxCtx )
         {
-            xResult = mbedtls_ssl_write( &pxCtx->xMbedSslCtx,
-                                         pucMsg + xWritten,
-                                         xMsgLength - xWritten );
+            xResult = prvReadStart( pxCtx );
+        }
 
-            if( 0 < xResult )
+        if( ( 0 <= xResult ) && ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+        {
+            xBuffered = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
+
+            if( 0U == xBuffered )
             {
-                /* Sent data, so update the tally and keep looping. */
-                xWritten += ( size_t ) xResult;
+                /* A zero length read decrypts the next record in place, in the
+                 * input buffer of mbedTLS, and leaves it there. */
+                do
+                {
+                    xResult = mbedtls_ssl_read( &pxCtx->xMbedSslCtx, &ucUnused, 0 );
+                } while( xResult == MBEDTLS_ERR_SSL_WANT_READ );
+
+                xBuffered = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
+
+                if( 0U != xBuffered )
+                {
+                    pxCtx->xStats.ulRecordsReceived++;
+                }
             }
-            else if( ( 0 == xResult ) || ( -pdFREERTOS_ERRNO_ENOSPC == xResult ) )
+        }
+        else if( 0 <= xResult )
+        {
+            xResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+        }
+
+        if( NULL != pxCtx )
+        {
+            prvReadEnd( pxCtx );
+        }
+
+        if( xResult >= 0 )
+        {
+            /* mbedTLS has no accessor for the next byte mbedtls_ssl_read would
+             * return, see the version check at the top of the file. */
+            if( 0U != xBuffered )
             {
-                /* No data sent. The secure sockets
-                 * API supports non-blocking send, so stop the loop but don't
-                 * flag an error. */
-                xResult = 0;
-                break;
+                *ppucData = pxCtx->xMbedSslCtx.in_offt;
+            }
+
+            xResult = ( BaseType_t ) xBuffered;
+        }
+        else
+        {
+            /* xResult < 0 is a hard error, so invalidate the context and stop. */
+            prvFreeContext( pxCtx );
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_RecvConsume( void * pvContext,
+                            size_t xLength )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    unsigned char ucDiscard[ tlsRECV_CONSUME_CHUNK_LENGTH ];
+    size_t xBuffered = 0;
+    size_t xConsumed = 0;
+
+    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    {
+        xBuffered = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
+
+        if( xLength > xBuffered )
+        {
+            xLength = xBuffered;
+        }
+
+        /* Reading the buffered data does not wait on the network, and erases
+         * the plaintext in mbedTLS as it is copied out. */
+        xResult = prvReadStart( pxCtx );
+
+        while( ( 0 <= xResult ) && ( xConsumed < xLength ) )
+        {
+            xResult = mbedtls_ssl_read( &pxCtx->xMbedSslCtx,
+                                        ucDiscard,
+                                        ( ( xLength - xConsumed ) < sizeof( ucDiscard ) ) ?
+                                        ( xLength - xConsumed ) : sizeof( ucDiscard ) );
+
+            if( 0 < xResult )
+            {
+                xConsumed += ( size_t ) xResult;
             }
-            else if( MBEDTLS_ERR_SSL_WANT_WRITE != xResult )
+            else if( 0 == xResult )
             {
-                /* Hard error: invalidate the context and stop. */
-                prvFreeContext( pxCtx );
+                /* The peer closed the connection, nothing is buffered. */
                 break;
             }
         }
+
+        prvReadEnd( pxCtx );
+        mbedtls_platform_zeroize( ucDiscard, sizeof( ucDiscard ) );
+
+        if( xResult >= 0 )
+        {
+            xResult = ( BaseType_t ) xConsumed;
+        }
+        else
+        {
+            /* xResult < 0 is a hard error, so invalidate the context and stop. */
+            prvFreeContext( pxCtx );
+        }
     }
     else
     {
         xResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
 
-    if( 0 <= xResult )
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_Send( void * pvContext,
+                     const unsigned char * pucMsg,
+                     size_t xMsgLength )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
     {
-        xResult = ( BaseType_t ) xWritten;
+        prvWriteLock( pxCtx );
+
+        if( 0 != pxCtx->xWriteDeadlineResult )
+        {
+            xResult = pxCtx->xWriteDeadlineResult;
+        }
+        else if( NULL != pxCtx->pucWriteBuffer )
+        {
+            xResult = prvWriteBufferSend( pxCtx, pucMsg, xMsgLength );
+        }
+        else
+        {
+            xResult = prvSslWrite( pxCtx, pucMsg, xMsgLength );
+        }
+
+        prvWriteUnlock( pxCtx );
+
+        if( xResult < 0 )
+        {
+            /* xResult < 0 is a hard error, so invalidate the context. */
+            prvFreeContext( pxCtx );
+        }
+    }
+    else
+    {
+        xResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_Flush( void * pvContext )
+{
+    BaseType_t xResult = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    {
+        prvWriteLock( pxCtx );
+
+        if( 0 != pxCtx->xWriteDeadlineResult )
+        {
+            xResult = pxCtx->xWriteDeadlineResult;
+        }
+        else if( NULL != pxCtx->pucWriteBuffer )
+        {
+            xResult = prvWriteBufferFlush( pxCtx );
+
+            if( 0 <= xResult )
+            {
+                xResult = ( BaseType_t ) pxCtx->xWriteBufferLength;
+            }
+        }
+
+        prvWriteUnlock( pxCtx );
+
+        if( xResult < 0 )
+        {
+            /* xResult < 0 is a hard error, so invalidate the context. */
+            prvFreeContext( pxCtx );
+        }
+    }
+    else
+    {
+        xResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
 
     return xResult;
@@ -1079,13 +2903,71 @@ BaseType_t TLS_Send( void * pvContext,
 void TLS_Cleanup( void * pvContext )
 {
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    BaseType_t xLastUser = pdFALSE;
 
     if( NULL != pxCtx )
     {
+        /* Send what is left before the close notification. */
+        prvWriteLock( pxCtx );
+
+        if( ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) &&
+            ( NULL != pxCtx->pucWriteBuffer ) &&
+            ( 0 == pxCtx->xWriteDeadlineResult ) )
+        {
+            ( void ) prvWriteBufferFlush( pxCtx );
+        }
+
+        prvWriteUnlock( pxCtx );
+
+        /* A stepped handshake may be abandoned before it finished. */
+        if( pdTRUE == pxCtx->xHandshakeStepping )
+        {
+            pxCtx->xHandshakeStepping = pdFALSE;
+            mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
+        }
+
         prvFreeContext( pxCtx );
 
+        #if ( tlsWRITE_DEADLINE_TIMER == 1 )
+            prvWriteDeadlineDelete( pxCtx );
+        #endif
+
+        /* The PKCS #11 session is shared, it is closed with the last context. */
+        if( NULL != pxCtx->pxCredentials )
+        {
+            prvCredentialsRelease( pxCtx->pxCredentials );
+        }
+
         /* Free memory. */
         vPortFree( pxCtx );
+
+        vTaskSuspendAll();
+        {
+            ulEntropyUsers--;
+            xLastUser = ( 0U == ulEntropyUsers ) ? pdTRUE : pdFALSE;
+        }
+        ( void ) xTaskResumeAll();
+
+        /* Close the entropy sessions with the last context. The pool keeps its
+         * bytes, and the sessions are opened again when needed. */
+        if( pdTRUE == xLastUser )
+        {
+            if( NULL != xEntropyLock )
+            {
+                ( void ) xSemaphoreTake( xEntropyLock, portMAX_DELAY );
+                prvEntropyClose( &xEntropySession );
+                ( void ) xSemaphoreGive( xEntropyLock );
+            }
+
+            #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+                if( NULL != xEntropyRefillLock )
+                {
+                    ( void ) xSemaphoreTake( xEntropyRefillLock, portMAX_DELAY );
+                    prvEntropyClose( &xEntropyRefillSession );
+                    ( void ) xSemaphoreGive( xEntropyRefillLock );
+                }
+            #endif
+        }
     }
 }
 
@@ -1095,3 +2977,166 @@ void TLS_setDateIsInThePastFunction( DateIsInThePast_t DateIsInThePast )
 {
     pDateIsInThePast = DateIsInThePast;
 }
+
+/*-----------------------------------------------------------*/
+
+void TLS_GetHandshakeStats( TLSHandshakeStats_t * pxStats )
+{
+    if( NULL != pxStats )
+    {
+        vTaskSuspendAll();
+        {
+            *pxStats = xHandshakeStats;
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_GetConnectionStats( void * pvContext,
+                             TLSConnectionStats_t * pxStats )
+{
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    if( NULL != pxStats )
+    {
+        if( NULL != pxCtx )
+        {
+            *pxStats = pxCtx->xStats;
+        }
+        else
+        {
+            memset( pxStats, 0, sizeof( TLSConnectionStats_t ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_setSessionPersistenceFunctions( TLSSessionStore_t xStore,
+                                         TLSSessionLoad_t xLoad )
+{
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        xSessionStore = xStore;
+        xSessionLoad = xLoad;
+    #else
+        ( void ) xStore;
+        ( void ) xLoad;
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_FlushSessionCache( void )
+{
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        uint32_t ulIndex;
+
+        vTaskSuspendAll();
+        {
+            for( ulIndex = 0; ulIndex < tlsconfigSESSION_CACHE_ENTRIES; ulIndex++ )
+            {
+                prvSessionCacheFreeEntry( &xSessionCache[ ulIndex ] );
+            }
+        }
+        ( void ) xTaskResumeAll();
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_FlushCredentialCache( void )
+{
+    if( NULL != xCredentialLock )
+    {
+        ( void ) xSemaphoreTake( xCredentialLock, portMAX_DELAY );
+
+        /* The detached credentials are freed by their last context. */
+        pxCredentialCache = NULL;
+
+        ( void ) xSemaphoreGive( xCredentialLock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TLS_GetEntropy( unsigned char * pucOutput,
+                           size_t xLength )
+{
+    BaseType_t xReturn = pdPASS;
+    size_t xTaken = 0;
+
+    #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+        BaseType_t xRefill = pdFALSE;
+    #endif
+
+    xReturn = prvCreateLockOnce( &xEntropyLock );
+
+    #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+        if( xReturn == pdPASS )
+        {
+            vTaskSuspendAll();
+            {
+                xTaken = ( xLength < xEntropyPoolLength ) ? xLength : xEntropyPoolLength;
+                xEntropyPoolLength -= xTaken;
+                ( void ) memcpy( pucOutput, &ucEntropyPool[ xEntropyPoolLength ], xTaken );
+                mbedtls_platform_zeroize( &ucEntropyPool[ xEntropyPoolLength ], xTaken );
+
+                if( ( xEntropyPoolLength < tlsconfigENTROPY_POOL_LOW_WATER ) &&
+                    ( xEntropyRefillPending == pdFALSE ) &&
+                    ( xEntropyPoolStarted == pdTRUE ) )
+                {
+                    xEntropyRefillPending = pdTRUE;
+                    xRefill = pdTRUE;
+                }
+            }
+            ( void ) xTaskResumeAll();
+        }
+    #endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
+
+    /* Generate what the pool could not serve directly. */
+    if( ( xReturn == pdPASS ) && ( xTaken < xLength ) )
+    {
+        ( void ) xSemaphoreTake( xEntropyLock, portMAX_DELAY );
+
+        if( prvEntropyGenerate( &xEntropySession, &pucOutput[ xTaken ], xLength - xTaken ) != CKR_OK )
+        {
+            xReturn = pdFAIL;
+        }
+
+        ( void ) xSemaphoreGive( xEntropyLock );
+    }
+
+    #if ( tlsconfigENTROPY_POOL_SIZE > 0 )
+        if( xRefill == pdTRUE )
+        {
+            if( NULL != xEntropyRefillTask )
+            {
+                ( void ) xTaskNotifyGive( xEntropyRefillTask );
+            }
+            else if( xSemaphoreTake( xEntropyRefillLock, 0 ) == pdTRUE )
+            {
+                /* Without the task, the caller refills unless a refill is
+                 * already in progress. */
+                prvEntropyPoolRefill();
+                ( void ) xSemaphoreGive( xEntropyRefillLock );
+            }
+            else
+            {
+                vTaskSuspendAll();
+                {
+                    xEntropyRefillPending = pdFALSE;
+                }
+                ( void ) xTaskResumeAll();
+            }
+        }
+    #endif /* if ( tlsconfigENTROPY_POOL_SIZE > 0 ) */
+
+    if( xReturn != pdPASS )
+    {
+        mbedtls_platform_zeroize( pucOutput, xLength );
+    }
+
+    return xReturn;
+}
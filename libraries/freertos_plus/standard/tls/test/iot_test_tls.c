@@ -26,6 +26,10 @@
 /* Standard includes. */
 #include <string.h>
 
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
 /* Test framework includes. */
 #include "unity_fixture.h"
 #include "aws_test_runner.h"
@@ -33,9 +37,13 @@
 /* Secure sockets includes */
 #include "iot_secure_sockets.h"
 
+/* TLS includes. */
+#include "iot_tls.h"
+
 /* Credential includes. */
 #include "aws_clientcredential.h"
 #include "aws_clientcredential_keys.h"
+#include "iot_default_root_certificates.h"
 #include "iot_test_tls.h"
 
 /* Configuration includes. */
@@ -85,6 +93,14 @@ TEST_TEAR_DOWN( Full_TLS )
 TEST_GROUP_RUNNER( Full_TLS )
 {
     RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectDefault );
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectResumed );
+    #endif
+    RUN_TEST_CASE( Full_TLS, AFQP_TLS_GetEntropy );
+    RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectSharedCredentials );
+    RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectStepwise );
+    RUN_TEST_CASE( Full_TLS, AFQP_TLS_RecvPeekConsume );
+    RUN_TEST_CASE( Full_TLS, AFQP_TLS_WriteCombineFlush );
     #if ( pkcs11configIMPORT_PRIVATE_KEYS_SUPPORTED == 1 )
         #if ( pkcs11testEC_KEY_SUPPORT == 1 )
             RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectEC );
@@ -135,6 +151,7 @@ static void prvConnectWithProvisioning( ProvisioningParams_t * pxProvisioningPar
     {
         /* Provision the device with the supplied parameters. */
         vAlternateKeyProvisioning( pxProvisioningParams );
+        TLS_FlushCredentialCache();
 
         /* Create socket. */
         xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
@@ -196,6 +213,7 @@ static void prvConnectWithProvisioning( ProvisioningParams_t * pxProvisioningPar
          * device with default RSA certs so that subsequent tests
          * are not changed. */
         vDevModeKeyProvisioning();
+        TLS_FlushCredentialCache();
     }
     else
     {
@@ -221,6 +239,7 @@ static void prvExpectFailAfterDataSentWithProvisioning( ProvisioningParams_t * p
     {
         /* Provision the device with the supplied parameters. */
         vAlternateKeyProvisioning( pxProvisioningParams );
+        TLS_FlushCredentialCache();
 
         /* Create socket. */
         xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
@@ -274,6 +293,7 @@ static void prvExpectFailAfterDataSentWithProvisioning( ProvisioningParams_t * p
      * device with default certs so that subsequent tests
      * are not changed. */
     vDevModeKeyProvisioning();
+    TLS_FlushCredentialCache();
 }
 /*-----------------------------------------------------------*/
 
@@ -307,6 +327,489 @@ TEST( Full_TLS, AFQP_TLS_ConnectDefault )
 }
 /*-----------------------------------------------------------*/
 
+#if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+    TEST( Full_TLS, AFQP_TLS_ConnectResumed )
+    {
+        const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+        uint16_t usAWSIoTPort = clientcredentialMQTT_BROKER_PORT;
+        SocketsSockaddr_t xMQTTServerAddress = { 0 };
+        TLSHandshakeStats_t xStatsBefore = { 0 };
+        TLSHandshakeStats_t xStatsAfter = { 0 };
+        Socket_t xSocket;
+        BaseType_t xResult;
+        BaseType_t xConnection;
+
+        xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+        xMQTTServerAddress.usPort = SOCKETS_htons( usAWSIoTPort );
+        xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+
+        /* Start from a full handshake. */
+        TLS_FlushSessionCache();
+        TLS_GetHandshakeStats( &xStatsBefore );
+
+        for( xConnection = 0; xConnection < 2; xConnection++ )
+        {
+            xSocket = prvSecureSocketCreate();
+
+            if( TEST_PROTECT() )
+            {
+                xResult = SOCKETS_SetSockOpt( xSocket, 0, SOCKETS_SO_SERVER_NAME_INDICATION, pcAWSIoTAddress, 1u + strlen( pcAWSIoTAddress ) );
+                TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket set sock opt server name indication failed" );
+
+                xResult = SOCKETS_Connect( xSocket, &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+                TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect failed" );
+
+                xResult = SOCKETS_Shutdown( xSocket, SOCKETS_SHUT_RDWR );
+                TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket disconnect failed" );
+            }
+
+            prvSecureSocketClose( xSocket );
+        }
+
+        TLS_GetHandshakeStats( &xStatsAfter );
+
+        /* The first handshake is a full one. The second one is resumed if the
+         * server accepts the session. */
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32( xStatsBefore.ulFullHandshakes + 1U, xStatsAfter.ulFullHandshakes );
+        TEST_ASSERT_EQUAL_UINT32( 2U,
+                                  ( xStatsAfter.ulFullHandshakes - xStatsBefore.ulFullHandshakes ) +
+                                  ( xStatsAfter.ulResumedHandshakes - xStatsBefore.ulResumedHandshakes ) );
+
+        configPRINTF( ( "TLS handshakes: %u full in %u ms, %u resumed in %u ms.\r\n",
+                        xStatsAfter.ulFullHandshakes - xStatsBefore.ulFullHandshakes,
+                        xStatsAfter.ulFullHandshakeTimeMs - xStatsBefore.ulFullHandshakeTimeMs,
+                        xStatsAfter.ulResumedHandshakes - xStatsBefore.ulResumedHandshakes,
+                        xStatsAfter.ulResumedHandshakeTimeMs - xStatsBefore.ulResumedHandshakeTimeMs ) );
+
+        /* A connection trusting only a root that did not sign the server
+         * certificate must not resume the cached session, and fails. */
+        xSocket = prvSecureSocketCreate();
+
+        if( TEST_PROTECT() )
+        {
+            xResult = SOCKETS_SetSockOpt( xSocket, 0, SOCKETS_SO_SERVER_NAME_INDICATION, pcAWSIoTAddress, 1u + strlen( pcAWSIoTAddress ) );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket set sock opt server name indication failed" );
+
+            xResult = SOCKETS_SetSockOpt( xSocket, 0, SOCKETS_SO_TRUSTED_SERVER_CERTIFICATE, tlsATS2_ROOT_CERTIFICATE_PEM, tlsATS2_ROOT_CERTIFICATE_LENGTH );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket set sock opt trusted server certificate failed" );
+
+            xResult = SOCKETS_Connect( xSocket, &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+            TEST_ASSERT_NOT_EQUAL_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect resumed a session negotiated under other trust settings" );
+        }
+
+        prvSecureSocketClose( xSocket );
+    }
+#endif /* if ( tlsconfigSESSION_CACHE_ENTRIES > 0 ) */
+/*-----------------------------------------------------------*/
+
+TEST( Full_TLS, AFQP_TLS_ConnectSharedCredentials )
+{
+    const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+    uint16_t usAWSIoTPort = clientcredentialMQTT_BROKER_PORT;
+    SocketsSockaddr_t xMQTTServerAddress = { 0 };
+    Socket_t xSockets[ 2 ] = { SOCKETS_INVALID_SOCKET, SOCKETS_INVALID_SOCKET };
+    TickType_t xConnectTicks[ 2 ] = { 0 };
+    TickType_t xStart;
+    BaseType_t xResult;
+    BaseType_t xIndex;
+
+    xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+    xMQTTServerAddress.usPort = SOCKETS_htons( usAWSIoTPort );
+    xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+
+    /* The second connection reuses the PKCS #11 session and the parsed
+     * certificates of the first one while it is open. */
+    if( TEST_PROTECT() )
+    {
+        for( xIndex = 0; xIndex < 2; xIndex++ )
+        {
+            xSockets[ xIndex ] = prvSecureSocketCreate();
+
+            xResult = SOCKETS_SetSockOpt( xSockets[ xIndex ], 0, SOCKETS_SO_SERVER_NAME_INDICATION, pcAWSIoTAddress, 1u + strlen( pcAWSIoTAddress ) );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket set sock opt server name indication failed" );
+
+            xStart = xTaskGetTickCount();
+            xResult = SOCKETS_Connect( xSockets[ xIndex ], &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+            xConnectTicks[ xIndex ] = xTaskGetTickCount() - xStart;
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect failed" );
+        }
+
+        configPRINTF( ( "TLS connect: first %u ms, second %u ms.\r\n",
+                        ( uint32_t ) ( xConnectTicks[ 0 ] * portTICK_PERIOD_MS ),
+                        ( uint32_t ) ( xConnectTicks[ 1 ] * portTICK_PERIOD_MS ) ) );
+    }
+
+    for( xIndex = 0; xIndex < 2; xIndex++ )
+    {
+        if( xSockets[ xIndex ] != SOCKETS_INVALID_SOCKET )
+        {
+            ( void ) SOCKETS_Shutdown( xSockets[ xIndex ], SOCKETS_SHUT_RDWR );
+            prvSecureSocketClose( xSockets[ xIndex ] );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPlainSocketRecv( void * pvCallerContext,
+                                      unsigned char * pucReceiveBuffer,
+                                      size_t xReceiveLength )
+{
+    return SOCKETS_Recv( ( Socket_t ) pvCallerContext, pucReceiveBuffer, xReceiveLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPlainSocketSend( void * pvCallerContext,
+                                      const unsigned char * pucData,
+                                      size_t xDataLength )
+{
+    return SOCKETS_Send( ( Socket_t ) pvCallerContext, pucData, xDataLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+TEST( Full_TLS, AFQP_TLS_ConnectStepwise )
+{
+    const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+    uint16_t usAWSIoTPort = clientcredentialMQTT_BROKER_PORT;
+    SocketsSockaddr_t xMQTTServerAddress = { 0 };
+    Socket_t xSockets[ 2 ] = { SOCKETS_INVALID_SOCKET, SOCKETS_INVALID_SOCKET };
+    void * pvTLSContexts[ 2 ] = { NULL, NULL };
+    BaseType_t xStatus[ 2 ] = { 0 };
+    TLSParams_t xTLSParams = { 0 };
+    TickType_t xStart;
+    BaseType_t xResult;
+    BaseType_t xIndex;
+    BaseType_t xPending;
+
+    xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+    xMQTTServerAddress.usPort = SOCKETS_htons( usAWSIoTPort );
+    xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+
+    /* One task drives both handshakes over non-blocking TCP sockets. */
+    if( TEST_PROTECT() )
+    {
+        for( xIndex = 0; xIndex < 2; xIndex++ )
+        {
+            xSockets[ xIndex ] = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+            TEST_ASSERT_NOT_EQUAL( xSockets[ xIndex ], SOCKETS_INVALID_SOCKET );
+
+            xResult = SOCKETS_Connect( xSockets[ xIndex ], &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect failed" );
+
+            xResult = SOCKETS_SetSockOpt( xSockets[ xIndex ], 0, SOCKETS_SO_NONBLOCK, NULL, 0 );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket set sock opt nonblock failed" );
+
+            xTLSParams.ulSize = sizeof( xTLSParams );
+            xTLSParams.pcDestination = pcAWSIoTAddress;
+            xTLSParams.pxNetworkRecv = prvPlainSocketRecv;
+            xTLSParams.pxNetworkSend = prvPlainSocketSend;
+            xTLSParams.pvCallerContext = xSockets[ xIndex ];
+
+            xResult = TLS_Init( &pvTLSContexts[ xIndex ], &xTLSParams );
+            TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS init failed" );
+
+            xStatus[ xIndex ] = TLS_ConnectStart( pvTLSContexts[ xIndex ] );
+            TEST_ASSERT_GREATER_OR_EQUAL_INT32_MESSAGE( 0, xStatus[ xIndex ], "TLS connect start failed" );
+        }
+
+        xStart = xTaskGetTickCount();
+
+        do
+        {
+            xPending = pdFALSE;
+
+            for( xIndex = 0; xIndex < 2; xIndex++ )
+            {
+                if( ( TLS_WANT_READ == xStatus[ xIndex ] ) || ( TLS_WANT_WRITE == xStatus[ xIndex ] ) )
+                {
+                    xStatus[ xIndex ] = TLS_ConnectStep( pvTLSContexts[ xIndex ] );
+                    TEST_ASSERT_GREATER_OR_EQUAL_INT32_MESSAGE( 0, xStatus[ xIndex ], "TLS connect step failed" );
+                    xPending |= ( 0 != xStatus[ xIndex ] ) ? pdTRUE : pdFALSE;
+                }
+            }
+
+            if( pdTRUE == xPending )
+            {
+                TEST_ASSERT_LESS_THAN_UINT32_MESSAGE( pdMS_TO_TICKS( 30000 ),
+                                                      xTaskGetTickCount() - xStart,
+                                                      "TLS handshakes timed out" );
+                vTaskDelay( 1 );
+            }
+        } while( pdTRUE == xPending );
+    }
+
+    for( xIndex = 0; xIndex < 2; xIndex++ )
+    {
+        if( NULL != pvTLSContexts[ xIndex ] )
+        {
+            TLS_Cleanup( pvTLSContexts[ xIndex ] );
+        }
+
+        if( xSockets[ xIndex ] != SOCKETS_INVALID_SOCKET )
+        {
+            ( void ) SOCKETS_Shutdown( xSockets[ xIndex ], SOCKETS_SHUT_RDWR );
+            prvSecureSocketClose( xSockets[ xIndex ] );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+TEST( Full_TLS, AFQP_TLS_RecvPeekConsume )
+{
+    const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+    uint16_t usAWSIoTPort = clientcredentialMQTT_BROKER_PORT;
+    const char * pcClientId = clientcredentialIOT_THING_NAME;
+    SocketsSockaddr_t xMQTTServerAddress = { 0 };
+    Socket_t xSocket = SOCKETS_INVALID_SOCKET;
+    void * pvTLSContext = NULL;
+    TLSParams_t xTLSParams = { 0 };
+    uint8_t ucConnect[ 128 ];
+    size_t xConnectLength = 0;
+    const unsigned char * pucData = NULL;
+    const unsigned char * pucPeeked = NULL;
+    TickType_t xStart;
+    BaseType_t xResult;
+    BaseType_t xAvailable;
+
+    xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+    xMQTTServerAddress.usPort = SOCKETS_htons( usAWSIoTPort );
+    xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+
+    /* MQTT CONNECT with a clean session and a 60 s keep-alive, to which the
+     * broker answers with a 4 byte CONNACK. */
+    TEST_ASSERT_LESS_THAN_UINT32( sizeof( ucConnect ) - 14U, strlen( pcClientId ) );
+    ucConnect[ xConnectLength++ ] = 0x10;
+    ucConnect[ xConnectLength++ ] = ( uint8_t ) ( 12U + strlen( pcClientId ) );
+    memcpy( &ucConnect[ xConnectLength ], "\x00\x04MQTT\x04\x02\x00\x3c", 10 );
+    xConnectLength += 10U;
+    ucConnect[ xConnectLength++ ] = 0x00;
+    ucConnect[ xConnectLength++ ] = ( uint8_t ) strlen( pcClientId );
+    memcpy( &ucConnect[ xConnectLength ], pcClientId, strlen( pcClientId ) );
+    xConnectLength += strlen( pcClientId );
+
+    if( TEST_PROTECT() )
+    {
+        xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+        TEST_ASSERT_NOT_EQUAL( xSocket, SOCKETS_INVALID_SOCKET );
+
+        xResult = SOCKETS_Connect( xSocket, &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect failed" );
+
+        xTLSParams.ulSize = sizeof( xTLSParams );
+        xTLSParams.pcDestination = pcAWSIoTAddress;
+        xTLSParams.pxNetworkRecv = prvPlainSocketRecv;
+        xTLSParams.pxNetworkSend = prvPlainSocketSend;
+        xTLSParams.pvCallerContext = xSocket;
+
+        xResult = TLS_Init( &pvTLSContext, &xTLSParams );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS init failed" );
+
+        xResult = TLS_Connect( pvTLSContext );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS connect failed" );
+
+        xResult = TLS_Send( pvTLSContext, ucConnect, xConnectLength );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( xConnectLength, xResult, "TLS send failed" );
+
+        /* Zero means the receive timed out before the CONNACK arrived. */
+        xStart = xTaskGetTickCount();
+
+        do
+        {
+            xAvailable = TLS_RecvPeek( pvTLSContext, &pucData );
+            TEST_ASSERT_GREATER_OR_EQUAL_INT32_MESSAGE( 0, xAvailable, "TLS peek failed" );
+            TEST_ASSERT_LESS_THAN_UINT32_MESSAGE( pdMS_TO_TICKS( 30000 ),
+                                                  xTaskGetTickCount() - xStart,
+                                                  "No CONNACK received" );
+        } while( 0 == xAvailable );
+
+        TEST_ASSERT_GREATER_OR_EQUAL_INT32( 4, xAvailable );
+        TEST_ASSERT_EQUAL_HEX8( 0x20, pucData[ 0 ] );
+        TEST_ASSERT_EQUAL_HEX8( 0x02, pucData[ 1 ] );
+
+        /* The data stays in place until it is consumed. */
+        pucPeeked = pucData;
+        TEST_ASSERT_EQUAL_INT32( xAvailable, TLS_RecvPeek( pvTLSContext, &pucData ) );
+        TEST_ASSERT_EQUAL_PTR( pucPeeked, pucData );
+
+        TEST_ASSERT_EQUAL_INT32( 2, TLS_RecvConsume( pvTLSContext, 2 ) );
+        TEST_ASSERT_EQUAL_INT32( xAvailable - 2, TLS_RecvPeek( pvTLSContext, &pucData ) );
+        TEST_ASSERT_EQUAL_PTR( pucPeeked + 2, pucData );
+
+        TEST_ASSERT_EQUAL_INT32( xAvailable - 2, TLS_RecvConsume( pvTLSContext, xAvailable ) );
+    }
+
+    if( NULL != pvTLSContext )
+    {
+        TLS_Cleanup( pvTLSContext );
+    }
+
+    if( xSocket != SOCKETS_INVALID_SOCKET )
+    {
+        ( void ) SOCKETS_Shutdown( xSocket, SOCKETS_SHUT_RDWR );
+        prvSecureSocketClose( xSocket );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Receive exactly xLength bytes, waiting up to 30 seconds for them.
+ */
+static void prvTlsRecvAll( void * pvTLSContext,
+                           unsigned char * pucBuffer,
+                           size_t xLength )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    size_t xReceived = 0;
+    BaseType_t xResult;
+
+    /* Zero means the receive timed out before the data arrived. */
+    while( xReceived < xLength )
+    {
+        xResult = TLS_Recv( pvTLSContext, &pucBuffer[ xReceived ], xLength - xReceived );
+        TEST_ASSERT_GREATER_OR_EQUAL_INT32_MESSAGE( 0, xResult, "TLS receive failed" );
+        TEST_ASSERT_LESS_THAN_UINT32_MESSAGE( pdMS_TO_TICKS( 30000 ),
+                                              xTaskGetTickCount() - xStart,
+                                              "No answer received" );
+        xReceived += ( size_t ) xResult;
+    }
+}
+/*-----------------------------------------------------------*/
+
+TEST( Full_TLS, AFQP_TLS_WriteCombineFlush )
+{
+    const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+    uint16_t usAWSIoTPort = clientcredentialMQTT_BROKER_PORT;
+    const char * pcClientId = clientcredentialIOT_THING_NAME;
+    const unsigned char ucPingReq[ 2 ] = { 0xC0, 0x00 };
+    SocketsSockaddr_t xMQTTServerAddress = { 0 };
+    Socket_t xSocket = SOCKETS_INVALID_SOCKET;
+    void * pvTLSContext = NULL;
+    TLSParams_t xTLSParams = { 0 };
+    TLSConnectionStats_t xStats = { 0 };
+    uint32_t ulRecordsSent = 0;
+    uint8_t ucConnect[ 128 ];
+    size_t xConnectLength = 0;
+    unsigned char ucAnswer[ 4 ] = { 0 };
+    BaseType_t xResult;
+
+    xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+    xMQTTServerAddress.usPort = SOCKETS_htons( usAWSIoTPort );
+    xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+
+    /* MQTT CONNECT with a clean session and a 60 s keep-alive, to which the
+     * broker answers with a 4 byte CONNACK. */
+    TEST_ASSERT_LESS_THAN_UINT32( sizeof( ucConnect ) - 14U, strlen( pcClientId ) );
+    ucConnect[ xConnectLength++ ] = 0x10;
+    ucConnect[ xConnectLength++ ] = ( uint8_t ) ( 12U + strlen( pcClientId ) );
+    memcpy( &ucConnect[ xConnectLength ], "\x00\x04MQTT\x04\x02\x00\x3c", 10 );
+    xConnectLength += 10U;
+    ucConnect[ xConnectLength++ ] = 0x00;
+    ucConnect[ xConnectLength++ ] = ( uint8_t ) strlen( pcClientId );
+    memcpy( &ucConnect[ xConnectLength ], pcClientId, strlen( pcClientId ) );
+    xConnectLength += strlen( pcClientId );
+
+    if( TEST_PROTECT() )
+    {
+        xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+        TEST_ASSERT_NOT_EQUAL( xSocket, SOCKETS_INVALID_SOCKET );
+
+        xResult = SOCKETS_Connect( xSocket, &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( SOCKETS_ERROR_NONE, xResult, "Socket connect failed" );
+
+        /* Only TLS_Flush and TLS_Recv send the combined writes. */
+        xTLSParams.ulSize = sizeof( xTLSParams );
+        xTLSParams.pcDestination = pcAWSIoTAddress;
+        xTLSParams.pxNetworkRecv = prvPlainSocketRecv;
+        xTLSParams.pxNetworkSend = prvPlainSocketSend;
+        xTLSParams.pvCallerContext = xSocket;
+        xTLSParams.ulWriteCombineMaxAgeMs = tlsWRITE_COMBINE_NO_MAX_AGE;
+
+        xResult = TLS_Init( &pvTLSContext, &xTLSParams );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS init failed" );
+
+        xResult = TLS_Connect( pvTLSContext );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS connect failed" );
+
+        TLS_GetConnectionStats( pvTLSContext, &xStats );
+        ulRecordsSent = xStats.ulRecordsSent;
+
+        /* Two small writes are buffered, not sent. */
+        xResult = TLS_Send( pvTLSContext, ucConnect, 2 );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 2, xResult, "TLS send failed" );
+        xResult = TLS_Send( pvTLSContext, &ucConnect[ 2 ], xConnectLength - 2U );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( xConnectLength - 2U, xResult, "TLS send failed" );
+
+        TLS_GetConnectionStats( pvTLSContext, &xStats );
+        TEST_ASSERT_EQUAL_UINT32( ulRecordsSent, xStats.ulRecordsSent );
+
+        /* TLS_Flush sends them as one record, which the broker answers. */
+        xResult = TLS_Flush( pvTLSContext );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS flush failed" );
+
+        TLS_GetConnectionStats( pvTLSContext, &xStats );
+        TEST_ASSERT_EQUAL_UINT32( ulRecordsSent + 1U, xStats.ulRecordsSent );
+
+        prvTlsRecvAll( pvTLSContext, ucAnswer, 4 );
+        TEST_ASSERT_EQUAL_HEX8( 0x20, ucAnswer[ 0 ] );
+        TEST_ASSERT_EQUAL_HEX8( 0x02, ucAnswer[ 1 ] );
+
+        /* A buffered PINGREQ is sent by the TLS_Recv waiting for its answer. */
+        xResult = TLS_Send( pvTLSContext, ucPingReq, sizeof( ucPingReq ) );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( sizeof( ucPingReq ), xResult, "TLS send failed" );
+
+        TLS_GetConnectionStats( pvTLSContext, &xStats );
+        TEST_ASSERT_EQUAL_UINT32( ulRecordsSent + 1U, xStats.ulRecordsSent );
+
+        prvTlsRecvAll( pvTLSContext, ucAnswer, 2 );
+        TEST_ASSERT_EQUAL_HEX8( 0xD0, ucAnswer[ 0 ] );
+        TEST_ASSERT_EQUAL_HEX8( 0x00, ucAnswer[ 1 ] );
+
+        TLS_GetConnectionStats( pvTLSContext, &xStats );
+        TEST_ASSERT_EQUAL_UINT32( ulRecordsSent + 2U, xStats.ulRecordsSent );
+    }
+
+    if( NULL != pvTLSContext )
+    {
+        TLS_Cleanup( pvTLSContext );
+    }
+
+    if( xSocket != SOCKETS_INVALID_SOCKET )
+    {
+        ( void ) SOCKETS_Shutdown( xSocket, SOCKETS_SHUT_RDWR );
+        prvSecureSocketClose( xSocket );
+    }
+}
+/*-----------------------------------------------------------*/
+
+TEST( Full_TLS, AFQP_TLS_GetEntropy )
+{
+    unsigned char ucFirst[ 32 ] = { 0 };
+    unsigned char ucSecond[ 32 ] = { 0 };
+    unsigned char * pucLarge = NULL;
+    size_t xLargeLength = tlsconfigENTROPY_POOL_SIZE + 64U;
+    BaseType_t xRequest;
+
+    /* Small requests drain the pool past the refill level. */
+    for( xRequest = 0; xRequest < 16; xRequest++ )
+    {
+        TEST_ASSERT_EQUAL_INT32( pdPASS, TLS_GetEntropy( ucFirst, sizeof( ucFirst ) ) );
+        TEST_ASSERT_EQUAL_INT32( pdPASS, TLS_GetEntropy( ucSecond, sizeof( ucSecond ) ) );
+        TEST_ASSERT_FALSE_MESSAGE( 0 == memcmp( ucFirst, ucSecond, sizeof( ucFirst ) ),
+                                   "Consecutive entropy requests returned the same bytes" );
+    }
+
+    /* A request larger than the pool is completed from the token. */
+    pucLarge = pvPortMalloc( xLargeLength );
+    TEST_ASSERT_NOT_NULL( pucLarge );
+
+    if( TEST_PROTECT() )
+    {
+        TEST_ASSERT_EQUAL_INT32( pdPASS, TLS_GetEntropy( pucLarge, xLargeLength ) );
+    }
+
+    vPortFree( pucLarge );
+}
+/*-----------------------------------------------------------*/
+
 TEST( Full_TLS, AFQP_TLS_ConnectEC )
 {
     ProvisioningParams_t xParams;
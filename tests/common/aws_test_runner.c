@@ -138,6 +138,10 @@ static void RunTestSuites( void )
         RUN_TEST_GROUP( Full_POSIX_STRESS );
     #endif
 
+    #if ( testrunnerFULL_POSIX_BENCHMARK_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_POSIX_BENCHMARK );
+    #endif
+
     #if ( testrunnerUTIL_PLATFORM_CLOCK_ENABLED == 1 )
         RUN_TEST_GROUP( UTIL_Platform_Clock );
     #endif
@@ -184,6 +188,10 @@ static void RunTestSuites( void )
         RUN_TEST_GROUP( coreMQTT_Integration_AWS_IoT_Compatible );
     #endif
 
+    #if ( testrunnerFULL_CORE_MQTT_AGENT_BENCHMARK_ENABLED == 1 )
+        RUN_TEST_GROUP( coreMQTT_Agent_Benchmark );
+    #endif
+
     #if ( testrunnerFULL_CORE_HTTP_ENABLED == 1 )
         RUN_TEST_GROUP( coreHTTP_Integration );
     #endif
@@ -0,0 +1,968 @@
+/*
+ * FreeRTOS V202203.00
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file core_mqtt_agent_benchmark.c
+ * @brief Throughput and latency benchmark for the coreMQTT Agent running over
+ * the Secure Sockets transport against a local MQTT broker.
+ *
+ * The benchmark connects a single MQTT agent (set up the same way as
+ * demos/coreMQTT_Agent/mqtt_agent_task.c) to a broker, subscribes to its own
+ * benchmark topic tree and then, for each combination of payload size, QoS
+ * and publisher task count, lets the publisher tasks publish through the agent
+ * while the incoming publish callback timestamps the echoed messages.
+ *
+ * Each run is reported as a single line of JSON (JSON Lines) through
+ * configPRINTF, for example:
+ *
+ * {"benchmark":"coreMQTT_Agent","payload":256,"qos":1,"publishers":2,
+ *  "sent":200,"received":200,"elapsed_us":41000,"msgs_per_sec":4878,
+ *  "bytes_per_sec":1248780,"latency_us":{"min":1000,"p50":7000,"p99":12000,
+ *  "max":13000,"avg":7210}}
+ *
+ * By default the benchmark connects without TLS to a broker on the loopback
+ * interface, e.g. one started with:
+ *
+ *     mosquitto -p 1883 -v
+ *
+ * Latency resolution is limited by MQTT_AGENT_BENCHMARK_GET_TIME_US(), which
+ * defaults to the RTOS tick.  Ports with a free running high resolution
+ * counter should override it.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/* Unity Test framework include. */
+#include "unity_fixture.h"
+
+/* Include connection configurations header. */
+#include "aws_clientcredential.h"
+
+/* Include header for root CA certificates. */
+#include "iot_default_root_certificates.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for the benchmark.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for the
+ * benchmark.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the benchmark. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "BENCH"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+#include "logging_stack.h"
+
+/* The logging configuration macros are defined above to ensure they are not
+ * superceded by definitions in the following header files. */
+
+/* Include the secure sockets implementation of the transport interface. */
+#include "transport_secure_sockets.h"
+
+/* MQTT agent include. */
+#include "core_mqtt_agent.h"
+
+/* MQTT Agent ports. */
+#include "freertos_agent_message.h"
+#include "freertos_command_pool.h"
+
+/**************Default Configurations values***********************/
+
+/**
+ * @brief Host name of the broker to benchmark against. Defaults to a broker,
+ * such as mosquitto, listening on the loopback interface.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_BROKER_ENDPOINT
+    #define MQTT_AGENT_BENCHMARK_BROKER_ENDPOINT    "127.0.0.1"
+#endif
+
+/**
+ * @brief Port of the broker to benchmark against.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_BROKER_PORT
+    #define MQTT_AGENT_BENCHMARK_BROKER_PORT    ( 1883 )
+#endif
+
+/**
+ * @brief Set to 1 to run the benchmark over TLS. When enabled, the client
+ * credentials from aws_clientcredential_keys.h and
+ * MQTT_AGENT_BENCHMARK_ROOT_CA_CERT are used.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_USE_TLS
+    #define MQTT_AGENT_BENCHMARK_USE_TLS    ( 0 )
+#endif
+
+/**
+ * @brief Root CA used to authenticate the broker when TLS is enabled.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_ROOT_CA_CERT
+    #define MQTT_AGENT_BENCHMARK_ROOT_CA_CERT    tlsSTARFIELD_ROOT_CERTIFICATE_PEM
+#endif
+
+/**
+ * @brief Client identifier for the benchmark MQTT connection.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_CLIENT_IDENTIFIER
+    #define MQTT_AGENT_BENCHMARK_CLIENT_IDENTIFIER    clientcredentialIOT_THING_NAME "-bench"
+#endif
+
+/**
+ * @brief Comma separated list of payload sizes, in bytes, to sweep. Every
+ * size must be at least sizeof( BenchmarkHeader_t ) and no more than
+ * MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_PAYLOAD_SIZES
+    #define MQTT_AGENT_BENCHMARK_PAYLOAD_SIZES    16U, 256U, 1024U, 4096U
+#endif
+
+/**
+ * @brief Comma separated list of QoS levels to sweep. The broker must support
+ * QoS 2 for it to be included.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_QOS_LEVELS
+    #define MQTT_AGENT_BENCHMARK_QOS_LEVELS    MQTTQoS0, MQTTQoS1, MQTTQoS2
+#endif
+
+/**
+ * @brief Comma separated list of publisher task counts to sweep. No entry
+ * may exceed MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_PUBLISHER_COUNTS
+    #define MQTT_AGENT_BENCHMARK_PUBLISHER_COUNTS    1U, 2U, 4U
+#endif
+
+/**
+ * @brief The largest payload size used in any run.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE
+    #define MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief The largest number of publisher tasks used in any run.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS
+    #define MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS    ( 4U )
+#endif
+
+/**
+ * @brief Number of messages each publisher task sends per run.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER
+    #define MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER    ( 100U )
+#endif
+
+/**
+ * @brief Size of the network buffer used by the agent. Must hold the largest
+ * incoming PUBLISH packet.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_NETWORK_BUFFER_SIZE
+    #define MQTT_AGENT_BENCHMARK_NETWORK_BUFFER_SIZE    ( MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE + 256U )
+#endif
+
+/**
+ * @brief The length of the queue used to hold commands for the agent.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_COMMAND_QUEUE_LENGTH
+    #define MQTT_AGENT_BENCHMARK_COMMAND_QUEUE_LENGTH    ( 10 )
+#endif
+
+/**
+ * @brief Stack size, in words, of the agent and publisher tasks.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_TASK_STACK_SIZE
+    #define MQTT_AGENT_BENCHMARK_TASK_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 8 )
+#endif
+
+/**
+ * @brief Current time in microseconds. Only differences between two readings
+ * are used, so the counter may wrap.
+ */
+#ifndef MQTT_AGENT_BENCHMARK_GET_TIME_US
+    #define MQTT_AGENT_BENCHMARK_GET_TIME_US()    ( ( uint32_t ) xTaskGetTickCount() * ( 1000000UL / configTICK_RATE_HZ ) )
+#endif
+
+/**********************End Configurations********************************/
+
+/**
+ * @brief Topic prefix of the benchmark. Each publisher task publishes to
+ * its own topic below the prefix.
+ */
+#define BENCHMARK_TOPIC_PREFIX             MQTT_AGENT_BENCHMARK_CLIENT_IDENTIFIER "/bench/"
+
+/**
+ * @brief Topic filter that covers all publisher topics.
+ */
+#define BENCHMARK_TOPIC_FILTER             BENCHMARK_TOPIC_PREFIX "#"
+
+/**
+ * @brief Size of the buffer holding a publisher topic name.
+ */
+#define BENCHMARK_TOPIC_BUFFER_LENGTH      ( sizeof( BENCHMARK_TOPIC_PREFIX ) + 4U )
+
+/**
+ * @brief Total number of latency samples that may be collected in a run.
+ */
+#define BENCHMARK_MAX_SAMPLES              ( MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS * MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER )
+
+/**
+ * @brief Time to wait for a single command to complete.
+ */
+#define BENCHMARK_COMMAND_TIMEOUT_MS       ( 10000U )
+
+/**
+ * @brief Time to wait, after all publishers finished, for the remaining
+ * messages to be echoed back by the broker.
+ */
+#define BENCHMARK_DRAIN_TIMEOUT_MS         ( 5000U )
+
+/**
+ * @brief Block time used when posting commands to the agent.
+ */
+#define BENCHMARK_COMMAND_BLOCK_TIME_MS    ( 500U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milli seconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS            ( 5000U )
+
+/**
+ * @brief Time interval in seconds at which an MQTT PINGREQ need to be sent to
+ * broker.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS   ( 60U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS     ( 750U )
+
+/**
+ * @brief Milliseconds per FreeRTOS tick.
+ */
+#define MILLISECONDS_PER_TICK              ( 1000U / configTICK_RATE_HZ )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ * It should contain a single pointer to the type of your desired transport.
+ * When using multiple transports in the same compilation unit, define this pointer as void *.
+ *
+ * @note Transport stacks are defined in amazon-freertos/libraries/abstractions/transport/secure_sockets/transport_secure_sockets.h.
+ */
+struct NetworkContext
+{
+    SecureSocketsTransportParams_t * pParams;
+};
+
+/**
+ * @brief Command callback context used to signal the task that issued a
+ * command to the agent.
+ */
+struct MQTTAgentCommandContext
+{
+    MQTTStatus_t xReturnStatus;
+    TaskHandle_t xTaskToNotify;
+};
+
+/**
+ * @brief Header placed at the start of each benchmark payload so that the
+ * incoming publish callback can compute the round-trip latency.
+ */
+typedef struct BenchmarkHeader
+{
+    uint32_t ulRunId;
+    uint32_t ulSendTimeUs;
+} BenchmarkHeader_t;
+
+/**
+ * @brief Parameters of one benchmark run.
+ */
+typedef struct BenchmarkRun
+{
+    uint32_t ulRunId;
+    size_t xPayloadSize;
+    MQTTQoS_t xQoS;
+    uint32_t ulPublishers;
+} BenchmarkRun_t;
+
+/**
+ * @brief Per publisher task state.
+ */
+typedef struct BenchmarkPublisher
+{
+    const BenchmarkRun_t * pxRun;
+    TaskHandle_t xParentTask;
+    uint32_t ulPublished;
+    uint32_t ulFailed;
+    char cTopic[ BENCHMARK_TOPIC_BUFFER_LENGTH ];
+    uint8_t ucPayload[ MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE ];
+} BenchmarkPublisher_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The timer query function provided to the MQTT context.
+ *
+ * @return Time in milliseconds.
+ */
+static uint32_t prvGetTimeMs( void );
+
+/**
+ * @brief Connect the transport and establish the MQTT session.
+ *
+ * @return `true` if both the transport and MQTT connections succeeded.
+ */
+static bool prvConnectToBroker( void );
+
+/**
+ * @brief Passed into SOCKETS_SetSockOpt() as the callback to execute when
+ * there is data on the socket available for reading.
+ *
+ * @param[in] pxSocket The handle of the socket.
+ */
+static void prvSocketWakeupCallback( Socket_t pxSocket );
+
+/**
+ * @brief Incoming publish callback of the agent. Records the round-trip
+ * latency of every benchmark message belonging to the current run.
+ *
+ * @param[in] pxMqttAgentContext Agent context.
+ * @param[in] usPacketId Packet ID of publish.
+ * @param[in] pxPublishInfo Info of incoming publish.
+ */
+static void prvIncomingPublishCallback( MQTTAgentContext_t * pxMqttAgentContext,
+                                        uint16_t usPacketId,
+                                        MQTTPublishInfo_t * pxPublishInfo );
+
+/**
+ * @brief Command completion callback that notifies the issuing task.
+ *
+ * @param[in] pxCommandContext Context of the initial command.
+ * @param[in] pxReturnInfo The result of the command.
+ */
+static void prvCommandCallback( MQTTAgentCommandContext_t * pxCommandContext,
+                                MQTTAgentReturnInfo_t * pxReturnInfo );
+
+/**
+ * @brief Task that runs the MQTT agent command loop until the agent is
+ * terminated or disconnected.
+ *
+ * @param[in] pvParameters Handle of the task to notify on exit.
+ */
+static void prvMQTTAgentTask( void * pvParameters );
+
+/**
+ * @brief Task that publishes MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER
+ * messages through the agent.
+ *
+ * @param[in] pvParameters Pointer to the #BenchmarkPublisher_t of the task.
+ */
+static void prvPublisherTask( void * pvParameters );
+
+/**
+ * @brief Execute one benchmark run and print its result.
+ *
+ * @param[in] pxRun Parameters of the run.
+ */
+static void prvExecuteRun( const BenchmarkRun_t * pxRun );
+
+/**
+ * @brief Comparison function for sorting latency samples with qsort().
+ */
+static int prvCompareSamples( const void * pvLeft,
+                              const void * pvRight );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Payload sizes to sweep.
+ */
+static const size_t xPayloadSizes[] = { MQTT_AGENT_BENCHMARK_PAYLOAD_SIZES };
+
+/**
+ * @brief QoS levels to sweep.
+ */
+static const MQTTQoS_t xQoSLevels[] = { MQTT_AGENT_BENCHMARK_QOS_LEVELS };
+
+/**
+ * @brief Publisher task counts to sweep.
+ */
+static const uint32_t ulPublisherCounts[] = { MQTT_AGENT_BENCHMARK_PUBLISHER_COUNTS };
+
+/**
+ * @brief The network context used by the agent.
+ */
+static NetworkContext_t xNetworkContext;
+
+/**
+ * @brief The parameters for the network context.
+ */
+static SecureSocketsTransportParams_t xSecureSocketsTransportParams;
+
+/**
+ * @brief The agent context used by the benchmark.
+ */
+static MQTTAgentContext_t xAgentContext;
+
+/**
+ * @brief Network buffer of the agent.
+ */
+static uint8_t ucNetworkBuffer[ MQTT_AGENT_BENCHMARK_NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief Message queue used to deliver commands to the agent task.
+ */
+static MQTTAgentMessageContext_t xCommandQueue;
+
+/**
+ * @brief State of the publisher tasks.
+ */
+static BenchmarkPublisher_t xPublishers[ MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS ];
+
+/**
+ * @brief Latency samples of the current run. Only written by the agent task.
+ */
+static uint32_t ulLatencySamples[ BENCHMARK_MAX_SAMPLES ];
+
+/**
+ * @brief Number of valid entries in ulLatencySamples.
+ */
+static volatile uint32_t ulReceivedCount = 0U;
+
+/**
+ * @brief Identifier of the run in progress. Messages tagged with another
+ * identifier (e.g. late QoS retransmissions) are ignored.
+ */
+static volatile uint32_t ulCurrentRunId = 0U;
+
+/**
+ * @brief Handle of the task executing the test case.
+ */
+static TaskHandle_t xTestTask = NULL;
+
+/**
+ * @brief Reference timestamp for prvGetTimeMs().
+ */
+static uint32_t ulGlobalEntryTimeMs = 0U;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGetTimeMs( void )
+{
+    uint32_t ulTimeMs = ( uint32_t ) xTaskGetTickCount() * MILLISECONDS_PER_TICK;
+
+    return ( uint32_t ) ( ulTimeMs - ulGlobalEntryTimeMs );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvConnectToBroker( void )
+{
+    ServerInfo_t xServerInfo = { 0 };
+    SocketsConfig_t xSocketsConfig = { 0 };
+    MQTTConnectInfo_t xConnectInfo = { 0 };
+    TransportSocketStatus_t xTransportStatus;
+    MQTTStatus_t xMqttStatus = MQTTBadParameter;
+    bool xSessionPresent = false;
+    const TickType_t xTransportTimeout = 1UL;
+
+    xServerInfo.pHostName = MQTT_AGENT_BENCHMARK_BROKER_ENDPOINT;
+    xServerInfo.hostNameLength = sizeof( MQTT_AGENT_BENCHMARK_BROKER_ENDPOINT ) - 1U;
+    xServerInfo.port = MQTT_AGENT_BENCHMARK_BROKER_PORT;
+
+    #if ( MQTT_AGENT_BENCHMARK_USE_TLS == 1 )
+        xSocketsConfig.enableTls = true;
+        xSocketsConfig.pRootCa = MQTT_AGENT_BENCHMARK_ROOT_CA_CERT;
+        xSocketsConfig.rootCaSize = sizeof( MQTT_AGENT_BENCHMARK_ROOT_CA_CERT );
+    #else
+        xSocketsConfig.enableTls = false;
+    #endif
+    xSocketsConfig.disableSni = true;
+    xSocketsConfig.sendTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    xSocketsConfig.recvTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+
+    xTransportStatus = SecureSocketsTransport_Connect( &xNetworkContext,
+                                                       &xServerInfo,
+                                                       &xSocketsConfig );
+
+    if( xTransportStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
+    {
+        xConnectInfo.cleanSession = true;
+        xConnectInfo.pClientIdentifier = MQTT_AGENT_BENCHMARK_CLIENT_IDENTIFIER;
+        xConnectInfo.clientIdentifierLength = ( uint16_t ) ( sizeof( MQTT_AGENT_BENCHMARK_CLIENT_IDENTIFIER ) - 1U );
+        xConnectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+        xMqttStatus = MQTT_Connect( &( xAgentContext.mqttContext ),
+                                    &xConnectInfo,
+                                    NULL,
+                                    CONNACK_RECV_TIMEOUT_MS,
+                                    &xSessionPresent );
+
+        if( xMqttStatus == MQTTSuccess )
+        {
+            /* Let the socket wake the agent as soon as data arrives, the same
+             * way the MQTT agent demo does. */
+            ( void ) SOCKETS_SetSockOpt( xNetworkContext.pParams->tcpSocket,
+                                         0,
+                                         SOCKETS_SO_WAKEUP_CALLBACK,
+                                         ( void * ) prvSocketWakeupCallback,
+                                         sizeof( void * ) );
+
+            ( void ) SOCKETS_SetSockOpt( xNetworkContext.pParams->tcpSocket,
+                                         0,
+                                         SOCKETS_SO_RCVTIMEO,
+                                         &xTransportTimeout,
+                                         sizeof( TickType_t ) );
+        }
+        else
+        {
+            LogError( ( "MQTT connection to the benchmark broker failed: %s",
+                        MQTT_Status_strerror( xMqttStatus ) ) );
+            ( void ) SecureSocketsTransport_Disconnect( &xNetworkContext );
+        }
+    }
+    else
+    {
+        LogError( ( "Could not connect to the benchmark broker %s:%d.",
+                    MQTT_AGENT_BENCHMARK_BROKER_ENDPOINT,
+                    MQTT_AGENT_BENCHMARK_BROKER_PORT ) );
+    }
+
+    return( xMqttStatus == MQTTSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSocketWakeupCallback( Socket_t pxSocket )
+{
+    MQTTAgentCommandInfo_t xCommandParams = { 0 };
+
+    ( void ) pxSocket;
+
+    if( uxQueueMessagesWaiting( xCommandQueue.queue ) == 0U )
+    {
+        ( void ) MQTTAgent_ProcessLoop( &xAgentContext, &xCommandParams );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvIncomingPublishCallback( MQTTAgentContext_t * pxMqttAgentContext,
+                                        uint16_t usPacketId,
+                                        MQTTPublishInfo_t * pxPublishInfo )
+{
+    BenchmarkHeader_t xHeader;
+    uint32_t ulNow = MQTT_AGENT_BENCHMARK_GET_TIME_US();
+    uint32_t ulCount;
+
+    ( void ) pxMqttAgentContext;
+    ( void ) usPacketId;
+
+    if( pxPublishInfo->payloadLength >= sizeof( BenchmarkHeader_t ) )
+    {
+        ( void ) memcpy( &xHeader, pxPublishInfo->pPayload, sizeof( BenchmarkHeader_t ) );
+        ulCount = ulReceivedCount;
+
+        if( ( xHeader.ulRunId == ulCurrentRunId ) && ( ulCount < BENCHMARK_MAX_SAMPLES ) )
+        {
+            ulLatencySamples[ ulCount ] = ulNow - xHeader.ulSendTimeUs;
+            ulReceivedCount = ulCount + 1U;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCommandCallback( MQTTAgentCommandContext_t * pxCommandContext,
+                                MQTTAgentReturnInfo_t * pxReturnInfo )
+{
+    pxCommandContext->xReturnStatus = pxReturnInfo->returnCode;
+
+    if( pxCommandContext->xTaskToNotify != NULL )
+    {
+        ( void ) xTaskNotifyGive( pxCommandContext->xTaskToNotify );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvMQTTAgentTask( void * pvParameters )
+{
+    TaskHandle_t xTaskToNotify = ( TaskHandle_t ) pvParameters;
+    MQTTStatus_t xStatus;
+
+    xStatus = MQTTAgent_CommandLoop( &xAgentContext );
+
+    if( xStatus != MQTTSuccess )
+    {
+        LogError( ( "MQTT agent command loop exited with error: %s",
+                    MQTT_Status_strerror( xStatus ) ) );
+    }
+
+    /* The wakeup callback must not fire once the socket is torn down. */
+    ( void ) SOCKETS_SetSockOpt( xNetworkContext.pParams->tcpSocket,
+                                 0,
+                                 SOCKETS_SO_WAKEUP_CALLBACK,
+                                 NULL,
+                                 sizeof( void * ) );
+
+    if( xAgentContext.mqttContext.connectStatus == MQTTConnected )
+    {
+        ( void ) MQTT_Disconnect( &( xAgentContext.mqttContext ) );
+    }
+
+    ( void ) SecureSocketsTransport_Disconnect( &xNetworkContext );
+
+    xTaskNotifyGive( xTaskToNotify );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPublisherTask( void * pvParameters )
+{
+    BenchmarkPublisher_t * pxPublisher = ( BenchmarkPublisher_t * ) pvParameters;
+    const BenchmarkRun_t * pxRun = pxPublisher->pxRun;
+    MQTTAgentCommandContext_t xCommandContext = { 0 };
+    MQTTAgentCommandInfo_t xCommandParams = { 0 };
+    MQTTPublishInfo_t xPublishInfo = { 0 };
+    BenchmarkHeader_t xHeader;
+    MQTTStatus_t xStatus;
+    uint32_t ulMessage;
+
+    xPublishInfo.qos = pxRun->xQoS;
+    xPublishInfo.pTopicName = pxPublisher->cTopic;
+    xPublishInfo.topicNameLength = ( uint16_t ) strlen( pxPublisher->cTopic );
+    xPublishInfo.pPayload = pxPublisher->ucPayload;
+    xPublishInfo.payloadLength = pxRun->xPayloadSize;
+
+    xCommandContext.xTaskToNotify = xTaskGetCurrentTaskHandle();
+    xCommandParams.blockTimeMs = BENCHMARK_COMMAND_BLOCK_TIME_MS;
+    xCommandParams.cmdCompleteCallback = prvCommandCallback;
+    xCommandParams.pCmdCompleteCallbackContext = &xCommandContext;
+
+    xHeader.ulRunId = pxRun->ulRunId;
+
+    for( ulMessage = 0U; ulMessage < MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER; ulMessage++ )
+    {
+        xHeader.ulSendTimeUs = MQTT_AGENT_BENCHMARK_GET_TIME_US();
+        ( void ) memcpy( pxPublisher->ucPayload, &xHeader, sizeof( BenchmarkHeader_t ) );
+
+        xCommandContext.xReturnStatus = MQTTSendFailed;
+        xStatus = MQTTAgent_Publish( &xAgentContext, &xPublishInfo, &xCommandParams );
+
+        /* The payload buffer is reused, so wait for the agent to finish with
+         * it before building the next message. */
+        if( ( xStatus == MQTTSuccess ) &&
+            ( ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( BENCHMARK_COMMAND_TIMEOUT_MS ) ) != 0U ) &&
+            ( xCommandContext.xReturnStatus == MQTTSuccess ) )
+        {
+            pxPublisher->ulPublished++;
+        }
+        else
+        {
+            pxPublisher->ulFailed++;
+        }
+    }
+
+    xTaskNotifyGive( pxPublisher->xParentTask );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareSamples( const void * pvLeft,
+                              const void * pvRight )
+{
+    uint32_t ulLeft = *( ( const uint32_t * ) pvLeft );
+    uint32_t ulRight = *( ( const uint32_t * ) pvRight );
+
+    return ( ulLeft > ulRight ) - ( ulLeft < ulRight );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvExecuteRun( const BenchmarkRun_t * pxRun )
+{
+    uint32_t ulIndex, ulExpected, ulSent = 0U, ulFailed = 0U, ulReceived;
+    uint32_t ulStartUs, ulElapsedUs, ulWaited = 0U;
+    uint64_t ullLatencySum = 0U;
+    uint32_t ulMessagesPerSecond = 0U, ulBytesPerSecond = 0U;
+    uint32_t ulMin = 0U, ulP50 = 0U, ulP99 = 0U, ulMax = 0U, ulAvg = 0U;
+    char cTaskName[ configMAX_TASK_NAME_LEN ];
+
+    ulExpected = pxRun->ulPublishers * MQTT_AGENT_BENCHMARK_MESSAGES_PER_PUBLISHER;
+
+    ulReceivedCount = 0U;
+    ulCurrentRunId = pxRun->ulRunId;
+
+    ulStartUs = MQTT_AGENT_BENCHMARK_GET_TIME_US();
+
+    for( ulIndex = 0U; ulIndex < pxRun->ulPublishers; ulIndex++ )
+    {
+        xPublishers[ ulIndex ].pxRun = pxRun;
+        xPublishers[ ulIndex ].xParentTask = xTestTask;
+        xPublishers[ ulIndex ].ulPublished = 0U;
+        xPublishers[ ulIndex ].ulFailed = 0U;
+        ( void ) snprintf( xPublishers[ ulIndex ].cTopic,
+                           sizeof( xPublishers[ ulIndex ].cTopic ),
+                           BENCHMARK_TOPIC_PREFIX "%u",
+                           ( unsigned int ) ulIndex );
+        ( void ) memset( xPublishers[ ulIndex ].ucPayload, 0xA5, pxRun->xPayloadSize );
+
+        ( void ) snprintf( cTaskName, sizeof( cTaskName ), "BenchPub%u", ( unsigned int ) ulIndex );
+        TEST_ASSERT_EQUAL( pdPASS, xTaskCreate( prvPublisherTask,
+                                                cTaskName,
+                                                MQTT_AGENT_BENCHMARK_TASK_STACK_SIZE,
+                                                &xPublishers[ ulIndex ],
+                                                tskIDLE_PRIORITY + 1,
+                                                NULL ) );
+    }
+
+    /* Wait for every publisher to finish. */
+    for( ulIndex = 0U; ulIndex < pxRun->ulPublishers; ulIndex++ )
+    {
+        ( void ) ulTaskNotifyTake( pdFALSE, portMAX_DELAY );
+        ulSent += xPublishers[ ulIndex ].ulPublished;
+        ulFailed += xPublishers[ ulIndex ].ulFailed;
+    }
+
+    /* Wait for the broker to echo back the remaining messages. */
+    while( ( ulReceivedCount < ulSent ) && ( ulWaited < BENCHMARK_DRAIN_TIMEOUT_MS ) )
+    {
+        vTaskDelay( pdMS_TO_TICKS( 10U ) );
+        ulWaited += 10U;
+    }
+
+    ulElapsedUs = MQTT_AGENT_BENCHMARK_GET_TIME_US() - ulStartUs;
+
+    /* Ignore anything still in flight from here on. */
+    ulCurrentRunId = 0U;
+    ulReceived = ulReceivedCount;
+
+    if( ulReceived > 0U )
+    {
+        qsort( ulLatencySamples, ulReceived, sizeof( uint32_t ), prvCompareSamples );
+
+        for( ulIndex = 0U; ulIndex < ulReceived; ulIndex++ )
+        {
+            ullLatencySum += ulLatencySamples[ ulIndex ];
+        }
+
+        ulMin = ulLatencySamples[ 0 ];
+        ulP50 = ulLatencySamples[ ( ulReceived * 50U ) / 100U ];
+        ulP99 = ulLatencySamples[ ( ( ulReceived * 99U ) / 100U < ulReceived ) ? ( ulReceived * 99U ) / 100U : ulReceived - 1U ];
+        ulMax = ulLatencySamples[ ulReceived - 1U ];
+        ulAvg = ( uint32_t ) ( ullLatencySum / ulReceived );
+    }
+
+    if( ulElapsedUs > 0U )
+    {
+        ulMessagesPerSecond = ( uint32_t ) ( ( ( uint64_t ) ulReceived * 1000000U ) / ulElapsedUs );
+        ulBytesPerSecond = ( uint32_t ) ( ( ( uint64_t ) ulReceived * pxRun->xPayloadSize * 1000000U ) / ulElapsedUs );
+    }
+
+    configPRINTF( ( "{\"benchmark\":\"coreMQTT_Agent\",\"payload\":%u,\"qos\":%u,\"publishers\":%u,"
+                    "\"expected\":%u,\"sent\":%u,\"failed\":%u,\"received\":%u,\"elapsed_us\":%u,"
+                    "\"msgs_per_sec\":%u,\"bytes_per_sec\":%u,"
+                    "\"latency_us\":{\"min\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u,\"avg\":%u}}\r\n",
+                    ( unsigned int ) pxRun->xPayloadSize,
+                    ( unsigned int ) pxRun->xQoS,
+                    ( unsigned int ) pxRun->ulPublishers,
+                    ( unsigned int ) ulExpected,
+                    ( unsigned int ) ulSent,
+                    ( unsigned int ) ulFailed,
+                    ( unsigned int ) ulReceived,
+                    ( unsigned int ) ulElapsedUs,
+                    ( unsigned int ) ulMessagesPerSecond,
+                    ( unsigned int ) ulBytesPerSecond,
+                    ( unsigned int ) ulMin,
+                    ( unsigned int ) ulP50,
+                    ( unsigned int ) ulP99,
+                    ( unsigned int ) ulMax,
+                    ( unsigned int ) ulAvg ) );
+
+    /* Every publish must have been accepted by the agent. Only QoS 1 and 2
+     * guarantee delivery, so only those runs require every message back. */
+    TEST_ASSERT_EQUAL( ulExpected, ulSent );
+
+    if( pxRun->xQoS != MQTTQoS0 )
+    {
+        TEST_ASSERT_EQUAL( ulSent, ulReceived );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+TEST_GROUP( coreMQTT_Agent_Benchmark );
+
+TEST_SETUP( coreMQTT_Agent_Benchmark )
+{
+    static uint8_t ucQueueStorageArea[ MQTT_AGENT_BENCHMARK_COMMAND_QUEUE_LENGTH * sizeof( MQTTAgentCommand_t * ) ];
+    static StaticQueue_t xQueueStructure;
+    static MQTTSubscribeInfo_t xSubscribeInfo;
+    static MQTTAgentSubscribeArgs_t xSubscribeArgs;
+    MQTTAgentCommandContext_t xCommandContext = { 0 };
+    MQTTAgentCommandInfo_t xCommandParams = { 0 };
+    MQTTFixedBuffer_t xFixedBuffer = { .pBuffer = ucNetworkBuffer, .size = MQTT_AGENT_BENCHMARK_NETWORK_BUFFER_SIZE };
+    TransportInterface_t xTransport = { 0 };
+    MQTTAgentMessageInterface_t xMessageInterface =
+    {
+        .pMsgCtx        = NULL,
+        .send           = Agent_MessageSend,
+        .recv           = Agent_MessageReceive,
+        .getCommand     = Agent_GetCommand,
+        .releaseCommand = Agent_ReleaseCommand
+    };
+
+    xTestTask = xTaskGetCurrentTaskHandle();
+    ulGlobalEntryTimeMs = ( uint32_t ) xTaskGetTickCount() * MILLISECONDS_PER_TICK;
+    xNetworkContext.pParams = &xSecureSocketsTransportParams;
+
+    if( xCommandQueue.queue == NULL )
+    {
+        xCommandQueue.queue = xQueueCreateStatic( MQTT_AGENT_BENCHMARK_COMMAND_QUEUE_LENGTH,
+                                                  sizeof( MQTTAgentCommand_t * ),
+                                                  ucQueueStorageArea,
+                                                  &xQueueStructure );
+    }
+
+    TEST_ASSERT_NOT_NULL( xCommandQueue.queue );
+    xQueueReset( xCommandQueue.queue );
+    xMessageInterface.pMsgCtx = &xCommandQueue;
+
+    Agent_InitializePool();
+
+    xTransport.pNetworkContext = &xNetworkContext;
+    xTransport.send = SecureSocketsTransport_Send;
+    xTransport.recv = SecureSocketsTransport_Recv;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTTAgent_Init( &xAgentContext,
+                                                    &xMessageInterface,
+                                                    &xFixedBuffer,
+                                                    &xTransport,
+                                                    prvGetTimeMs,
+                                                    prvIncomingPublishCallback,
+                                                    NULL ) );
+
+    TEST_ASSERT_TRUE( prvConnectToBroker() );
+
+    /* The agent task runs above the publishers so its command queue drains. */
+    TEST_ASSERT_EQUAL( pdPASS, xTaskCreate( prvMQTTAgentTask,
+                                            "BenchAgent",
+                                            MQTT_AGENT_BENCHMARK_TASK_STACK_SIZE,
+                                            xTestTask,
+                                            tskIDLE_PRIORITY + 2,
+                                            NULL ) );
+
+    /* Subscribe to every publisher topic at the highest QoS so the broker
+     * echoes each message back at the QoS it was published with. */
+    xSubscribeInfo.qos = MQTTQoS2;
+    xSubscribeInfo.pTopicFilter = BENCHMARK_TOPIC_FILTER;
+    xSubscribeInfo.topicFilterLength = ( uint16_t ) ( sizeof( BENCHMARK_TOPIC_FILTER ) - 1U );
+    xSubscribeArgs.pSubscribeInfo = &xSubscribeInfo;
+    xSubscribeArgs.numSubscriptions = 1U;
+
+    xCommandContext.xReturnStatus = MQTTSendFailed;
+    xCommandContext.xTaskToNotify = xTestTask;
+    xCommandParams.blockTimeMs = BENCHMARK_COMMAND_BLOCK_TIME_MS;
+    xCommandParams.cmdCompleteCallback = prvCommandCallback;
+    xCommandParams.pCmdCompleteCallbackContext = &xCommandContext;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTTAgent_Subscribe( &xAgentContext, &xSubscribeArgs, &xCommandParams ) );
+    TEST_ASSERT_NOT_EQUAL( 0U, ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( BENCHMARK_COMMAND_TIMEOUT_MS ) ) );
+    TEST_ASSERT_EQUAL( MQTTSuccess, xCommandContext.xReturnStatus );
+}
+
+TEST_TEAR_DOWN( coreMQTT_Agent_Benchmark )
+{
+    MQTTAgentCommandInfo_t xCommandParams = { 0 };
+
+    xCommandParams.blockTimeMs = BENCHMARK_COMMAND_BLOCK_TIME_MS;
+
+    /* The agent task disconnects and notifies this task once it exits. */
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTTAgent_Terminate( &xAgentContext, &xCommandParams ) );
+    TEST_ASSERT_NOT_EQUAL( 0U, ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( BENCHMARK_COMMAND_TIMEOUT_MS ) ) );
+}
+
+/* ========================== Test Cases ============================ */
+
+TEST_GROUP_RUNNER( coreMQTT_Agent_Benchmark )
+{
+    RUN_TEST_CASE( coreMQTT_Agent_Benchmark, Throughput_Latency_Sweep );
+}
+
+/**
+ * @brief Sweep every combination of payload size, QoS and publisher count
+ * and print one JSON result line per combination.
+ */
+TEST( coreMQTT_Agent_Benchmark, Throughput_Latency_Sweep )
+{
+    BenchmarkRun_t xRun = { 0 };
+    size_t xPayloadIndex, xQoSIndex, xPublisherIndex;
+
+    for( xPayloadIndex = 0U; xPayloadIndex < ( sizeof( xPayloadSizes ) / sizeof( xPayloadSizes[ 0 ] ) ); xPayloadIndex++ )
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL( sizeof( BenchmarkHeader_t ), xPayloadSizes[ xPayloadIndex ] );
+        TEST_ASSERT_LESS_OR_EQUAL( MQTT_AGENT_BENCHMARK_MAX_PAYLOAD_SIZE, xPayloadSizes[ xPayloadIndex ] );
+
+        for( xQoSIndex = 0U; xQoSIndex < ( sizeof( xQoSLevels ) / sizeof( xQoSLevels[ 0 ] ) ); xQoSIndex++ )
+        {
+            for( xPublisherIndex = 0U; xPublisherIndex < ( sizeof( ulPublisherCounts ) / sizeof( ulPublisherCounts[ 0 ] ) ); xPublisherIndex++ )
+            {
+                TEST_ASSERT_LESS_OR_EQUAL( MQTT_AGENT_BENCHMARK_MAX_PUBLISHERS, ulPublisherCounts[ xPublisherIndex ] );
+
+                /* Run identifiers start at 1 because 0 marks "no run". */
+                xRun.ulRunId++;
+                xRun.xPayloadSize = xPayloadSizes[ xPayloadIndex ];
+                xRun.xQoS = xQoSLevels[ xQoSIndex ];
+                xRun.ulPublishers = ulPublisherCounts[ xPublisherIndex ];
+
+                prvExecuteRun( &xRun );
+            }
+        }
+    }
+}
@@ -56,4 +56,9 @@
 #define socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS       4
 #define socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH    300
 
+/**
+ * @brief Use SOCKETS_Sendv() in the Secure Sockets transport.
+ */
+#define socketsconfigSENDV_SUPPORTED                      ( 1 )
+
 #endif /* _IOT_SECURE_SOCKETS_CONFIG_H_ */
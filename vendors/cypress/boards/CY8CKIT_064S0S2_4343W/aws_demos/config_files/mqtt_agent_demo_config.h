@@ -108,10 +108,10 @@
  */
 
 /**
- * @brief Maximum number of subscriptions maintained by the subscription manager
- * simultaneously in a list.
+ * @brief Number of subscriptions, or of topic trie nodes, the subscription
+ * manager allocates at once when its pool runs out of free entries.
  *
- * #define SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS    ( insert here. )
+ * #define SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH    ( insert here. )
  */
 
 /**
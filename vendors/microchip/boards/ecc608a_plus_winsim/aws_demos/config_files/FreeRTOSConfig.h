@@ -58,7 +58,7 @@
 #define configUSE_APPLICATION_TASK_TAG             1
 #define configUSE_COUNTING_SEMAPHORES              1
 #define configUSE_ALTERNATIVE_API                  0
-#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    3      /* FreeRTOS+FAT requires 2 pointers if a CWD is supported. */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    10     /* FreeRTOS+FAT requires 2 pointers if a CWD is supported, FreeRTOS+POSIX pthread keys use the rest. */
 #define configRECORD_STACK_HIGH_ADDRESS            1
 
 /* Hook function related definitions. */
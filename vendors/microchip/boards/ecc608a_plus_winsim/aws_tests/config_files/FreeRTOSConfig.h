@@ -60,7 +60,7 @@
 #define configUSE_APPLICATION_TASK_TAG             1
 #define configUSE_COUNTING_SEMAPHORES              1
 #define configUSE_ALTERNATIVE_API                  0
-#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    3      /* FreeRTOS+FAT requires 2 pointers if a CWD is supported. */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    10     /* FreeRTOS+FAT requires 2 pointers if a CWD is supported, FreeRTOS+POSIX pthread keys use the rest. */
 #define configRECORD_STACK_HIGH_ADDRESS            1
 
 /* Hook function related definitions. */
@@ -85,6 +85,11 @@ void vConfigureTimerForRunTimeStats( void );
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vConfigureTimerForRunTimeStats()
 #define portGET_RUN_TIME_COUNTER_VALUE()            ulGetRunTimeCounterValue()
 
+/* The FreeRTOS+POSIX and coreMQTT Agent benchmarks time with the run time
+ * counter, which counts in 10 microsecond units. */
+#define posixtestBENCHMARK_GET_TIME_US()            ( ( uint32_t ) ulGetRunTimeCounterValue() * 10UL )
+#define MQTT_AGENT_BENCHMARK_GET_TIME_US()          ( ( uint32_t ) ulGetRunTimeCounterValue() * 10UL )
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
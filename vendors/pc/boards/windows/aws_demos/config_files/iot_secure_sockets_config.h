@@ -53,4 +53,14 @@
  */
 #define AWS_IOT_SECURE_SOCKETS_METRICS_ENABLED    ( 1 )
 
+/**
+ * @brief The FreeRTOS+TCP port provides SOCKETS_Sendv().
+ */
+#define socketsconfigSENDV_SUPPORTED              ( 1 )
+
+/**
+ * @brief Keep the addresses of the MQTT, HTTP and S3 endpoints between connections.
+ */
+#define socketsconfigDNS_CACHE_ENTRIES            ( 4 )
+
 #endif /* _IOT_SECURE_SOCKETS_CONFIG_H_ */
\ No newline at end of file
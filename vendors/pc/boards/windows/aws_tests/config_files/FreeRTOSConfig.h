@@ -60,8 +60,9 @@
 #define configUSE_APPLICATION_TASK_TAG             1
 #define configUSE_COUNTING_SEMAPHORES              1
 #define configUSE_ALTERNATIVE_API                  0
-#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    3      /* FreeRTOS+FAT requires 2 pointers if a CWD is supported. */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    10     /* FreeRTOS+FAT requires 2 pointers if a CWD is supported, FreeRTOS+POSIX pthread keys use the rest. */
 #define configRECORD_STACK_HIGH_ADDRESS            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES      2      /* FreeRTOS+POSIX wakes blocked threads on the last index. */
 
 /* Hook function related definitions. */
 #define configUSE_TICK_HOOK                        0
@@ -85,6 +86,11 @@ void vConfigureTimerForRunTimeStats( void );
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vConfigureTimerForRunTimeStats()
 #define portGET_RUN_TIME_COUNTER_VALUE()            ulGetRunTimeCounterValue()
 
+/* The FreeRTOS+POSIX and coreMQTT Agent benchmarks time with the run time
+ * counter, which counts in 10 microsecond units. */
+#define posixtestBENCHMARK_GET_TIME_US()            ( ( uint32_t ) ulGetRunTimeCounterValue() * 10UL )
+#define MQTT_AGENT_BENCHMARK_GET_TIME_US()          ( ( uint32_t ) ulGetRunTimeCounterValue() * 10UL )
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
@@ -239,4 +245,10 @@ extern uint32_t ulRand();
 /* Header required for the tracealyzer recorder library. */
 #include "trcRecorder.h"
 
+/* Number of TLS sessions kept for resumption, see iot_tls.h. */
+#define tlsconfigSESSION_CACHE_ENTRIES    ( 2 )
+
+/* Bytes of PKCS #11 randomness buffered for TLS and TCP, see iot_tls.h. */
+#define tlsconfigENTROPY_POOL_SIZE    ( 256 )
+
 #endif /* FREERTOS_CONFIG_H */
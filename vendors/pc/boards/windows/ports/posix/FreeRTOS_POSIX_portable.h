@@ -31,7 +31,8 @@
 #ifndef _FREERTOS_POSIX_PORTABLE_H_
 #define _FREERTOS_POSIX_PORTABLE_H_
 
-/* This port uses the defaults in FreeRTOS_POSIX_portable_default.h, so this
- * file is empty. */
+/* FreeRTOS+FAT may use thread local storage pointers 0 and 1, so pthread keys
+ * use the remaining pointers. */
+#define posixconfigPTHREAD_KEY_TLS_INDEX    2
 
 #endif /* _FREERTOS_POSIX_PORTABLE_H_ */